@@ -0,0 +1,386 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "Arena.h"
+#include "Numa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+PageSize Arena::pageSize = PageSize::BASE;
+std::atomic<size_t> Arena::mappedBytes[static_cast<int>(ArenaUse::COUNT)][static_cast<int>(PageSize::COUNT)] = {};
+thread_local int Arena::node = -1;
+
+/**
+ * Names of the uses of arenas printed in the report.
+ */
+static const char *const USE_NAMES[] = {"Orders", "Limits", "Order index", "Other"};
+
+/**
+ * Round a size up to a whole number of pages.
+ *
+ * @param size Number of bytes
+ * @param pageBytes Bytes in a page, a power of two
+ * @return Size rounded up to the page
+ */
+static size_t roundUp(size_t size, size_t pageBytes) {
+    return (size + pageBytes - 1) & ~(pageBytes - 1);
+}
+
+/**
+ * Reserve address space aligned to a page with base pages, by over-mapping by a page and trimming both ends.
+ *
+ * @param size Number of bytes to reserve, a whole number of pages
+ * @param pageBytes Bytes in a page, a power of two
+ * @return Start of the reservation, nullptr if it could not be mapped
+ */
+static void *reserveAligned(size_t size, size_t pageBytes) {
+    void *memory = mmap(nullptr, size + pageBytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    auto start = reinterpret_cast<uintptr_t>(memory);
+    uintptr_t aligned = roundUp(start, pageBytes);
+    if (aligned != start) {
+        munmap(memory, aligned - start);
+    }
+    munmap(reinterpret_cast<void *>(aligned + size), start + pageBytes - aligned);
+    return reinterpret_cast<void *>(aligned);
+}
+
+/**
+ * Getter for boolean indicating if the kernel honours transparent huge page hints, read from sysfs. Assumed to if
+ * the setting cannot be read.
+ *
+ * @return Whether transparent huge pages are not disabled
+ */
+static bool isTransparentEnabled() {
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string setting;
+    if (!std::getline(file, setting)) {
+        return true;
+    }
+    return setting.find("[never]") == std::string::npos;
+}
+
+/**
+ * Setter for the page size requested for new mappings.
+ *
+ * @param newPageSize New page size
+ */
+void Arena::setPageSize(PageSize newPageSize) {
+    Arena::pageSize = newPageSize;
+}
+
+/**
+ * Getter for the page size requested for new mappings.
+ *
+ * @return Page size requested
+ */
+PageSize Arena::getPageSize() {
+    return pageSize;
+}
+
+/**
+ * Setter for the NUMA node new mappings of the calling thread are bound to.
+ *
+ * @param newNode Node to bind to, -1 for first touch placement
+ */
+void Arena::setNode(int newNode) {
+    Arena::node = newNode;
+}
+
+/**
+ * Getter for the NUMA node new mappings of the calling thread are bound to.
+ *
+ * @return Node bound to, -1 for first touch placement
+ */
+int Arena::getNode() {
+    return node;
+}
+
+/**
+ * Getter for the number of bytes in a page. Transparent huge page mappings are aligned to and sized in 2 MB pages.
+ *
+ * @param pageSize Page size
+ * @return Bytes in a page
+ */
+size_t Arena::getPageBytes(PageSize pageSize) {
+    switch (pageSize) {
+        case PageSize::HUGE_1GB:
+            return size_t(1) << 30;
+        case PageSize::HUGE_2MB:
+        case PageSize::TRANSPARENT:
+            return size_t(1) << 21;
+        case PageSize::BASE:
+        default:
+            return size_t(1) << 12;
+    }
+}
+
+/**
+ * Getter for the name of a page size.
+ *
+ * @param pageSize Page size
+ * @return Name of the page size
+ */
+const char *Arena::getPageSizeName(PageSize pageSize) {
+    switch (pageSize) {
+        case PageSize::HUGE_1GB:
+            return "1 GB pages";
+        case PageSize::HUGE_2MB:
+            return "2 MB pages";
+        case PageSize::TRANSPARENT:
+            return "transparent huge pages";
+        case PageSize::BASE:
+        default:
+            return "base pages";
+    }
+}
+
+/**
+ * Try to map memory with one page size. Hugetlb pages are reserved when mapped, so the mapping fails rather than
+ * faulting later if there are not enough free huge pages. Base and transparent mappings only reserve address space.
+ * A transparent mapping is over-mapped by a page so it can be trimmed to a 2 MB aligned start, and fails if
+ * transparent huge pages are disabled or the hint is refused.
+ *
+ * @param size Number of bytes to map, rounded up to the page size
+ * @param pageSize Page size to map with
+ * @return Start of the mapping, nullptr if it could not be mapped
+ */
+void *Arena::tryMap(size_t size, PageSize pageSize) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    switch (pageSize) {
+        case PageSize::HUGE_1GB:
+        case PageSize::HUGE_2MB: {
+#ifdef MAP_HUGETLB
+            int shift = pageSize == PageSize::HUGE_1GB ? 30 : 21;
+            void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | shift << MAP_HUGE_SHIFT,
+                                -1, 0);
+            return memory == MAP_FAILED ? nullptr : memory;
+#else
+            return nullptr;
+#endif
+        }
+        case PageSize::TRANSPARENT: {
+#ifdef MADV_HUGEPAGE
+            if (!isTransparentEnabled()) {
+                return nullptr;
+            }
+            void *memory = reserveAligned(size, getPageBytes(pageSize));
+            if (memory == nullptr) {
+                return nullptr;
+            }
+            if (madvise(memory, size, MADV_HUGEPAGE) != 0) {
+                munmap(memory, size);
+                return nullptr;
+            }
+            return memory;
+#else
+            return nullptr;
+#endif
+        }
+        case PageSize::BASE:
+        default: {
+            void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags | MAP_NORESERVE, -1, 0);
+            return memory == MAP_FAILED ? nullptr : memory;
+        }
+    }
+}
+
+/**
+ * Maps zeroed memory, trying the requested page size first and then each smaller page size, down to base pages.
+ * Page sizes larger than the mapping are skipped, so small arrays never take a whole huge page. The bytes mapped are
+ * counted against the page size obtained. If the calling thread set a NUMA node the mapping is bound to it before any
+ * page is touched, and left to first touch if binding fails. Throws std::bad_alloc if even base pages cannot be mapped.
+ *
+ * @param size Number of bytes to map
+ * @param use Storage the memory is used for
+ * @param obtained Page size the memory was mapped with
+ * @return Start of the mapping
+ */
+void *Arena::map(size_t size, ArenaUse use, PageSize &obtained) {
+    for (int i = static_cast<int>(pageSize); i < static_cast<int>(PageSize::COUNT); i++) {
+        auto candidate = static_cast<PageSize>(i);
+        size_t pageBytes = getPageBytes(candidate);
+        if (candidate != PageSize::BASE && size < pageBytes) {
+            continue;
+        }
+        void *memory = tryMap(roundUp(size, pageBytes), candidate);
+        if (memory != nullptr) {
+            if (node >= 0) {
+                Numa::bindMemory(memory, roundUp(size, pageBytes), node);
+            }
+            obtained = candidate;
+            mappedBytes[static_cast<int>(use)][i].fetch_add(roundUp(size, pageBytes), std::memory_order_relaxed);
+            return memory;
+        }
+    }
+    throw std::bad_alloc();
+}
+
+/**
+ * Reserves address space for an array that grows. If a hugetlb page size is requested and the array spans at least
+ * one such page, base pages aligned to that page size are reserved without counting them, and hugetlb pages are
+ * committed a chunk at a time by commit, so the array only needs free huge pages for the part it uses. Otherwise the
+ * whole reservation is mapped by map and committed at once.
+ *
+ * @param reservation Reservation to fill in
+ * @param size Number of bytes to reserve
+ * @param use Storage the memory is used for
+ */
+void Arena::reserve(ArenaReservation &reservation, size_t size, ArenaUse use) {
+    for (int i = static_cast<int>(pageSize); i < static_cast<int>(PageSize::TRANSPARENT); i++) {
+        auto candidate = static_cast<PageSize>(i);
+        size_t pageBytes = getPageBytes(candidate);
+        if (size < pageBytes) {
+            continue;
+        }
+        void *memory = reserveAligned(roundUp(size, pageBytes), pageBytes);
+        if (memory == nullptr) {
+            break;
+        }
+        reservation.start = memory;
+        reservation.size = roundUp(size, pageBytes);
+        reservation.committedBytes = 0;
+        reservation.pageSize = candidate;
+        reservation.chunkPageSize = candidate;
+        return;
+    }
+    reservation.start = map(size, use, reservation.pageSize);
+    reservation.size = size;
+    reservation.committedBytes = size;
+    reservation.chunkPageSize = PageSize::BASE;
+}
+
+/**
+ * Commits a reservation a chunk at a time until the bytes are committed. Reservations mapped whole are already
+ * committed.
+ *
+ * @param reservation Reservation to commit
+ * @param bytes Number of bytes from the start that will be touched
+ * @param use Storage the memory is used for
+ */
+void Arena::commit(ArenaReservation &reservation, size_t bytes, ArenaUse use) {
+    if (bytes > reservation.size) {
+        throw std::bad_alloc();
+    }
+    while (reservation.committedBytes < bytes) {
+        commitChunk(reservation, use);
+    }
+}
+
+/**
+ * Commits the next chunk of a reservation by mapping hugetlb pages over it, trying the page size of the reservation
+ * and then 2 MB pages. If neither can be obtained the chunk is mapped again with base pages, as a failed fixed mapping
+ * may have unmapped it, and marked for transparent huge pages if they are enabled. The chunk is bound to the NUMA node
+ * of the calling thread if set, and counted against the page size obtained. Throws std::bad_alloc if even base pages
+ * cannot be mapped.
+ *
+ * @param reservation Reservation to commit the next chunk of
+ * @param use Storage the memory is used for
+ */
+void Arena::commitChunk(ArenaReservation &reservation, ArenaUse use) {
+    size_t chunkBytes = std::min(roundUp(CHUNK_BYTES, getPageBytes(reservation.chunkPageSize)),
+                                 reservation.size - reservation.committedBytes);
+    void *chunk = static_cast<uint8_t *>(reservation.start) + reservation.committedBytes;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+    PageSize obtained = PageSize::BASE;
+#ifdef MAP_HUGETLB
+    for (int i = static_cast<int>(reservation.chunkPageSize); i < static_cast<int>(PageSize::TRANSPARENT); i++) {
+        int shift = static_cast<PageSize>(i) == PageSize::HUGE_1GB ? 30 : 21;
+        if (mmap(chunk, chunkBytes, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | shift << MAP_HUGE_SHIFT, -1, 0)
+            != MAP_FAILED) {
+            obtained = static_cast<PageSize>(i);
+            break;
+        }
+    }
+#endif
+    if (obtained == PageSize::BASE) {
+        if (mmap(chunk, chunkBytes, PROT_READ | PROT_WRITE, flags | MAP_NORESERVE, -1, 0) == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+#ifdef MADV_HUGEPAGE
+        if (isTransparentEnabled() && madvise(chunk, chunkBytes, MADV_HUGEPAGE) == 0) {
+            obtained = PageSize::TRANSPARENT;
+        }
+#endif
+    }
+    if (node >= 0) {
+        Numa::bindMemory(chunk, chunkBytes, node);
+    }
+    mappedBytes[static_cast<int>(use)][static_cast<int>(obtained)].fetch_add(chunkBytes, std::memory_order_relaxed);
+    reservation.committedBytes += chunkBytes;
+    reservation.pageSize = obtained;
+}
+
+/**
+ * Unmaps memory mapped by map, uncounting it from the page size it was mapped with.
+ *
+ * @param memory Start of the mapping
+ * @param size Number of bytes mapped
+ * @param use Storage the memory was used for
+ * @param pageSize Page size the memory was mapped with
+ */
+void Arena::unmap(void *memory, size_t size, ArenaUse use, PageSize pageSize) {
+    size_t pageBytes = getPageBytes(pageSize);
+    munmap(memory, roundUp(size, pageBytes));
+    mappedBytes[static_cast<int>(use)][static_cast<int>(pageSize)].fetch_sub(roundUp(size, pageBytes),
+                                                                             std::memory_order_relaxed);
+}
+
+/**
+ * Getter for the bytes currently mapped for a use with a page size.
+ *
+ * @param use Storage the memory is used for
+ * @param pageSize Page size
+ * @return Bytes mapped
+ */
+size_t Arena::getMappedBytes(ArenaUse use, PageSize pageSize) {
+    return mappedBytes[static_cast<int>(use)][static_cast<int>(pageSize)].load(std::memory_order_relaxed);
+}
+
+/**
+ * Prints the requested page size, then for each use the kilobytes of address space mapped with each page size it
+ * obtained, counting only the committed part of reservations committed in hugetlb chunks. As transparent huge pages are
+ * only a hint, the anonymous memory of the process the kernel actually backs with them is printed from procfs if
+ * available.
+ */
+void Arena::printReport() {
+    std::cout << "Requested " << getPageSizeName(pageSize) << "." << std::endl;
+    for (int use = 0; use < static_cast<int>(ArenaUse::COUNT); use++) {
+        bool isMapped = false;
+        for (int i = 0; i < static_cast<int>(PageSize::COUNT); i++) {
+            size_t bytes = mappedBytes[use][i].load(std::memory_order_relaxed);
+            if (bytes == 0) {
+                continue;
+            }
+            std::cout << (isMapped ? ", " : std::string(USE_NAMES[use]) + ": ") << (bytes >> 10)
+                      << " KB in " << getPageSizeName(static_cast<PageSize>(i));
+            isMapped = true;
+        }
+        if (isMapped) {
+            std::cout << "." << std::endl;
+        }
+    }
+
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(smaps, line)) {
+        if (line.compare(0, 14, "AnonHugePages:") == 0) {
+            std::cout << "Anonymous memory backed by transparent huge pages: " << std::stoull(line.substr(14))
+                      << " KB." << std::endl;
+        }
+    }
+}
@@ -0,0 +1,258 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_ARENA_H
+#define ORDER_BOOK_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Size of the pages backing an arena, from largest to smallest.
+ */
+enum class PageSize : uint8_t {
+    /**
+     * 1 GB pages from the hugetlb pool.
+     */
+    HUGE_1GB,
+
+    /**
+     * 2 MB pages from the hugetlb pool.
+     */
+    HUGE_2MB,
+
+    /**
+     * Base pages, aligned to 2 MB and marked for transparent huge pages, which the kernel may back with 2 MB pages.
+     */
+    TRANSPARENT,
+
+    /**
+     * Base pages.
+     */
+    BASE,
+
+    /**
+     * Number of page sizes.
+     */
+    COUNT
+};
+
+/**
+ * Storage an arena is used for, to report the pages each kind of storage obtained.
+ */
+enum class ArenaUse : uint8_t {
+    /**
+     * Order pools and their cold data.
+     */
+    ORDERS,
+
+    /**
+     * Limit pools and their cold data.
+     */
+    LIMITS,
+
+    /**
+     * Slot arrays of order maps.
+     */
+    ORDER_INDEX,
+
+    /**
+     * Any other storage.
+     */
+    OTHER,
+
+    /**
+     * Number of uses.
+     */
+    COUNT
+};
+
+/**
+ * Address space reserved for an array that grows, committed from its start as it grows.
+ */
+struct ArenaReservation {
+    /**
+     * Start of the reservation.
+     */
+    void *start = nullptr;
+
+    /**
+     * Number of bytes reserved.
+     */
+    size_t size = 0;
+
+    /**
+     * Number of bytes from the start that may be touched.
+     */
+    size_t committedBytes = 0;
+
+    /**
+     * Page size of the last bytes committed.
+     */
+    PageSize pageSize = PageSize::BASE;
+
+    /**
+     * Hugetlb page size the reservation is committed with a chunk at a time, BASE if it was mapped whole.
+     */
+    PageSize chunkPageSize = PageSize::BASE;
+};
+
+/**
+ * Maps the large arrays of the order book, optionally backed by huge pages.
+ *
+ * Random cancels into millions of resting orders miss the TLB on almost every access with base pages, a 2 MB page
+ * covers 512 times as much memory per TLB entry. The page size is chosen for the whole process before the first order
+ * book allocates. Each mapping falls back to the next smaller page size when the larger one cannot be obtained, and
+ * mappings smaller than a page size skip it. The bytes obtained with each page size are counted for a report.
+ *
+ * Hugetlb mappings reserve their pages when mapped, so an array that grows, like a pool, reserves address space only
+ * and commits hugetlb pages a chunk at a time as it grows, each chunk falling back to smaller pages on its own.
+ * Transparent huge pages are committed lazily like base pages.
+ *
+ * Pages are placed on the NUMA node of the thread that first touches them, unless the mapping thread set a node to
+ * bind its mappings to before they are touched.
+ */
+class Arena {
+private:
+    /**
+     * Page size requested for new mappings.
+     */
+    static PageSize pageSize;
+
+    /**
+     * Bytes currently mapped for each use with each page size, updated by every thread that maps.
+     */
+    static std::atomic<size_t> mappedBytes[static_cast<int>(ArenaUse::COUNT)][static_cast<int>(PageSize::COUNT)];
+
+    /**
+     * Bytes committed at a time to a reservation committed in hugetlb chunks, rounded up to a whole page.
+     */
+    static constexpr size_t CHUNK_BYTES = size_t(1) << 26;
+
+    /**
+     * NUMA node new mappings of the calling thread are bound to, -1 to place pages on the node that first touches them.
+     */
+    static thread_local int node;
+
+    /**
+     * Try to map memory with one page size.
+     *
+     * @param size Number of bytes to map, rounded up to the page size
+     * @param pageSize Page size to map with
+     * @return Start of the mapping, nullptr if it could not be mapped
+     */
+    static void *tryMap(size_t size, PageSize pageSize);
+
+    /**
+     * Commit one chunk of a reservation committed in hugetlb chunks.
+     *
+     * @param reservation Reservation to commit the next chunk of
+     * @param use Storage the memory is used for
+     */
+    static void commitChunk(ArenaReservation &reservation, ArenaUse use);
+
+public:
+    /**
+     * Setter for the page size requested for new mappings. Existing mappings keep their pages.
+     *
+     * @param pageSize New page size
+     */
+    static void setPageSize(PageSize pageSize);
+
+    /**
+     * Getter for the page size requested for new mappings.
+     *
+     * @return Page size requested
+     */
+    static PageSize getPageSize();
+
+    /**
+     * Setter for the NUMA node new mappings of the calling thread are bound to. Existing mappings stay where they are.
+     *
+     * @param node Node to bind to, -1 for first touch placement
+     */
+    static void setNode(int node);
+
+    /**
+     * Getter for the NUMA node new mappings of the calling thread are bound to.
+     *
+     * @return Node bound to, -1 for first touch placement
+     */
+    static int getNode();
+
+    /**
+     * Getter for the number of bytes in a page.
+     *
+     * @param pageSize Page size
+     * @return Bytes in a page
+     */
+    static size_t getPageBytes(PageSize pageSize);
+
+    /**
+     * Getter for the name of a page size.
+     *
+     * @param pageSize Page size
+     * @return Name of the page size
+     */
+    static const char *getPageSizeName(PageSize pageSize);
+
+    /**
+     * Map zeroed memory with the requested page size, or the largest smaller page size that can be obtained, bound to
+     * the NUMA node of the calling thread if set. Throws std::bad_alloc if even base pages cannot be mapped.
+     *
+     * @param size Number of bytes to map
+     * @param use Storage the memory is used for
+     * @param obtained Page size the memory was mapped with
+     * @return Start of the mapping
+     */
+    static void *map(size_t size, ArenaUse use, PageSize &obtained);
+
+    /**
+     * Reserve address space for an array that grows. With a hugetlb page size requested, nothing is committed until
+     * commit is called, otherwise the whole reservation is mapped as by map and committed at once.
+     *
+     * @param reservation Reservation to fill in
+     * @param size Number of bytes to reserve
+     * @param use Storage the memory is used for
+     */
+    static void reserve(ArenaReservation &reservation, size_t size, ArenaUse use);
+
+    /**
+     * Commit a reservation from its start up to at least a number of bytes. Throws std::bad_alloc if the bytes are
+     * beyond the reservation or even base pages cannot be mapped.
+     *
+     * @param reservation Reservation to commit
+     * @param bytes Number of bytes from the start that will be touched
+     * @param use Storage the memory is used for
+     */
+    static void commit(ArenaReservation &reservation, size_t bytes, ArenaUse use);
+
+    /**
+     * Unmap memory mapped by map.
+     *
+     * @param memory Start of the mapping
+     * @param size Number of bytes mapped
+     * @param use Storage the memory was used for
+     * @param pageSize Page size the memory was mapped with
+     */
+    static void unmap(void *memory, size_t size, ArenaUse use, PageSize pageSize);
+
+    /**
+     * Getter for the bytes currently mapped for a use with a page size.
+     *
+     * @param use Storage the memory is used for
+     * @param pageSize Page size
+     * @return Bytes mapped
+     */
+    static size_t getMappedBytes(ArenaUse use, PageSize pageSize);
+
+    /**
+     * Print the requested page size and the bytes mapped for each use with each page size obtained.
+     */
+    static void printReport();
+};
+
+
+#endif //ORDER_BOOK_ARENA_H
@@ -0,0 +1,220 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "AvlPriceIndex.h"
+#include "OrderBook.h"
+#include "Limit.h"
+#include "Order.h"
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * Constructor for AvlPriceIndex.
+ *
+ * @param orderBook Pointer to the order book
+ * @param isBuy Boolean indicating if the index is for buy limits
+ */
+template <typename Traits>
+AvlPriceIndex<Traits>::AvlPriceIndex(OrderBook *orderBook, bool isBuy) {
+    this->orderBook = orderBook;
+    this->isBuy = isBuy;
+}
+
+/**
+ * Getter for the root of the AVL tree.
+ *
+ * @return Root of the AVL tree
+ */
+template <typename Traits>
+typename AvlPriceIndex<Traits>::Limit *AvlPriceIndex<Traits>::getRoot() const {
+    return isBuy ? orderBook->getBuyTree() : orderBook->getSellTree();
+}
+
+/**
+ * Setter for the root of the AVL tree.
+ *
+ * @param root New root of the AVL tree
+ */
+template <typename Traits>
+void AvlPriceIndex<Traits>::setRoot(Limit *root) {
+    if (isBuy) {
+        orderBook->setBuyTree(root);
+    } else {
+        orderBook->setSellTree(root);
+    }
+}
+
+/**
+ * Find the limit at a price.
+ *
+ * @param price Price of the limit
+ * @return Limit at the price, nullptr if there is none
+ */
+template <typename Traits>
+typename AvlPriceIndex<Traits>::Limit *AvlPriceIndex<Traits>::find(Price price) const {
+    auto it = limits.find(price);
+    return it == limits.end() ? nullptr : it->second;
+}
+
+/**
+ * Insert a new limit into the map and the AVL tree.
+ *
+ * @param limit Limit to insert, its price must not be in the index
+ */
+template <typename Traits>
+void AvlPriceIndex<Traits>::insert(Limit *limit) {
+    limits.insert(std::make_pair(limit->getPrice(), limit));
+    if (getRoot() == nullptr) {
+        setRoot(limit);
+    } else {
+        getRoot()->insertLimit(limit);
+    }
+}
+
+/**
+ * Build the map and a perfectly balanced AVL tree from limits sorted by price.
+ *
+ * @param sortedLimits Limits sorted by ascending price
+ */
+template <typename Traits>
+void AvlPriceIndex<Traits>::build(const std::vector<Limit *> &sortedLimits) {
+    limits.reserve(sortedLimits.size());
+    for (Limit *limit : sortedLimits) {
+        limits.insert(std::make_pair(limit->getPrice(), limit));
+    }
+    setRoot(Limit::buildTree(sortedLimits, 0, (int) sortedLimits.size(), nullptr));
+}
+
+/**
+ * Getter for the next inside order. If the limit is empty, walks the AVL tree in order from the limit towards lower
+ * prices for buy limits or higher prices for sell limits until a limit with orders is found.
+ *
+ * @param limit Limit to start from
+ * @return Next inside order, nullptr if there is none
+ */
+template <typename Traits>
+typename AvlPriceIndex<Traits>::Order *AvlPriceIndex<Traits>::getNextInsideOrder(const Limit *limit) const {
+    if (limit->getHeadOrder() != nullptr) {
+        return limit->getHeadOrder();
+    }
+    return getNextOuterOrder(limit);
+}
+
+/**
+ * Getter for the next outer order. Walks the AVL tree in order from the limit towards lower prices for buy limits or
+ * higher prices for sell limits until a limit with orders is found.
+ *
+ * @param limit Limit to start from
+ * @return Next outer order, nullptr if there is none
+ */
+template <typename Traits>
+typename AvlPriceIndex<Traits>::Order *AvlPriceIndex<Traits>::getNextOuterOrder(const Limit *limit) const {
+    const Limit *curr = limit;
+    do {
+        const Limit *towards = isBuy ? curr->getLeftChild() : curr->getRightChild();
+        if (towards != nullptr) {
+            // Next limit is the outermost limit of the subtree towards the next price
+            curr = towards;
+            const Limit *away = isBuy ? curr->getRightChild() : curr->getLeftChild();
+            while (away != nullptr) {
+                curr = away;
+                away = isBuy ? curr->getRightChild() : curr->getLeftChild();
+            }
+        } else {
+            // Next limit is the first ancestor reached from the side away from the next price
+            const Limit *parent = curr->getParent();
+            while (parent != nullptr && (isBuy ? parent->getLeftChild() : parent->getRightChild()) == curr) {
+                curr = parent;
+                parent = curr->getParent();
+            }
+            curr = parent;
+        }
+    } while (curr != nullptr && curr->getHeadOrder() == nullptr);
+    return curr == nullptr ? nullptr : curr->getHeadOrder();
+}
+
+/**
+ * Getter for boolean indicating if the index is empty.
+ *
+ * @return Whether the index is empty
+ */
+template <typename Traits>
+bool AvlPriceIndex<Traits>::empty() const {
+    return limits.empty();
+}
+
+/**
+ * Checks a subtree in order. Each child must point back to its parent, each height must be one more than the height
+ * of its taller child, with a missing child at height -1, and the heights of the children may differ by at most one.
+ *
+ * @param limit Root of the subtree, may be nullptr
+ * @param sortedLimits Limits to append to, sorted by ascending price
+ * @return Description of the first broken invariant, nullptr if the subtree is valid
+ */
+template <typename Traits>
+const char *AvlPriceIndex<Traits>::validateTree(const Limit *limit, std::vector<const Limit *> &sortedLimits) const {
+    if (limit == nullptr) {
+        return nullptr;
+    }
+    const Limit *left = limit->getLeftChild();
+    const Limit *right = limit->getRightChild();
+    if ((left != nullptr && left->getParent() != limit) || (right != nullptr && right->getParent() != limit)) {
+        return "AVL tree child does not point to its parent.";
+    }
+
+    const char *error = validateTree(left, sortedLimits);
+    if (error != nullptr) {
+        return error;
+    }
+    sortedLimits.push_back(limit);
+    error = validateTree(right, sortedLimits);
+    if (error != nullptr) {
+        return error;
+    }
+
+    int leftHeight = left == nullptr ? -1 : left->getHeight();
+    int rightHeight = right == nullptr ? -1 : right->getHeight();
+    if (limit->getHeight() != std::max(leftHeight, rightHeight) + 1) {
+        return "AVL tree height is wrong.";
+    }
+    if (std::abs(leftHeight - rightHeight) > 1) {
+        return "AVL tree is not balanced.";
+    }
+    return nullptr;
+}
+
+/**
+ * Checks the AVL tree from its root, that its limits are in ascending price order, and that the price map holds
+ * exactly the limits of the tree.
+ *
+ * @param sortedLimits Limits to append to, sorted by ascending price
+ * @return Description of the first broken invariant, nullptr if the index is valid
+ */
+template <typename Traits>
+const char *AvlPriceIndex<Traits>::validate(std::vector<const Limit *> &sortedLimits) const {
+    const Limit *root = getRoot();
+    if (root != nullptr && root->getParent() != nullptr) {
+        return "AVL tree root has a parent.";
+    }
+    size_t begin = sortedLimits.size();
+    const char *error = validateTree(root, sortedLimits);
+    if (error != nullptr) {
+        return error;
+    }
+
+    for (size_t i = begin; i < sortedLimits.size(); i++) {
+        if (i > begin && !(sortedLimits[i - 1]->getPrice() < sortedLimits[i]->getPrice())) {
+            return "AVL tree limits are not in price order.";
+        }
+        if (find(sortedLimits[i]->getPrice()) != sortedLimits[i]) {
+            return "AVL tree limit is not in the price map.";
+        }
+    }
+    if (sortedLimits.size() - begin != limits.size()) {
+        return "Price map has limits not in the AVL tree.";
+    }
+    return nullptr;
+}
+
+template class AvlPriceIndex<OrderBook::Traits>;
@@ -0,0 +1,127 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_AVLPRICEINDEX_H
+#define ORDER_BOOK_AVLPRICEINDEX_H
+
+#include <unordered_map>
+#include "PriceIndex.h"
+
+/**
+ * Price index looking limits up in a hash map, with limits linked into an AVL tree rooted in the order book.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class AvlPriceIndex final : public PriceIndex<Traits> {
+public:
+    using Price = typename Traits::Price;
+    using Limit = typename Traits::Limit;
+    using Order = typename Traits::Order;
+    using OrderBook = typename Traits::OrderBook;
+
+private:
+    /**
+     * Map of limits by price.
+     */
+    std::unordered_map<Price, Limit *> limits;
+
+    /**
+     * Pointer to the order book holding the root of the AVL tree.
+     */
+    OrderBook *orderBook;
+
+    /**
+     * Boolean indicating if the index is for buy limits.
+     */
+    bool isBuy;
+
+    /**
+     * Getter for the root of the AVL tree.
+     *
+     * @return Root of the AVL tree
+     */
+    Limit *getRoot() const;
+
+    /**
+     * Setter for the root of the AVL tree.
+     *
+     * @param root New root of the AVL tree
+     */
+    void setRoot(Limit *root);
+
+    /**
+     * Check the links, height and balance of a subtree and collect its limits in order.
+     *
+     * @param limit Root of the subtree, may be nullptr
+     * @param sortedLimits Limits to append to, sorted by ascending price
+     * @return Description of the first broken invariant, nullptr if the subtree is valid
+     */
+    const char *validateTree(const Limit *limit, std::vector<const Limit *> &sortedLimits) const;
+
+public:
+    /**
+     * Constructor for AvlPriceIndex.
+     *
+     * @param orderBook Pointer to the order book
+     * @param isBuy Boolean indicating if the index is for buy limits
+     */
+    AvlPriceIndex(OrderBook *orderBook, bool isBuy);
+
+    /**
+     * Find the limit at a price.
+     *
+     * @param price Price of the limit
+     * @return Limit at the price, nullptr if there is none
+     */
+    Limit *find(Price price) const override;
+
+    /**
+     * Insert a new limit into the map and the AVL tree.
+     *
+     * @param limit Limit to insert, its price must not be in the index
+     */
+    void insert(Limit *limit) override;
+
+    /**
+     * Build the map and a perfectly balanced AVL tree from limits sorted by price.
+     *
+     * @param sortedLimits Limits sorted by ascending price
+     */
+    void build(const std::vector<Limit *> &sortedLimits) override;
+
+    /**
+     * Getter for the next inside order, found by walking the AVL tree in order away from the inside.
+     *
+     * @param limit Limit to start from
+     * @return Next inside order, nullptr if there is none
+     */
+    Order *getNextInsideOrder(const Limit *limit) const override;
+
+    /**
+     * Getter for the next outer order, found by walking the AVL tree in order away from the inside.
+     *
+     * @param limit Limit to start from
+     * @return Next outer order, nullptr if there is none
+     */
+    Order *getNextOuterOrder(const Limit *limit) const override;
+
+    /**
+     * Getter for boolean indicating if the index is empty.
+     *
+     * @return Whether the index is empty
+     */
+    bool empty() const override;
+
+    /**
+     * Check the invariants of the index and collect its limits, including limits without orders.
+     *
+     * @param sortedLimits Limits to append to, sorted by ascending price
+     * @return Description of the first broken invariant, nullptr if the index is valid
+     */
+    const char *validate(std::vector<const Limit *> &sortedLimits) const override;
+};
+
+
+#endif //ORDER_BOOK_AVLPRICEINDEX_H
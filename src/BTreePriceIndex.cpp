@@ -0,0 +1,481 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "BTreePriceIndex.h"
+#include "OrderBook.h"
+#include "Limit.h"
+#include "Order.h"
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Price of unused slots in a node, greater than every price so it is never counted by rank.
+ *
+ * @tparam Price Type of prices
+ */
+template <typename Price>
+static constexpr Price EMPTY_PRICE = std::numeric_limits<Price>::has_infinity ?
+                                     std::numeric_limits<Price>::infinity() : std::numeric_limits<Price>::max();
+
+/**
+ * Constructor for BTreePriceIndex.
+ *
+ * @param isBuy Boolean indicating if the index is for buy limits
+ */
+template <typename Traits>
+BTreePriceIndex<Traits>::BTreePriceIndex(bool isBuy) {
+    this->root = nullptr;
+    this->height = 0;
+    this->isBuy = isBuy;
+}
+
+/**
+ * Destructor for BTreePriceIndex.
+ */
+template <typename Traits>
+BTreePriceIndex<Traits>::~BTreePriceIndex() {
+    freeNode(root, height);
+}
+
+/**
+ * Free a subtree.
+ *
+ * @param node Root of the subtree
+ * @param level Number of inner node levels above the leaves in the subtree
+ */
+template <typename Traits>
+void BTreePriceIndex<Traits>::freeNode(void *node, int level) {
+    if (node == nullptr) {
+        return;
+    }
+    if (level == 0) {
+        delete static_cast<LeafNode *>(node);
+        return;
+    }
+    InnerNode *inner = static_cast<InnerNode *>(node);
+    for (int i = 0; i <= inner->size; i++) {
+        freeNode(inner->children[i], level - 1);
+    }
+    delete inner;
+}
+
+/**
+ * Count the prices in a node that are less than, or less than or equal to, a price. All 16 float prices are compared
+ * at once with SIMD comparisons, which works because unused slots are infinity and prices are sorted.
+ *
+ * @param prices Prices of the node, unused slots are the empty price
+ * @param price Price to compare against
+ * @param orEqual Boolean indicating to also count equal prices
+ * @return Number of prices counted
+ */
+template <typename Traits>
+int BTreePriceIndex<Traits>::rank(const Price *prices, Price price, bool orEqual) {
+#if defined(__SSE2__)
+    if constexpr (std::is_same<Price, float>::value) {
+        __m128 key = _mm_set1_ps(price);
+        int mask = 0;
+        for (int i = 0; i < NODE_SIZE; i += 4) {
+            __m128 block = _mm_load_ps(prices + i);
+            __m128 compare = orEqual ? _mm_cmple_ps(block, key) : _mm_cmplt_ps(block, key);
+            mask |= _mm_movemask_ps(compare) << i;
+        }
+        return __builtin_popcount(mask);
+    }
+#endif
+    int count = 0;
+    for (int i = 0; i < NODE_SIZE; i++) {
+        count += orEqual ? prices[i] <= price : prices[i] < price;
+    }
+    return count;
+}
+
+/**
+ * Find the leaf that holds or would hold a price.
+ *
+ * @param price Price to find
+ * @return Leaf for the price, nullptr if the tree is empty
+ */
+template <typename Traits>
+typename BTreePriceIndex<Traits>::LeafNode *BTreePriceIndex<Traits>::findLeaf(Price price) const {
+    void *node = root;
+    for (int level = height; level > 0; level--) {
+        InnerNode *inner = static_cast<InnerNode *>(node);
+        node = inner->children[rank(inner->prices, price, true)];
+    }
+    return static_cast<LeafNode *>(node);
+}
+
+/**
+ * Find the limit at a price.
+ *
+ * @param price Price of the limit
+ * @return Limit at the price, nullptr if there is none
+ */
+template <typename Traits>
+typename BTreePriceIndex<Traits>::Limit *BTreePriceIndex<Traits>::find(Price price) const {
+    LeafNode *leaf = findLeaf(price);
+    if (leaf == nullptr) {
+        return nullptr;
+    }
+    int position = rank(leaf->prices, price, false);
+    if (position < leaf->size && leaf->prices[position] == price) {
+        return leaf->limits[position];
+    }
+    return nullptr;
+}
+
+/**
+ * Insert a new limit into the B+-tree. If the root splits, the tree grows a new root.
+ *
+ * @param limit Limit to insert, its price must not be in the index
+ */
+template <typename Traits>
+void BTreePriceIndex<Traits>::insert(Limit *limit) {
+    if (root == nullptr) {
+        LeafNode *leaf = new LeafNode();
+        std::fill(leaf->prices, leaf->prices + NODE_SIZE, EMPTY_PRICE<Price>);
+        leaf->prices[0] = limit->getPrice();
+        leaf->limits[0] = limit;
+        leaf->size = 1;
+        root = leaf;
+        return;
+    }
+
+    Price splitPrice;
+    void *split = insertInto(root, height, limit, splitPrice);
+    if (split != nullptr) {
+        InnerNode *newRoot = new InnerNode();
+        std::fill(newRoot->prices, newRoot->prices + NODE_SIZE, EMPTY_PRICE<Price>);
+        newRoot->prices[0] = splitPrice;
+        newRoot->children[0] = root;
+        newRoot->children[1] = split;
+        newRoot->size = 1;
+        root = newRoot;
+        height++;
+    }
+}
+
+/**
+ * Insert a limit into a subtree. Full nodes are split in half, the new right node is returned to the parent along
+ * with the price separating it from the left node.
+ *
+ * @param node Root of the subtree
+ * @param level Number of inner node levels above the leaves in the subtree
+ * @param limit Limit to insert
+ * @param splitPrice Smallest price of the new right node if the subtree root split
+ * @return New right node if the subtree root split, else nullptr
+ */
+template <typename Traits>
+void *BTreePriceIndex<Traits>::insertInto(void *node, int level, Limit *limit, Price &splitPrice) {
+    Price price = limit->getPrice();
+
+    if (level == 0) {
+        LeafNode *leaf = static_cast<LeafNode *>(node);
+        int position = rank(leaf->prices, price, false);
+
+        // Gather the prices and limits with the new limit in place
+        Price prices[NODE_SIZE + 1];
+        Limit *limits[NODE_SIZE + 1];
+        std::copy(leaf->prices, leaf->prices + position, prices);
+        std::copy(leaf->limits, leaf->limits + position, limits);
+        prices[position] = price;
+        limits[position] = limit;
+        std::copy(leaf->prices + position, leaf->prices + leaf->size, prices + position + 1);
+        std::copy(leaf->limits + position, leaf->limits + leaf->size, limits + position + 1);
+        int total = leaf->size + 1;
+
+        if (total <= NODE_SIZE) {
+            std::copy(prices, prices + total, leaf->prices);
+            std::copy(limits, limits + total, leaf->limits);
+            leaf->size = total;
+            return nullptr;
+        }
+
+        // Split leaf in half and link new leaf after it
+        int leftSize = total / 2;
+        LeafNode *right = new LeafNode();
+        std::fill(right->prices, right->prices + NODE_SIZE, EMPTY_PRICE<Price>);
+        std::fill(leaf->prices, leaf->prices + NODE_SIZE, EMPTY_PRICE<Price>);
+        std::copy(prices, prices + leftSize, leaf->prices);
+        std::copy(limits, limits + leftSize, leaf->limits);
+        std::copy(prices + leftSize, prices + total, right->prices);
+        std::copy(limits + leftSize, limits + total, right->limits);
+        leaf->size = leftSize;
+        right->size = total - leftSize;
+
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (leaf->next != nullptr) {
+            leaf->next->prev = right;
+        }
+        leaf->next = right;
+
+        splitPrice = right->prices[0];
+        return right;
+    }
+
+    InnerNode *inner = static_cast<InnerNode *>(node);
+    int position = rank(inner->prices, price, true);
+    Price childSplitPrice;
+    void *childSplit = insertInto(inner->children[position], level - 1, limit, childSplitPrice);
+    if (childSplit == nullptr) {
+        return nullptr;
+    }
+
+    // Gather the prices and children with the split child in place
+    Price prices[NODE_SIZE + 1];
+    void *children[NODE_SIZE + 2];
+    std::copy(inner->prices, inner->prices + position, prices);
+    std::copy(inner->children, inner->children + position + 1, children);
+    prices[position] = childSplitPrice;
+    children[position + 1] = childSplit;
+    std::copy(inner->prices + position, inner->prices + inner->size, prices + position + 1);
+    std::copy(inner->children + position + 1, inner->children + inner->size + 1, children + position + 2);
+    int total = inner->size + 1;
+
+    if (total <= NODE_SIZE) {
+        std::copy(prices, prices + total, inner->prices);
+        std::copy(children, children + total + 1, inner->children);
+        inner->size = total;
+        return nullptr;
+    }
+
+    // Split inner node in half, moving the middle price up to the parent
+    int leftSize = total / 2;
+    InnerNode *right = new InnerNode();
+    std::fill(right->prices, right->prices + NODE_SIZE, EMPTY_PRICE<Price>);
+    std::fill(inner->prices, inner->prices + NODE_SIZE, EMPTY_PRICE<Price>);
+    std::copy(prices, prices + leftSize, inner->prices);
+    std::copy(children, children + leftSize + 1, inner->children);
+    std::copy(prices + leftSize + 1, prices + total, right->prices);
+    std::copy(children + leftSize + 1, children + total + 1, right->children);
+    inner->size = leftSize;
+    right->size = total - leftSize - 1;
+
+    splitPrice = prices[leftSize];
+    return right;
+}
+
+/**
+ * Bulk load the B+-tree from limits sorted by price. Leaves are filled to three quarters and linked in order, then
+ * each level of inner nodes is built from the level below, with the nodes spread evenly over as few parents of up to
+ * three quarters full as hold them, so building M limits is O(M).
+ *
+ * @param sortedLimits Limits sorted by ascending price
+ */
+template <typename Traits>
+void BTreePriceIndex<Traits>::build(const std::vector<Limit *> &sortedLimits) {
+    if (sortedLimits.empty()) {
+        return;
+    }
+
+    // Nodes of the level being built, with the smallest price under each node
+    std::vector<void *> nodes;
+    std::vector<Price> minPrices;
+
+    LeafNode *prevLeaf = nullptr;
+    for (size_t i = 0; i < sortedLimits.size(); i += BUILD_LEAF_SIZE) {
+        LeafNode *leaf = new LeafNode();
+        std::fill(leaf->prices, leaf->prices + NODE_SIZE, EMPTY_PRICE<Price>);
+        for (size_t j = i; j < sortedLimits.size() && j < i + BUILD_LEAF_SIZE; j++) {
+            leaf->prices[leaf->size] = sortedLimits[j]->getPrice();
+            leaf->limits[leaf->size] = sortedLimits[j];
+            leaf->size++;
+        }
+        leaf->prev = prevLeaf;
+        if (prevLeaf != nullptr) {
+            prevLeaf->next = leaf;
+        }
+        prevLeaf = leaf;
+        nodes.push_back(leaf);
+        minPrices.push_back(leaf->prices[0]);
+    }
+
+    height = 0;
+    while (nodes.size() > 1) {
+        std::vector<void *> parents;
+        std::vector<Price> parentMinPrices;
+
+        // Spread the nodes evenly so every parent has at least two children
+        size_t parentCount = (nodes.size() + BUILD_LEAF_SIZE) / (BUILD_LEAF_SIZE + 1);
+        for (size_t k = 0; k < parentCount; k++) {
+            size_t first = k * nodes.size() / parentCount;
+            size_t last = (k + 1) * nodes.size() / parentCount;
+            InnerNode *inner = new InnerNode();
+            std::fill(inner->prices, inner->prices + NODE_SIZE, EMPTY_PRICE<Price>);
+            inner->children[0] = nodes[first];
+            for (size_t j = first + 1; j < last; j++) {
+                inner->prices[inner->size] = minPrices[j];
+                inner->size++;
+                inner->children[inner->size] = nodes[j];
+            }
+            parents.push_back(inner);
+            parentMinPrices.push_back(minPrices[first]);
+        }
+        nodes.swap(parents);
+        minPrices.swap(parentMinPrices);
+        height++;
+    }
+    root = nodes[0];
+}
+
+/**
+ * Getter for the next inside order. If the limit is empty, walks the leaves towards lower prices for buy limits or
+ * higher prices for sell limits until a limit with orders is found.
+ *
+ * @param limit Limit to start from
+ * @return Next inside order, nullptr if there is none
+ */
+template <typename Traits>
+typename BTreePriceIndex<Traits>::Order *BTreePriceIndex<Traits>::getNextInsideOrder(const Limit *limit) const {
+    if (limit->getHeadOrder() != nullptr) {
+        return limit->getHeadOrder();
+    }
+    return getNextOuterOrder(limit);
+}
+
+/**
+ * Getter for the next outer order. Walks the leaves from the limit towards lower prices for buy limits or higher
+ * prices for sell limits until a limit with orders is found.
+ *
+ * @param limit Limit to start from
+ * @return Next outer order, nullptr if there is none
+ */
+template <typename Traits>
+typename BTreePriceIndex<Traits>::Order *BTreePriceIndex<Traits>::getNextOuterOrder(const Limit *limit) const {
+    LeafNode *leaf = findLeaf(limit->getPrice());
+    if (leaf == nullptr) {
+        return nullptr;
+    }
+    int position = rank(leaf->prices, limit->getPrice(), false);
+
+    if (isBuy) {
+        position--;
+        while (leaf != nullptr) {
+            for (; position >= 0; position--) {
+                if (leaf->limits[position]->getHeadOrder() != nullptr) {
+                    return leaf->limits[position]->getHeadOrder();
+                }
+            }
+            leaf = leaf->prev;
+            position = leaf == nullptr ? 0 : leaf->size - 1;
+        }
+    } else {
+        position++;
+        while (leaf != nullptr) {
+            for (; position < leaf->size; position++) {
+                if (leaf->limits[position]->getHeadOrder() != nullptr) {
+                    return leaf->limits[position]->getHeadOrder();
+                }
+            }
+            leaf = leaf->next;
+            position = 0;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Getter for boolean indicating if the index is empty.
+ *
+ * @return Whether the index is empty
+ */
+template <typename Traits>
+bool BTreePriceIndex<Traits>::empty() const {
+    return root == nullptr;
+}
+
+/**
+ * Checks a subtree. Every node must hold between 1 and NODE_SIZE prices in strictly ascending order within the bounds
+ * set by its parent, with unused slots at EMPTY_PRICE so rank never counts them. A leaf must hold the limit of each
+ * price and be linked to the leaf before it, the children of an inner node are bounded by its prices.
+ *
+ * @param node Root of the subtree
+ * @param level Number of inner node levels above the leaves in the subtree
+ * @param low Lowest price the subtree may hold, nullptr if unbounded
+ * @param high Price every price of the subtree must be below, nullptr if unbounded
+ * @param sortedLimits Limits to append to, sorted by ascending price
+ * @param prevLeaf Leaf before the subtree in order, updated to the last leaf of the subtree
+ * @return Description of the first broken invariant, nullptr if the subtree is valid
+ */
+template <typename Traits>
+const char *BTreePriceIndex<Traits>::validateNode(const void *node, int level, const Price *low, const Price *high,
+                                                  std::vector<const Limit *> &sortedLimits,
+                                                  const LeafNode *&prevLeaf) const {
+    // Leaves and inner nodes both start with their prices
+    const Price *prices = level == 0 ? static_cast<const LeafNode *>(node)->prices :
+                          static_cast<const InnerNode *>(node)->prices;
+    int size = level == 0 ? static_cast<const LeafNode *>(node)->size : static_cast<const InnerNode *>(node)->size;
+    if (size < 1 || size > NODE_SIZE) {
+        return "B+-tree node size is out of range.";
+    }
+    for (int i = 0; i < NODE_SIZE; i++) {
+        if (i >= size) {
+            if (prices[i] != EMPTY_PRICE<Price>) {
+                return "B+-tree node has a price in an unused slot.";
+            }
+        } else if ((i > 0 && !(prices[i - 1] < prices[i])) || (low != nullptr && prices[i] < *low) ||
+                   (high != nullptr && !(prices[i] < *high))) {
+            return "B+-tree node prices are out of order.";
+        }
+    }
+
+    if (level == 0) {
+        const auto *leaf = static_cast<const LeafNode *>(node);
+        if (leaf->prev != prevLeaf || (prevLeaf != nullptr && prevLeaf->next != leaf)) {
+            return "B+-tree leaves are not linked in order.";
+        }
+        for (int i = 0; i < size; i++) {
+            if (leaf->limits[i] == nullptr || leaf->limits[i]->getPrice() != prices[i]) {
+                return "B+-tree leaf limit does not match its price.";
+            }
+            sortedLimits.push_back(leaf->limits[i]);
+        }
+        prevLeaf = leaf;
+        return nullptr;
+    }
+
+    const auto *inner = static_cast<const InnerNode *>(node);
+    for (int i = 0; i <= size; i++) {
+        if (inner->children[i] == nullptr) {
+            return "B+-tree inner node is missing a child.";
+        }
+        const char *error = validateNode(inner->children[i], level - 1, i == 0 ? low : &prices[i - 1],
+                                         i == size ? high : &prices[i], sortedLimits, prevLeaf);
+        if (error != nullptr) {
+            return error;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Checks the B+-tree from its root, and that the last leaf ends the chain of leaves.
+ *
+ * @param sortedLimits Limits to append to, sorted by ascending price
+ * @return Description of the first broken invariant, nullptr if the index is valid
+ */
+template <typename Traits>
+const char *BTreePriceIndex<Traits>::validate(std::vector<const Limit *> &sortedLimits) const {
+    if (root == nullptr) {
+        return height == 0 ? nullptr : "B+-tree is empty but has inner levels.";
+    }
+    const LeafNode *prevLeaf = nullptr;
+    const char *error = validateNode(root, height, nullptr, nullptr, sortedLimits, prevLeaf);
+    if (error != nullptr) {
+        return error;
+    }
+    if (prevLeaf->next != nullptr) {
+        return "B+-tree leaves are not linked in order.";
+    }
+    return nullptr;
+}
+
+template class BTreePriceIndex<OrderBook::Traits>;
+template class BTreePriceIndex<CryptoOrderBook::Traits>;
@@ -0,0 +1,196 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_BTREEPRICEINDEX_H
+#define ORDER_BOOK_BTREEPRICEINDEX_H
+
+#include "PriceIndex.h"
+
+/**
+ * Price index storing limits in a B+-tree.
+ *
+ * Each node holds up to 16 prices in one cache line, searched with SIMD comparisons, so a lookup touches
+ * O(log16 M) nodes instead of the O(log2 M) limits of the AVL tree. Leaves are doubly linked to walk limits in price
+ * order. Limits are never removed, matching the order book which keeps empty limits to be filled again. Nodes of
+ * 64-bit prices span two cache lines and are searched with scalar comparisons.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class BTreePriceIndex final : public PriceIndex<Traits> {
+public:
+    using Price = typename Traits::Price;
+    using Limit = typename Traits::Limit;
+    using Order = typename Traits::Order;
+
+    /**
+     * Maximum number of prices in a node.
+     */
+    static const int NODE_SIZE = 16;
+
+private:
+    /**
+     * Number of limits in each leaf when bulk loading, leaving room for new limits before leaves split.
+     */
+    static const int BUILD_LEAF_SIZE = NODE_SIZE * 3 / 4;
+
+    /**
+     * Inner node of the B+-tree. Prices are the smallest price of each child but the first.
+     */
+    struct InnerNode {
+        alignas(64) Price prices[NODE_SIZE];
+        void *children[NODE_SIZE + 1];
+        int size;
+    };
+
+    /**
+     * Leaf node of the B+-tree.
+     */
+    struct LeafNode {
+        alignas(64) Price prices[NODE_SIZE];
+        Limit *limits[NODE_SIZE];
+        LeafNode *prev;
+        LeafNode *next;
+        int size;
+    };
+
+    /**
+     * Root of the B+-tree, a leaf node if height is 0.
+     */
+    void *root;
+
+    /**
+     * Number of inner node levels above the leaves.
+     */
+    int height;
+
+    /**
+     * Boolean indicating if the index is for buy limits.
+     */
+    bool isBuy;
+
+    /**
+     * Count the prices in a node that are less than, or less than or equal to, a price.
+     *
+     * @param prices Prices of the node, unused slots are the empty price
+     * @param price Price to compare against
+     * @param orEqual Boolean indicating to also count equal prices
+     * @return Number of prices counted
+     */
+    static int rank(const Price *prices, Price price, bool orEqual);
+
+    /**
+     * Find the leaf that holds or would hold a price.
+     *
+     * @param price Price to find
+     * @return Leaf for the price, nullptr if the tree is empty
+     */
+    LeafNode *findLeaf(Price price) const;
+
+    /**
+     * Insert a limit into a subtree, splitting full nodes.
+     *
+     * @param node Root of the subtree
+     * @param level Number of inner node levels above the leaves in the subtree
+     * @param limit Limit to insert
+     * @param splitPrice Smallest price of the new right node if the subtree root split
+     * @return New right node if the subtree root split, else nullptr
+     */
+    void *insertInto(void *node, int level, Limit *limit, Price &splitPrice);
+
+    /**
+     * Free a subtree.
+     *
+     * @param node Root of the subtree
+     * @param level Number of inner node levels above the leaves in the subtree
+     */
+    static void freeNode(void *node, int level);
+
+    /**
+     * Check a subtree and collect its limits in order.
+     *
+     * @param node Root of the subtree
+     * @param level Number of inner node levels above the leaves in the subtree
+     * @param low Lowest price the subtree may hold, nullptr if unbounded
+     * @param high Price every price of the subtree must be below, nullptr if unbounded
+     * @param sortedLimits Limits to append to, sorted by ascending price
+     * @param prevLeaf Leaf before the subtree in order, updated to the last leaf of the subtree
+     * @return Description of the first broken invariant, nullptr if the subtree is valid
+     */
+    const char *validateNode(const void *node, int level, const Price *low, const Price *high,
+                             std::vector<const Limit *> &sortedLimits, const LeafNode *&prevLeaf) const;
+
+public:
+    /**
+     * Constructor for BTreePriceIndex.
+     *
+     * @param isBuy Boolean indicating if the index is for buy limits
+     */
+    explicit BTreePriceIndex(bool isBuy);
+
+    /**
+     * Destructor for BTreePriceIndex.
+     */
+    ~BTreePriceIndex() override;
+
+    BTreePriceIndex(const BTreePriceIndex &) = delete;
+
+    BTreePriceIndex &operator=(const BTreePriceIndex &) = delete;
+
+    /**
+     * Find the limit at a price.
+     *
+     * @param price Price of the limit
+     * @return Limit at the price, nullptr if there is none
+     */
+    Limit *find(Price price) const override;
+
+    /**
+     * Insert a new limit into the B+-tree.
+     *
+     * @param limit Limit to insert, its price must not be in the index
+     */
+    void insert(Limit *limit) override;
+
+    /**
+     * Bulk load the B+-tree from limits sorted by price.
+     *
+     * @param sortedLimits Limits sorted by ascending price
+     */
+    void build(const std::vector<Limit *> &sortedLimits) override;
+
+    /**
+     * Getter for the next inside order, found by walking the leaves away from the inside.
+     *
+     * @param limit Limit to start from
+     * @return Next inside order, nullptr if there is none
+     */
+    Order *getNextInsideOrder(const Limit *limit) const override;
+
+    /**
+     * Getter for the next outer order, found by walking the leaves away from the inside.
+     *
+     * @param limit Limit to start from
+     * @return Next outer order, nullptr if there is none
+     */
+    Order *getNextOuterOrder(const Limit *limit) const override;
+
+    /**
+     * Getter for boolean indicating if the index is empty.
+     *
+     * @return Whether the index is empty
+     */
+    bool empty() const override;
+
+    /**
+     * Check the invariants of the index and collect its limits, including limits without orders.
+     *
+     * @param sortedLimits Limits to append to, sorted by ascending price
+     * @return Description of the first broken invariant, nullptr if the index is valid
+     */
+    const char *validate(std::vector<const Limit *> &sortedLimits) const override;
+};
+
+
+#endif //ORDER_BOOK_BTREEPRICEINDEX_H
@@ -0,0 +1,130 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "OrderBook.h"
+#include "Arena.h"
+#include "BookWorker.h"
+#include "FlowGenerator.h"
+#include "FlowReplay.h"
+#include "TscClock.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/**
+ * Replay a mapped flow into a new order book, timing each message in timestamp counter cycles, and print the
+ * throughput and latency percentiles.
+ *
+ * @tparam OrderBook Type of the order book
+ * @param name Name of the order book printed with the results
+ * @param flowFile Mapped flow file
+ * @param orderBook Empty order book to replay into
+ */
+template <typename OrderBook>
+void benchmark(const char *name, const FlowFile &flowFile, OrderBook *orderBook) {
+    const FlowHeader &header = flowFile.getHeader();
+    const FlowMessage *messages = flowFile.getMessages();
+    FlowReplay<OrderBook> replay(orderBook, header);
+    std::vector<uint64_t> cycles(header.messageCount);
+
+    uint64_t startTime = TscClock::now();
+    for (uint64_t i = 0; i < header.messageCount; i++) {
+        uint64_t startTicks = TscClock::ticks();
+        replay.apply(messages[i]);
+        cycles[i] = TscClock::ticks() - startTicks;
+    }
+    uint64_t elapsed = TscClock::now() - startTime;
+
+    std::sort(cycles.begin(), cycles.end());
+    auto percentile = [&cycles](double fraction) {
+        return cycles.empty() ? 0 : cycles[static_cast<size_t>(fraction * (cycles.size() - 1))];
+    };
+    std::cout << name << ": " << header.messageCount << " messages in " << elapsed / 1000000.0 << " ms, "
+              << (elapsed == 0 ? 0 : header.messageCount * 1000000000.0 / elapsed) << " messages/s, cycles p50 "
+              << percentile(0.5) << " p99 " << percentile(0.99) << " p99.9 " << percentile(0.999) << " max "
+              << percentile(1) << ", " << replay.getExecutedCount() << " executions, " << replay.getRejectedCount()
+              << " rejected" << std::endl;
+}
+
+/**
+ * Parse the name of a page size.
+ *
+ * @param name Name of the page size: base, thp, 2mb or 1gb
+ * @param pageSize Page size parsed
+ * @return Whether the name is a page size
+ */
+bool parsePageSize(const char *name, PageSize &pageSize) {
+    const char *names[] = {"1gb", "2mb", "thp", "base"};
+    for (int i = 0; i < static_cast<int>(PageSize::COUNT); i++) {
+        if (std::strcmp(name, names[i]) == 0) {
+            pageSize = static_cast<PageSize>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Generate a flow file, or replay a flow file into each preset order book with the storage of the order books mapped
+ * with a page size, base pages by default, and report the pages obtained. Given a CPU, the order books are created and
+ * replayed on a worker pinned to it with its memory on the NUMA node of the CPU.
+ *
+ * Usage: OrderBookBench generate <file> [messages] [seed]
+ *        OrderBookBench replay <file> [base|thp|2mb|1gb] [cpu]
+ */
+int main(int argc, char **argv) {
+    if (argc >= 3 && std::strcmp(argv[1], "generate") == 0) {
+        FlowConfig config;
+        if (argc >= 4) {
+            config.messageCount = std::strtoull(argv[3], nullptr, 10);
+        }
+        if (argc >= 5) {
+            config.seed = std::strtoull(argv[4], nullptr, 10);
+        }
+        FlowGenerator generator(config);
+        std::vector<FlowMessage> messages;
+        FlowHeader header = generator.generate(messages);
+        if (!FlowGenerator::write(argv[2], header, messages)) {
+            return 1;
+        }
+        std::cout << "Generated " << header.messageCount << " messages for " << header.orderCount << " orders."
+                  << std::endl;
+        return 0;
+    }
+
+    if (argc >= 3 && std::strcmp(argv[1], "replay") == 0) {
+        FlowFile flowFile;
+        if (!flowFile.open(argv[2])) {
+            return 1;
+        }
+        PageSize pageSize = PageSize::BASE;
+        if (argc >= 4 && !parsePageSize(argv[3], pageSize)) {
+            std::cout << "Page size is not base, thp, 2mb or 1gb." << std::endl;
+            return 1;
+        }
+        Arena::setPageSize(pageSize);
+        const FlowHeader &header = flowFile.getHeader();
+        auto replay = [&flowFile, &header]() {
+            benchmark("Equity", flowFile,
+                      new EquityOrderBook(PriceIndexType::TICK_LADDER, header.minPrice, header.tickSize));
+            benchmark("Futures", flowFile, new FuturesOrderBook());
+            benchmark("Crypto", flowFile, new CryptoOrderBook());
+        };
+        if (argc >= 5) {
+            BookWorker worker(std::atoi(argv[4]));
+            worker.start(replay);
+            worker.join();
+        } else {
+            replay();
+        }
+        Arena::printReport();
+        return 0;
+    }
+
+    std::cout << "Usage: OrderBookBench generate <file> [messages] [seed]" << std::endl;
+    std::cout << "       OrderBookBench replay <file> [base|thp|2mb|1gb] [cpu]" << std::endl;
+    return 1;
+}
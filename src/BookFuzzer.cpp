@@ -0,0 +1,247 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "BookFuzzer.h"
+#include "OrderBook.h"
+#include <iostream>
+#include <type_traits>
+
+/**
+ * Constructor for BookFuzzer.
+ *
+ * @param orderBook Empty order book to test, its trade tape is replaced
+ * @param minPrice Price of tick 0
+ * @param tickSize Price difference between ticks
+ */
+template <typename OrderBook>
+BookFuzzer<OrderBook>::BookFuzzer(OrderBook *orderBook, double minPrice, double tickSize) : tape(1 << 16) {
+    this->orderBook = orderBook;
+    this->trades.resize(1 << 16);
+    this->minPrice = minPrice;
+    this->tickSize = tickSize;
+    this->orderBook->setTradeTape(&tape);
+    reset();
+}
+
+/**
+ * Converts a price in ticks to the price type of the order book.
+ *
+ * @param priceTicks Price in ticks
+ * @return Price in the order book
+ */
+template <typename OrderBook>
+typename BookFuzzer<OrderBook>::Price BookFuzzer<OrderBook>::toPrice(int32_t priceTicks) const {
+    if (std::is_integral<Price>::value) {
+        return static_cast<Price>(priceTicks);
+    }
+    return static_cast<Price>(minPrice + priceTicks * tickSize);
+}
+
+/**
+ * Cancels every live order in both books, then records the traded totals of the order book so later comparisons
+ * only count trades since the reset.
+ */
+template <typename OrderBook>
+void BookFuzzer<OrderBook>::reset() {
+    for (const LiveOrder &liveOrder : liveOrders) {
+        orderBook->cancelOrder(liveOrder.order);
+    }
+    liveOrders.clear();
+    reference.clear();
+    tape.read(trades.data(), trades.size());
+    MarketSnapshot<Price, Quantity> snapshot = orderBook->getSnapshot();
+    baseVolume = snapshot.volume;
+    baseTradeCount = snapshot.tradeCount;
+    stepCount = 0;
+}
+
+/**
+ * Resets, then runs every whole operation of an input, stopping at the first difference, and validates the order
+ * book at the end. An input shorter than an operation only checks the reset left both books empty.
+ *
+ * @param data Input
+ * @param size Size of the input in bytes
+ * @return Whether the books agreed after every step
+ */
+template <typename OrderBook>
+bool BookFuzzer<OrderBook>::run(const uint8_t *data, size_t size) {
+    reset();
+    if (!compare()) {
+        return false;
+    }
+    for (size_t offset = 0; offset + OPERATION_SIZE <= size; offset += OPERATION_SIZE) {
+        if (!step(data + offset)) {
+            return false;
+        }
+    }
+    if (!orderBook->validate()) {
+        return report("invariant");
+    }
+    return true;
+}
+
+/**
+ * Applies one operation to both books, then compares them. The low two bits of the first byte choose the operation,
+ * two of four are adds so the books fill up, and the third bit chooses the side of an add:
+ * - Add: price from the second byte within PRICE_WINDOW ticks, quantity from the third, owner from the fourth. The
+ *   order book is executed until it is no longer crossed.
+ * - Cancel: the live order picked by the second and third bytes.
+ * - Decrease: the live order picked by the second and third bytes, by an amount from the fourth that leaves it with
+ *   some quantity.
+ * Orders the reference book filled are then no longer live.
+ *
+ * @param operation OPERATION_SIZE bytes of input
+ * @return Whether the books agree
+ */
+template <typename OrderBook>
+bool BookFuzzer<OrderBook>::step(const uint8_t *operation) {
+    stepCount++;
+    uint8_t kind = operation[0] & 3;
+    size_t pick = operation[1] | operation[2] << 8;
+    if (kind <= 1) {
+        bool isBuy = (operation[0] & 4) != 0;
+        Price price = toPrice(BASE_TICK + operation[1] % PRICE_WINDOW);
+        Quantity quantity = 1 + operation[2] % MAX_QUANTITY;
+        OrderHandle order = orderBook->addOrder(price, quantity, isBuy, 0, operation[3]);
+        if (order == nullptr) {
+            return report("order book rejected an order");
+        }
+        liveOrders.push_back({order, order->getId(), isBuy});
+        reference.addOrder(order->getId(), price, quantity, isBuy);
+        while (orderBook->executeOrder()) {
+        }
+    } else if (!liveOrders.empty()) {
+        LiveOrder &liveOrder = liveOrders[pick % liveOrders.size()];
+        Quantity quantity = reference.getQuantity(liveOrder.id, liveOrder.isBuy);
+        if (kind == 2) {
+            orderBook->cancelOrder(liveOrder.order);
+            reference.cancelOrder(liveOrder.id, liveOrder.isBuy);
+        } else if (quantity > 1) {
+            Quantity amount = 1 + operation[3] % (quantity - 1);
+            liveOrder.order->decreaseQuantity(amount);
+            reference.decreaseQuantity(liveOrder.id, liveOrder.isBuy, amount);
+        }
+    }
+
+    for (size_t i = 0; i < liveOrders.size();) {
+        if (reference.getQuantity(liveOrders[i].id, liveOrders[i].isBuy) == 0) {
+            liveOrders[i] = liveOrders.back();
+            liveOrders.pop_back();
+        } else {
+            i++;
+        }
+    }
+    return compare();
+}
+
+/**
+ * Compares the fills published since the last comparison, the best bid and offer, the traded totals and both sides
+ * of the order book with the reference book.
+ *
+ * @return Whether the books agree
+ */
+template <typename OrderBook>
+bool BookFuzzer<OrderBook>::compare() {
+    const std::vector<ReferenceFill<Price, Quantity>> &fills = reference.getFills();
+    size_t tradeCount = tape.read(trades.data(), trades.size());
+    if (tape.getDroppedCount() != 0 || tradeCount != fills.size()) {
+        return report("number of fills");
+    }
+    for (size_t i = 0; i < tradeCount; i++) {
+        if (trades[i].price != fills[i].price || trades[i].quantity != fills[i].quantity ||
+            trades[i].buyOrderId != fills[i].buyOrderId || trades[i].sellOrderId != fills[i].sellOrderId) {
+            return report("fill");
+        }
+    }
+    reference.clearFills();
+
+    MarketSnapshot<Price, Quantity> snapshot = orderBook->getSnapshot();
+    const auto &bids = reference.getBids();
+    const auto &asks = reference.getAsks();
+    if (snapshot.bestBid != (bids.empty() ? 0 : bids.rbegin()->first) ||
+        snapshot.bestAsk != (asks.empty() ? 0 : asks.begin()->first)) {
+        return report("best price");
+    }
+    if (snapshot.volume - baseVolume != reference.getVolume() ||
+        snapshot.tradeCount - baseTradeCount != reference.getTradeCount()) {
+        return report("traded totals");
+    }
+    return compareSide(true) && compareSide(false);
+}
+
+/**
+ * Compares one side of the order book with the reference book. Walks the order book from the limit of its best
+ * price outwards through the price index, checking the price, volume and size of each limit and the ID and quantity
+ * of each order in time priority.
+ *
+ * @param isBuy Boolean indicating if the buy side is compared
+ * @return Whether the sides are the same
+ */
+template <typename OrderBook>
+bool BookFuzzer<OrderBook>::compareSide(bool isBuy) {
+    using Limit = typename OrderBook::Limit;
+    const auto &levels = isBuy ? reference.getBids() : reference.getAsks();
+    MarketSnapshot<Price, Quantity> snapshot = orderBook->getSnapshot();
+    auto *priceIndex = orderBook->getPriceIndex(isBuy);
+    const Limit *limit = levels.empty() ? nullptr : priceIndex->find(isBuy ? snapshot.bestBid : snapshot.bestAsk);
+    if (limit != nullptr && limit->getHeadOrder() == nullptr) {
+        return report("best limit has no orders");
+    }
+
+    auto compareLevel = [&](const std::pair<const Price, typename ReferenceBook<Traits>::Level> &level) {
+        if (limit == nullptr || limit->getPrice() != level.first || limit->getSize() != (int) level.second.size()) {
+            return report("limit");
+        }
+        Quantity volume = 0;
+        const Order *order = limit->getHeadOrder();
+        for (const ReferenceOrder<Quantity> &referenceOrder : level.second) {
+            if (order == nullptr || order->getId() != referenceOrder.id ||
+                order->getQuantity() != referenceOrder.quantity || order->getParentLimit() != limit) {
+                return report("order");
+            }
+            volume += referenceOrder.quantity;
+            order = order->getNextOrder();
+        }
+        if (order != nullptr || limit->getTotalVolume() != volume) {
+            return report("limit volume");
+        }
+        const Order *nextOrder = priceIndex->getNextOuterOrder(limit);
+        limit = nextOrder == nullptr ? nullptr : nextOrder->getParentLimit();
+        return true;
+    };
+    if (isBuy) {
+        for (auto level = levels.rbegin(); level != levels.rend(); ++level) {
+            if (!compareLevel(*level)) {
+                return false;
+            }
+        }
+    } else {
+        for (const auto &level : levels) {
+            if (!compareLevel(level)) {
+                return false;
+            }
+        }
+    }
+    if (limit != nullptr) {
+        return report("extra limit");
+    }
+    return true;
+}
+
+/**
+ * Prints a difference found at the current step.
+ *
+ * @param difference Description of the difference
+ * @return false
+ */
+template <typename OrderBook>
+bool BookFuzzer<OrderBook>::report(const char *difference) const {
+    std::cout << "Order book differs from reference at step " << stepCount << ": " << difference << "." << std::endl;
+    return false;
+}
+
+template class BookFuzzer<OrderBook>;
+template class BookFuzzer<EquityOrderBook>;
+template class BookFuzzer<FuturesOrderBook>;
+template class BookFuzzer<CryptoOrderBook>;
@@ -0,0 +1,192 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_BOOKFUZZER_H
+#define ORDER_BOOK_BOOKFUZZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ReferenceBook.h"
+#include "TradeTape.h"
+
+/**
+ * Differential fuzzer driving an order book and a reference book with the same operations and comparing them after
+ * every step.
+ *
+ * Input is read as 4 byte operations: adds at a price in a narrow window so orders cross often, cancels and quantity
+ * decreases of a live order picked by the input. After each step the fills published to the trade tape, the best
+ * prices and volumes, the traded totals and every level and order of both sides are compared with the reference
+ * book. The first difference is printed and stops the run.
+ *
+ * @tparam OrderBook Type of the order book
+ */
+template <typename OrderBook>
+class BookFuzzer {
+public:
+    using Traits = typename OrderBook::Traits;
+    using Price = typename OrderBook::Price;
+    using Quantity = typename OrderBook::Quantity;
+    using Order = typename OrderBook::Order;
+    using OrderHandle = typename OrderBook::OrderHandle;
+    using Trade = typename OrderBook::Trade;
+
+    /**
+     * Bytes of input read per operation.
+     */
+    static const size_t OPERATION_SIZE = 4;
+
+    /**
+     * Tick of the lowest price orders are added at.
+     */
+    static const int32_t BASE_TICK = 1000;
+
+    /**
+     * Number of ticks orders are added across.
+     */
+    static const int32_t PRICE_WINDOW = 32;
+
+    /**
+     * Largest quantity of an added order.
+     */
+    static const int32_t MAX_QUANTITY = 16;
+
+private:
+    /**
+     * Order of the order book believed to be live.
+     */
+    struct LiveOrder {
+        /**
+         * Handle to the order in the order book.
+         */
+        OrderHandle order;
+
+        /**
+         * ID of the order.
+         */
+        int id;
+
+        /**
+         * Boolean indicating if the order is a buy order.
+         */
+        bool isBuy;
+    };
+
+    /**
+     * Order book under test.
+     */
+    OrderBook *orderBook;
+
+    /**
+     * Reference book the order book is compared against.
+     */
+    ReferenceBook<Traits> reference;
+
+    /**
+     * Trade tape the order book publishes fills to.
+     */
+    TradeTape<Trade> tape;
+
+    /**
+     * Buffer fills are read from the trade tape into.
+     */
+    std::vector<Trade> trades;
+
+    /**
+     * Orders live in the reference book, in the order book if it agrees.
+     */
+    std::vector<LiveOrder> liveOrders;
+
+    /**
+     * Price of tick 0.
+     */
+    double minPrice;
+
+    /**
+     * Price difference between ticks.
+     */
+    double tickSize;
+
+    /**
+     * Number of steps run since the last reset.
+     */
+    uint64_t stepCount;
+
+    /**
+     * Volume the order book had traded at the last reset.
+     */
+    Quantity baseVolume;
+
+    /**
+     * Number of trades the order book had made at the last reset.
+     */
+    uint64_t baseTradeCount;
+
+    /**
+     * Convert a price in ticks to the price type of the order book. Integer prices are the ticks themselves.
+     *
+     * @param priceTicks Price in ticks
+     * @return Price in the order book
+     */
+    Price toPrice(int32_t priceTicks) const;
+
+    /**
+     * Compare one side of the order book with the reference book, level by level and order by order.
+     *
+     * @param isBuy Boolean indicating if the buy side is compared
+     * @return Whether the sides are the same
+     */
+    bool compareSide(bool isBuy);
+
+    /**
+     * Print a difference found at the current step.
+     *
+     * @param difference Description of the difference
+     * @return false
+     */
+    bool report(const char *difference) const;
+
+public:
+    /**
+     * Constructor for BookFuzzer.
+     *
+     * @param orderBook Empty order book to test, its trade tape is replaced
+     * @param minPrice Price of tick 0
+     * @param tickSize Price difference between ticks
+     */
+    BookFuzzer(OrderBook *orderBook, double minPrice, double tickSize);
+
+    /**
+     * Cancel every live order so both books are empty, and restart the step count.
+     */
+    void reset();
+
+    /**
+     * Reset, then run every whole operation of an input and validate the order book. Prints the first difference
+     * found.
+     *
+     * @param data Input
+     * @param size Size of the input in bytes
+     * @return Whether the books agreed after every step
+     */
+    bool run(const uint8_t *data, size_t size);
+
+    /**
+     * Apply one operation to both books and compare them. Prints the difference if they differ.
+     *
+     * @param operation OPERATION_SIZE bytes of input
+     * @return Whether the books agree
+     */
+    bool step(const uint8_t *operation);
+
+    /**
+     * Compare the order book with the reference book. Prints the difference if they differ.
+     *
+     * @return Whether the books agree
+     */
+    bool compare();
+};
+
+
+#endif //ORDER_BOOK_BOOKFUZZER_H
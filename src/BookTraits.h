@@ -0,0 +1,57 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_BOOKTRAITS_H
+#define ORDER_BOOK_BOOKTRAITS_H
+
+#include "Policies.h"
+
+template <typename Traits>
+class BasicOrder;
+
+template <typename Traits>
+class BasicOrderHandle;
+
+template <typename Traits>
+class BasicLimit;
+
+template <typename Traits>
+struct LimitColdData;
+
+struct OrderColdData;
+
+template <typename PricePolicy, typename QuantityPolicy, typename IndexPolicy, typename AllocPolicy,
+          typename ListenerPolicy>
+class BasicOrderBook;
+
+/**
+ * Types an order book is built from, derived from its policies and shared by its orders, limits, sides and price
+ * indexes.
+ */
+template <typename PricePolicy, typename QuantityPolicy, typename IndexPolicy, typename AllocPolicy,
+          typename ListenerPolicy>
+struct BookTraits {
+    using Price = typename PricePolicy::Price;
+    using Quantity = typename QuantityPolicy::Quantity;
+    using Order = BasicOrder<BookTraits>;
+    using OrderHandle = BasicOrderHandle<BookTraits>;
+    using Limit = BasicLimit<BookTraits>;
+    using OrderBook = BasicOrderBook<PricePolicy, QuantityPolicy, IndexPolicy, AllocPolicy, ListenerPolicy>;
+    using OrderPool = typename AllocPolicy::template OrderPool<Order, OrderColdData>;
+    using LimitPool = typename AllocPolicy::template LimitPool<Limit, LimitColdData<BookTraits>>;
+    using Index = IndexPolicy;
+    using PriceIndex = typename IndexPolicy::template Index<BookTraits>;
+    using Listener = ListenerPolicy;
+
+    static constexpr int64_t FIXED_POINT_SCALE = PricePolicy::FIXED_POINT_SCALE;
+};
+
+/**
+ * Types of the default order book, with float prices, 32-bit quantities, the price index chosen at runtime and
+ * events printed to stdout.
+ */
+using DefaultBookTraits = BookTraits<FloatPrice, Int32Quantity, RuntimeIndex, PoolAllocator<>, StdoutListener>;
+
+
+#endif //ORDER_BOOK_BOOKTRAITS_H
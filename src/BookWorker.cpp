@@ -0,0 +1,67 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "BookWorker.h"
+
+/**
+ * Constructor for BookWorker, looking up the NUMA node of the CPU.
+ *
+ * @param cpu CPU to pin the worker to
+ */
+BookWorker::BookWorker(int cpu) : cpu(cpu), node(Numa::getNodeOfCpu(cpu)), isPinned(false) {}
+
+/**
+ * Destructor for BookWorker, waiting for the worker thread to finish so it never outlives the worker.
+ */
+BookWorker::~BookWorker() {
+    join();
+}
+
+/**
+ * Pins the calling thread to the CPU and binds its arena mappings to the node of the CPU, then prints where the
+ * worker was placed as a single write so lines of workers starting together do not interleave. If pinning fails the
+ * thread may run on a remote node, so its mappings are left to first touch instead of bound to the node.
+ */
+void BookWorker::place() {
+    isPinned = Numa::pinThread(cpu);
+    Arena::setNode(isPinned ? node : -1);
+    std::cout << "Worker on CPU " + std::to_string(cpu) + ": node " + std::to_string(node) + ", " +
+                 (isPinned ? "pinned." : "not pinned, memory placed by first touch.") + "\n" << std::flush;
+}
+
+/**
+ * Waits for the worker thread to finish its body, if it was started.
+ */
+void BookWorker::join() {
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+/**
+ * Getter for the CPU the worker is pinned to.
+ *
+ * @return CPU of the worker
+ */
+int BookWorker::getCpu() const {
+    return cpu;
+}
+
+/**
+ * Getter for the NUMA node of the worker.
+ *
+ * @return Node of the worker
+ */
+int BookWorker::getNode() const {
+    return node;
+}
+
+/**
+ * Getter for boolean indicating if the worker was pinned to its CPU.
+ *
+ * @return Whether the worker was pinned
+ */
+bool BookWorker::getIsPinned() const {
+    return isPinned;
+}
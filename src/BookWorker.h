@@ -0,0 +1,107 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_BOOKWORKER_H
+#define ORDER_BOOK_BOOKWORKER_H
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include "Arena.h"
+#include "Numa.h"
+
+/**
+ * Thread owning a shard of order books, pinned to a CPU with its memory on the NUMA node of that CPU.
+ *
+ * The worker pins itself and binds its arena mappings to its node before running its body, so the order books, trade
+ * tapes and order maps the body creates are first touched, or bound, on the local node. Every thread has its own
+ * order and limit pools, reserved by its first allocation, so each worker has pools of its own on its node and shards
+ * of the same order book type on different workers share no pool state. Order books must only be used on the worker
+ * that created them. A placement line is printed when the worker starts.
+ */
+class BookWorker {
+private:
+    /**
+     * CPU the worker is pinned to.
+     */
+    int cpu;
+
+    /**
+     * NUMA node of the CPU.
+     */
+    int node;
+
+    /**
+     * Boolean indicating if the worker was pinned to its CPU.
+     */
+    bool isPinned;
+
+    /**
+     * Thread of the worker.
+     */
+    std::thread thread;
+
+    /**
+     * Pin the calling thread to the CPU, bind its arena mappings to the node and print a placement line.
+     */
+    void place();
+
+public:
+    /**
+     * Constructor for BookWorker.
+     *
+     * @param cpu CPU to pin the worker to
+     */
+    explicit BookWorker(int cpu);
+
+    /**
+     * Destructor for BookWorker, waiting for the worker thread to finish.
+     */
+    ~BookWorker();
+
+    /**
+     * Start the worker thread, which places itself and then runs the body. Order books should be created inside the
+     * body so their memory is on the node of the worker.
+     *
+     * @tparam Body Type of the body
+     * @param body Function run on the worker thread
+     */
+    template <typename Body>
+    void start(Body body) {
+        thread = std::thread([this, body = std::move(body)]() mutable {
+            place();
+            body();
+        });
+    }
+
+    /**
+     * Wait for the worker thread to finish its body.
+     */
+    void join();
+
+    /**
+     * Getter for the CPU the worker is pinned to.
+     *
+     * @return CPU of the worker
+     */
+    int getCpu() const;
+
+    /**
+     * Getter for the NUMA node of the worker.
+     *
+     * @return Node of the worker
+     */
+    int getNode() const;
+
+    /**
+     * Getter for boolean indicating if the worker was pinned to its CPU, valid once the body is running.
+     *
+     * @return Whether the worker was pinned
+     */
+    bool getIsPinned() const;
+};
+
+
+#endif //ORDER_BOOK_BOOKWORKER_H
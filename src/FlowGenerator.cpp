@@ -0,0 +1,305 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "FlowGenerator.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Constructor for FlowGenerator.
+ *
+ * @param config Parameters of the flow
+ */
+FlowGenerator::FlowGenerator(const FlowConfig &config) : config(config), engine(config.seed) {
+}
+
+/**
+ * Adds an order to the model behind the orders at its price, then matches the inside orders in price-time priority
+ * while the model is crossed, as the order book does when executing a crossing order.
+ *
+ * @param priceTicks Price in ticks
+ * @param quantity Quantity
+ * @param isBuy Boolean indicating if the order is a buy order
+ * @param messageIndex Index of the add message
+ * @return Order number
+ */
+uint32_t FlowGenerator::addToModel(int32_t priceTicks, int32_t quantity, bool isBuy, uint64_t messageIndex) {
+    auto orderRef = static_cast<uint32_t>(orders.size());
+    orders.push_back({priceTicks, quantity, isBuy});
+    livePositions.push_back(static_cast<uint32_t>(liveOrders.size()));
+    liveOrders.push_back(orderRef);
+    (isBuy ? bids : asks)[priceTicks].push_back(orderRef);
+    (isBuy ? bidVolumes : askVolumes)[priceTicks] += quantity;
+    std::exponential_distribution<double> lifetime(1 / config.meanLifetime);
+    expiries.emplace(messageIndex + static_cast<uint64_t>(lifetime(engine)), orderRef);
+
+    while (!bidVolumes.empty() && !askVolumes.empty() && bidVolumes.rbegin()->first >= askVolumes.begin()->first) {
+        std::deque<uint32_t> &buyQueue = bids[bidVolumes.rbegin()->first];
+        std::deque<uint32_t> &sellQueue = asks[askVolumes.begin()->first];
+        while (orders[buyQueue.front()].quantity == 0) {
+            buyQueue.pop_front();
+        }
+        while (orders[sellQueue.front()].quantity == 0) {
+            sellQueue.pop_front();
+        }
+        uint32_t buyRef = buyQueue.front();
+        uint32_t sellRef = sellQueue.front();
+        int32_t fillQuantity = std::min(orders[buyRef].quantity, orders[sellRef].quantity);
+        removeFromModel(buyRef, fillQuantity);
+        removeFromModel(sellRef, fillQuantity);
+    }
+    return orderRef;
+}
+
+/**
+ * Removes quantity from a live order in the model. Price levels without live volume are removed, and orders without
+ * quantity are no longer live.
+ *
+ * @param orderRef Order number
+ * @param quantity Quantity to remove
+ */
+void FlowGenerator::removeFromModel(uint32_t orderRef, int32_t quantity) {
+    ModelOrder &order = orders[orderRef];
+    order.quantity -= quantity;
+    std::map<int32_t, int64_t> &volumes = order.isBuy ? bidVolumes : askVolumes;
+    auto volume = volumes.find(order.priceTicks);
+    volume->second -= quantity;
+    if (volume->second == 0) {
+        volumes.erase(volume);
+        (order.isBuy ? bids : asks).erase(order.priceTicks);
+    }
+
+    if (order.quantity == 0) {
+        uint32_t position = livePositions[orderRef];
+        liveOrders[position] = liveOrders.back();
+        livePositions[liveOrders[position]] = position;
+        liveOrders.pop_back();
+    }
+}
+
+/**
+ * Draws the distance of a passive order from the inside from the configured distribution.
+ *
+ * @return Distance in ticks
+ */
+int32_t FlowGenerator::drawDistance() {
+    int32_t distance;
+    if (config.priceDistance == PriceDistance::GEOMETRIC) {
+        std::geometric_distribution<int32_t> geometric(1 / (config.meanDistanceTicks + 1));
+        distance = geometric(engine);
+    } else {
+        std::uniform_int_distribution<int32_t> uniform(0, config.maxDistanceTicks);
+        distance = uniform(engine);
+    }
+    return std::min(distance, config.maxDistanceTicks);
+}
+
+/**
+ * Generates the flow. Each message is a passive add, cancel, modify or aggressive add drawn by the configured
+ * weights, falling back to a passive add if there is no order to act on. Passive orders are placed behind the inside
+ * of their side without crossing, aggressive orders are priced through the opposite inside. Cancels take the live
+ * order whose lifetime ends first, modifies take a random live order and draw a new quantity. Times between messages
+ * are exponential, shortened during bursts.
+ *
+ * @param messages Messages to append to
+ * @return Header of the flow
+ */
+FlowHeader FlowGenerator::generate(std::vector<FlowMessage> &messages) {
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::uniform_int_distribution<int32_t> quantities(1, config.maxQuantity);
+    std::uniform_int_distribution<int32_t> owners(1, config.ownerCount);
+    std::uniform_int_distribution<int32_t> aggression(0, config.maxAggressionTicks);
+    std::exponential_distribution<double> gaps(1);
+    double totalWeight = config.addWeight + config.cancelWeight + config.modifyWeight + config.aggressiveWeight;
+    uint64_t time = 0;
+    uint32_t burstRemaining = 0;
+    messages.reserve(messages.size() + config.messageCount);
+
+    for (uint64_t i = 0; i < config.messageCount; i++) {
+        if (burstRemaining == 0 && unit(engine) < config.burstProbability) {
+            burstRemaining = config.burstLength;
+        }
+        double meanGap = burstRemaining > 0 ? config.meanGapNanos / config.burstFactor : config.meanGapNanos;
+        burstRemaining -= burstRemaining > 0;
+        time += static_cast<uint64_t>(gaps(engine) * meanGap) + 1;
+
+        FlowMessage message = {};
+        message.time = time;
+        double draw = unit(engine) * totalWeight;
+        bool isBuy = unit(engine) < 0.5;
+        if (draw >= config.addWeight && draw < config.addWeight + config.cancelWeight && !liveOrders.empty()) {
+            // Cancel the live order whose lifetime ends first
+            while (orders[expiries.top().second].quantity == 0) {
+                expiries.pop();
+            }
+            uint32_t orderRef = expiries.top().second;
+            expiries.pop();
+            message.type = FlowType::CANCEL;
+            message.orderRef = orderRef;
+            message.isBuy = orders[orderRef].isBuy;
+            removeFromModel(orderRef, orders[orderRef].quantity);
+        } else if (draw >= config.addWeight + config.cancelWeight &&
+                   draw < config.addWeight + config.cancelWeight + config.modifyWeight && !liveOrders.empty()) {
+            // Modify a random live order, an increase loses priority
+            uint32_t orderRef = liveOrders[engine() % liveOrders.size()];
+            ModelOrder &order = orders[orderRef];
+            int32_t quantity = quantities(engine);
+            if (quantity < order.quantity) {
+                removeFromModel(orderRef, order.quantity - quantity);
+            } else if (quantity > order.quantity) {
+                std::deque<uint32_t> &queue = (order.isBuy ? bids : asks)[order.priceTicks];
+                queue.erase(std::find(queue.begin(), queue.end(), orderRef));
+                queue.push_back(orderRef);
+                (order.isBuy ? bidVolumes : askVolumes)[order.priceTicks] += quantity - order.quantity;
+                order.quantity = quantity;
+            }
+            message.type = FlowType::MODIFY;
+            message.orderRef = orderRef;
+            message.quantity = quantity;
+            message.isBuy = order.isBuy;
+        } else {
+            int32_t priceTicks;
+            const std::map<int32_t, int64_t> &opposite = isBuy ? askVolumes : bidVolumes;
+            if (draw >= totalWeight - config.aggressiveWeight && !opposite.empty()) {
+                // Price through the opposite inside
+                priceTicks = isBuy ? opposite.begin()->first + aggression(engine) :
+                             opposite.rbegin()->first - aggression(engine);
+            } else {
+                // Place behind the inside of the side without crossing
+                const std::map<int32_t, int64_t> &same = isBuy ? bidVolumes : askVolumes;
+                int32_t inside = config.startTick;
+                if (!same.empty()) {
+                    inside = isBuy ? same.rbegin()->first : same.begin()->first;
+                } else if (!opposite.empty()) {
+                    inside = isBuy ? opposite.begin()->first - 1 : opposite.rbegin()->first + 1;
+                }
+                priceTicks = isBuy ? inside - drawDistance() : inside + drawDistance();
+                if (!opposite.empty()) {
+                    priceTicks = isBuy ? std::min(priceTicks, opposite.begin()->first - 1) :
+                                 std::max(priceTicks, opposite.rbegin()->first + 1);
+                }
+            }
+            priceTicks = std::max(0, std::min(priceTicks, config.tickCount - 1));
+            message.type = FlowType::ADD;
+            message.priceTicks = priceTicks;
+            message.quantity = quantities(engine);
+            message.isBuy = isBuy;
+            message.owner = static_cast<uint16_t>(owners(engine));
+            message.orderRef = addToModel(priceTicks, message.quantity, isBuy, i);
+        }
+        messages.push_back(message);
+    }
+
+    FlowHeader header = {};
+    header.magic = FlowFile::MAGIC;
+    header.version = FlowFile::VERSION;
+    header.messageSize = sizeof(FlowMessage);
+    header.messageCount = messages.size();
+    header.orderCount = orders.size();
+    header.seed = config.seed;
+    header.minPrice = config.minPrice;
+    header.tickSize = config.tickSize;
+    return header;
+}
+
+/**
+ * Writes a flow to a file, the header followed by the messages.
+ *
+ * @param path Path of the file
+ * @param header Header of the flow
+ * @param messages Messages of the flow
+ * @return Whether the file was written
+ */
+bool FlowGenerator::write(const char *path, const FlowHeader &header, const std::vector<FlowMessage> &messages) {
+    FILE *file = std::fopen(path, "wb");
+    if (file == nullptr) {
+        std::cout << "Flow file could not be written." << std::endl;
+        return false;
+    }
+    bool isWritten = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                     std::fwrite(messages.data(), sizeof(FlowMessage), messages.size(), file) == messages.size();
+    if (std::fclose(file) != 0 || !isWritten) {
+        std::cout << "Flow file could not be written." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Constructor for FlowFile.
+ */
+FlowFile::FlowFile() {
+    this->mapping = nullptr;
+    this->size = 0;
+}
+
+/**
+ * Destructor for FlowFile.
+ */
+FlowFile::~FlowFile() {
+    if (mapping != nullptr) {
+        munmap(mapping, size);
+    }
+}
+
+/**
+ * Maps a flow file read-only and checks its header against the size of the file.
+ *
+ * @param path Path of the file
+ * @return Whether the file was mapped
+ */
+bool FlowFile::open(const char *path) {
+    int fd = ::open(path, O_RDONLY);
+    struct stat status = {};
+    if (fd < 0 || fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(FlowHeader)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        std::cout << "Flow file could not be opened." << std::endl;
+        return false;
+    }
+    void *memory = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        std::cout << "Flow file could not be opened." << std::endl;
+        return false;
+    }
+
+    const auto *header = static_cast<const FlowHeader *>(memory);
+    if (header->magic != MAGIC || header->version != VERSION || header->messageSize != sizeof(FlowMessage) ||
+        sizeof(FlowHeader) + header->messageCount * sizeof(FlowMessage) > static_cast<size_t>(status.st_size)) {
+        munmap(memory, status.st_size);
+        std::cout << "Flow file is not valid." << std::endl;
+        return false;
+    }
+    if (mapping != nullptr) {
+        munmap(mapping, size);
+    }
+    this->mapping = memory;
+    this->size = status.st_size;
+    return true;
+}
+
+/**
+ * Getter for the header of the mapped file.
+ *
+ * @return Header of the flow
+ */
+const FlowHeader &FlowFile::getHeader() const {
+    return *static_cast<const FlowHeader *>(mapping);
+}
+
+/**
+ * Getter for the messages of the mapped file, which follow the header.
+ *
+ * @return First message of the flow
+ */
+const FlowMessage *FlowFile::getMessages() const {
+    return reinterpret_cast<const FlowMessage *>(static_cast<const char *>(mapping) + sizeof(FlowHeader));
+}
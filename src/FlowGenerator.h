@@ -0,0 +1,442 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_FLOWGENERATOR_H
+#define ORDER_BOOK_FLOWGENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+/**
+ * Type of an order flow message.
+ */
+enum class FlowType : uint8_t {
+    /**
+     * Add an order, which executes against the opposite side if it crosses.
+     */
+    ADD,
+
+    /**
+     * Cancel an order.
+     */
+    CANCEL,
+
+    /**
+     * Change the quantity of an order, keeping its priority if the quantity decreases.
+     */
+    MODIFY
+};
+
+/**
+ * Order flow message, 24 bytes in the flow file.
+ */
+struct FlowMessage {
+    /**
+     * Exchange time of the message in nanoseconds.
+     */
+    uint64_t time;
+
+    /**
+     * Number of the order the message is for, counting up from 0 in order of the add messages.
+     */
+    uint32_t orderRef;
+
+    /**
+     * Price of an added order in ticks above the minimum price.
+     */
+    int32_t priceTicks;
+
+    /**
+     * Quantity of an added order, or new quantity of a modified order.
+     */
+    int32_t quantity;
+
+    /**
+     * Type of the message.
+     */
+    FlowType type;
+
+    /**
+     * Boolean indicating if the order is a buy order.
+     */
+    uint8_t isBuy;
+
+    /**
+     * ID of the participant owning the order.
+     */
+    uint16_t owner;
+};
+
+/**
+ * Header of a flow file, followed by the messages.
+ */
+struct FlowHeader {
+    /**
+     * Marker of a flow file.
+     */
+    uint64_t magic;
+
+    /**
+     * Layout version of the file.
+     */
+    uint32_t version;
+
+    /**
+     * Size of a message in bytes.
+     */
+    uint32_t messageSize;
+
+    /**
+     * Number of messages.
+     */
+    uint64_t messageCount;
+
+    /**
+     * Number of orders added.
+     */
+    uint64_t orderCount;
+
+    /**
+     * Seed the flow was generated from.
+     */
+    uint64_t seed;
+
+    /**
+     * Price of tick 0.
+     */
+    double minPrice;
+
+    /**
+     * Price difference between ticks.
+     */
+    double tickSize;
+};
+
+/**
+ * Distribution of the distance of passive orders from the inside of the book.
+ */
+enum class PriceDistance {
+    /**
+     * Geometric, most orders join or sit just behind the inside.
+     */
+    GEOMETRIC,
+
+    /**
+     * Uniform up to the maximum distance.
+     */
+    UNIFORM
+};
+
+/**
+ * Parameters of a generated order flow.
+ */
+struct FlowConfig {
+    /**
+     * Seed of the random number generator, the same seed always generates the same flow.
+     */
+    uint64_t seed = 1;
+
+    /**
+     * Number of messages.
+     */
+    uint64_t messageCount = 1000000;
+
+    /**
+     * Price of tick 0.
+     */
+    double minPrice = 100;
+
+    /**
+     * Price difference between ticks.
+     */
+    double tickSize = 0.01;
+
+    /**
+     * Number of valid ticks, prices are kept within [0, tickCount).
+     */
+    int32_t tickCount = 1 << 18;
+
+    /**
+     * Tick orders are placed around while the book is empty.
+     */
+    int32_t startTick = 10000;
+
+    /**
+     * Distribution of the distance of passive orders from the inside.
+     */
+    PriceDistance priceDistance = PriceDistance::GEOMETRIC;
+
+    /**
+     * Mean distance of passive orders from the inside in ticks, for the geometric distribution.
+     */
+    double meanDistanceTicks = 3;
+
+    /**
+     * Maximum distance of passive orders from the inside in ticks.
+     */
+    int32_t maxDistanceTicks = 50;
+
+    /**
+     * Maximum number of ticks an aggressive order is priced through the opposite inside.
+     */
+    int32_t maxAggressionTicks = 2;
+
+    /**
+     * Maximum quantity of an order, quantities are uniform from 1.
+     */
+    int32_t maxQuantity = 100;
+
+    /**
+     * Number of participants owning orders, owners are uniform from 1.
+     */
+    uint16_t ownerCount = 16;
+
+    /**
+     * Relative frequency of passive adds.
+     */
+    double addWeight = 0.45;
+
+    /**
+     * Relative frequency of cancels. Relative to the aggressive weight this sets the cancel to trade ratio.
+     */
+    double cancelWeight = 0.40;
+
+    /**
+     * Relative frequency of modifies.
+     */
+    double modifyWeight = 0.10;
+
+    /**
+     * Relative frequency of aggressive adds.
+     */
+    double aggressiveWeight = 0.05;
+
+    /**
+     * Mean lifetime of an order in messages. Cancels take the live order whose drawn lifetime ends first.
+     */
+    double meanLifetime = 500;
+
+    /**
+     * Mean time between messages in nanoseconds outside bursts.
+     */
+    double meanGapNanos = 1000;
+
+    /**
+     * Probability a message starts a burst.
+     */
+    double burstProbability = 0.01;
+
+    /**
+     * Number of messages in a burst.
+     */
+    uint32_t burstLength = 100;
+
+    /**
+     * Factor the mean time between messages is divided by during a burst.
+     */
+    double burstFactor = 50;
+};
+
+/**
+ * Seeded generator of realistic order flow for benchmarks and replay.
+ *
+ * The generator keeps a model of the book, price levels of order queues matched in price-time priority, so passive
+ * orders are placed relative to the current inside, aggressive orders cross it, and cancels and modifies only refer
+ * to orders that are still live when the flow is replayed into an order book matching in price-time priority.
+ * Everything is drawn from one seeded engine, so a seed and configuration always give the same flow.
+ */
+class FlowGenerator {
+private:
+    /**
+     * State of a generated order in the model.
+     */
+    struct ModelOrder {
+        /**
+         * Price in ticks.
+         */
+        int32_t priceTicks;
+
+        /**
+         * Remaining quantity, 0 once filled or cancelled.
+         */
+        int32_t quantity;
+
+        /**
+         * Boolean indicating if the order is a buy order.
+         */
+        bool isBuy;
+    };
+
+    /**
+     * Parameters of the flow.
+     */
+    FlowConfig config;
+
+    /**
+     * Random number engine.
+     */
+    std::mt19937_64 engine;
+
+    /**
+     * Model state of every added order, indexed by order number.
+     */
+    std::vector<ModelOrder> orders;
+
+    /**
+     * Queues of order numbers at each buy price, may hold orders that are no longer live.
+     */
+    std::map<int32_t, std::deque<uint32_t>> bids;
+
+    /**
+     * Queues of order numbers at each sell price, may hold orders that are no longer live.
+     */
+    std::map<int32_t, std::deque<uint32_t>> asks;
+
+    /**
+     * Live volume at each buy price.
+     */
+    std::map<int32_t, int64_t> bidVolumes;
+
+    /**
+     * Live volume at each sell price.
+     */
+    std::map<int32_t, int64_t> askVolumes;
+
+    /**
+     * Order numbers of live orders.
+     */
+    std::vector<uint32_t> liveOrders;
+
+    /**
+     * Position of each order in liveOrders.
+     */
+    std::vector<uint32_t> livePositions;
+
+    /**
+     * End of the drawn lifetime of each order, earliest first.
+     */
+    std::priority_queue<std::pair<uint64_t, uint32_t>, std::vector<std::pair<uint64_t, uint32_t>>,
+                        std::greater<std::pair<uint64_t, uint32_t>>> expiries;
+
+    /**
+     * Add an order to the model and match it against the opposite side.
+     *
+     * @param priceTicks Price in ticks
+     * @param quantity Quantity
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @param messageIndex Index of the add message
+     * @return Order number
+     */
+    uint32_t addToModel(int32_t priceTicks, int32_t quantity, bool isBuy, uint64_t messageIndex);
+
+    /**
+     * Remove quantity from a live order in the model, removing the order once it has none left.
+     *
+     * @param orderRef Order number
+     * @param quantity Quantity to remove
+     */
+    void removeFromModel(uint32_t orderRef, int32_t quantity);
+
+    /**
+     * Draw the distance of a passive order from the inside.
+     *
+     * @return Distance in ticks
+     */
+    int32_t drawDistance();
+
+public:
+    /**
+     * Constructor for FlowGenerator.
+     *
+     * @param config Parameters of the flow
+     */
+    explicit FlowGenerator(const FlowConfig &config);
+
+    /**
+     * Generate the flow.
+     *
+     * @param messages Messages to append to
+     * @return Header of the flow
+     */
+    FlowHeader generate(std::vector<FlowMessage> &messages);
+
+    /**
+     * Write a flow to a file. Prints error message if the file cannot be written.
+     *
+     * @param path Path of the file
+     * @param header Header of the flow
+     * @param messages Messages of the flow
+     * @return Whether the file was written
+     */
+    static bool write(const char *path, const FlowHeader &header, const std::vector<FlowMessage> &messages);
+};
+
+/**
+ * Flow file mapped read-only into memory, so replay reads messages straight from the page cache.
+ */
+class FlowFile {
+private:
+    /**
+     * Start of the mapping, nullptr if no file is mapped.
+     */
+    void *mapping;
+
+    /**
+     * Size of the mapping in bytes.
+     */
+    size_t size;
+
+public:
+    /**
+     * Marker of a flow file.
+     */
+    static const uint64_t MAGIC = 0x574f4c464b4f4f42ull;
+
+    /**
+     * Layout version of the file.
+     */
+    static const uint32_t VERSION = 1;
+
+    /**
+     * Constructor for FlowFile.
+     */
+    FlowFile();
+
+    /**
+     * Destructor for FlowFile, unmapping the file.
+     */
+    ~FlowFile();
+
+    /**
+     * Map a flow file. Prints error message if the file cannot be mapped or is not a flow file.
+     *
+     * @param path Path of the file
+     * @return Whether the file was mapped
+     */
+    bool open(const char *path);
+
+    /**
+     * Getter for the header of the mapped file.
+     *
+     * @return Header of the flow
+     */
+    const FlowHeader &getHeader() const;
+
+    /**
+     * Getter for the messages of the mapped file.
+     *
+     * @return First message of the flow
+     */
+    const FlowMessage *getMessages() const;
+};
+
+
+#endif //ORDER_BOOK_FLOWGENERATOR_H
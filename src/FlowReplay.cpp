@@ -0,0 +1,117 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "FlowReplay.h"
+#include "OrderBook.h"
+#include <type_traits>
+
+/**
+ * Constructor for FlowReplay.
+ *
+ * @param orderBook Order book to replay into
+ * @param header Header of the flow
+ */
+template <typename OrderBook>
+FlowReplay<OrderBook>::FlowReplay(OrderBook *orderBook, const FlowHeader &header) {
+    this->orderBook = orderBook;
+    this->orders.assign(header.orderCount, nullptr);
+    this->minPrice = header.minPrice;
+    this->tickSize = header.tickSize;
+    this->rejectedCount = 0;
+    this->executedCount = 0;
+}
+
+/**
+ * Converts a price in ticks to the price type of the order book.
+ *
+ * @param priceTicks Price in ticks
+ * @return Price in the order book
+ */
+template <typename OrderBook>
+typename FlowReplay<OrderBook>::Price FlowReplay<OrderBook>::toPrice(int32_t priceTicks) const {
+    if (std::is_integral<Price>::value) {
+        return static_cast<Price>(priceTicks);
+    }
+    return static_cast<Price>(minPrice + priceTicks * tickSize);
+}
+
+/**
+ * Applies a message to the order book. Adds are executed while the order book is crossed. A decreased order keeps
+ * its priority, an increased order is cancelled and added again behind the orders at its price. Messages for orders
+ * that were rejected are skipped.
+ *
+ * @param message Message to apply
+ */
+template <typename OrderBook>
+void FlowReplay<OrderBook>::apply(const FlowMessage &message) {
+    OrderHandle &order = orders[message.orderRef];
+    switch (message.type) {
+        case FlowType::ADD:
+            order = orderBook->addOrder(toPrice(message.priceTicks), message.quantity, message.isBuy, message.time,
+                                        message.owner);
+            if (order == nullptr) {
+                rejectedCount++;
+                return;
+            }
+            while (orderBook->executeOrder()) {
+                executedCount++;
+            }
+            break;
+        case FlowType::CANCEL:
+            if (order != nullptr) {
+                orderBook->cancelOrder(order);
+                order = nullptr;
+            }
+            break;
+        case FlowType::MODIFY:
+            if (order == nullptr || message.quantity == order->getQuantity()) {
+                return;
+            }
+            if (message.quantity < order->getQuantity()) {
+                order->decreaseQuantity(order->getQuantity() - message.quantity);
+            } else {
+                Price price = order->getPrice();
+                uint16_t owner = order->getOwner();
+                orderBook->cancelOrder(order);
+                order = orderBook->addOrder(price, message.quantity, message.isBuy, message.time, owner);
+            }
+            break;
+    }
+}
+
+/**
+ * Getter for the handle to the order of an order number.
+ *
+ * @param orderRef Order number
+ * @return Handle to the order, to no order if it was cancelled or rejected
+ */
+template <typename OrderBook>
+typename FlowReplay<OrderBook>::OrderHandle FlowReplay<OrderBook>::getOrder(uint32_t orderRef) const {
+    return orders[orderRef];
+}
+
+/**
+ * Getter for the number of adds the order book rejected.
+ *
+ * @return Number of rejected adds
+ */
+template <typename OrderBook>
+uint64_t FlowReplay<OrderBook>::getRejectedCount() const {
+    return rejectedCount;
+}
+
+/**
+ * Getter for the number of executions.
+ *
+ * @return Number of executions
+ */
+template <typename OrderBook>
+uint64_t FlowReplay<OrderBook>::getExecutedCount() const {
+    return executedCount;
+}
+
+template class FlowReplay<OrderBook>;
+template class FlowReplay<EquityOrderBook>;
+template class FlowReplay<FuturesOrderBook>;
+template class FlowReplay<CryptoOrderBook>;
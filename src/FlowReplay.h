@@ -0,0 +1,107 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_FLOWREPLAY_H
+#define ORDER_BOOK_FLOWREPLAY_H
+
+#include <cstdint>
+#include <vector>
+#include "FlowGenerator.h"
+
+/**
+ * Replays order flow messages into an order book.
+ *
+ * Order numbers of the flow are mapped to the orders the order book returned, adds that cross the book are executed
+ * until it is no longer crossed, and prices in ticks are converted to the price type of the order book.
+ *
+ * @tparam OrderBook Type of the order book
+ */
+template <typename OrderBook>
+class FlowReplay {
+public:
+    using Price = typename OrderBook::Price;
+    using Order = typename OrderBook::Order;
+    using OrderHandle = typename OrderBook::OrderHandle;
+
+private:
+    /**
+     * Order book the flow is replayed into.
+     */
+    OrderBook *orderBook;
+
+    /**
+     * Handle to the order of each order number, to no order once it is cancelled or if it was rejected. Filled orders
+     * are not cleared, the flow never refers to them again.
+     */
+    std::vector<OrderHandle> orders;
+
+    /**
+     * Price of tick 0.
+     */
+    double minPrice;
+
+    /**
+     * Price difference between ticks.
+     */
+    double tickSize;
+
+    /**
+     * Number of adds the order book rejected.
+     */
+    uint64_t rejectedCount;
+
+    /**
+     * Number of executions.
+     */
+    uint64_t executedCount;
+
+public:
+    /**
+     * Constructor for FlowReplay.
+     *
+     * @param orderBook Order book to replay into
+     * @param header Header of the flow
+     */
+    FlowReplay(OrderBook *orderBook, const FlowHeader &header);
+
+    /**
+     * Convert a price in ticks to the price type of the order book. Integer prices are the ticks themselves.
+     *
+     * @param priceTicks Price in ticks
+     * @return Price in the order book
+     */
+    Price toPrice(int32_t priceTicks) const;
+
+    /**
+     * Apply a message to the order book.
+     *
+     * @param message Message to apply
+     */
+    void apply(const FlowMessage &message);
+
+    /**
+     * Getter for the handle to the order of an order number.
+     *
+     * @param orderRef Order number
+     * @return Handle to the order, to no order if it was cancelled or rejected
+     */
+    OrderHandle getOrder(uint32_t orderRef) const;
+
+    /**
+     * Getter for the number of adds the order book rejected.
+     *
+     * @return Number of rejected adds
+     */
+    uint64_t getRejectedCount() const;
+
+    /**
+     * Getter for the number of executions.
+     *
+     * @return Number of executions
+     */
+    uint64_t getExecutedCount() const;
+};
+
+
+#endif //ORDER_BOOK_FLOWREPLAY_H
@@ -0,0 +1,81 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "OrderBook.h"
+#include "BookFuzzer.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+/**
+ * Run an input against an order book, printing the difference and aborting if it differs from the reference book.
+ * Output of the order book is suppressed while the input runs, the run is repeated with output if it fails.
+ *
+ * Books are kept across inputs, since order books are never freed, so each run starts by cancelling the orders the
+ * previous input left behind. Empty limits stay in the price index, which also fuzzes indexes with stale limits.
+ *
+ * @tparam OrderBook Type of the order book
+ * @param name Name of the order book printed with a difference
+ * @param fuzzer Fuzzer of the order book
+ * @param data Input
+ * @param size Size of the input in bytes
+ */
+template <typename OrderBook>
+void fuzz(const char *name, BookFuzzer<OrderBook> &fuzzer, const uint8_t *data, size_t size) {
+    std::cout.setstate(std::ios::badbit);
+    bool isSame = fuzzer.run(data, size);
+    std::cout.clear();
+    if (!isSame) {
+        std::cout << name << ": ";
+        fuzzer.run(data, size);
+        std::abort();
+    }
+}
+
+/**
+ * libFuzzer entry point, runs an input against every price index and preset order book.
+ *
+ * @param data Input
+ * @param size Size of the input in bytes
+ * @return 0
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static BookFuzzer<OrderBook> avl(new OrderBook(PriceIndexType::AVL), 0, 1);
+    static BookFuzzer<OrderBook> bTree(new OrderBook(PriceIndexType::BTREE), 0, 1);
+    static BookFuzzer<OrderBook> ladder(new OrderBook(PriceIndexType::TICK_LADDER, 0, 0.5), 0, 0.5);
+    // Equity and futures books are fixed to a tick ladder at compile time, the index type argument is ignored
+    static BookFuzzer<EquityOrderBook> equity(new EquityOrderBook(PriceIndexType::TICK_LADDER, 100, 0.01), 100, 0.01);
+    static BookFuzzer<FuturesOrderBook> futures(new FuturesOrderBook(), 0, 1);
+    static BookFuzzer<CryptoOrderBook> crypto(new CryptoOrderBook(), 100, 0.25);
+    fuzz("AVL", avl, data, size);
+    fuzz("B+-tree", bTree, data, size);
+    fuzz("Tick ladder", ladder, data, size);
+    fuzz("Equity", equity, data, size);
+    fuzz("Futures", futures, data, size);
+    fuzz("Crypto", crypto, data, size);
+    return 0;
+}
+
+#ifndef ORDER_BOOK_LIBFUZZER
+/**
+ * Run each file given as an input, so a corpus or crash can be replayed without libFuzzer.
+ *
+ * Usage: OrderBookFuzz <file>...
+ */
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::cout << "Input file could not be opened." << std::endl;
+            return 1;
+        }
+        std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    std::cout << "Ran " << argc - 1 << " inputs without differences." << std::endl;
+    return 0;
+}
+#endif
@@ -0,0 +1,411 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "HalfBook.h"
+#include "OrderBook.h"
+#include "Stats.h"
+
+/**
+ * Constructor for HalfBook.
+ *
+ * @param limits Index of limits
+ * @param orderBook Pointer to the order book
+ */
+template <Side S, typename Traits>
+HalfBook<S, Traits>::HalfBook(PriceIndex *limits, OrderBook *orderBook) {
+    this->tree = nullptr;
+    this->best = nullptr;
+    this->isBestDeferred = false;
+    this->staleLimit = nullptr;
+    this->orders = new OrderIndex();
+    this->limits = limits;
+    this->currOrdersId = 0;
+    this->orderBook = orderBook;
+}
+
+/**
+ * Adds an order to the side. If limit price does not exist, creates new limit. Else, adds order to limit.
+ * If the limit price is not valid for the price index, prints error message and returns nullptr.
+ *
+ * @param price Price of the order
+ * @param quantity Quantity of the order
+ * @param time Exchange time the order was placed, in nanoseconds since the epoch
+ * @param sequence Sequence number of the order in the order book
+ * @param owner ID of the participant owning the order, 0 if the order has no owner
+ * @return New order
+ */
+template <Side S, typename Traits>
+typename HalfBook<S, Traits>::Order *HalfBook<S, Traits>::addOrder(Price price, Quantity quantity, uint64_t time,
+                                                                   uint64_t sequence, uint16_t owner) {
+    // If limit price not in index, create new limit in index
+    Limit *limit = limits->find(price);
+    if (limit == nullptr) {
+        if (!limits->isValidPrice(price)) {
+            orderBook->getListener().onError("Price is not a valid tick.");
+            return nullptr;
+        }
+        limit = new Limit(price, IS_BUY, orderBook);
+        limits->insert(limit);
+        Stats::add(Counter::NEW_LIMITS);
+    }
+
+    Order *newOrder = new Order(currOrdersId, price, quantity, IS_BUY, time, sequence, owner);
+    orders->insert(currOrdersId, OrderPool::indexOf(newOrder));
+    currOrdersId++;
+
+    limit->addOrder(newOrder);
+    if (limit->getSize() == 1) {
+        limits->setEmpty(limit, false);
+    }
+
+    // If order is best, update best. While the best order is stale, every limit better than the stale limit is
+    // empty, so an order at or better than it is the best order
+    if (staleLimit != nullptr) {
+        if (!isBetter(staleLimit->getPrice(), price)) {
+            best = newOrder;
+            staleLimit = nullptr;
+        }
+    } else if (best == nullptr || isBetter(price, best->getPrice())) {
+        best = newOrder;
+    }
+
+    // Notify order added
+    orderBook->getListener().onOrderAdded(*newOrder);
+    return newOrder;
+}
+
+/**
+ * Cancels an order by removing from Limit. If order does not exist, prints error message.
+ * If Limit is empty, Limit is not removed because assuming high volume of orders, Limit will be filled again.
+ * The order is returned to the order pool once the listener has been notified.
+ *
+ * @param order Order to be cancelled
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::cancelOrder(Order *order) {
+    // Check if order exists
+    if (orders->find(order->getId()) != OrderPool::indexOf(order)) {
+        orderBook->getListener().onError("Order does not exist.");
+        return;
+    }
+
+    // Remove order from limit
+    Limit *limit = order->getParentLimit();
+    removeFromLimit(order);
+
+    // Notify order cancelled
+    orderBook->getRiskGate().onOrderCancelled(*order);
+    orderBook->getListener().onOrderCancelled(*order);
+
+    // If order is best, update best
+    if (order == best) {
+        onBestRemoved(limit);
+    }
+
+    // Remove order from orders map
+    orders->erase(order->getId());
+    delete order;
+}
+
+/**
+ * Removes a fully executed order from its limit and the orders map, updating the best order. The order is not
+ * returned to the order pool, as the listener has not been notified of the execution yet.
+ *
+ * @param order Executed order
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::removeExecutedOrder(Order *order) {
+    removeFromLimit(order);
+    orders->erase(order->getId());
+    if (order == best) {
+        onBestRemoved(order->getParentLimit());
+    }
+}
+
+/**
+ * Finds a live order by looking up its ID in the orders map.
+ *
+ * @param id ID of the order
+ * @return Order with the ID, nullptr if there is none
+ */
+template <Side S, typename Traits>
+typename HalfBook<S, Traits>::Order *HalfBook<S, Traits>::findOrder(int id) const {
+    return OrderPool::get(orders->find(id));
+}
+
+/**
+ * Prefetches the orders map slot of an ID, so a later lookup of the ID does not wait on memory.
+ *
+ * @param id ID of the order
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::prefetchOrder(int id) const {
+    orders->prefetch(id);
+}
+
+/**
+ * Finds an order by ID, counted as an orders map lookup, and prefetches its record. Used as the second stage of a
+ * prefetch pipeline, after the orders map slot of the ID was prefetched.
+ *
+ * @param id ID of the order
+ * @return Order pool index of the order, 0 if there is none
+ */
+template <Side S, typename Traits>
+uint32_t HalfBook<S, Traits>::prefetchOrderRecord(int id) const {
+    uint32_t order = orders->find(id);
+    if (order != 0) {
+        __builtin_prefetch(OrderPool::get(order));
+    }
+    return order;
+}
+
+/**
+ * Prefetches what removing an order from its queue updates: the tree node and queue data of its limit and the
+ * records of the orders before and after it. Used as the third stage of a prefetch pipeline, after the record of the
+ * order was prefetched.
+ *
+ * @param order Order pool index of the order, 0 to prefetch nothing
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::prefetchQueue(uint32_t order) const {
+    if (order != 0) {
+        const Order *record = OrderPool::get(order);
+        Limit *limit = record->getParentLimit();
+        __builtin_prefetch(limit);
+        __builtin_prefetch(&LimitPool::cold(LimitPool::indexOf(limit)));
+        __builtin_prefetch(record->getPrevOrder());
+        __builtin_prefetch(record->getNextOrder());
+    }
+}
+
+/**
+ * Prefetches the memory the price index reads first to find the limit at a price.
+ *
+ * @param price Price of the limit
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::prefetchLevel(Price price) const {
+    limits->prefetch(price);
+}
+
+/**
+ * Setter for boolean indicating if finding the next best order is deferred. While deferred, removing the last order
+ * of the best limit leaves the best order stale instead of searching the price index, so a burst of cancels at the
+ * inside searches once. Ending the deferral searches outwards from the stale limit.
+ *
+ * @param newIsBestDeferred New boolean indicating if finding the next best order is deferred
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::setBestDeferred(bool newIsBestDeferred) {
+    this->isBestDeferred = newIsBestDeferred;
+    if (!isBestDeferred && staleLimit != nullptr) {
+        best = limits->getNextInsideOrder(staleLimit);
+        staleLimit = nullptr;
+    }
+}
+
+/**
+ * Updates the best order after it was removed from its limit. The next order of the limit is the best order. If the
+ * limit is empty and finding the best order is deferred, the best order is left stale, else the price index is
+ * searched outwards.
+ *
+ * @param limit Limit the best order was removed from
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::onBestRemoved(Limit *limit) {
+    if (isBestDeferred && limit->getHeadOrder() == nullptr) {
+        best = nullptr;
+        staleLimit = limit;
+        return;
+    }
+    best = limits->getNextInsideOrder(limit);
+}
+
+/**
+ * Removes an order from its limit, marking the limit empty in the price index if it was the last order.
+ *
+ * @param order Order to remove
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::removeFromLimit(Order *order) {
+    Limit *limit = order->getParentLimit();
+    limit->removeOrder(order);
+    if (limit->getSize() == 0) {
+        limits->setEmpty(limit, true);
+    }
+}
+
+/**
+ * Builds the side in bulk from orders sorted by price. Limits are created in price order and bulk loaded into the
+ * price index, orders are appended to their limit queues directly and the orders map is reserved up front.
+ *
+ * @param sortedOrders Orders of the side sorted by ascending price, in time priority within a price
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::build(const std::vector<Order *> &sortedOrders) {
+    orders->reserve(sortedOrders.size());
+
+    // Create limits in price order and append orders to their limits
+    std::vector<Limit *> sortedLimits;
+    for (Order *order : sortedOrders) {
+        if (sortedLimits.empty() || sortedLimits.back()->getPrice() != order->getPrice()) {
+            sortedLimits.push_back(new Limit(order->getPrice(), IS_BUY, orderBook));
+        }
+        sortedLimits.back()->addOrder(order);
+        orders->insert(order->getId(), OrderPool::indexOf(order));
+
+        // Continue id sequence after the highest id
+        if (order->getId() >= currOrdersId) {
+            currOrdersId = order->getId() + 1;
+        }
+    }
+    limits->build(sortedLimits);
+
+    // Best order is the oldest order at the highest buy or lowest sell limit
+    if (!sortedLimits.empty()) {
+        best = (IS_BUY ? sortedLimits.back() : sortedLimits.front())->getHeadOrder();
+    }
+}
+
+/**
+ * Getter for boolean indicating if the side has no orders or limits.
+ *
+ * @return Whether the side is empty
+ */
+template <Side S, typename Traits>
+bool HalfBook<S, Traits>::isEmpty() const {
+    return orders->empty() && limits->empty();
+}
+
+/**
+ * Getter for the best order.
+ *
+ * @return Best order, nullptr if there is none
+ */
+template <Side S, typename Traits>
+typename HalfBook<S, Traits>::Order *HalfBook<S, Traits>::getBest() const {
+    return best;
+}
+
+/**
+ * Appends the live orders of the side, walking the limits with orders from the best limit outwards and each limit in
+ * time priority. The best order must not be deferred.
+ *
+ * @param sideOrders Orders to append to
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::getOrders(std::vector<Order *> &sideOrders) const {
+    for (Order *head = best; head != nullptr; head = limits->getNextOuterOrder(head->getParentLimit())) {
+        for (Order *order = head; order != nullptr; order = order->getNextOrder()) {
+            sideOrders.push_back(order);
+        }
+    }
+}
+
+/**
+ * Getter for the limit at a price.
+ *
+ * @param price Price of the limit
+ * @return Limit at the price, nullptr if there is none
+ */
+template <Side S, typename Traits>
+typename HalfBook<S, Traits>::Limit *HalfBook<S, Traits>::getLimit(Price price) const {
+    return limits->find(price);
+}
+
+/**
+ * Getter for the index of limits.
+ *
+ * @return Index of limits
+ */
+template <Side S, typename Traits>
+typename HalfBook<S, Traits>::PriceIndex *HalfBook<S, Traits>::getPriceIndex() const {
+    return limits;
+}
+
+/**
+ * Getter for the root of the limit AVL tree.
+ *
+ * @return Root of the limit AVL tree
+ */
+template <Side S, typename Traits>
+typename HalfBook<S, Traits>::Limit *HalfBook<S, Traits>::getTree() const {
+    return tree;
+}
+
+/**
+ * Setter for the root of the limit AVL tree.
+ *
+ * @param newTree New root of the limit AVL tree
+ */
+template <Side S, typename Traits>
+void HalfBook<S, Traits>::setTree(Limit *newTree) {
+    this->tree = newTree;
+}
+
+/**
+ * Checks the side. After the price index checks itself, each limit queue is walked from its head: every order must
+ * link back to the order before it, belong to the limit, match its price and side, have quantity and be the order the
+ * orders map holds for its ID. The size and volume of each limit must match its queue. As IDs are unique and every
+ * queued order is in the orders map, equal counts mean every order in the map is in exactly one queue. The best order
+ * must be the head of the inside limit with orders.
+ *
+ * @return Description of the first broken invariant, nullptr if the side is valid
+ */
+template <Side S, typename Traits>
+const char *HalfBook<S, Traits>::validate() const {
+    std::vector<const Limit *> sortedLimits;
+    const char *error = limits->validate(sortedLimits);
+    if (error != nullptr) {
+        return error;
+    }
+
+    size_t orderCount = 0;
+    const Order *inside = nullptr;
+    for (const Limit *limit : sortedLimits) {
+        int size = 0;
+        Quantity volume = 0;
+        const Order *prev = nullptr;
+        for (const Order *order = limit->getHeadOrder(); order != nullptr; order = order->getNextOrder()) {
+            if (order->getPrevOrder() != prev || order->getParentLimit() != limit) {
+                return "Limit queue is not linked.";
+            }
+            if (order->getPrice() != limit->getPrice() || order->isBuy() != IS_BUY || order->getQuantity() <= 0) {
+                return "Order does not match its limit.";
+            }
+            if (orders->find(order->getId()) != OrderPool::indexOf(order)) {
+                return "Order in a limit queue is not in the orders map.";
+            }
+            prev = order;
+            size++;
+            volume += order->getQuantity();
+        }
+        if (limit->getTailOrder() != prev) {
+            return "Limit tail is not the last order of its queue.";
+        }
+        if (limit->getSize() != size || limit->getTotalVolume() != volume) {
+            return "Limit size or volume does not match its orders.";
+        }
+        if (size > 0 && (inside == nullptr || IS_BUY)) {
+            inside = limit->getHeadOrder();
+        }
+        orderCount += size;
+    }
+    if (orderCount != orders->size()) {
+        return "Orders map has orders not in a limit queue.";
+    }
+    if (best != inside) {
+        return "Best order is not at the inside of the side.";
+    }
+    return nullptr;
+}
+
+template class HalfBook<Side::Bid, OrderBook::Traits>;
+template class HalfBook<Side::Ask, OrderBook::Traits>;
+template class HalfBook<Side::Bid, EquityOrderBook::Traits>;
+template class HalfBook<Side::Ask, EquityOrderBook::Traits>;
+template class HalfBook<Side::Bid, FuturesOrderBook::Traits>;
+template class HalfBook<Side::Ask, FuturesOrderBook::Traits>;
+template class HalfBook<Side::Bid, CryptoOrderBook::Traits>;
+template class HalfBook<Side::Ask, CryptoOrderBook::Traits>;
@@ -0,0 +1,269 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_HALFBOOK_H
+#define ORDER_BOOK_HALFBOOK_H
+
+#include <cstdint>
+#include <vector>
+#include "Order.h"
+#include "OrderIndex.h"
+#include "Limit.h"
+#include "PriceIndex.h"
+
+/**
+ * Side of the order book.
+ */
+enum class Side {
+    /**
+     * Buy side, best price is the highest.
+     */
+    Bid,
+
+    /**
+     * Sell side, best price is the lowest.
+     */
+    Ask
+};
+
+/**
+ * Class representing one side of the order book.
+ *
+ * The side is a template parameter, so price comparisons, best price updates and the direction of the next inside
+ * limit are resolved at compile time instead of branching on a buy flag for every order.
+ *
+ * @tparam S Side of the order book
+ * @tparam Traits Types of the order book
+ */
+template <Side S, typename Traits>
+class HalfBook {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+    using Order = typename Traits::Order;
+    using Limit = typename Traits::Limit;
+    using OrderBook = typename Traits::OrderBook;
+    using OrderPool = typename Traits::OrderPool;
+    using LimitPool = typename Traits::LimitPool;
+    using PriceIndex = typename Traits::PriceIndex;
+
+private:
+    /**
+     * Boolean indicating if the side is the buy side.
+     */
+    static constexpr bool IS_BUY = S == Side::Bid;
+
+    /**
+     * Pointer to the root of the limit AVL tree.
+     */
+    Limit *tree;
+
+    /**
+     * Pointer to the best order, the oldest order at the best limit.
+     */
+    Order *best;
+
+    /**
+     * Boolean indicating if finding the next best order is deferred when the best limit empties.
+     */
+    bool isBestDeferred;
+
+    /**
+     * Limit the best order was removed from while deferred, nullptr if the best order is current.
+     */
+    Limit *staleLimit;
+
+    /**
+     * Map of orders.
+     */
+    OrderIndex *orders;
+
+    /**
+     * Index of limits.
+     */
+    PriceIndex *limits;
+
+    /**
+     * ID of the next order.
+     */
+    int currOrdersId;
+
+    /**
+     * Pointer to the order book.
+     */
+    OrderBook *orderBook;
+
+public:
+    /**
+     * Compare prices by how close they are to the inside of the order book.
+     *
+     * @param price Price to compare
+     * @param other Price to compare against
+     * @return Whether price is better than other
+     */
+    static constexpr bool isBetter(Price price, Price other) {
+        return IS_BUY ? price > other : price < other;
+    }
+
+    /**
+     * Constructor for HalfBook.
+     *
+     * @param limits Index of limits
+     * @param orderBook Pointer to the order book
+     */
+    HalfBook(PriceIndex *limits, OrderBook *orderBook);
+
+    /**
+     * Add order to the side. Prints error message and returns nullptr if the price is not valid for the price index.
+     *
+     * @param price Price of the order
+     * @param quantity Quantity of the order
+     * @param time Exchange time the order was placed, in nanoseconds since the epoch
+     * @param sequence Sequence number of the order in the order book
+     * @param owner ID of the participant owning the order, 0 if the order has no owner
+     * @return New order
+     */
+    Order *addOrder(Price price, Quantity quantity, uint64_t time, uint64_t sequence, uint16_t owner = 0);
+
+    /**
+     * Cancel order on the side. Prints error message if the order does not exist.
+     *
+     * @param order Order to cancel
+     */
+    void cancelOrder(Order *order);
+
+    /**
+     * Remove a fully executed order from the side.
+     *
+     * @param order Executed order
+     */
+    void removeExecutedOrder(Order *order);
+
+    /**
+     * Find a live order by ID.
+     *
+     * @param id ID of the order
+     * @return Order with the ID, nullptr if there is none
+     */
+    Order *findOrder(int id) const;
+
+    /**
+     * Prefetch the orders map slot of an ID, ahead of finding the order.
+     *
+     * @param id ID of the order
+     */
+    void prefetchOrder(int id) const;
+
+    /**
+     * Find an order by ID and prefetch its record. The orders map slot of the ID should already be in cache.
+     *
+     * @param id ID of the order
+     * @return Order pool index of the order, 0 if there is none
+     */
+    uint32_t prefetchOrderRecord(int id) const;
+
+    /**
+     * Prefetch the limit and neighbouring orders of an order. The record of the order should already be in cache.
+     *
+     * @param order Order pool index of the order, 0 to prefetch nothing
+     */
+    void prefetchQueue(uint32_t order) const;
+
+    /**
+     * Prefetch the memory finding the limit at a price reads first.
+     *
+     * @param price Price of the limit
+     */
+    void prefetchLevel(Price price) const;
+
+    /**
+     * Setter for boolean indicating if finding the next best order is deferred. Ending the deferral finds the best
+     * order if it is stale.
+     *
+     * @param isBestDeferred New boolean indicating if finding the next best order is deferred
+     */
+    void setBestDeferred(bool isBestDeferred);
+
+    /**
+     * Build the side in bulk from orders sorted by price. The side must be empty.
+     *
+     * @param sortedOrders Orders of the side sorted by ascending price, in time priority within a price
+     */
+    void build(const std::vector<Order *> &sortedOrders);
+
+    /**
+     * Getter for boolean indicating if the side has no orders or limits.
+     *
+     * @return Whether the side is empty
+     */
+    bool isEmpty() const;
+
+    /**
+     * Getter for the best order.
+     *
+     * @return Best order, nullptr if there is none
+     */
+    Order *getBest() const;
+
+    /**
+     * Append the live orders of the side, from the best limit outwards in time priority.
+     *
+     * @param sideOrders Orders to append to
+     */
+    void getOrders(std::vector<Order *> &sideOrders) const;
+
+    /**
+     * Getter for the limit at a price.
+     *
+     * @param price Price of the limit
+     * @return Limit at the price, nullptr if there is none
+     */
+    Limit *getLimit(Price price) const;
+
+    /**
+     * Getter for the index of limits.
+     *
+     * @return Index of limits
+     */
+    PriceIndex *getPriceIndex() const;
+
+    /**
+     * Getter for the root of the limit AVL tree.
+     *
+     * @return Root of the limit AVL tree
+     */
+    Limit *getTree() const;
+
+    /**
+     * Setter for the root of the limit AVL tree.
+     *
+     * @param tree New root of the limit AVL tree
+     */
+    void setTree(Limit *tree);
+
+    /**
+     * Check the invariants of the price index, the limit queues, the orders map and the best order.
+     *
+     * @return Description of the first broken invariant, nullptr if the side is valid
+     */
+    const char *validate() const;
+
+private:
+    /**
+     * Remove order from its limit.
+     *
+     * @param order Order to remove
+     */
+    void removeFromLimit(Order *order);
+
+    /**
+     * Update the best order after it was removed from its limit.
+     *
+     * @param limit Limit the best order was removed from
+     */
+    void onBestRemoved(Limit *limit);
+};
+
+
+#endif //ORDER_BOOK_HALFBOOK_H
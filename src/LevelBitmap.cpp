@@ -0,0 +1,165 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "LevelBitmap.h"
+
+/**
+ * Index of the highest set bit of a non-zero word.
+ *
+ * @param word Non-zero word
+ * @return Index of the highest set bit
+ */
+static inline int highestBit(uint64_t word) {
+    return 63 - __builtin_clzll(word);
+}
+
+/**
+ * Index of the lowest set bit of a non-zero word.
+ *
+ * @param word Non-zero word
+ * @return Index of the lowest set bit
+ */
+static inline int lowestBit(uint64_t word) {
+    return __builtin_ctzll(word);
+}
+
+/**
+ * Mask of the bits of a word below a bit.
+ *
+ * @param bit Bit index from 0 to 63
+ * @return Mask of the bits below the bit
+ */
+static inline uint64_t maskBelow(int bit) {
+    return (uint64_t(1) << bit) - 1;
+}
+
+/**
+ * Mask of the bits of a word above a bit.
+ *
+ * @param bit Bit index from 0 to 63
+ * @return Mask of the bits above the bit
+ */
+static inline uint64_t maskAbove(int bit) {
+    return bit == 63 ? 0 : ~uint64_t(0) << (bit + 1);
+}
+
+/**
+ * Constructor for LevelBitmap.
+ */
+LevelBitmap::LevelBitmap() : levels(), words(), summary(0) {
+}
+
+/**
+ * Mark a price level as non-empty.
+ *
+ * @param level Price level to mark
+ */
+void LevelBitmap::set(int level) {
+    levels[level >> 6] |= uint64_t(1) << (level & 63);
+    words[level >> 12] |= uint64_t(1) << ((level >> 6) & 63);
+    summary |= uint64_t(1) << (level >> 12);
+}
+
+/**
+ * Mark a price level as empty, clearing the higher level bits of words that become zero.
+ *
+ * @param level Price level to mark
+ */
+void LevelBitmap::clear(int level) {
+    levels[level >> 6] &= ~(uint64_t(1) << (level & 63));
+    if (levels[level >> 6] != 0) {
+        return;
+    }
+    words[level >> 12] &= ~(uint64_t(1) << ((level >> 6) & 63));
+    if (words[level >> 12] != 0) {
+        return;
+    }
+    summary &= ~(uint64_t(1) << (level >> 12));
+}
+
+/**
+ * Getter for boolean indicating if a price level is non-empty.
+ *
+ * @param level Price level to check
+ * @return Whether the price level is non-empty
+ */
+bool LevelBitmap::test(int level) const {
+    return (levels[level >> 6] >> (level & 63)) & 1;
+}
+
+/**
+ * Find the highest non-empty price level below a price level. Checks the rest of the level's word, then the rest of
+ * its word of words, then the summary, descending through the highest set bits.
+ *
+ * @param level Price level to search below
+ * @return Highest non-empty price level below the level, -1 if there is none
+ */
+int LevelBitmap::findBelow(int level) const {
+    int levelWord = level >> 6;
+    uint64_t bits = levels[levelWord] & maskBelow(level & 63);
+    if (bits != 0) {
+        return (levelWord << 6) | highestBit(bits);
+    }
+
+    int wordsWord = level >> 12;
+    bits = words[wordsWord] & maskBelow(levelWord & 63);
+    if (bits == 0) {
+        bits = summary & maskBelow(wordsWord);
+        if (bits == 0) {
+            return -1;
+        }
+        wordsWord = highestBit(bits);
+        bits = words[wordsWord];
+    }
+    levelWord = (wordsWord << 6) | highestBit(bits);
+    return (levelWord << 6) | highestBit(levels[levelWord]);
+}
+
+/**
+ * Find the lowest non-empty price level above a price level. Checks the rest of the level's word, then the rest of
+ * its word of words, then the summary, descending through the lowest set bits.
+ *
+ * @param level Price level to search above
+ * @return Lowest non-empty price level above the level, -1 if there is none
+ */
+int LevelBitmap::findAbove(int level) const {
+    int levelWord = level >> 6;
+    uint64_t bits = levels[levelWord] & maskAbove(level & 63);
+    if (bits != 0) {
+        return (levelWord << 6) | lowestBit(bits);
+    }
+
+    int wordsWord = level >> 12;
+    bits = words[wordsWord] & maskAbove(levelWord & 63);
+    if (bits == 0) {
+        bits = summary & maskAbove(wordsWord);
+        if (bits == 0) {
+            return -1;
+        }
+        wordsWord = lowestBit(bits);
+        bits = words[wordsWord];
+    }
+    levelWord = (wordsWord << 6) | lowestBit(bits);
+    return (levelWord << 6) | lowestBit(levels[levelWord]);
+}
+
+/**
+ * Check that each bit of the words of words is set exactly when its word of levels has a bit set, and each bit of the
+ * summary exactly when its word of words has a bit set. findBelow and findAbove rely on this to descend.
+ *
+ * @return Whether the layers are consistent
+ */
+bool LevelBitmap::validate() const {
+    for (int levelWord = 0; levelWord < LEVEL_COUNT / 64; levelWord++) {
+        if (((words[levelWord >> 6] >> (levelWord & 63)) & 1) != (levels[levelWord] != 0)) {
+            return false;
+        }
+    }
+    for (int wordsWord = 0; wordsWord < LEVEL_COUNT / 64 / 64; wordsWord++) {
+        if (((summary >> wordsWord) & 1) != (words[wordsWord] != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_LEVELBITMAP_H
+#define ORDER_BOOK_LEVELBITMAP_H
+
+#include <cstdint>
+
+/**
+ * Three level bitmap of non-empty price levels.
+ *
+ * Each bit of the bottom level marks a price level, each bit of a higher level marks a non-zero word of the level
+ * below. Finding the nearest set level above or below a level scans at most one word per level with a count
+ * leading or trailing zeros instruction, however many empty levels lie in between.
+ */
+class LevelBitmap {
+public:
+    /**
+     * Number of price levels in the bitmap.
+     */
+    static const int LEVEL_COUNT = 64 * 64 * 64;
+
+private:
+    /**
+     * Bits marking non-empty price levels.
+     */
+    uint64_t levels[LEVEL_COUNT / 64];
+
+    /**
+     * Bits marking non-zero words of levels.
+     */
+    uint64_t words[LEVEL_COUNT / 64 / 64];
+
+    /**
+     * Bits marking non-zero words of words.
+     */
+    uint64_t summary;
+
+public:
+    /**
+     * Constructor for LevelBitmap.
+     */
+    LevelBitmap();
+
+    /**
+     * Mark a price level as non-empty.
+     *
+     * @param level Price level to mark
+     */
+    void set(int level);
+
+    /**
+     * Mark a price level as empty.
+     *
+     * @param level Price level to mark
+     */
+    void clear(int level);
+
+    /**
+     * Getter for boolean indicating if a price level is non-empty.
+     *
+     * @param level Price level to check
+     * @return Whether the price level is non-empty
+     */
+    bool test(int level) const;
+
+    /**
+     * Find the highest non-empty price level below a price level.
+     *
+     * @param level Price level to search below
+     * @return Highest non-empty price level below the level, -1 if there is none
+     */
+    int findBelow(int level) const;
+
+    /**
+     * Find the lowest non-empty price level above a price level.
+     *
+     * @param level Price level to search above
+     * @return Lowest non-empty price level above the level, -1 if there is none
+     */
+    int findAbove(int level) const;
+
+    /**
+     * Check that the bits of the upper layers are set exactly for the words below them with bits set.
+     *
+     * @return Whether the layers are consistent
+     */
+    bool validate() const;
+};
+
+
+#endif //ORDER_BOOK_LEVELBITMAP_H
@@ -5,26 +5,61 @@
 #include "Limit.h"
 #include "OrderBook.h"
 #include "Order.h"
+#include "Stats.h"
 
 /**
- * Constructor for Limit.
+ * Constructor for BasicLimit.
  *
  * @param price Price of the limit
  * @param isBuy Boolean indicating if the limit is a buy limit
  * @param orderBook Pointer to the order book
  */
-Limit::Limit(float price, bool isBuy, OrderBook *orderBook) {
+template <typename Traits>
+BasicLimit<Traits>::BasicLimit(Price price, bool isBuy, OrderBook *orderBook) {
     this->price = price;
-    this->size = 0;
-    this->totalVolume = 0;
-    this->parent = nullptr;
-    this->leftChild = nullptr;
-    this->rightChild = nullptr;
-    this->headOrder = nullptr;
-    this->tailOrder = nullptr;
+    this->parent = 0;
+    this->leftChild = 0;
+    this->rightChild = 0;
     this->height = 0;
-    this->orderBook = orderBook;
     this->isBuy = isBuy;
+
+    LimitColdData<Traits> &queue = this->getQueue();
+    queue.size = 0;
+    queue.totalVolume = 0;
+    queue.headOrder = 0;
+    queue.tailOrder = 0;
+    queue.orderBook = orderBook;
+}
+
+/**
+ * Getter for the queue fields of the limit.
+ *
+ * @return Queue fields of the limit
+ */
+template <typename Traits>
+LimitColdData<Traits> &BasicLimit<Traits>::getQueue() const {
+    return LimitPool::cold(LimitPool::indexOf(this));
+}
+
+/**
+ * Allocate a limit from the limit pool.
+ *
+ * @param size Size of the limit
+ * @return Slot for the limit
+ */
+template <typename Traits>
+void *BasicLimit<Traits>::operator new(size_t size) {
+    return LimitPool::allocate();
+}
+
+/**
+ * Return a limit to the limit pool.
+ *
+ * @param limit Limit to return
+ */
+template <typename Traits>
+void BasicLimit<Traits>::operator delete(void *limit) {
+    LimitPool::release(limit);
 }
 
 /**
@@ -32,8 +67,9 @@ Limit::Limit(float price, bool isBuy, OrderBook *orderBook) {
  *
  * @return Size of the limit
  */
-int Limit::getSize() const {
-    return size;
+template <typename Traits>
+int BasicLimit<Traits>::getSize() const {
+    return getQueue().size;
 }
 
 /**
@@ -41,8 +77,9 @@ int Limit::getSize() const {
  *
  * @return Total volume of the limit
  */
-int Limit::getTotalVolume() const {
-    return totalVolume;
+template <typename Traits>
+typename BasicLimit<Traits>::Quantity BasicLimit<Traits>::getTotalVolume() const {
+    return getQueue().totalVolume;
 }
 
 /**
@@ -50,8 +87,9 @@ int Limit::getTotalVolume() const {
  *
  * @return Pointer to the parent limit of the limit
  */
-Limit *Limit::getParent() const {
-    return parent;
+template <typename Traits>
+BasicLimit<Traits> *BasicLimit<Traits>::getParent() const {
+    return LimitPool::get(parent);
 }
 
 /**
@@ -59,8 +97,9 @@ Limit *Limit::getParent() const {
  *
  * @return Pointer to the left child of the limit
  */
-Limit *Limit::getLeftChild() const {
-    return leftChild;
+template <typename Traits>
+BasicLimit<Traits> *BasicLimit<Traits>::getLeftChild() const {
+    return LimitPool::get(leftChild);
 }
 
 /**
@@ -68,8 +107,9 @@ Limit *Limit::getLeftChild() const {
  *
  * @return Pointer to the right child of the limit
  */
-Limit *Limit::getRightChild() const {
-    return rightChild;
+template <typename Traits>
+BasicLimit<Traits> *BasicLimit<Traits>::getRightChild() const {
+    return LimitPool::get(rightChild);
 }
 
 /**
@@ -77,8 +117,9 @@ Limit *Limit::getRightChild() const {
  *
  * @return Pointer to the head order of the limit
  */
-Order *Limit::getHeadOrder() const {
-    return headOrder;
+template <typename Traits>
+typename BasicLimit<Traits>::Order *BasicLimit<Traits>::getHeadOrder() const {
+    return OrderPool::get(getQueue().headOrder);
 }
 
 /**
@@ -86,8 +127,9 @@ Order *Limit::getHeadOrder() const {
  *
  * @return Pointer to the tail order of the limit
  */
-Order *Limit::getTailOrder() const {
-    return tailOrder;
+template <typename Traits>
+typename BasicLimit<Traits>::Order *BasicLimit<Traits>::getTailOrder() const {
+    return OrderPool::get(getQueue().tailOrder);
 }
 
 /**
@@ -95,7 +137,8 @@ Order *Limit::getTailOrder() const {
  *
  * @return Height of the limit
  */
-int Limit::getHeight() const {
+template <typename Traits>
+int BasicLimit<Traits>::getHeight() const {
     return height;
 }
 
@@ -104,7 +147,8 @@ int Limit::getHeight() const {
  *
  * @return Price of the limit
  */
-float Limit::getPrice() const {
+template <typename Traits>
+typename BasicLimit<Traits>::Price BasicLimit<Traits>::getPrice() const {
     return price;
 }
 
@@ -113,8 +157,9 @@ float Limit::getPrice() const {
  *
  * @param amount Amount to increase the size by
  */
-void Limit::increaseSize(int amount) {
-    this->size += amount;
+template <typename Traits>
+void BasicLimit<Traits>::increaseSize(int amount) {
+    this->getQueue().size += amount;
 }
 
 /**
@@ -122,8 +167,9 @@ void Limit::increaseSize(int amount) {
  *
  * @param amount Amount to decrease the size by
  */
-void Limit::decreaseSize(int amount) {
-    this->size -= amount;
+template <typename Traits>
+void BasicLimit<Traits>::decreaseSize(int amount) {
+    this->getQueue().size -= amount;
 }
 
 /**
@@ -131,8 +177,9 @@ void Limit::decreaseSize(int amount) {
  *
  * @param volume Volume to increase the total volume by
  */
-void Limit::increaseVolume(int volume) {
-    this->totalVolume += volume;
+template <typename Traits>
+void BasicLimit<Traits>::increaseVolume(Quantity volume) {
+    this->getQueue().totalVolume += volume;
 }
 
 /**
@@ -140,8 +187,9 @@ void Limit::increaseVolume(int volume) {
  *
  * @param volume Volume to decrease the total volume by
  */
-void Limit::decreaseVolume(int volume) {
-    this->totalVolume -= volume;
+template <typename Traits>
+void BasicLimit<Traits>::decreaseVolume(Quantity volume) {
+    this->getQueue().totalVolume -= volume;
 }
 
 /**
@@ -149,8 +197,9 @@ void Limit::decreaseVolume(int volume) {
  *
  * @param newParent New parent limit of the limit
  */
-void Limit::setParent(Limit *newParent) {
-    this->parent = newParent;
+template <typename Traits>
+void BasicLimit<Traits>::setParent(Limit *newParent) {
+    this->parent = LimitPool::indexOf(newParent);
 }
 
 /**
@@ -158,8 +207,9 @@ void Limit::setParent(Limit *newParent) {
  *
  * @param newLeftChild New left child of the limit
  */
-void Limit::setLeftChild(Limit *newLeftChild) {
-    this->leftChild = newLeftChild;
+template <typename Traits>
+void BasicLimit<Traits>::setLeftChild(Limit *newLeftChild) {
+    this->leftChild = LimitPool::indexOf(newLeftChild);
 }
 
 /**
@@ -167,8 +217,9 @@ void Limit::setLeftChild(Limit *newLeftChild) {
  *
  * @param newRightChild New right child of the limit
  */
-void Limit::setRightChild(Limit *newRightChild) {
-    this->rightChild = newRightChild;
+template <typename Traits>
+void BasicLimit<Traits>::setRightChild(Limit *newRightChild) {
+    this->rightChild = LimitPool::indexOf(newRightChild);
 }
 
 /**
@@ -176,14 +227,15 @@ void Limit::setRightChild(Limit *newRightChild) {
  *
  * @param order Order to add to the limit
  */
-void Limit::addOrder(Order *order) {
-    if (this->headOrder == nullptr) {
-        this->headOrder = order;
-        this->tailOrder = order;
+template <typename Traits>
+void BasicLimit<Traits>::addOrder(Order *order) {
+    if (this->getHeadOrder() == nullptr) {
+        this->setHeadOrder(order);
+        this->setTailOrder(order);
     } else {
-        this->tailOrder->setNextOrder(order);
-        order->setPrevOrder(tailOrder);
-        this->tailOrder = order;
+        this->getTailOrder()->setNextOrder(order);
+        order->setPrevOrder(this->getTailOrder());
+        this->setTailOrder(order);
     }
     this->increaseSize(1);
     this->increaseVolume(order->getQuantity());
@@ -195,7 +247,8 @@ void Limit::addOrder(Order *order) {
  *
  * @param limit Limit to insert into the limit AVL tree
  */
-void Limit::insertLimit(Limit *limit) {
+template <typename Traits>
+void BasicLimit<Traits>::insertLimit(Limit *limit) {
     if (limit->getPrice() < this->getPrice()) {
         if (this->getLeftChild() == nullptr) {
             this->setLeftChild(limit);
@@ -222,14 +275,27 @@ void Limit::insertLimit(Limit *limit) {
  *
  * @param newHeight New height of the limit
  */
-void Limit::setHeight(int newHeight) {
+template <typename Traits>
+void BasicLimit<Traits>::setHeight(int newHeight) {
     this->height = newHeight;
 }
 
+/**
+ * Setter for the price of the limit. Only limits queueing a peg group are repriced, a limit in a price index is found
+ * by its price and must keep it.
+ *
+ * @param newPrice New price of the limit
+ */
+template <typename Traits>
+void BasicLimit<Traits>::setPrice(Price newPrice) {
+    this->price = newPrice;
+}
+
 /**
  * Update the height of the limit.
  */
-void Limit::updateHeight() {
+template <typename Traits>
+void BasicLimit<Traits>::updateHeight() {
     Limit *curr = this;
 
     while (curr != nullptr) {
@@ -253,7 +319,8 @@ void Limit::updateHeight() {
 /**
  * Rebalance the limit AVL tree on add.
  */
-void Limit::rebalanceOnAdd() {
+template <typename Traits>
+void BasicLimit<Traits>::rebalanceOnAdd() {
     // Find the first height unbalanced node
     Limit *curr = this->getParent();
     bool isLeftHeavy;
@@ -342,7 +409,9 @@ void Limit::rebalanceOnAdd() {
 /**
  * Left rotate the limit.
  */
-void Limit::leftRotate() {
+template <typename Traits>
+void BasicLimit<Traits>::leftRotate() {
+    Stats::add(Counter::ROTATIONS);
     Limit *right = this->getRightChild();
     right->setParent(this->getParent());
     if (this->getParent() != nullptr) {
@@ -352,7 +421,7 @@ void Limit::leftRotate() {
             this->getParent()->setRightChild(right);
         }
     }
-    this->parent = right;
+    this->setParent(right);
     this->setRightChild(right->getLeftChild());
     if (right->getLeftChild() != nullptr) {
         right->getLeftChild()->setParent(this);
@@ -362,17 +431,20 @@ void Limit::leftRotate() {
     this->updateHeight();
 
     // Update root
-    if (this->orderBook->getBuyTree() == this) {
-        this->orderBook->setBuyTree(right);
-    } else if (this->orderBook->getSellTree() == this) {
-        this->orderBook->setSellTree(right);
+    OrderBook *orderBook = this->getQueue().orderBook;
+    if (orderBook->getBuyTree() == this) {
+        orderBook->setBuyTree(right);
+    } else if (orderBook->getSellTree() == this) {
+        orderBook->setSellTree(right);
     }
 }
 
 /**
  * Right rotate the limit.
  */
-void Limit::rightRotate() {
+template <typename Traits>
+void BasicLimit<Traits>::rightRotate() {
+    Stats::add(Counter::ROTATIONS);
     Limit *left = this->getLeftChild();
     left->setParent(this->getParent());
     if (this->getParent() != nullptr) {
@@ -382,7 +454,7 @@ void Limit::rightRotate() {
             this->getParent()->setRightChild(left);
         }
     }
-    this->parent = left;
+    this->setParent(left);
     this->setLeftChild(left->getRightChild());
     if (left->getRightChild() != nullptr) {
         left->getRightChild()->setParent(this);
@@ -392,10 +464,11 @@ void Limit::rightRotate() {
     this->updateHeight();
 
     // Update root
-    if (this->orderBook->getBuyTree() == this) {
-        this->orderBook->setBuyTree(left);
-    } else if (this->orderBook->getSellTree() == this) {
-        this->orderBook->setSellTree(left);
+    OrderBook *orderBook = this->getQueue().orderBook;
+    if (orderBook->getBuyTree() == this) {
+        orderBook->setBuyTree(left);
+    } else if (orderBook->getSellTree() == this) {
+        orderBook->setSellTree(left);
     }
 }
 
@@ -404,14 +477,15 @@ void Limit::rightRotate() {
  *
  * @param order Order to remove from the limit
  */
-void Limit::removeOrder(Order *order) {
-    if (this->headOrder == order && this->tailOrder == order) {
+template <typename Traits>
+void BasicLimit<Traits>::removeOrder(Order *order) {
+    if (this->getHeadOrder() == order && this->getTailOrder() == order) {
         this->setHeadOrder(nullptr);
         this->setTailOrder(nullptr);
-    } else if (this->headOrder == order) {
+    } else if (this->getHeadOrder() == order) {
         this->setHeadOrder(order->getNextOrder());
         order->getNextOrder()->setPrevOrder(nullptr);
-    } else if (this->tailOrder == order) {
+    } else if (this->getTailOrder() == order) {
         this->setTailOrder(order->getPrevOrder());
         order->getPrevOrder()->setNextOrder(nullptr);
     } else {
@@ -423,41 +497,21 @@ void Limit::removeOrder(Order *order) {
 }
 
 /**
- * Getter for the next inside order in the order book.
+ * Getter for the next inside order in the order book. If the limit has no orders, the order book's price index finds
+ * the next limit with orders away from the inside.
  *
  * @return Next inside order in the order book
  */
-Order *Limit::getNextInsideOrder() const {
-    if (this->headOrder != nullptr) {
-        return this->headOrder;
+template <typename Traits>
+typename BasicLimit<Traits>::Order *BasicLimit<Traits>::getNextInsideOrder() const {
+    if (this->getHeadOrder() != nullptr) {
+        return this->getHeadOrder();
     }
-    if (this->isBuy) {
-        /*
-         * Find next highest buy limit. If limit contained highest order, it must be the bottom right of the tree.
-         * It will not have any right children. Since tree is balanced, limit will have at most a height 0 left child.
-         * Next highest buy limit will be either the parent or it's left child.
-         */
-        if (this->leftChild != nullptr) {
-            return this->leftChild->getHeadOrder();
-        } else if (this->parent != nullptr) {
-            return this->parent->getHeadOrder();
-        } else {
-            return nullptr;
-        }
-    } else {
-        /*
-         * Find next lowest sell limit. If limit contained lowest order, it must be the bottom left of the tree.
-         * It will not have any left children. Since tree is balanced, limit will have at most a height 0 right child.
-         * Next lowest sell limit will be either the parent or it's right child.
-         */
-        if (this->rightChild != nullptr) {
-            return this->rightChild->getHeadOrder();
-        } else if (this->parent != nullptr) {
-            return this->parent->getHeadOrder();
-        } else {
-            return nullptr;
-        }
+    OrderBook *orderBook = this->getQueue().orderBook;
+    if (orderBook == nullptr) {
+        return nullptr;
     }
+    return orderBook->getPriceIndex(this->isBuy)->getNextInsideOrder(this);
 }
 
 /**
@@ -465,8 +519,9 @@ Order *Limit::getNextInsideOrder() const {
  *
  * @param newHeadOrder New pointer to the head order of the limit
  */
-void Limit::setHeadOrder(Order *newHeadOrder) {
-    this->headOrder = newHeadOrder;
+template <typename Traits>
+void BasicLimit<Traits>::setHeadOrder(Order *newHeadOrder) {
+    this->getQueue().headOrder = OrderPool::indexOf(newHeadOrder);
 }
 
 /**
@@ -474,6 +529,41 @@ void Limit::setHeadOrder(Order *newHeadOrder) {
  *
  * @param newTailOrder New pointer to the tail order of the limit
  */
-void Limit::setTailOrder(Order *newTailOrder) {
-    this->tailOrder = newTailOrder;
+template <typename Traits>
+void BasicLimit<Traits>::setTailOrder(Order *newTailOrder) {
+    this->getQueue().tailOrder = OrderPool::indexOf(newTailOrder);
 }
+
+/**
+ * Build a perfectly balanced AVL tree from limits sorted by ascending price. Each limit is visited once, so building
+ * M limits is O(M) rather than the O(M log M) of inserting them one at a time.
+ *
+ * @param limits Limits sorted by ascending price
+ * @param begin Index of the first limit of the subtree
+ * @param end Index one past the last limit of the subtree
+ * @param parent Parent of the root of the subtree
+ * @return Root of the subtree
+ */
+template <typename Traits>
+BasicLimit<Traits> *BasicLimit<Traits>::buildTree(const std::vector<Limit *> &limits, int begin, int end,
+                                                 Limit *parent) {
+    if (begin >= end) {
+        return nullptr;
+    }
+
+    int mid = begin + (end - begin) / 2;
+    Limit *root = limits[mid];
+    root->setParent(parent);
+    root->setLeftChild(buildTree(limits, begin, mid, root));
+    root->setRightChild(buildTree(limits, mid + 1, end, root));
+
+    int leftHeight = root->getLeftChild() == nullptr ? -1 : root->getLeftChild()->getHeight();
+    int rightHeight = root->getRightChild() == nullptr ? -1 : root->getRightChild()->getHeight();
+    root->setHeight(std::max(leftHeight, rightHeight) + 1);
+    return root;
+}
+
+template class BasicLimit<OrderBook::Traits>;
+template class BasicLimit<EquityOrderBook::Traits>;
+template class BasicLimit<FuturesOrderBook::Traits>;
+template class BasicLimit<CryptoOrderBook::Traits>;
@@ -5,19 +5,17 @@
 #ifndef ORDER_BOOK_LIMIT_H
 #define ORDER_BOOK_LIMIT_H
 
-class Order;
-class OrderBook;
+#include "BookTraits.h"
+#include <cstdint>
+#include <vector>
 
 /**
- * Class representing a limit in the order book.
+ * Queue fields of a limit, kept out of the limit record so descending the AVL tree only touches tree fields.
+ *
+ * @tparam Traits Types of the order book
  */
-class Limit {
-private:
-    /**
-     * Price of the limit.
-     */
-    float price;
-
+template <typename Traits>
+struct LimitColdData {
     /**
      * Number of orders at the limit.
      */
@@ -26,64 +24,112 @@ private:
     /**
      * Total quantity of orders at the limit.
      */
-    int totalVolume;
+    typename Traits::Quantity totalVolume;
 
     /**
-     * Pointer to the parent limit of the limit.
+     * Order pool index of the head order of the limit.
      */
-    Limit *parent;
+    uint32_t headOrder;
 
     /**
-     * Pointer to the left child of the limit.
+     * Order pool index of the tail order of the limit.
      */
-    Limit *leftChild;
+    uint32_t tailOrder;
 
     /**
-     * Pointer to the right child of the limit.
+     * Pointer to the order book.
      */
-    Limit *rightChild;
+    typename Traits::OrderBook *orderBook;
+};
+
+/**
+ * Class representing a limit in the order book.
+ *
+ * The limit record only holds the fields used to navigate the AVL tree, linked by 32-bit limit pool indices, so a
+ * node fits in 32 bytes for 32-bit prices. The order queue of the limit is kept in the cold data of the limit pool.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class alignas(32) BasicLimit {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+    using Order = typename Traits::Order;
+    using Limit = BasicLimit;
+    using OrderBook = typename Traits::OrderBook;
+    using OrderPool = typename Traits::OrderPool;
+    using LimitPool = typename Traits::LimitPool;
 
+private:
     /**
-     * Pointer to the head order of the limit.
+     * Price of the limit.
      */
-    Order *headOrder;
+    Price price;
 
     /**
-     * Pointer to the tail order of the limit.
+     * Limit pool index of the parent limit of the limit.
      */
-    Order *tailOrder;
+    uint32_t parent;
 
     /**
-     * Height of the limit in the AVL tree.
+     * Limit pool index of the left child of the limit.
      */
-    int height;
+    uint32_t leftChild;
 
     /**
-     * Pointer to the order book.
+     * Limit pool index of the right child of the limit.
+     */
+    uint32_t rightChild;
+
+    /**
+     * Height of the limit in the AVL tree.
      */
-    OrderBook *orderBook;
+    int height;
 
     /**
      * Boolean indicating if the limit is a buy limit.
      */
     bool isBuy;
 
+    /**
+     * Getter for the queue fields of the limit.
+     *
+     * @return Queue fields of the limit
+     */
+    LimitColdData<Traits> &getQueue() const;
+
 public:
     /**
-     * Constructor for Limit.
+     * Allocate a limit from the limit pool.
+     *
+     * @param size Size of the limit
+     * @return Slot for the limit
+     */
+    static void *operator new(size_t size);
+
+    /**
+     * Return a limit to the limit pool.
+     *
+     * @param limit Limit to return
+     */
+    static void operator delete(void *limit);
+
+    /**
+     * Constructor for BasicLimit.
      *
      * @param price Price of the limit
      * @param isBuy Boolean indicating if the limit is a buy limit
      * @param orderBook Pointer to the order book
      */
-    Limit(float price, bool isBuy, OrderBook *orderBook);
+    BasicLimit(Price price, bool isBuy, OrderBook *orderBook);
 
     /**
      * Getter for price of the limit.
      *
      * @return Price of the limit
      */
-    float getPrice() const;
+    Price getPrice() const;
 
     /**
      * Getter for boolean indicating if the limit is a buy limit.
@@ -97,7 +143,7 @@ public:
      *
      * @return Total volume of the limit
      */
-    int getTotalVolume() const;
+    Quantity getTotalVolume() const;
 
     /**
      * Getter for pointer to the parent limit of the limit.
@@ -236,14 +282,14 @@ public:
      *
      * @param volume Volume to increase the total volume of the limit by
      */
-    void increaseVolume(int volume);
+    void increaseVolume(Quantity volume);
 
     /**
      * Decrease the volume of the limit.
      *
      * @param volume Volume to decrease the total volume of the limit by
      */
-    void decreaseVolume(int volume);
+    void decreaseVolume(Quantity volume);
 
     /**
      * Setter for the height of the limit.
@@ -252,13 +298,43 @@ public:
      */
     void setHeight(int height);
 
+    /**
+     * Setter for the price of the limit, for peg groups whose price follows the inside.
+     *
+     * @param price New price of the limit
+     */
+    void setPrice(Price price);
+
     /**
      * Getter for the next inside order in the linked list.
      *
      * @return Next inside order in the linked list
      */
     Order *getNextInsideOrder() const;
+
+    /**
+     * Build a perfectly balanced AVL tree from limits sorted by ascending price.
+     *
+     * @param limits Limits sorted by ascending price
+     * @param begin Index of the first limit of the subtree
+     * @param end Index one past the last limit of the subtree
+     * @param parent Parent of the root of the subtree
+     * @return Root of the subtree
+     */
+    static Limit *buildTree(const std::vector<Limit *> &limits, int begin, int end, Limit *parent);
 };
 
+/**
+ * Limit of the default order book.
+ */
+using Limit = DefaultBookTraits::Limit;
+
+/**
+ * Pool all limits of the default order book are allocated from.
+ */
+using LimitPool = DefaultBookTraits::LimitPool;
+
+static_assert(sizeof(Limit) == 32, "Limit record must fit in 32 bytes");
+
 
 #endif //ORDER_BOOK_LIMIT_H
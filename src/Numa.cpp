@@ -0,0 +1,109 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "Numa.h"
+
+#include <fstream>
+#include <string>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Memory policy preferring a node, falling back to other nodes when it is full.
+ */
+static const int MPOL_PREFERRED_MODE = 1;
+
+/**
+ * get_mempolicy flags returning the node of the page at an address.
+ */
+static const unsigned long MPOL_F_NODE_ADDR = 3;
+
+/**
+ * Getter for the number of NUMA nodes, one more than the highest online node listed in sysfs.
+ *
+ * @return Number of nodes, 1 if the topology cannot be read
+ */
+int Numa::getNodeCount() {
+    std::ifstream file("/sys/devices/system/node/online");
+    std::string online;
+    if (!std::getline(file, online) || online.empty()) {
+        return 1;
+    }
+    size_t last = online.find_last_of(",-");
+    return std::stoi(last == std::string::npos ? online : online.substr(last + 1)) + 1;
+}
+
+/**
+ * Getter for the NUMA node of a CPU, found by probing sysfs for the node link of the CPU.
+ *
+ * @param cpu CPU number
+ * @return Node of the CPU, 0 if the topology cannot be read
+ */
+int Numa::getNodeOfCpu(int cpu) {
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/node";
+    int nodeCount = getNodeCount();
+    for (int node = 0; node < nodeCount; node++) {
+        if (access((path + std::to_string(node)).c_str(), F_OK) == 0) {
+            return node;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Getter for the CPU the calling thread is running on.
+ *
+ * @return CPU number, -1 if it cannot be read
+ */
+int Numa::getCurrentCpu() {
+    return sched_getcpu();
+}
+
+/**
+ * Pins the calling thread to a CPU by setting its affinity to that CPU alone.
+ *
+ * @param cpu CPU number
+ * @return Whether the thread was pinned
+ */
+bool Numa::pinThread(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+/**
+ * Binds the pages of a mapping to a NUMA node with mbind. The node is preferred rather than required, so pages fall
+ * back to another node instead of failing when the node is full.
+ *
+ * @param memory Start of the mapping, page aligned
+ * @param size Number of bytes of the mapping
+ * @param node Node to place the pages on
+ * @return Whether the mapping was bound
+ */
+bool Numa::bindMemory(void *memory, size_t size, int node) {
+    if (node < 0 || node >= static_cast<int>(8 * sizeof(unsigned long))) {
+        return false;
+    }
+    unsigned long nodeMask = 1ul << node;
+    return syscall(SYS_mbind, memory, size, MPOL_PREFERRED_MODE, &nodeMask, 8 * sizeof(nodeMask), 0) == 0;
+}
+
+/**
+ * Getter for the NUMA node the page of an address is on, with get_mempolicy.
+ *
+ * @param address Address in a touched page
+ * @return Node of the page, -1 if it cannot be read
+ */
+int Numa::getNodeOfAddress(const void *address) {
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, address, MPOL_F_NODE_ADDR) != 0) {
+        return -1;
+    }
+    return node;
+}
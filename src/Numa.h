@@ -0,0 +1,67 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_NUMA_H
+#define ORDER_BOOK_NUMA_H
+
+#include <cstddef>
+
+/**
+ * NUMA topology and placement of threads and memory, through sysfs and system calls so no NUMA library is needed.
+ *
+ * On a machine without NUMA every CPU and page is on node 0, and binding memory to node 0 has no effect.
+ */
+class Numa {
+public:
+    /**
+     * Getter for the number of NUMA nodes.
+     *
+     * @return Number of nodes, 1 if the topology cannot be read
+     */
+    static int getNodeCount();
+
+    /**
+     * Getter for the NUMA node of a CPU.
+     *
+     * @param cpu CPU number
+     * @return Node of the CPU, 0 if the topology cannot be read
+     */
+    static int getNodeOfCpu(int cpu);
+
+    /**
+     * Getter for the CPU the calling thread is running on.
+     *
+     * @return CPU number, -1 if it cannot be read
+     */
+    static int getCurrentCpu();
+
+    /**
+     * Pin the calling thread to a CPU.
+     *
+     * @param cpu CPU number
+     * @return Whether the thread was pinned
+     */
+    static bool pinThread(int cpu);
+
+    /**
+     * Bind the pages of a mapping to a NUMA node, before they are touched.
+     *
+     * @param memory Start of the mapping, page aligned
+     * @param size Number of bytes of the mapping
+     * @param node Node to place the pages on
+     * @return Whether the mapping was bound
+     */
+    static bool bindMemory(void *memory, size_t size, int node);
+
+    /**
+     * Getter for the NUMA node the page of an address is on.
+     *
+     * @param address Address in a touched page
+     * @return Node of the page, -1 if it cannot be read
+     */
+    static int getNodeOfAddress(const void *address);
+};
+
+
+#endif //ORDER_BOOK_NUMA_H
@@ -4,25 +4,57 @@
 
 #include "Order.h"
 #include "Limit.h"
+#include "OrderBook.h"
 
 /**
- * Constructor for Order.
+ * Constructor for BasicOrder.
  *
  * @param id ID of the order
  * @param price Price of the order
  * @param quantity Quantity of the order
  * @param isBuyOrder Boolean indicating if the order is a buy order
- * @param time Time the order was placed
+ * @param time Exchange time the order was placed, in nanoseconds since the epoch
+ * @param sequence Sequence number of the order in its order book
+ * @param owner ID of the participant owning the order, 0 if the order has no owner
  */
-Order::Order(int id, float price, int quantity, bool isBuyOrder, time_t time) {
+template <typename Traits>
+BasicOrder<Traits>::BasicOrder(int id, Price price, Quantity quantity, bool isBuyOrder, uint64_t time,
+                               uint64_t sequence, uint16_t owner) {
     this->id = id;
     this->price = price;
     this->quantity = quantity;
     this->isBuyOrder = isBuyOrder;
-    this->time = time;
-    this->nextOrder = nullptr;
-    this->prevOrder = nullptr;
-    this->parentLimit = nullptr;
+    this->owner = owner;
+    this->nextOrder = 0;
+    this->prevOrder = 0;
+    this->parentLimit = 0;
+    OrderColdData &cold = OrderPool::cold(OrderPool::indexOf(this));
+    cold.time = time;
+    cold.sequence = sequence;
+}
+
+/**
+ * Allocate an order from the order pool.
+ *
+ * @param size Size of the order
+ * @return Slot for the order
+ */
+template <typename Traits>
+void *BasicOrder<Traits>::operator new(size_t size) {
+    return OrderPool::allocate();
+}
+
+/**
+ * Return an order to the order pool, moving its slot to the next generation so handles to it no longer match.
+ *
+ * @param order Order to return
+ */
+template <typename Traits>
+void BasicOrder<Traits>::operator delete(void *order) {
+    if (order != nullptr) {
+        OrderPool::cold(OrderPool::indexOf(static_cast<Order *>(order))).generation++;
+    }
+    OrderPool::release(order);
 }
 
 /**
@@ -30,7 +62,8 @@ Order::Order(int id, float price, int quantity, bool isBuyOrder, time_t time) {
  *
  * @return ID of the order
  */
-int Order::getId() const {
+template <typename Traits>
+int BasicOrder<Traits>::getId() const {
     return id;
 }
 
@@ -39,7 +72,8 @@ int Order::getId() const {
  *
  * @return Price of the order
  */
-float Order::getPrice() const {
+template <typename Traits>
+typename BasicOrder<Traits>::Price BasicOrder<Traits>::getPrice() const {
     return price;
 }
 
@@ -48,7 +82,8 @@ float Order::getPrice() const {
  *
  * @return Quantity of the order
  */
-int Order::getQuantity() const {
+template <typename Traits>
+typename BasicOrder<Traits>::Quantity BasicOrder<Traits>::getQuantity() const {
     return quantity;
 }
 
@@ -57,17 +92,49 @@ int Order::getQuantity() const {
  *
  * @return Whether the order is a buy order
  */
-bool Order::isBuy() const {
+template <typename Traits>
+bool BasicOrder<Traits>::isBuy() const {
     return isBuyOrder;
 }
 
 /**
- * Getter for time the order was placed.
+ * Getter for ID of the participant owning the order.
+ *
+ * @return ID of the owner, 0 if the order has no owner
+ */
+template <typename Traits>
+uint16_t BasicOrder<Traits>::getOwner() const {
+    return owner;
+}
+
+/**
+ * Getter for exchange time the order was placed.
  *
- * @return Time the order was placed
+ * @return Nanoseconds since the epoch
  */
-time_t Order::getTime() const {
-    return time;
+template <typename Traits>
+uint64_t BasicOrder<Traits>::getTime() const {
+    return OrderPool::cold(OrderPool::indexOf(this)).time;
+}
+
+/**
+ * Getter for sequence number of the order in its order book.
+ *
+ * @return Sequence number of the order
+ */
+template <typename Traits>
+uint64_t BasicOrder<Traits>::getSequence() const {
+    return OrderPool::cold(OrderPool::indexOf(this)).sequence;
+}
+
+/**
+ * Getter for the number of times the slot of the order has been returned to the order pool.
+ *
+ * @return Generation of the slot of the order
+ */
+template <typename Traits>
+uint32_t BasicOrder<Traits>::getGeneration() const {
+    return OrderPool::cold(OrderPool::indexOf(this)).generation;
 }
 
 /**
@@ -75,8 +142,9 @@ time_t Order::getTime() const {
  *
  * @return Next order in the linked list
  */
-Order *Order::getNextOrder() const {
-    return nextOrder;
+template <typename Traits>
+BasicOrder<Traits> *BasicOrder<Traits>::getNextOrder() const {
+    return OrderPool::get(nextOrder);
 }
 
 /**
@@ -84,8 +152,9 @@ Order *Order::getNextOrder() const {
  *
  * @return Previous order in the linked list
  */
-Order *Order::getPrevOrder() const {
-    return prevOrder;
+template <typename Traits>
+BasicOrder<Traits> *BasicOrder<Traits>::getPrevOrder() const {
+    return OrderPool::get(prevOrder);
 }
 
 /**
@@ -93,8 +162,9 @@ Order *Order::getPrevOrder() const {
  *
  * @return Parent limit of the order
  */
-Limit *Order::getParentLimit() const {
-    return parentLimit;
+template <typename Traits>
+typename BasicOrder<Traits>::Limit *BasicOrder<Traits>::getParentLimit() const {
+    return LimitPool::get(parentLimit);
 }
 
 /**
@@ -102,8 +172,9 @@ Limit *Order::getParentLimit() const {
  *
  * @param nextOrder Order to set as the next order in the linked list
  */
-void Order::setNextOrder(Order *newNextOrder) {
-    this->nextOrder = newNextOrder;
+template <typename Traits>
+void BasicOrder<Traits>::setNextOrder(Order *newNextOrder) {
+    this->nextOrder = OrderPool::indexOf(newNextOrder);
 }
 
 /**
@@ -111,8 +182,9 @@ void Order::setNextOrder(Order *newNextOrder) {
  *
  * @param prevOrder Order to set as the previous order in the linked list
  */
-void Order::setPrevOrder(Order *newPrevOrder) {
-    this->prevOrder = newPrevOrder;
+template <typename Traits>
+void BasicOrder<Traits>::setPrevOrder(Order *newPrevOrder) {
+    this->prevOrder = OrderPool::indexOf(newPrevOrder);
 }
 
 /**
@@ -120,7 +192,8 @@ void Order::setPrevOrder(Order *newPrevOrder) {
  *
  * @param quantity Quantity to decrease the order quantity by
  */
-void Order::decreaseQuantity(int amount) {
+template <typename Traits>
+void BasicOrder<Traits>::decreaseQuantity(Quantity amount) {
     this->quantity -= amount;
     this->getParentLimit()->decreaseVolume(amount);
 }
@@ -130,6 +203,89 @@ void Order::decreaseQuantity(int amount) {
  *
  * @param parentLimit Limit to set as the parent limit of the order
  */
-void Order::setParentLimit(Limit *newParentLimit) {
-    this->parentLimit = newParentLimit;
+template <typename Traits>
+void BasicOrder<Traits>::setParentLimit(Limit *newParentLimit) {
+    this->parentLimit = LimitPool::indexOf(newParentLimit);
 }
+
+/**
+ * Setter for the price of the order. Only pegged orders are repriced, orders resting in a price index keep the price
+ * of their limit.
+ *
+ * @param newPrice New price of the order
+ */
+template <typename Traits>
+void BasicOrder<Traits>::setPrice(Price newPrice) {
+    this->price = newPrice;
+}
+
+/**
+ * Constructor for a handle to no order.
+ */
+template <typename Traits>
+BasicOrderHandle<Traits>::BasicOrderHandle(std::nullptr_t) {
+    this->order = nullptr;
+    this->generation = 0;
+}
+
+/**
+ * Constructor for a handle to the order currently in a slot, taking the generation of the slot.
+ *
+ * @param order Order to take a handle of, nullptr for no order
+ */
+template <typename Traits>
+BasicOrderHandle<Traits>::BasicOrderHandle(Order *order) {
+    this->order = order;
+    this->generation = order == nullptr ? 0 : order->getGeneration();
+}
+
+/**
+ * Getter for boolean indicating if the order of the handle has not left the order book since the handle was taken,
+ * by comparing the generation of its slot with the generation taken.
+ *
+ * @return Whether the slot of the order still holds the order
+ */
+template <typename Traits>
+bool BasicOrderHandle<Traits>::isLive() const {
+    return order != nullptr && order->getGeneration() == generation;
+}
+
+/**
+ * Getter for the order of the handle.
+ *
+ * @return Order of the handle, nullptr for a handle to no order
+ */
+template <typename Traits>
+typename BasicOrderHandle<Traits>::Order *BasicOrderHandle<Traits>::get() const {
+    return order;
+}
+
+/**
+ * Access the order of the handle.
+ *
+ * @return Order of the handle
+ */
+template <typename Traits>
+typename BasicOrderHandle<Traits>::Order *BasicOrderHandle<Traits>::operator->() const {
+    return order;
+}
+
+/**
+ * Convert the handle to a pointer to its order.
+ *
+ * @return Order of the handle, nullptr for a handle to no order
+ */
+template <typename Traits>
+BasicOrderHandle<Traits>::operator Order *() const {
+    return order;
+}
+
+template class BasicOrder<OrderBook::Traits>;
+template class BasicOrder<EquityOrderBook::Traits>;
+template class BasicOrder<FuturesOrderBook::Traits>;
+template class BasicOrder<CryptoOrderBook::Traits>;
+
+template class BasicOrderHandle<OrderBook::Traits>;
+template class BasicOrderHandle<EquityOrderBook::Traits>;
+template class BasicOrderHandle<FuturesOrderBook::Traits>;
+template class BasicOrderHandle<CryptoOrderBook::Traits>;
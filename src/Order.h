@@ -5,28 +5,71 @@
 #ifndef ORDER_BOOK_ORDER_H
 #define ORDER_BOOK_ORDER_H
 
-#include "Limit.h"
-#include <ctime>
+#include "BookTraits.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fields of an order kept out of the 32 byte order record, written when the order is added and returned to the pool.
+ * They are not free to read: every execution reads the sequence numbers of both orders for the trade price, the
+ * aggressor and self-trade prevention, and the times when trades are recorded, and every cancel or modify through a
+ * handle reads the generation, each an extra cache line per order. The sequence number does not fit in the record
+ * beside the 32-bit links, so that cost is accepted for the smaller record on every other path.
+ */
+struct OrderColdData {
+    /**
+     * Exchange time the order was placed, in nanoseconds since the epoch.
+     */
+    uint64_t time;
+
+    /**
+     * Sequence number of the order in its order book.
+     */
+    uint64_t sequence;
+
+    /**
+     * Number of times the slot of the order has been returned to the order pool, so a handle to an order that has
+     * left the order book no longer matches its slot once a later order reuses it.
+     */
+    uint32_t generation;
+};
 
 /**
  * Class representing an order in the order book.
+ *
+ * Orders are allocated from the order pool and link to each other and to their limit by 32-bit pool indices, so the
+ * fields touched by add, cancel and execute fit in one 32 byte record for 32-bit quantities. Orders must be created
+ * with new. The order book returns an order to the pool once it is cancelled or fully executed and the listener has
+ * been notified, so a pointer to it must not be used after that, its slot is reused by later orders. Orders are
+ * cancelled and modified through handles, which the order book rejects once the order has left it.
+ *
+ * @tparam Traits Types of the order book
  */
-class Order {
+template <typename Traits>
+class alignas(32) BasicOrder {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+    using Order = BasicOrder;
+    using Limit = typename Traits::Limit;
+    using OrderPool = typename Traits::OrderPool;
+    using LimitPool = typename Traits::LimitPool;
+
 private:
     /**
-     * ID of the order.
+     * Price of the order.
      */
-    int id;
+    Price price;
 
     /**
-     * Price of the order.
+     * ID of the order.
      */
-    float price;
+    int id;
 
     /**
      * Quantity of the order.
      */
-    int quantity;
+    Quantity quantity;
 
     /**
      * Boolean indicating if the order is a buy order.
@@ -34,36 +77,54 @@ private:
     bool isBuyOrder;
 
     /**
-     * Time the order was placed.
+     * ID of the participant owning the order, 0 if the order has no owner.
      */
-    time_t time;
+    uint16_t owner;
 
     /**
-     * Pointer to the next order in the linked list.
+     * Pool index of the next order in the linked list.
      */
-    Order *nextOrder;
+    uint32_t nextOrder;
 
     /**
-     * Pointer to the previous order in the linked list.
+     * Pool index of the previous order in the linked list.
      */
-    Order *prevOrder;
+    uint32_t prevOrder;
 
     /**
-     * Pointer to the parent limit of the order.
+     * Pool index of the parent limit of the order.
      */
-    Limit *parentLimit;
+    uint32_t parentLimit;
 
 public:
     /**
-     * Constructor for Order.
+     * Allocate an order from the order pool.
+     *
+     * @param size Size of the order
+     * @return Slot for the order
+     */
+    static void *operator new(size_t size);
+
+    /**
+     * Return an order to the order pool.
+     *
+     * @param order Order to return
+     */
+    static void operator delete(void *order);
+
+    /**
+     * Constructor for BasicOrder.
      *
      * @param id ID of the order
      * @param price Price of the order
      * @param quantity Quantity of the order
      * @param isBuyOrder Boolean indicating if the order is a buy order
-     * @param time Time the order was placed
+     * @param time Exchange time the order was placed, in nanoseconds since the epoch
+     * @param sequence Sequence number of the order in its order book
+     * @param owner ID of the participant owning the order, 0 if the order has no owner
      */
-    Order(int id, float price, int quantity, bool isBuyOrder, time_t time);
+    BasicOrder(int id, Price price, Quantity quantity, bool isBuyOrder, uint64_t time, uint64_t sequence = 0,
+               uint16_t owner = 0);
 
     /**
      * Getter for the ID of the order.
@@ -77,14 +138,14 @@ public:
      *
      * @return Price of the order
      */
-    float getPrice() const;
+    Price getPrice() const;
 
     /**
      * Getter for the quantity of the order.
      *
      * @return Quantity of the order
      */
-    int getQuantity() const;
+    Quantity getQuantity() const;
 
     /**
      * Getter for the boolean indicating if the order is a buy order.
@@ -94,11 +155,32 @@ public:
     bool isBuy() const;
 
     /**
-     * Getter for the time the order was placed.
+     * Getter for the ID of the participant owning the order.
+     *
+     * @return ID of the owner, 0 if the order has no owner
+     */
+    uint16_t getOwner() const;
+
+    /**
+     * Getter for the exchange time the order was placed.
+     *
+     * @return Nanoseconds since the epoch
+     */
+    uint64_t getTime() const;
+
+    /**
+     * Getter for the sequence number of the order in its order book.
+     *
+     * @return Sequence number of the order
+     */
+    uint64_t getSequence() const;
+
+    /**
+     * Getter for the number of times the slot of the order has been returned to the order pool.
      *
-     * @return Time the order was placed
+     * @return Generation of the slot of the order
      */
-    time_t getTime() const;
+    uint32_t getGeneration() const;
 
     /**
      * Getter for the next order in the linked list.
@@ -142,13 +224,103 @@ public:
      */
     void setParentLimit(Limit *parentLimit);
 
+    /**
+     * Setter for the price of the order, for pegged orders whose price follows the inside.
+     *
+     * @param price New price of the order
+     */
+    void setPrice(Price price);
+
     /**
      * Decreases the quantity of the order by the given quantity.
      *
      * @param quantity Quantity to decrease the order quantity by
      */
-    void decreaseQuantity(int amount);
+    void decreaseQuantity(Quantity amount);
+};
+
+/**
+ * Handle to an order, made of a pointer to the order and the generation of its slot when the handle was taken. The
+ * handle is live while the order is, and stops matching its slot once the order leaves the order book, even after a
+ * later order reuses the slot, so a cancel or modify through an old handle cannot reach the later order.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class BasicOrderHandle {
+public:
+    using Order = typename Traits::Order;
+
+private:
+    /**
+     * Order the handle was taken of.
+     */
+    Order *order;
+
+    /**
+     * Generation of the slot of the order when the handle was taken.
+     */
+    uint32_t generation;
+
+public:
+    /**
+     * Constructor for a handle to no order.
+     */
+    BasicOrderHandle(std::nullptr_t = nullptr);
+
+    /**
+     * Constructor for a handle to the order currently in a slot.
+     *
+     * @param order Order to take a handle of, nullptr for no order
+     */
+    explicit BasicOrderHandle(Order *order);
+
+    /**
+     * Getter for boolean indicating if the order of the handle has not left the order book since the handle was
+     * taken, false for a handle to no order.
+     *
+     * @return Whether the slot of the order still holds the order
+     */
+    bool isLive() const;
+
+    /**
+     * Getter for the order of the handle, which must only be read while the handle is live.
+     *
+     * @return Order of the handle, nullptr for a handle to no order
+     */
+    Order *get() const;
+
+    /**
+     * Access the order of the handle, which must only be read while the handle is live.
+     *
+     * @return Order of the handle
+     */
+    Order *operator->() const;
+
+    /**
+     * Convert the handle to a pointer to its order, dropping the generation.
+     *
+     * @return Order of the handle, nullptr for a handle to no order
+     */
+    operator Order *() const;
 };
 
+/**
+ * Order of the default order book.
+ */
+using Order = DefaultBookTraits::Order;
+
+/**
+ * Handle to an order of the default order book.
+ */
+using OrderHandle = DefaultBookTraits::OrderHandle;
+
+/**
+ * Pool all orders of the default order book are allocated from.
+ */
+using OrderPool = DefaultBookTraits::OrderPool;
+
+static_assert(sizeof(Order) == 32, "Order record must fit in 32 bytes");
+
 
 #endif //ORDER_BOOK_ORDER_H
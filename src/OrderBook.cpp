@@ -5,25 +5,97 @@
 #include "OrderBook.h"
 #include "Order.h"
 #include "Limit.h"
+#include "TscClock.h"
+#include "Stats.h"
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <utility>
 
 /**
- * Constructor for OrderBook.
+ * Create the price index chosen by the configuration for one side of an order book.
+ *
+ * @param config Configuration of the price index
+ * @param orderBook Pointer to the order book
+ * @param isBuy Boolean indicating if the index is for buy limits
+ * @return New price index
  */
-OrderBook::OrderBook() {
-    this->buyTree = nullptr;
-    this->sellTree = nullptr;
-    this->lowestSell = nullptr;
-    this->highestBuy = nullptr;
-    this->buyOrders = new std::unordered_map<int, Order *>();
-    this->sellOrders = new std::unordered_map<int, Order *>();
-    this->buyLimits = new std::unordered_map<float, Limit *>();
-    this->sellLimits = new std::unordered_map<float, Limit *>();
-    this->currBuyOrdersId = 0;
-    this->currSellOrdersId = 0;
-    this->profit = 0;
+template <typename Traits>
+PriceIndex<Traits> *RuntimeIndex::create(const PriceIndexConfig &config, typename Traits::OrderBook *orderBook,
+                                         bool isBuy) {
+    switch (config.type) {
+        case PriceIndexType::BTREE:
+            return new BTreePriceIndex<Traits>(isBuy);
+        case PriceIndexType::TICK_LADDER:
+            return new TickLadderPriceIndex<Traits>(config.minPrice, config.tickSize, isBuy);
+        case PriceIndexType::AVL:
+        default:
+            return new AvlPriceIndex<Traits>(orderBook, isBuy);
+    }
+}
+
+/**
+ * Create an AVL price index for one side of an order book.
+ *
+ * @param config Configuration of the price index
+ * @param orderBook Pointer to the order book
+ * @param isBuy Boolean indicating if the index is for buy limits
+ * @return New price index
+ */
+template <typename Traits>
+AvlPriceIndex<Traits> *AvlIndex::create(const PriceIndexConfig &config, typename Traits::OrderBook *orderBook,
+                                        bool isBuy) {
+    return new AvlPriceIndex<Traits>(orderBook, isBuy);
+}
+
+/**
+ * Create a B+-tree price index for one side of an order book.
+ *
+ * @param config Configuration of the price index
+ * @param orderBook Pointer to the order book
+ * @param isBuy Boolean indicating if the index is for buy limits
+ * @return New price index
+ */
+template <typename Traits>
+BTreePriceIndex<Traits> *BTreeIndex::create(const PriceIndexConfig &config, typename Traits::OrderBook *orderBook,
+                                            bool isBuy) {
+    return new BTreePriceIndex<Traits>(isBuy);
+}
+
+/**
+ * Create a tick ladder price index for one side of an order book.
+ *
+ * @param config Configuration of the price index
+ * @param orderBook Pointer to the order book
+ * @param isBuy Boolean indicating if the index is for buy limits
+ * @return New price index
+ */
+template <typename Traits>
+TickLadderPriceIndex<Traits> *TickLadderIndex::create(const PriceIndexConfig &config,
+                                                      typename Traits::OrderBook *orderBook, bool isBuy) {
+    return new TickLadderPriceIndex<Traits>(config.minPrice, config.tickSize, isBuy);
+}
+
+/**
+ * Constructor for BasicOrderBook.
+ *
+ * @param priceIndexType Type of price index used for each side, if the index policy chooses it at runtime
+ * @param minPrice Lowest price of a tick ladder
+ * @param tickSize Price difference between ticks of a tick ladder
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+BasicOrderBook<P, Q, I, A, L>::BasicOrderBook(PriceIndexType priceIndexType, double minPrice, double tickSize)
+        : bids(I::template create<Traits>({priceIndexType, minPrice, tickSize}, this, true), this),
+          asks(I::template create<Traits>({priceIndexType, minPrice, tickSize}, this, false), this),
+          pegBook(this),
+          riskGate(this) {
+    this->sequence = 0;
+    this->tradeId = 0;
+    this->tradeTape = nullptr;
+    this->selfTradePrevention = SelfTradePrevention::NONE;
+    this->isAuction = false;
+    this->referencePrice = 0;
 }
 
 /**
@@ -31,8 +103,9 @@ OrderBook::OrderBook() {
  *
  * @return Buy limit tree
  */
-Limit *OrderBook::getBuyTree() {
-    return this->buyTree;
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::Limit *BasicOrderBook<P, Q, I, A, L>::getBuyTree() {
+    return this->bids.getTree();
 }
 
 /**
@@ -40,8 +113,9 @@ Limit *OrderBook::getBuyTree() {
  *
  * @return Sell limit tree
  */
-Limit *OrderBook::getSellTree() {
-    return this->sellTree;
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::Limit *BasicOrderBook<P, Q, I, A, L>::getSellTree() {
+    return this->asks.getTree();
 }
 
 /**
@@ -49,8 +123,9 @@ Limit *OrderBook::getSellTree() {
  *
  * @param newBuyTree New buy limit tree
  */
-void OrderBook::setBuyTree(Limit *newBuyTree) {
-    this->buyTree = newBuyTree;
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::setBuyTree(Limit *newBuyTree) {
+    this->bids.setTree(newBuyTree);
 }
 
 /**
@@ -58,206 +133,1008 @@ void OrderBook::setBuyTree(Limit *newBuyTree) {
  *
  * @param newSellTree New sell limit tree
  */
-void OrderBook::setSellTree(Limit *newSellTree) {
-    this->sellTree = newSellTree;
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::setSellTree(Limit *newSellTree) {
+    this->asks.setTree(newSellTree);
+}
+
+/**
+ * Getter for the price index of one side of the order book.
+ *
+ * @param isBuy Boolean indicating to get the buy or sell index
+ * @return Price index of the side
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::PriceIndex *BasicOrderBook<P, Q, I, A, L>::getPriceIndex(bool isBuy) {
+    return isBuy ? this->bids.getPriceIndex() : this->asks.getPriceIndex();
 }
 
 /**
- * Adds an order to the order book. If limit price does not exist, creates new limit. Else, adds order to limit.
+ * Adds an order to the buy or sell side of the order book, checked by the throttle and risk gate and stamped with
+ * the next sequence number of the order book.
  *
  * @param price Price of the order
  * @param quantity Quantity of the order
  * @param isBuy Boolean indicating if the order is a buy order
+ * @param time Exchange time of the order in nanoseconds since the epoch, 0 to use the local clock
+ * @param owner ID of the participant owning the order, 0 if the order has no owner
+ * @return Handle to the new order, to no order if the price is not valid or the order is rejected
  */
-Order *OrderBook::addOrder(float price, int quantity, bool isBuy) {
-    time_t timeNow = time(nullptr);
-    if (isBuy) {
-        Order *newOrder = new Order(currBuyOrdersId, price, quantity, isBuy, timeNow);
-        buyOrders->insert(std::make_pair(currBuyOrdersId, newOrder));
-        currBuyOrdersId++;
-
-        // If limit price not in tree, create new limit in tree
-        if (buyLimits->find(price) == buyLimits->end()) {
-            // If limit price not in limits, create new limit in tree
-            Limit *newLimit = new Limit(price, isBuy, this);
-            buyLimits->insert(std::make_pair(price, newLimit));
-
-            newLimit->addOrder(newOrder);
-
-            if (buyTree == nullptr) {
-                buyTree = newLimit;
-            } else {
-                buyTree->insertLimit(newLimit);
-            }
-        }
-        // If limit price in tree, add order to limit
-        else {
-            Limit *limit = buyLimits->at(price);
-            limit->addOrder(newOrder);
-        }
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::OrderHandle BasicOrderBook<P, Q, I, A, L>::addOrder(Price price,
+                                                                                    Quantity quantity, bool isBuy,
+                                                                                    uint64_t time, uint16_t owner) {
+    uint64_t startTicks = TscClock::ticks();
+    Order *order = isAdmitted(owner) ? add(price, quantity, isBuy, time, owner) : nullptr;
+    checkInvariants();
 
-        // If order is highest buy, update highest buy
-        if (highestBuy == nullptr || price > highestBuy->getPrice()) {
-            highestBuy = newOrder;
+    Stats::add(Counter::ADDS);
+    Stats::add(Counter::ADD_CYCLES, TscClock::ticks() - startTicks);
+    return OrderHandle(order);
+}
+
+/**
+ * Checks an order with the risk gate and adds it to its side, stamped with the next sequence number of the order
+ * book. If no exchange time is given, the order is stamped with the local timestamp counter clock. If the limit price
+ * is not valid for the price index, prints error message and returns nullptr without using a sequence number. The
+ * price collar of the risk gate is centred on the best opposite order, or the best order on the same side if the
+ * opposite side is empty. Rejected orders are reported with the failed check and nullptr is returned.
+ *
+ * @param price Price of the order
+ * @param quantity Quantity of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ * @param time Exchange time of the order in nanoseconds since the epoch, 0 to use the local clock
+ * @param owner ID of the participant owning the order, 0 if the order has no owner
+ * @return New order, nullptr if the price is not valid or the order is rejected by the risk gate
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::Order *BasicOrderBook<P, Q, I, A, L>::add(Price price, Quantity quantity,
+                                                                          bool isBuy, uint64_t time,
+                                                                          uint16_t owner) {
+    if (riskGate.isEnabled()) {
+        Order *reference = isBuy ? asks.getBest() : bids.getBest();
+        if (reference == nullptr) {
+            reference = isBuy ? bids.getBest() : asks.getBest();
         }
+        RiskReject reject = riskGate.check(owner, price, quantity, isBuy,
+                                           reference == nullptr ? 0 : reference->getPrice());
+        if (reject != RiskReject::NONE) {
+            listener.onOrderRejected(RiskGate<Traits>::getReasonName(reject));
+            return nullptr;
+        }
+    }
 
-        // Print order added
-        std::cout << "Buy order added: " << newOrder->getId() << " at " << newOrder->getPrice() << std::endl;
-        return newOrder;
+    if (time == 0) {
+        time = TscClock::now();
+    }
+    Order *order;
+    if (isBuy) {
+        order = bids.addOrder(price, quantity, time, sequence, owner);
     } else {
-        Order *newOrder = new Order(currSellOrdersId, price, quantity, isBuy, timeNow);
-        sellOrders->insert(std::make_pair(currSellOrdersId, newOrder));
-        currSellOrdersId++;
-
-        // If limit price not in tree, create new limit in tree
-        if (sellLimits->find(price) == sellLimits->end()) {
-            // If limit price not in limits, create new limit in tree
-            Limit *newLimit = new Limit(price, isBuy, this);
-            sellLimits->insert(std::make_pair(price, newLimit));
-
-            newLimit->addOrder(newOrder);
-
-            if (sellTree == nullptr) {
-                sellTree = newLimit;
-            } else {
-                sellTree->insertLimit(newLimit);
-            }
+        order = asks.addOrder(price, quantity, time, sequence, owner);
+    }
+    if (order != nullptr) {
+        sequence++;
+        riskGate.onOrderAdded(*order);
+    }
+    return order;
+}
+
+/**
+ * Builds the order book in bulk from orders sorted by price, e.g. from a snapshot or a start of day refresh. Limits are
+ * created in price order and bulk loaded into the price indexes in O(M), orders are appended to their limit queues
+ * directly and the order maps are reserved up front. Sequence numbers continue after the highest sequence number of the
+ * orders, and the orders are counted as open by the risk gate. If the order book is not empty, the orders are not
+ * sorted by price, a price is not valid for the price index or an order id is repeated on a side, prints error message
+ * and builds nothing.
+ *
+ * @param sortedOrders Orders sorted by ascending price, in time priority within a price
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::buildFrom(const std::vector<Order *> &sortedOrders) {
+    if (!bids.isEmpty() || !asks.isEmpty()) {
+        listener.onError("Order book is not empty.");
+        return;
+    }
+
+    // Check orders are sorted and split orders by side
+    std::vector<Order *> sortedBuyOrders;
+    std::vector<Order *> sortedSellOrders;
+    for (Order *order : sortedOrders) {
+        std::vector<Order *> &sideOrders = order->isBuy() ? sortedBuyOrders : sortedSellOrders;
+        if (!sideOrders.empty() && order->getPrice() < sideOrders.back()->getPrice()) {
+            listener.onError("Orders are not sorted by price.");
+            return;
         }
-        // If limit price in tree, add order to limit
-        else {
-            Limit *limit = sellLimits->at(price);
-            limit->addOrder(newOrder);
+        if (!getPriceIndex(order->isBuy())->isValidPrice(order->getPrice())) {
+            listener.onError("Price is not a valid tick.");
+            return;
         }
+        sideOrders.push_back(order);
+    }
 
-        // If order is lowest sell, update lowest sell
-        if (lowestSell == nullptr || price < lowestSell->getPrice()) {
-            lowestSell = newOrder;
+    // Check order ids are unique on each side
+    for (const std::vector<Order *> *sideOrders : {&sortedBuyOrders, &sortedSellOrders}) {
+        std::vector<int> ids;
+        ids.reserve(sideOrders->size());
+        for (Order *order : *sideOrders) {
+            ids.push_back(order->getId());
+        }
+        std::sort(ids.begin(), ids.end());
+        if (std::adjacent_find(ids.begin(), ids.end()) != ids.end()) {
+            listener.onError("Order id is duplicated.");
+            return;
         }
+    }
 
-        // Print order added
-        std::cout << "Sell order added: " << newOrder->getId() << " at " << newOrder->getPrice() << std::endl;
-        return newOrder;
+    for (Order *order : sortedOrders) {
+        if (order->getSequence() >= sequence) {
+            sequence = order->getSequence() + 1;
+        }
     }
+    bids.build(sortedBuyOrders);
+    asks.build(sortedSellOrders);
+    for (Order *order : sortedOrders) {
+        riskGate.onOrderAdded(*order);
+    }
+    checkInvariants();
+
+    // Notify order book built
+    listener.onBookBuilt(sortedOrders.size());
 }
 
 /**
- * Cancels an order by removing from Limit. If order does not exist, prints error message.
- * If Limit is empty, Limit is not removed because assuming high volume of orders, Limit will be filled again.
+ * Cancels an order on its side of the order book, counted by the throttle if the order exists. If the handle no longer
+ * matches the slot of its order, because the order has left the order book, or order does not exist, prints error
+ * message.
  *
- * @param order Order to be cancelled
+ * @param handle Handle to the order to be cancelled
  */
-void OrderBook::cancelOrder(Order *order) {
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::cancelOrder(OrderHandle handle) {
+    if (!handle.isLive()) {
+        listener.onError("Order does not exist.");
+        return;
+    }
+    uint64_t startTicks = TscClock::ticks();
+    Order *order = handle.get();
+    if (throttle.isEnabled() && findOrder(order->getId(), order->isBuy()) == order) {
+        throttle.onOrderCancelled(*order, TscClock::now());
+    }
     if (order->isBuy()) {
-        // Check if order exists
-        if (buyOrders->find(order->getId()) == buyOrders->end()) {
-            std::cout << "Order does not exist." << std::endl;
-            return;
-        }
+        bids.cancelOrder(order);
+    } else {
+        asks.cancelOrder(order);
+    }
+    checkInvariants();
+
+    Stats::add(Counter::CANCELS);
+    Stats::add(Counter::CANCEL_CYCLES, TscClock::ticks() - startTicks);
+}
 
-        // Remove order from limit
-        Limit *limit = buyLimits->at(order->getPrice());
-        limit->removeOrder(order);
+/**
+ * Modifies the price or quantity of an order, checked by the throttle. If the handle no longer matches the slot of its
+ * order, the order does not exist or the quantity is not positive, prints error message and returns a handle to no
+ * order. A modify rejected by the throttle leaves the order as is.
+ *
+ * @param handle Handle to the order to modify
+ * @param price New price of the order
+ * @param quantity New quantity of the order
+ * @return Handle to the modified order, to the new order if it was replaced, to no order if the modify is rejected
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::OrderHandle BasicOrderBook<P, Q, I, A, L>::modifyOrder(OrderHandle handle,
+                                                                                       Price price,
+                                                                                       Quantity quantity) {
+    uint64_t startTicks = TscClock::ticks();
+    Order *order = handle.get();
+    if (!handle.isLive() || findOrder(order->getId(), order->isBuy()) != order) {
+        listener.onError("Order does not exist.");
+        return nullptr;
+    }
+    if (!isAdmitted(order->getOwner())) {
+        return nullptr;
+    }
+    Order *modifiedOrder = modify(order, price, quantity);
+    checkInvariants();
 
-        // Print order cancelled
-        std::cout << "Buy order cancelled: " << order->getId() << " at " << order->getPrice() << std::endl;
+    Stats::add(Counter::MODIFIES);
+    Stats::add(Counter::MODIFY_CYCLES, TscClock::ticks() - startTicks);
+    return OrderHandle(modifiedOrder);
+}
 
-        // If order is highest buy, update highest buy
-        if (order == highestBuy) {
-            highestBuy = limit->getNextInsideOrder();
+/**
+ * Modifies the price or quantity of a live order. A decrease at the same price is applied in place, so the order
+ * keeps its priority. A new price or a larger quantity cancels the order and adds a new order with the same owner,
+ * stamped with the local clock, behind the orders at its price. The new price is checked before the order is
+ * cancelled, but if the risk gate rejects the new order the old order stays cancelled. If the quantity is not
+ * positive or the new price is not valid for the price index, prints error message and returns nullptr.
+ *
+ * @param order Order to modify
+ * @param price New price of the order
+ * @param quantity New quantity of the order
+ * @return Modified order, the new order if it was replaced, nullptr if the modify is rejected
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::Order *BasicOrderBook<P, Q, I, A, L>::modify(Order *order, Price price,
+                                                                             Quantity quantity) {
+    if (quantity <= 0) {
+        listener.onError("Quantity is not positive.");
+        return nullptr;
+    }
+    if (price == order->getPrice() && quantity <= order->getQuantity()) {
+        if (quantity < order->getQuantity()) {
+            riskGate.onOrderDecreased(*order, order->getQuantity() - quantity);
+            order->decreaseQuantity(order->getQuantity() - quantity);
         }
+        return order;
+    }
 
-        // Remove order from orders map
-        buyOrders->erase(order->getId());
+    bool isBuy = order->isBuy();
+    uint16_t owner = order->getOwner();
+    if (!getPriceIndex(isBuy)->isValidPrice(price)) {
+        listener.onError("Price is not a valid tick.");
+        return nullptr;
+    }
+    if (isBuy) {
+        bids.cancelOrder(order);
     } else {
-        // Check if order exists
-        if (sellOrders->find(order->getId()) == sellOrders->end()) {
-            std::cout << "Order does not exist." << std::endl;
-            return;
+        asks.cancelOrder(order);
+    }
+    return add(price, quantity, isBuy, 0, owner);
+}
+
+/**
+ * Applies a batch of messages in order, filling the result of each. Cancels and modifies find their order by ID on
+ * its side. Messages ahead of the current one are prefetched in a pipeline, see prefetchBatch, so their orders and
+ * limits are in cache by the time they are applied. Finding the next best order when the best limit empties is
+ * deferred to the end of the batch, or to the next message that needs the best orders: an execute, or an add or
+ * modify checked by the risk gate. Adds, modifies and cancels are checked by the throttle as they are applied.
+ * Invariants are checked and the batch is counted and timed once. Listener events
+ * are still emitted as each message is applied, as they refer to orders that later messages change.
+ *
+ * @param messages Messages to apply in order
+ * @param count Number of messages
+ * @param results Results to fill, one per message
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::applyBatch(const Message *messages, size_t count, BatchResult *results) {
+    uint64_t startTicks = TscClock::ticks();
+    uint32_t aheadOrders[BATCH_PREFETCH_DISTANCE] = {};
+    bids.setBestDeferred(true);
+    asks.setBestDeferred(true);
+    for (size_t i = 0; i < count; i++) {
+        prefetchBatch(messages, count, i, aheadOrders);
+
+        const Message &message = messages[i];
+        BatchResult &result = results[i];
+        result = {-1, 0, false};
+        bool needsBest = message.type == BatchType::EXECUTE ||
+                         (message.type != BatchType::CANCEL && riskGate.isEnabled());
+        if (needsBest) {
+            bids.setBestDeferred(false);
+            asks.setBestDeferred(false);
+        }
+
+        Order *order = nullptr;
+        if (message.type == BatchType::CANCEL || message.type == BatchType::MODIFY) {
+            order = findOrder(message.orderId, message.isBuy);
+            if (order == nullptr) {
+                listener.onError("Order does not exist.");
+            }
+        }
+        switch (message.type) {
+            case BatchType::ADD:
+                order = isAdmitted(message.owner) ?
+                        add(message.price, message.quantity, message.isBuy, message.time, message.owner) : nullptr;
+                Stats::add(Counter::ADDS);
+                break;
+            case BatchType::CANCEL:
+                if (order != nullptr) {
+                    if (throttle.isEnabled()) {
+                        throttle.onOrderCancelled(*order, TscClock::now());
+                    }
+                    result.orderId = order->getId();
+                    result.isApplied = true;
+                    if (message.isBuy) {
+                        bids.cancelOrder(order);
+                    } else {
+                        asks.cancelOrder(order);
+                    }
+                    order = nullptr;
+                    Stats::add(Counter::CANCELS);
+                }
+                break;
+            case BatchType::MODIFY:
+                if (order != nullptr) {
+                    order = isAdmitted(order->getOwner()) ? modify(order, message.price, message.quantity) : nullptr;
+                    Stats::add(Counter::MODIFIES);
+                }
+                break;
+            case BatchType::EXECUTE:
+                while (executeOrder()) {
+                    result.executedCount++;
+                }
+                result.isApplied = true;
+                break;
+        }
+        if (order != nullptr) {
+            result.orderId = order->getId();
+            result.isApplied = true;
         }
 
-        // Remove order from limit
-        Limit *limit = sellLimits->at(order->getPrice());
-        limit->removeOrder(order);
+        if (needsBest) {
+            bids.setBestDeferred(true);
+            asks.setBestDeferred(true);
+        }
+    }
+    bids.setBestDeferred(false);
+    asks.setBestDeferred(false);
+    checkInvariants();
 
-        // Print order cancelled
-        std::cout << "Sell order cancelled: " << order->getId() << " at " << order->getPrice() << std::endl;
+    Stats::add(Counter::BATCHES);
+    Stats::add(Counter::BATCH_CYCLES, TscClock::ticks() - startTicks);
+}
 
-        // If order is lowest sell, update lowest sell
-        if (order == lowestSell) {
-            lowestSell = limit->getNextInsideOrder();
+/**
+ * Adds an order pegged to the best bid, best offer or midpoint of the displayed orders plus an offset, checked by the
+ * throttle and risk gate and stamped with the next sequence number of the order book. The order joins the back of
+ * the group of pegged orders with the same peg, offset and side, and is repriced with its group whenever the
+ * displayed inside moves. Pegged orders are not displayed and trade when executeOrder finds them crossing the other
+ * side. The risk gate checks the order at its current peg price, without a price collar if the price it follows does
+ * not exist yet.
+ *
+ * @param type Price the order follows
+ * @param offset Offset added to the price followed
+ * @param quantity Quantity of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ * @param time Exchange time of the order in nanoseconds since the epoch, 0 to use the local clock
+ * @param owner ID of the participant owning the order, 0 if the order has no owner
+ * @return Handle to the new pegged order, to no order if the order is rejected by the throttle or risk gate
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::OrderHandle BasicOrderBook<P, Q, I, A, L>::addPeggedOrder(PegType type,
+                                                                                          Price offset,
+                                                                                          Quantity quantity,
+                                                                                          bool isBuy,
+                                                                                          uint64_t time,
+                                                                                          uint16_t owner) {
+    uint64_t startTicks = TscClock::ticks();
+    if (!isAdmitted(owner)) {
+        return nullptr;
+    }
+    pegBook.reprice(bids.getBest(), asks.getBest());
+    if (riskGate.isEnabled()) {
+        Price price;
+        bool isPriced = pegBook.getPrice(type, offset, price);
+        Order *reference = isBuy ? asks.getBest() : bids.getBest();
+        if (reference == nullptr) {
+            reference = isBuy ? bids.getBest() : asks.getBest();
+        }
+        RiskReject reject = riskGate.check(owner, isPriced ? price : 0, quantity, isBuy,
+                                           isPriced && reference != nullptr ? reference->getPrice() : 0);
+        if (reject != RiskReject::NONE) {
+            listener.onOrderRejected(RiskGate<Traits>::getReasonName(reject));
+            return nullptr;
         }
+    }
 
-        // Remove order from orders map
-        sellOrders->erase(order->getId());
+    if (time == 0) {
+        time = TscClock::now();
     }
+    Order *order = pegBook.addOrder(type, offset, quantity, isBuy, time, sequence, owner);
+    sequence++;
+    riskGate.onOrderAdded(*order);
+    checkInvariants();
+
+    Stats::add(Counter::ADDS);
+    Stats::add(Counter::ADD_CYCLES, TscClock::ticks() - startTicks);
+    return OrderHandle(order);
 }
 
 /**
- * Executes an order if highest buy is greater than or equal to lowest sell.
+ * Cancels a pegged order, counted by the throttle if it is a live pegged order. If the handle no longer matches the
+ * slot of its order or the order is not a live pegged order, prints error message.
+ *
+ * @param handle Handle to the pegged order to cancel
  */
-void OrderBook::executeOrder() {
-    if (highestBuy == nullptr || lowestSell == nullptr || highestBuy->getPrice() < lowestSell->getPrice()) {
-        std::cout << "There are no orders to execute." << std::endl;
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::cancelPeggedOrder(OrderHandle handle) {
+    if (!handle.isLive()) {
+        listener.onError("Order does not exist.");
         return;
     }
+    uint64_t startTicks = TscClock::ticks();
+    Order *order = handle.get();
+    if (throttle.isEnabled() && pegBook.findOrder(order->getId()) == order) {
+        throttle.onOrderCancelled(*order, TscClock::now());
+    }
+    pegBook.cancelOrder(order);
+    checkInvariants();
+
+    Stats::add(Counter::CANCELS);
+    Stats::add(Counter::CANCEL_CYCLES, TscClock::ticks() - startTicks);
+}
+
+/**
+ * Finds a live pegged order by looking up its ID in the orders map of the pegged orders.
+ *
+ * @param id ID of the pegged order
+ * @return Pegged order with the ID, nullptr if there is none
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::Order *BasicOrderBook<P, Q, I, A, L>::findPeggedOrder(int id) {
+    return pegBook.findOrder(id);
+}
 
-    if (highestBuy->getQuantity() == lowestSell->getQuantity()) {
-        // Remove both from limits
-        highestBuy->getParentLimit()->removeOrder(highestBuy);
-        lowestSell->getParentLimit()->removeOrder(lowestSell);
-        this->profit += (highestBuy->getPrice() - lowestSell->getPrice()) * highestBuy->getQuantity();
+/**
+ * Checks a new or modified order of a participant with the throttle at the local clock. A rejected order is reported
+ * with the failed check.
+ *
+ * @param owner ID of the participant owning the order
+ * @return Whether the order passes the throttle, true while the throttle is disabled
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+bool BasicOrderBook<P, Q, I, A, L>::isAdmitted(uint16_t owner) {
+    if (!throttle.isEnabled()) {
+        return true;
+    }
+    ThrottleReject reject = throttle.admit(owner, TscClock::now());
+    if (reject != ThrottleReject::NONE) {
+        listener.onOrderRejected(Throttle<Traits>::getReasonName(reject));
+        return false;
+    }
+    return true;
+}
 
-        // Remove highest buy and lowest sell from orders map
-        buyOrders->erase(highestBuy->getId());
-        sellOrders->erase(lowestSell->getId());
+/**
+ * Finds a live order by looking up its ID in the orders map of its side. Order IDs are unique within a side.
+ *
+ * @param id ID of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ * @return Order with the ID, nullptr if there is none
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::Order *BasicOrderBook<P, Q, I, A, L>::findOrder(int id, bool isBuy) {
+    return isBuy ? bids.findOrder(id) : asks.findOrder(id);
+}
 
-        // Print orders executed
-        std::cout << "Executed buy order at " << highestBuy->getPrice() << " and sell order at " <<
-            lowestSell->getPrice() << std::endl;
+/**
+ * Advances the prefetch pipeline of a batch by one message. Each stage runs BATCH_PREFETCH_DISTANCE messages after
+ * the stage before, by when the memory it reads is in cache:
+ * 1. The orders map slot of a cancel or modify, and the start of the limit lookup of an add or modify.
+ * 2. The order record, looked up in the orders map. Its pool index is kept in a ring for the next stage.
+ * 3. The limit of the order and the orders before and after it in its queue.
+ * The ring slot of a message is read by the third stage before the second stage reuses it for a later message.
+ *
+ * @param messages Messages of the batch
+ * @param count Number of messages
+ * @param index Index of the message about to be applied
+ * @param aheadOrders Order pool indices found by the second stage, BATCH_PREFETCH_DISTANCE long
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::prefetchBatch(const Message *messages, size_t count, size_t index,
+                                                  uint32_t *aheadOrders) {
+    const size_t distance = BATCH_PREFETCH_DISTANCE;
+    if (index + 3 * distance < count) {
+        const Message &message = messages[index + 3 * distance];
+        if (message.type == BatchType::CANCEL || message.type == BatchType::MODIFY) {
+            prefetchOrder(message.orderId, message.isBuy);
+        }
+        if (message.type == BatchType::ADD || message.type == BatchType::MODIFY) {
+            prefetchLevel(message.price, message.isBuy);
+        }
+    }
+    if (index + distance < count) {
+        uint32_t &order = aheadOrders[index % distance];
+        if (messages[index + distance].isBuy) {
+            bids.prefetchQueue(order);
+        } else {
+            asks.prefetchQueue(order);
+        }
+        order = 0;
+    }
+    if (index + 2 * distance < count) {
+        const Message &message = messages[index + 2 * distance];
+        if (message.type == BatchType::CANCEL || message.type == BatchType::MODIFY) {
+            aheadOrders[index % distance] = message.isBuy ? bids.prefetchOrderRecord(message.orderId) :
+                                            asks.prefetchOrderRecord(message.orderId);
+        }
+    }
+}
 
-        // Update highest buy and lowest sell
-        highestBuy = highestBuy->getParentLimit()->getNextInsideOrder();
-        lowestSell = lowestSell->getParentLimit()->getNextInsideOrder();
+/**
+ * Prefetches the orders map slot of an order ID, so the lookup of a cancel or modify that follows does not wait on
+ * memory. Meant to be issued as soon as a message is decoded, ahead of applying it.
+ *
+ * @param id ID of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::prefetchOrder(int id, bool isBuy) {
+    if (isBuy) {
+        bids.prefetchOrder(id);
     } else {
-        Order *lowerQuantity = highestBuy->getQuantity() < lowestSell->getQuantity() ? highestBuy : lowestSell;
-        Order *higherQuantity = highestBuy->getQuantity() < lowestSell->getQuantity() ? lowestSell : highestBuy;
+        asks.prefetchOrder(id);
+    }
+}
 
-        // Remove lower quantity from limit and update higher quantity
-        lowerQuantity->getParentLimit()->removeOrder(lowerQuantity);
-        higherQuantity->decreaseQuantity(lowerQuantity->getQuantity());
+/**
+ * Prefetches what the price index of a side reads first to find the limit at a price, the ladder slot of a tick
+ * ladder. Tree indexes prefetch nothing. Meant to be issued as soon as an add is decoded, ahead of applying it.
+ *
+ * @param price Price of the limit
+ * @param isBuy Boolean indicating if the limit is a buy limit
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::prefetchLevel(Price price, bool isBuy) {
+    if (isBuy) {
+        bids.prefetchLevel(price);
+    } else {
+        asks.prefetchLevel(price);
+    }
+}
 
-        if (lowerQuantity->isBuy()) {
-            // Remove lower quantity from orders map
-            buyOrders->erase(lowerQuantity->getId());
+/**
+ * Executes an order if highest buy is greater than or equal to lowest sell. While the best buy and sell orders have
+ * the same owner, self-trade prevention is applied and the next best orders are tried. Only executions are counted.
+ * If there are pegged orders, their groups are repriced to the displayed inside first, and the best pegged order of a
+ * side takes part if its price is better than the best displayed order, which keeps priority at the same price.
+ *
+ * @return Whether an order was executed, false if the order book is not crossed or is in an auction
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+bool BasicOrderBook<P, Q, I, A, L>::executeOrder() {
+    if (isAuction) {
+        listener.onError("Order book is in an auction.");
+        return false;
+    }
 
-            // Print orders executed, noting which is partial
-            std::cout << "Executed buy order at " << lowerQuantity->getPrice() << " and partial sell order at" <<
-                      higherQuantity->getPrice() << std::endl;
+    uint64_t startTicks = TscClock::ticks();
+    Order *highestBuy;
+    Order *lowestSell;
+    do {
+        highestBuy = bids.getBest();
+        lowestSell = asks.getBest();
+        if (!pegBook.isEmpty()) {
+            pegBook.reprice(highestBuy, lowestSell);
+            Order *peggedBuy = pegBook.getBest(true);
+            Order *peggedSell = pegBook.getBest(false);
+            if (peggedBuy != nullptr && (highestBuy == nullptr || peggedBuy->getPrice() > highestBuy->getPrice())) {
+                highestBuy = peggedBuy;
+            }
+            if (peggedSell != nullptr && (lowestSell == nullptr || peggedSell->getPrice() < lowestSell->getPrice())) {
+                lowestSell = peggedSell;
+            }
+        }
+        if (highestBuy == nullptr || lowestSell == nullptr || highestBuy->getPrice() < lowestSell->getPrice()) {
+            listener.onError("There are no orders to execute.");
+            return false;
+        }
+    } while (preventSelfTrade(highestBuy, lowestSell));
+
+    // Trade settles at the price of the older order, which was resting when the newer one arrived
+    Quantity fillQuantity = std::min(highestBuy->getQuantity(), lowestSell->getQuantity());
+    Price tradePrice = highestBuy->getSequence() < lowestSell->getSequence() ? highestBuy->getPrice() :
+                       lowestSell->getPrice();
+    recordTrade(*highestBuy, *lowestSell, tradePrice, fillQuantity, false);
+    bool isBuyFilled = highestBuy->getQuantity() == fillQuantity;
+    bool isSellFilled = lowestSell->getQuantity() == fillQuantity;
+    if (isBuyFilled && isSellFilled) {
+        // Remove both from order book
+        removeBestOrder(highestBuy, false);
+        removeBestOrder(lowestSell, false);
+    } else if (isBuyFilled) {
+        // Remove buy order from order book and update sell order
+        removeBestOrder(highestBuy, false);
+        lowestSell->decreaseQuantity(fillQuantity);
+    } else {
+        // Remove sell order from order book and update buy order
+        removeBestOrder(lowestSell, false);
+        highestBuy->decreaseQuantity(fillQuantity);
+    }
+    // Notify orders executed, noting which is partial, and trade
+    listener.onOrderExecuted(*highestBuy, *lowestSell, isBuyFilled, isSellFilled);
+    listener.onTrade(tradePrice, fillQuantity);
+    releaseFilled(highestBuy, lowestSell, isBuyFilled, isSellFilled);
+    checkInvariants();
+
+    Stats::add(Counter::EXECUTES);
+    Stats::add(Counter::EXECUTE_CYCLES, TscClock::ticks() - startTicks);
+    return true;
+}
+
+/**
+ * Applies self-trade prevention to the best buy and sell orders if they have the same owner. Orders without an owner
+ * never self-trade. The newer order is the one with the higher sequence number. Cancelled orders are removed from
+ * their side like any other cancel.
+ *
+ * @param buyOrder Best buy order
+ * @param sellOrder Best sell order
+ * @return Whether a self-trade was prevented
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+bool BasicOrderBook<P, Q, I, A, L>::preventSelfTrade(Order *buyOrder, Order *sellOrder) {
+    if (selfTradePrevention == SelfTradePrevention::NONE || buyOrder->getOwner() == 0 ||
+        buyOrder->getOwner() != sellOrder->getOwner()) {
+        return false;
+    }
+
+    bool isBuyNewer = buyOrder->getSequence() > sellOrder->getSequence();
+    bool cancelBuy;
+    bool cancelSell;
+    switch (selfTradePrevention) {
+        case SelfTradePrevention::CANCEL_NEWEST:
+            cancelBuy = isBuyNewer;
+            cancelSell = !isBuyNewer;
+            break;
+        case SelfTradePrevention::CANCEL_OLDEST:
+            cancelBuy = !isBuyNewer;
+            cancelSell = isBuyNewer;
+            break;
+        case SelfTradePrevention::DECREMENT_AND_CANCEL:
+            // Larger order keeps the difference
+            cancelBuy = buyOrder->getQuantity() <= sellOrder->getQuantity();
+            cancelSell = sellOrder->getQuantity() <= buyOrder->getQuantity();
+            if (!cancelBuy) {
+                riskGate.onOrderDecreased(*buyOrder, sellOrder->getQuantity());
+                buyOrder->decreaseQuantity(sellOrder->getQuantity());
+            } else if (!cancelSell) {
+                riskGate.onOrderDecreased(*sellOrder, buyOrder->getQuantity());
+                sellOrder->decreaseQuantity(buyOrder->getQuantity());
+            }
+            break;
+        case SelfTradePrevention::CANCEL_BOTH:
+        default:
+            cancelBuy = true;
+            cancelSell = true;
+            break;
+    }
 
-            // Update highest buy
-            highestBuy = highestBuy->getParentLimit()->getNextInsideOrder();
+    if (cancelBuy) {
+        removeBestOrder(buyOrder, true);
+    }
+    if (cancelSell) {
+        removeBestOrder(sellOrder, true);
+    }
+    return true;
+}
 
-            // Update profit
-            // Buy > Sell, lower quantity is the buy order
-            this->profit += (lowerQuantity->getPrice() - higherQuantity->getPrice()) * lowerQuantity->getQuantity();
+/**
+ * Removes a best buy or sell order from the order book. An order that is not the best displayed order of its side is
+ * the best pegged order, and is removed from its peg group.
+ *
+ * @param order Best order of its side
+ * @param isCancelled Boolean indicating if the order is cancelled rather than fully executed
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::removeBestOrder(Order *order, bool isCancelled) {
+    if (order->isBuy() ? order != bids.getBest() : order != asks.getBest()) {
+        if (isCancelled) {
+            pegBook.cancelOrder(order);
+        } else {
+            pegBook.removeExecutedOrder(order);
+        }
+    } else if (order->isBuy()) {
+        if (isCancelled) {
+            bids.cancelOrder(order);
         } else {
-            // Remove lower quantity from orders map
-            sellOrders->erase(lowerQuantity->getId());
+            bids.removeExecutedOrder(order);
+        }
+    } else {
+        if (isCancelled) {
+            asks.cancelOrder(order);
+        } else {
+            asks.removeExecutedOrder(order);
+        }
+    }
+}
+
+/**
+ * Returns the fully executed orders of an execution to the order pool. Called once the listener has been notified of
+ * the execution, as it reads the orders.
+ *
+ * @param buyOrder Buy order of the execution
+ * @param sellOrder Sell order of the execution
+ * @param isBuyFilled Boolean indicating if the buy order was fully executed
+ * @param isSellFilled Boolean indicating if the sell order was fully executed
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::releaseFilled(Order *buyOrder, Order *sellOrder, bool isBuyFilled,
+                                                  bool isSellFilled) {
+    if (isBuyFilled) {
+        delete buyOrder;
+    }
+    if (isSellFilled) {
+        delete sellOrder;
+    }
+}
+
+/**
+ * Records a trade between a buy and sell order, stamped with the local clock. Fills are reported to the risk gate,
+ * throttle, PnL ledger and trade statistics and, if a trade tape is set, a trade record is published to it. The newer
+ * order is the aggressor.
+ *
+ * @param buyOrder Buy order traded
+ * @param sellOrder Sell order traded
+ * @param price Price the trade settled at
+ * @param quantity Quantity traded
+ * @param isAuction Boolean indicating if the trade is part of an auction uncross
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::recordTrade(const Order &buyOrder, const Order &sellOrder, Price price,
+                                                Quantity quantity, bool isAuction) {
+    uint64_t time = TscClock::now();
+    riskGate.onOrderFilled(buyOrder, quantity);
+    riskGate.onOrderFilled(sellOrder, quantity);
+    throttle.onOrderFilled(buyOrder, time);
+    throttle.onOrderFilled(sellOrder, time);
+    pnlLedger.onFill(buyOrder.getOwner(), true, price, quantity);
+    pnlLedger.onFill(sellOrder.getOwner(), false, price, quantity);
+    tradeStats.onTrade(price, quantity, time);
+
+    if (tradeTape != nullptr) {
+        Trade trade;
+        trade.tradeId = tradeId;
+        trade.time = time;
+        trade.buyTime = buyOrder.getTime();
+        trade.sellTime = sellOrder.getTime();
+        trade.price = price;
+        trade.quantity = quantity;
+        trade.buyOrderId = buyOrder.getId();
+        trade.sellOrderId = sellOrder.getId();
+        trade.isBuyAggressor = !isAuction && buyOrder.getSequence() > sellOrder.getSequence();
+        trade.isAuction = isAuction;
+        tradeTape->publish(trade);
+    }
+    tradeId++;
+}
+
+/**
+ * Setter for the trade tape every trade is published to.
+ *
+ * @param newTradeTape New trade tape, nullptr to stop recording trades
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::setTradeTape(Tape *newTradeTape) {
+    this->tradeTape = newTradeTape;
+}
+
+/**
+ * Getter for the trade statistics, for rolling volume and volatility.
+ *
+ * @return Trade statistics of the order book
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+TradeStats<typename BasicOrderBook<P, Q, I, A, L>::Traits> &BasicOrderBook<P, Q, I, A, L>::getTradeStats() {
+    return tradeStats;
+}
+
+/**
+ * Getter for the cost of filling a quantity against the opposite side, taking each limit from the inside outwards
+ * without changing the order book. Tick ladders sweep contiguous ticks with vector instructions, other price indexes
+ * walk their limits. If the side runs out, the cost is of the quantity that could be filled.
+ *
+ * @param quantity Quantity to fill
+ * @param isBuy Boolean indicating if the quantity is bought, sweeping the sell side
+ * @return Cost of the sweep
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+SweepCost<typename BasicOrderBook<P, Q, I, A, L>::Price, typename BasicOrderBook<P, Q, I, A, L>::Quantity>
+BasicOrderBook<P, Q, I, A, L>::getSweepCost(Quantity quantity, bool isBuy) {
+    SweepCost<Price, Quantity> cost = {};
+    Order *best = isBuy ? asks.getBest() : bids.getBest();
+    if (best == nullptr || quantity <= 0) {
+        return cost;
+    }
+    getPriceIndex(!isBuy)->sweep(best->getParentLimit(), quantity, cost);
+    cost.averagePrice = cost.notional / cost.quantity;
+    return cost;
+}
+
+/**
+ * Validates the order book on demand. Checks the price index, limit queues, orders map and best order of each side,
+ * reporting the first broken invariant as an error. Walks every limit and order, so it is meant for tests, debugging
+ * and periodic audits, not the hot path.
+ *
+ * @return Whether the order book is valid
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+bool BasicOrderBook<P, Q, I, A, L>::validate() {
+    const char *error = bids.validate();
+    if (error == nullptr) {
+        error = asks.validate();
+    }
+    if (error != nullptr) {
+        listener.onError(error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Validates the order book after a change when built with ORDER_BOOK_VALIDATE, aborting at the first change that
+ * breaks an invariant. Compiles to nothing otherwise.
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::checkInvariants() {
+#ifdef ORDER_BOOK_VALIDATE
+    if (!validate()) {
+        std::abort();
+    }
+#endif
+}
+
+/**
+ * Getter for the best bid and offer with the last trade and session trade statistics, in one call so strategies do
+ * not recompute them from the trade stream.
+ *
+ * @return Market snapshot of the order book
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+MarketSnapshot<typename BasicOrderBook<P, Q, I, A, L>::Price, typename BasicOrderBook<P, Q, I, A, L>::Quantity>
+BasicOrderBook<P, Q, I, A, L>::getSnapshot() {
+    MarketSnapshot<Price, Quantity> snapshot = {};
+    Order *highestBuy = bids.getBest();
+    Order *lowestSell = asks.getBest();
+    if (highestBuy != nullptr) {
+        snapshot.bestBid = highestBuy->getPrice();
+        snapshot.bestBidVolume = highestBuy->getParentLimit()->getTotalVolume();
+    }
+    if (lowestSell != nullptr) {
+        snapshot.bestAsk = lowestSell->getPrice();
+        snapshot.bestAskVolume = lowestSell->getParentLimit()->getTotalVolume();
+    }
+    snapshot.lastPrice = tradeStats.getLastPrice();
+    snapshot.lastQuantity = tradeStats.getLastQuantity();
+    snapshot.vwap = tradeStats.getVwap();
+    snapshot.volume = tradeStats.getVolume();
+    snapshot.tradeCount = tradeStats.getTradeCount();
+    return snapshot;
+}
 
-            // Print orders executed, noting which is partial
-            std::cout << "Executed partial buy order at " << higherQuantity->getPrice() << " and sell order at" <<
-                      lowerQuantity->getPrice() << std::endl;
+/**
+ * Setter for the self-trade prevention mode.
+ *
+ * @param newSelfTradePrevention New self-trade prevention mode
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::setSelfTradePrevention(SelfTradePrevention newSelfTradePrevention) {
+    this->selfTradePrevention = newSelfTradePrevention;
+}
+
+/**
+ * Starts a call auction. Orders are added as usual but executeOrder is refused until the auction is uncrossed.
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::startAuction() {
+    this->isAuction = true;
+}
+
+/**
+ * Uncrosses the call auction. The crossed limits of each side are walked once from the inside to build cumulative
+ * volume curves, demand at or above each price and supply at or below it, and each limit price in the crossed range
+ * is a candidate. The equilibrium price maximises executed volume, then minimises the imbalance between demand and
+ * supply. If the remaining candidates all have more demand the highest is taken, if they all have more supply the
+ * lowest is taken, else the one closest to the reference price. All fills then execute at the equilibrium price in
+ * price-time priority. Self-trade prevention is not applied to auction fills.
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::uncross() {
+    this->isAuction = false;
+    uint64_t startTicks = TscClock::ticks();
+    Order *highestBuy = bids.getBest();
+    Order *lowestSell = asks.getBest();
+    if (highestBuy == nullptr || lowestSell == nullptr || highestBuy->getPrice() < lowestSell->getPrice()) {
+        listener.onError("There are no orders to uncross.");
+        return;
+    }
+
+    // Volume of each crossed limit, bids from the highest price down and asks from the lowest price up
+    std::vector<std::pair<Price, Quantity>> bidLevels;
+    std::vector<std::pair<Price, Quantity>> askLevels;
+    Quantity demand = 0;
+    for (Order *order = highestBuy; order != nullptr && order->getPrice() >= lowestSell->getPrice();
+         order = bids.getPriceIndex()->getNextOuterOrder(order->getParentLimit())) {
+        bidLevels.emplace_back(order->getPrice(), order->getParentLimit()->getTotalVolume());
+        demand += order->getParentLimit()->getTotalVolume();
+    }
+    for (Order *order = lowestSell; order != nullptr && order->getPrice() <= highestBuy->getPrice();
+         order = asks.getPriceIndex()->getNextOuterOrder(order->getParentLimit())) {
+        askLevels.emplace_back(order->getPrice(), order->getParentLimit()->getTotalVolume());
+    }
+
+    // Walk candidate prices upwards, demand falls as bids drop out and supply rises as asks join
+    Quantity supply = 0;
+    Quantity bestVolume = 0;
+    Quantity bestSurplus = 0;
+    Price lowestPrice = 0;
+    Price highestPrice = 0;
+    Price closestPrice = 0;
+    bool hasBuyPressure = false;
+    bool hasSellPressure = false;
+    size_t bidPosition = bidLevels.size();
+    size_t askPosition = 0;
+    while (bidPosition > 0 || askPosition < askLevels.size()) {
+        Price price = askPosition == askLevels.size() ||
+                      (bidPosition > 0 && bidLevels[bidPosition - 1].first < askLevels[askPosition].first) ?
+                      bidLevels[bidPosition - 1].first : askLevels[askPosition].first;
+        for (; askPosition < askLevels.size() && askLevels[askPosition].first <= price; askPosition++) {
+            supply += askLevels[askPosition].second;
+        }
+
+        Quantity volume = std::min(demand, supply);
+        Quantity surplus = demand > supply ? demand - supply : supply - demand;
+        if (volume > bestVolume || (volume == bestVolume && surplus < bestSurplus)) {
+            bestVolume = volume;
+            bestSurplus = surplus;
+            lowestPrice = price;
+            closestPrice = price;
+            hasBuyPressure = false;
+            hasSellPressure = false;
+        }
+        if (volume == bestVolume && surplus == bestSurplus) {
+            highestPrice = price;
+            hasBuyPressure |= demand > supply;
+            hasSellPressure |= supply > demand;
+            Price distance = price > referencePrice ? price - referencePrice : referencePrice - price;
+            Price closestDistance = closestPrice > referencePrice ? closestPrice - referencePrice :
+                                    referencePrice - closestPrice;
+            if (distance < closestDistance) {
+                closestPrice = price;
+            }
+        }
+
+        for (; bidPosition > 0 && bidLevels[bidPosition - 1].first <= price; bidPosition--) {
+            demand -= bidLevels[bidPosition - 1].second;
+        }
+    }
 
-            // Update lowest sell
-            lowestSell = lowestSell->getParentLimit()->getNextInsideOrder();
+    Price price = closestPrice;
+    if (hasBuyPressure && !hasSellPressure) {
+        price = highestPrice;
+    } else if (hasSellPressure && !hasBuyPressure) {
+        price = lowestPrice;
+    }
 
-            // Update profit
-            // Buy > Sell, higher quantity is the buy order
-            this->profit += (higherQuantity->getPrice() - lowerQuantity->getPrice()) * lowerQuantity->getQuantity();
+    // Match inside orders until the equilibrium volume is executed, every fill is within the equilibrium price
+    for (Quantity remaining = bestVolume; remaining > 0;) {
+        highestBuy = bids.getBest();
+        lowestSell = asks.getBest();
+        Quantity quantity = std::min(highestBuy->getQuantity(), lowestSell->getQuantity());
+        bool isBuyFilled = highestBuy->getQuantity() == quantity;
+        bool isSellFilled = lowestSell->getQuantity() == quantity;
+        recordTrade(*highestBuy, *lowestSell, price, quantity, true);
+        if (isBuyFilled) {
+            bids.removeExecutedOrder(highestBuy);
+        } else {
+            highestBuy->decreaseQuantity(quantity);
+        }
+        if (isSellFilled) {
+            asks.removeExecutedOrder(lowestSell);
+        } else {
+            lowestSell->decreaseQuantity(quantity);
         }
+        listener.onOrderExecuted(*highestBuy, *lowestSell, isBuyFilled, isSellFilled);
+        listener.onTrade(price, quantity);
+        releaseFilled(highestBuy, lowestSell, isBuyFilled, isSellFilled);
+        remaining -= quantity;
+        Stats::add(Counter::EXECUTES);
     }
-    // Print profit
-    std::cout << "Profit: " << this->profit << std::endl;
+    listener.onUncrossed(price, bestVolume);
+    checkInvariants();
+
+    Stats::add(Counter::EXECUTE_CYCLES, TscClock::ticks() - startTicks);
+}
+
+/**
+ * Setter for the reference price breaking ties between equilibrium prices.
+ *
+ * @param newReferencePrice New reference price
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::setReferencePrice(Price newReferencePrice) {
+    this->referencePrice = newReferencePrice;
 }
 
 /**
@@ -266,31 +1143,113 @@ void OrderBook::executeOrder() {
  * @param price Limit price to get volume at
  * @param isBuy Boolean indicating to check buy or sell tree
  */
-void OrderBook::getVolumeAtLimitPrice(float price, bool isBuy) {
-    if (isBuy) {
-        if (this->buyLimits->find(price) == this->buyLimits->end()) {
-            std::cout << "There is no buy volume at this limit price." << std::endl;
-            return;
-        }
-        Limit *limit = this->buyLimits->at(price);
-        std::cout << limit->getTotalVolume() << std::endl;
-    } else {
-        if (this->sellLimits->find(price) == this->sellLimits->end()) {
-            std::cout << "There is no sell volume at this limit price." << std::endl;
-            return;
-        }
-        Limit *limit = this->sellLimits->at(price);
-        std::cout << limit->getTotalVolume() << std::endl;
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::getVolumeAtLimitPrice(Price price, bool isBuy) {
+    Limit *limit = isBuy ? bids.getLimit(price) : asks.getLimit(price);
+    if (limit == nullptr) {
+        std::cout << "There is no " << (isBuy ? "buy" : "sell") << " volume at this limit price." << std::endl;
+        return;
     }
+    std::cout << limit->getTotalVolume() << std::endl;
 }
 
 /**
  * Prints the best ask price. If there is no best ask price, prints error message.
  */
-void OrderBook::getBestBid() {
-    if (this->highestBuy == nullptr) {
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::getBestBid() {
+    Order *highestBuy = bids.getBest();
+    if (highestBuy == nullptr) {
         std::cout << "There is no best bid." << std::endl;
     } else {
-        std::cout << this->highestBuy->getPrice() << std::endl;
+        std::cout << highestBuy->getPrice() << std::endl;
+    }
+}
+
+/**
+ * Getter for the listener receiving order book events.
+ *
+ * @return Listener of the order book
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+typename BasicOrderBook<P, Q, I, A, L>::Listener &BasicOrderBook<P, Q, I, A, L>::getListener() {
+    return listener;
+}
+
+/**
+ * Getter for the pre-trade risk gate, to set account limits and read positions.
+ *
+ * @return Risk gate of the order book
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+RiskGate<typename BasicOrderBook<P, Q, I, A, L>::Traits> &BasicOrderBook<P, Q, I, A, L>::getRiskGate() {
+    return riskGate;
+}
+
+/**
+ * Getter for the participant throttle, to set message rate and order to trade ratio limits.
+ *
+ * @return Throttle of the order book
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+Throttle<typename BasicOrderBook<P, Q, I, A, L>::Traits> &BasicOrderBook<P, Q, I, A, L>::getThrottle() {
+    return throttle;
+}
+
+/**
+ * Getter for the pegged orders, to read peg prices and groups.
+ *
+ * @return Peg book of the order book
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+PegBook<typename BasicOrderBook<P, Q, I, A, L>::Traits> &BasicOrderBook<P, Q, I, A, L>::getPegBook() {
+    return pegBook;
+}
+
+/**
+ * Getter for the ledger of positions and PnL.
+ *
+ * @return PnL ledger of the order book
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+PnlLedger<typename BasicOrderBook<P, Q, I, A, L>::Traits> &BasicOrderBook<P, Q, I, A, L>::getPnlLedger() {
+    return pnlLedger;
+}
+
+/**
+ * Appends the live orders of the order book: buy orders then sell orders from the best limit outwards, then pegged
+ * orders group by group, each limit and group in time priority.
+ *
+ * @param liveOrders Orders to append to
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::getOrders(std::vector<Order *> &liveOrders) {
+    bids.getOrders(liveOrders);
+    asks.getOrders(liveOrders);
+    pegBook.getOrders(liveOrders);
+}
+
+/**
+ * Appends a report of each account that has traded. Open positions are marked at the mid price, at the best price
+ * of the only side with orders if one side is empty, and not marked if the order book is empty.
+ *
+ * @param reports Reports to append to
+ */
+template <typename P, typename Q, typename I, typename A, typename L>
+void BasicOrderBook<P, Q, I, A, L>::getPnlReport(std::vector<PnlReport<Quantity>> &reports) {
+    Order *highestBuy = bids.getBest();
+    Order *lowestSell = asks.getBest();
+    int64_t markPrice = 0;
+    if (highestBuy != nullptr && lowestSell != nullptr) {
+        markPrice = (PnlLedger<Traits>::toFixedPoint(highestBuy->getPrice()) +
+                     PnlLedger<Traits>::toFixedPoint(lowestSell->getPrice())) / 2;
+    } else if (highestBuy != nullptr || lowestSell != nullptr) {
+        markPrice = PnlLedger<Traits>::toFixedPoint((highestBuy != nullptr ? highestBuy : lowestSell)->getPrice());
     }
+    pnlLedger.report(markPrice, reports);
 }
+
+template class BasicOrderBook<FloatPrice, Int32Quantity, RuntimeIndex, PoolAllocator<>, StdoutListener>;
+template class BasicOrderBook<FloatPrice, Int32Quantity, TickLadderIndex, PoolAllocator<>, NullListener>;
+template class BasicOrderBook<TickPrice, Int32Quantity, TickLadderIndex, PoolAllocator<>, NullListener>;
+template class BasicOrderBook<DoublePrice, Int64Quantity, BTreeIndex, PoolAllocator<>, NullListener>;
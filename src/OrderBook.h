@@ -5,74 +5,315 @@
 #ifndef ORDER_BOOK_ORDERBOOK_H
 #define ORDER_BOOK_ORDERBOOK_H
 
-#include <unordered_map>
+#include <cstdint>
+#include <vector>
+#include "BookTraits.h"
 #include "Order.h"
+#include "OrderIndex.h"
 #include "Limit.h"
+#include "PriceIndex.h"
+#include "AvlPriceIndex.h"
+#include "BTreePriceIndex.h"
+#include "TickLadderPriceIndex.h"
+#include "HalfBook.h"
+#include "RiskGate.h"
+#include "Throttle.h"
+#include "PegBook.h"
+#include "PnlLedger.h"
+#include "TradeTape.h"
+#include "TradeStats.h"
 
 /**
- * Class representing the order book.
+ * Self-trade prevention modes, applied when the best buy and sell orders have the same owner.
  */
-class OrderBook {
+enum class SelfTradePrevention {
+    /**
+     * Orders of the same owner are matched.
+     */
+    NONE,
+
+    /**
+     * The newer order is cancelled.
+     */
+    CANCEL_NEWEST,
+
+    /**
+     * The older order is cancelled.
+     */
+    CANCEL_OLDEST,
+
+    /**
+     * Both orders are cancelled.
+     */
+    CANCEL_BOTH,
+
+    /**
+     * Both orders are decreased by the smaller quantity, cancelling the smaller order, or both if equal.
+     */
+    DECREMENT_AND_CANCEL
+};
+
+/**
+ * Best bid and offer of an order book together with its last trade and session trade statistics.
+ *
+ * @tparam Price Price type of the order book
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Price, typename Quantity>
+struct MarketSnapshot {
+    /**
+     * Highest buy price, 0 if there are no buy orders.
+     */
+    Price bestBid;
+
+    /**
+     * Volume at the highest buy price.
+     */
+    Quantity bestBidVolume;
+
+    /**
+     * Lowest sell price, 0 if there are no sell orders.
+     */
+    Price bestAsk;
+
+    /**
+     * Volume at the lowest sell price.
+     */
+    Quantity bestAskVolume;
+
+    /**
+     * Price of the last trade, 0 if there has been no trade.
+     */
+    Price lastPrice;
+
+    /**
+     * Quantity of the last trade.
+     */
+    Quantity lastQuantity;
+
+    /**
+     * Volume weighted average price of the session.
+     */
+    double vwap;
+
+    /**
+     * Quantity traded in the session.
+     */
+    Quantity volume;
+
+    /**
+     * Number of trades in the session.
+     */
+    uint64_t tradeCount;
+};
+
+/**
+ * Types of messages applied to an order book in a batch.
+ */
+enum class BatchType : uint8_t {
+    /**
+     * Add an order.
+     */
+    ADD,
+
+    /**
+     * Cancel an order.
+     */
+    CANCEL,
+
+    /**
+     * Modify the price or quantity of an order.
+     */
+    MODIFY,
+
+    /**
+     * Execute orders until the order book is no longer crossed.
+     */
+    EXECUTE
+};
+
+/**
+ * Message applied to an order book in a batch.
+ *
+ * @tparam Price Price type of the order book
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Price, typename Quantity>
+struct BatchMessage {
+    /**
+     * Type of the message.
+     */
+    BatchType type;
+
+    /**
+     * Boolean indicating if the order is a buy order.
+     */
+    bool isBuy;
+
+    /**
+     * ID of the participant owning an added order, 0 if the order has no owner.
+     */
+    uint16_t owner;
+
+    /**
+     * ID of the order cancelled or modified.
+     */
+    int orderId;
+
+    /**
+     * Price of an added order, or new price of a modified order.
+     */
+    Price price;
+
+    /**
+     * Quantity of an added order, or new quantity of a modified order.
+     */
+    Quantity quantity;
+
+    /**
+     * Exchange time of an added order in nanoseconds since the epoch, 0 to use the local clock.
+     */
+    uint64_t time;
+};
+
+/**
+ * Result of a message applied to an order book in a batch.
+ */
+struct BatchResult {
+    /**
+     * ID of the order added, cancelled or modified, a new ID if a modify replaced the order, -1 if the message was
+     * rejected or is an execute.
+     */
+    int orderId;
+
+    /**
+     * Number of executions of an execute message.
+     */
+    uint32_t executedCount;
+
+    /**
+     * Boolean indicating if the message was applied.
+     */
+    bool isApplied;
+};
+
+/**
+ * Class representing the order book. Each side is a HalfBook specialised at compile time, the public API dispatches
+ * to the side once.
+ *
+ * Every representation choice is a policy, so each instrument instantiates exactly the book it needs. Price and
+ * quantity policies fix the numeric types, the index policy fixes the price index of each side or leaves it to be
+ * chosen at runtime, the allocation policy fixes the pools orders and limits are allocated from and the listener
+ * policy receives order book events.
+ *
+ * @tparam PricePolicy Policy providing the price type
+ * @tparam QuantityPolicy Policy providing the quantity type
+ * @tparam IndexPolicy Policy providing the price index of each side
+ * @tparam AllocPolicy Policy providing the order and limit pools
+ * @tparam ListenerPolicy Policy receiving order book events
+ */
+template <typename PricePolicy, typename QuantityPolicy, typename IndexPolicy, typename AllocPolicy,
+          typename ListenerPolicy>
+class BasicOrderBook {
+public:
+    using Traits = BookTraits<PricePolicy, QuantityPolicy, IndexPolicy, AllocPolicy, ListenerPolicy>;
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+    using Order = typename Traits::Order;
+    using OrderHandle = typename Traits::OrderHandle;
+    using Limit = typename Traits::Limit;
+    using PriceIndex = typename Traits::PriceIndex;
+    using Listener = typename Traits::Listener;
+    using Trade = TradeRecord<Price, Quantity>;
+    using Tape = TradeTape<Trade>;
+    using Message = BatchMessage<Price, Quantity>;
+
+    /**
+     * Number of messages between the stages of the prefetch pipeline of a batch.
+     */
+    static const size_t BATCH_PREFETCH_DISTANCE = 4;
+
 private:
     /**
-     * Pointer to the root of the buy limit AVL tree.
+     * Buy side of the order book.
      */
-    Limit *buyTree;
+    HalfBook<Side::Bid, Traits> bids;
 
     /**
-     * Pointer to the root of the sell limit AVL tree.
+     * Sell side of the order book.
      */
-    Limit *sellTree;
+    HalfBook<Side::Ask, Traits> asks;
 
     /**
-     * Pointer to the lowest sell order.
+     * Pegged orders of both sides, not displayed.
      */
-    Order *lowestSell;
+    PegBook<Traits> pegBook;
 
     /**
-     * Pointer to the highest buy order.
+     * Position and PnL of each account.
      */
-    Order *highestBuy;
+    PnlLedger<Traits> pnlLedger;
 
     /**
-     * Map of buy orders.
+     * Sequence number of the next order added to the order book.
      */
-    std::unordered_map<int, Order *> *buyOrders;
+    uint64_t sequence;
 
     /**
-     * Map of sell orders.
+     * ID of the next trade.
      */
-    std::unordered_map<int, Order *> *sellOrders;
+    uint64_t tradeId;
 
     /**
-     * Map of buy limits.
+     * Trade tape every trade is published to, nullptr if trades are not recorded.
      */
-    std::unordered_map<float, Limit *> *buyLimits;
+    Tape *tradeTape;
 
     /**
-     * Map of sell limits.
+     * Last trade, session and rolling trade statistics.
      */
-    std::unordered_map<float, Limit *> *sellLimits;
+    TradeStats<Traits> tradeStats;
 
     /**
-     * ID of the next buy order.
+     * Self-trade prevention mode applied when matching.
      */
-    int currBuyOrdersId;
+    SelfTradePrevention selfTradePrevention;
 
     /**
-     * ID of the next sell order.
+     * Boolean indicating if the order book is in a call auction, accumulating orders without matching.
      */
-    int currSellOrdersId;
+    bool isAuction;
 
     /**
-     * Current total profits of the order book.
+     * Reference price breaking ties between equilibrium prices, usually the last traded or closing price.
      */
-    float profit;
+    Price referencePrice;
+
+    /**
+     * Pre-trade risk gate checking orders before they are added.
+     */
+    RiskGate<Traits> riskGate;
+
+    /**
+     * Per-participant message rate and order to trade ratio throttle checking adds, modifies and cancels.
+     */
+    Throttle<Traits> throttle;
+
+    /**
+     * Listener receiving order book events.
+     */
+    Listener listener;
+
 public:
     /**
-     * Constructor for OrderBook.
+     * Constructor for BasicOrderBook.
+     *
+     * @param priceIndexType Type of price index used for each side, if the index policy chooses it at runtime
+     * @param minPrice Lowest price of a tick ladder
+     * @param tickSize Price difference between ticks of a tick ladder
      */
-    OrderBook();
+    explicit BasicOrderBook(PriceIndexType priceIndexType = PriceIndexType::AVL, double minPrice = 0,
+                            double tickSize = PricePolicy::DEFAULT_TICK_SIZE);
 
     /**
      * Add order to the order book.
@@ -80,20 +321,132 @@ public:
      * @param price Price of the order
      * @param quantity Quantity of the order
      * @param isBuy Boolean indicating if the order is a buy order
+     * @param time Exchange time of the order in nanoseconds since the epoch, 0 to use the local clock
+     * @param owner ID of the participant owning the order, 0 if the order has no owner
+     * @return Handle to the new order, to no order if the price is not valid or the order is rejected by the throttle
+     * or risk gate
+     */
+    OrderHandle addOrder(Price price, Quantity quantity, bool isBuy, uint64_t time = 0, uint16_t owner = 0);
+
+    /**
+     * Build the order book in bulk from orders sorted by price. The order book must be empty.
+     *
+     * @param sortedOrders Orders sorted by ascending price, in time priority within a price
      */
-    Order *addOrder(float price, int quantity, bool isBuy);
+    void buildFrom(const std::vector<Order *> &sortedOrders);
 
     /**
      * Cancel order in the order book.
      *
-     * @param order Order to cancel
+     * @param handle Handle to the order to cancel
+     */
+    void cancelOrder(OrderHandle handle);
+
+    /**
+     * Modify the price or quantity of an order. A decrease at the same price keeps its priority, any other change
+     * replaces it with a new order behind the orders at its price.
+     *
+     * @param handle Handle to the order to modify
+     * @param price New price of the order
+     * @param quantity New quantity of the order
+     * @return Handle to the modified order, to the new order if it was replaced, to no order if the modify is rejected
      */
-    void cancelOrder(Order *order);
+    OrderHandle modifyOrder(OrderHandle handle, Price price, Quantity quantity);
 
     /**
-     * Execute order in the order book.
+     * Apply a batch of add, cancel, modify and execute messages, finding the best orders once at the end.
+     *
+     * @param messages Messages to apply in order
+     * @param count Number of messages
+     * @param results Results to fill, one per message
+     */
+    void applyBatch(const Message *messages, size_t count, BatchResult *results);
+
+    /**
+     * Find a live order by ID.
+     *
+     * @param id ID of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @return Order with the ID, nullptr if there is none
      */
-    void executeOrder();
+    Order *findOrder(int id, bool isBuy);
+
+    /**
+     * Add an order pegged to the best bid, best offer or midpoint of the displayed orders plus an offset.
+     *
+     * @param type Price the order follows
+     * @param offset Offset added to the price followed
+     * @param quantity Quantity of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @param time Exchange time of the order in nanoseconds since the epoch, 0 to use the local clock
+     * @param owner ID of the participant owning the order, 0 if the order has no owner
+     * @return Handle to the new pegged order, to no order if the order is rejected by the throttle or risk gate
+     */
+    OrderHandle addPeggedOrder(PegType type, Price offset, Quantity quantity, bool isBuy, uint64_t time = 0,
+                               uint16_t owner = 0);
+
+    /**
+     * Cancel a pegged order.
+     *
+     * @param handle Handle to the pegged order to cancel
+     */
+    void cancelPeggedOrder(OrderHandle handle);
+
+    /**
+     * Find a live pegged order by ID.
+     *
+     * @param id ID of the pegged order
+     * @return Pegged order with the ID, nullptr if there is none
+     */
+    Order *findPeggedOrder(int id);
+
+    /**
+     * Prefetch the orders map slot of an order ID, ahead of a cancel or modify of the order.
+     *
+     * @param id ID of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     */
+    void prefetchOrder(int id, bool isBuy);
+
+    /**
+     * Prefetch what finding the limit at a price reads first, ahead of an add at the price.
+     *
+     * @param price Price of the limit
+     * @param isBuy Boolean indicating if the limit is a buy limit
+     */
+    void prefetchLevel(Price price, bool isBuy);
+
+    /**
+     * Execute order in the order book at the price of the older order, applying self-trade prevention to orders of
+     * the same owner.
+     *
+     * @return Whether an order was executed
+     */
+    bool executeOrder();
+
+    /**
+     * Setter for the self-trade prevention mode.
+     *
+     * @param selfTradePrevention New self-trade prevention mode
+     */
+    void setSelfTradePrevention(SelfTradePrevention selfTradePrevention);
+
+    /**
+     * Start a call auction. Orders accumulate without matching until the auction is uncrossed.
+     */
+    void startAuction();
+
+    /**
+     * Uncross the call auction, executing all fills in one batch at the equilibrium price and ending the auction.
+     */
+    void uncross();
+
+    /**
+     * Setter for the reference price breaking ties between equilibrium prices.
+     *
+     * @param referencePrice New reference price
+     */
+    void setReferencePrice(Price referencePrice);
 
     /**
      * Getter for the volume at a given price.
@@ -101,7 +454,7 @@ public:
      * @param price Price to get volume at
      * @param isBuy Boolean indicating to check buy or sell side
      */
-    void getVolumeAtLimitPrice(float price, bool isBuy);
+    void getVolumeAtLimitPrice(Price price, bool isBuy);
 
     /**
      * Getter for the best bid.
@@ -129,13 +482,213 @@ public:
      */
     void setBuyTree(Limit *buyTree);
 
+    /**
+     * Getter for the price index of one side of the order book.
+     *
+     * @param isBuy Boolean indicating to get the buy or sell index
+     * @return Price index of the side
+     */
+    PriceIndex *getPriceIndex(bool isBuy);
+
     /**
      * Setter for limit sell tree.
      *
      * @param sellTree New limit sell tree
      */
     void setSellTree(Limit *sellTree);
+
+    /**
+     * Getter for the listener receiving order book events.
+     *
+     * @return Listener of the order book
+     */
+    Listener &getListener();
+
+    /**
+     * Getter for the pre-trade risk gate.
+     *
+     * @return Risk gate of the order book
+     */
+    RiskGate<Traits> &getRiskGate();
+
+    /**
+     * Getter for the participant throttle.
+     *
+     * @return Throttle of the order book
+     */
+    Throttle<Traits> &getThrottle();
+
+    /**
+     * Getter for the pegged orders.
+     *
+     * @return Peg book of the order book
+     */
+    PegBook<Traits> &getPegBook();
+
+    /**
+     * Getter for the ledger of positions and PnL.
+     *
+     * @return PnL ledger of the order book
+     */
+    PnlLedger<Traits> &getPnlLedger();
+
+    /**
+     * Append the live orders of the order book, displayed and pegged.
+     *
+     * @param liveOrders Orders to append to
+     */
+    void getOrders(std::vector<Order *> &liveOrders);
+
+    /**
+     * Append a report of the position and PnL of each account that has traded, marked at the mid price.
+     *
+     * @param reports Reports to append to
+     */
+    void getPnlReport(std::vector<PnlReport<Quantity>> &reports);
+
+    /**
+     * Setter for the trade tape every trade is published to. The order book is the only producer of the tape.
+     *
+     * @param tradeTape New trade tape, nullptr to stop recording trades
+     */
+    void setTradeTape(Tape *tradeTape);
+
+    /**
+     * Getter for the trade statistics, for rolling volume and volatility.
+     *
+     * @return Trade statistics of the order book
+     */
+    TradeStats<Traits> &getTradeStats();
+
+    /**
+     * Getter for the best bid and offer with the last trade and session trade statistics.
+     *
+     * @return Market snapshot of the order book
+     */
+    MarketSnapshot<Price, Quantity> getSnapshot();
+
+    /**
+     * Getter for the cost of filling a quantity against the opposite side, as if sweeping it with a market order.
+     *
+     * @param quantity Quantity to fill
+     * @param isBuy Boolean indicating if the quantity is bought, sweeping the sell side
+     * @return Cost of the sweep
+     */
+    SweepCost<Price, Quantity> getSweepCost(Quantity quantity, bool isBuy);
+
+    /**
+     * Check the invariants of both sides of the order book. Prints the first broken invariant.
+     *
+     * @return Whether the order book is valid
+     */
+    bool validate();
+
+private:
+    /**
+     * Check an order with the risk gate and add it to its side.
+     *
+     * @param price Price of the order
+     * @param quantity Quantity of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @param time Exchange time of the order in nanoseconds since the epoch, 0 to use the local clock
+     * @param owner ID of the participant owning the order, 0 if the order has no owner
+     * @return New order, nullptr if the price is not valid or the order is rejected by the risk gate
+     */
+    Order *add(Price price, Quantity quantity, bool isBuy, uint64_t time, uint16_t owner);
+
+    /**
+     * Modify the price or quantity of a live order.
+     *
+     * @param order Order to modify
+     * @param price New price of the order
+     * @param quantity New quantity of the order
+     * @return Modified order, the new order if it was replaced, nullptr if the modify is rejected
+     */
+    Order *modify(Order *order, Price price, Quantity quantity);
+
+    /**
+     * Check a new or modified order of a participant with the throttle.
+     *
+     * @param owner ID of the participant owning the order
+     * @return Whether the order passes the throttle
+     */
+    bool isAdmitted(uint16_t owner);
+
+    /**
+     * Advance the prefetch pipeline of a batch by one message.
+     *
+     * @param messages Messages of the batch
+     * @param count Number of messages
+     * @param index Index of the message about to be applied
+     * @param aheadOrders Order pool indices found by the second stage, BATCH_PREFETCH_DISTANCE long
+     */
+    void prefetchBatch(const Message *messages, size_t count, size_t index, uint32_t *aheadOrders);
+
+    /**
+     * Apply self-trade prevention to the best buy and sell orders if they have the same owner.
+     *
+     * @param buyOrder Best buy order
+     * @param sellOrder Best sell order
+     * @return Whether a self-trade was prevented
+     */
+    bool preventSelfTrade(Order *buyOrder, Order *sellOrder);
+
+    /**
+     * Remove a best buy or sell order, displayed or pegged, from the order book.
+     *
+     * @param order Best order of its side
+     * @param isCancelled Boolean indicating if the order is cancelled rather than fully executed
+     */
+    void removeBestOrder(Order *order, bool isCancelled);
+
+    /**
+     * Return the fully executed orders of an execution to the order pool, after the listener has been notified.
+     *
+     * @param buyOrder Buy order of the execution
+     * @param sellOrder Sell order of the execution
+     * @param isBuyFilled Boolean indicating if the buy order was fully executed
+     * @param isSellFilled Boolean indicating if the sell order was fully executed
+     */
+    static void releaseFilled(Order *buyOrder, Order *sellOrder, bool isBuyFilled, bool isSellFilled);
+
+    /**
+     * Record a trade between a buy and sell order, before the orders are decreased.
+     *
+     * @param buyOrder Buy order traded
+     * @param sellOrder Sell order traded
+     * @param price Price the trade settled at
+     * @param quantity Quantity traded
+     * @param isAuction Boolean indicating if the trade is part of an auction uncross
+     */
+    void recordTrade(const Order &buyOrder, const Order &sellOrder, Price price, Quantity quantity, bool isAuction);
+
+    /**
+     * Validate the order book after a change if built with ORDER_BOOK_VALIDATE.
+     */
+    void checkInvariants();
 };
 
+/**
+ * Default order book, with float prices, 32-bit quantities, the price index chosen at runtime and events printed to
+ * stdout.
+ */
+using OrderBook = DefaultBookTraits::OrderBook;
+
+/**
+ * Equities order book, with float prices on a penny tick ladder and events ignored.
+ */
+using EquityOrderBook = BasicOrderBook<FloatPrice, Int32Quantity, TickLadderIndex, PoolAllocator<>, NullListener>;
+
+/**
+ * Futures order book, with integer tick prices on a tick ladder and events ignored.
+ */
+using FuturesOrderBook = BasicOrderBook<TickPrice, Int32Quantity, TickLadderIndex, PoolAllocator<>, NullListener>;
+
+/**
+ * Crypto order book, with double prices over a wide, sparse range in a B+-tree, 64-bit quantities for fractional
+ * units and events ignored.
+ */
+using CryptoOrderBook = BasicOrderBook<DoublePrice, Int64Quantity, BTreeIndex, PoolAllocator<>, NullListener>;
+
 
 #endif //ORDER_BOOK_ORDERBOOK_H
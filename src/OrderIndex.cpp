@@ -0,0 +1,193 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "OrderIndex.h"
+#include "Stats.h"
+
+/**
+ * Initial number of slots.
+ */
+static const size_t INITIAL_CAPACITY = 16;
+
+/**
+ * Constructor for OrderIndex.
+ */
+OrderIndex::OrderIndex() {
+    this->slots = mapSlots(INITIAL_CAPACITY, slotsPageSize);
+    this->mask = INITIAL_CAPACITY - 1;
+    this->count = 0;
+}
+
+/**
+ * Destructor for OrderIndex.
+ */
+OrderIndex::~OrderIndex() {
+    Arena::unmap(slots, sizeof(Slot) * (mask + 1), ArenaUse::ORDER_INDEX, slotsPageSize);
+}
+
+/**
+ * Maps a slot array. Mapped memory is zeroed, so every slot starts empty.
+ *
+ * @param capacity Number of slots
+ * @param pageSize Page size the array was mapped with
+ * @return Slot array
+ */
+OrderIndex::Slot *OrderIndex::mapSlots(size_t capacity, PageSize &pageSize) {
+    return static_cast<Slot *>(Arena::map(sizeof(Slot) * capacity, ArenaUse::ORDER_INDEX, pageSize));
+}
+
+/**
+ * Getter for the home slot of an ID. IDs are mostly sequential, so they are spread with Fibonacci hashing.
+ *
+ * @param id ID of the order
+ * @return Home slot of the ID
+ */
+size_t OrderIndex::slotOf(int id) const {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(id)) * 0x9E3779B97F4A7C15ull >> 32) & mask;
+}
+
+/**
+ * Count a lookup of the order map and the slots it probed past the home slot.
+ *
+ * @param home Home slot of the ID
+ * @param found Slot the lookup stopped at
+ */
+void OrderIndex::countProbes(size_t home, size_t found) const {
+    Stats::add(Counter::HASH_LOOKUPS);
+    Stats::add(Counter::HASH_PROBES, (found - home) & mask);
+}
+
+/**
+ * Find an order by ID.
+ *
+ * @param id ID of the order
+ * @return Order pool index of the order with the ID, 0 if there is none
+ */
+uint32_t OrderIndex::find(int id) const {
+    size_t home = slotOf(id);
+    size_t i = home;
+    while (slots[i].order != 0 && slots[i].id != id) {
+        i = (i + 1) & mask;
+    }
+    countProbes(home, i);
+    return slots[i].order;
+}
+
+/**
+ * Prefetch the home slot of an ID into cache, so a later find, insert or erase of the ID does not wait on memory.
+ *
+ * @param id ID of the order
+ */
+void OrderIndex::prefetch(int id) const {
+    __builtin_prefetch(&slots[slotOf(id)]);
+}
+
+/**
+ * Insert an order, replacing any order with the same ID. Grows the map to keep it at most half full.
+ *
+ * @param id ID of the order
+ * @param order Order pool index of the order to insert, must not be 0
+ */
+void OrderIndex::insert(int id, uint32_t order) {
+    if ((count + 1) * 2 > mask + 1) {
+        rehash((mask + 1) * 2);
+    }
+
+    size_t home = slotOf(id);
+    size_t i = home;
+    while (slots[i].order != 0 && slots[i].id != id) {
+        i = (i + 1) & mask;
+    }
+    countProbes(home, i);
+    if (slots[i].order == 0) {
+        count++;
+    }
+    slots[i].id = id;
+    slots[i].order = order;
+}
+
+/**
+ * Erase an order by ID. Following entries of the probe sequence are shifted back into the hole.
+ *
+ * @param id ID of the order to erase
+ */
+void OrderIndex::erase(int id) {
+    size_t home = slotOf(id);
+    size_t hole = home;
+    while (slots[hole].order != 0 && slots[hole].id != id) {
+        hole = (hole + 1) & mask;
+    }
+    countProbes(home, hole);
+    if (slots[hole].order == 0) {
+        return;
+    }
+
+    for (size_t i = (hole + 1) & mask; slots[i].order != 0; i = (i + 1) & mask) {
+        // Entry can fill the hole if its home slot is not cyclically between the hole and itself
+        size_t home = slotOf(slots[i].id);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    slots[hole].order = 0;
+    count--;
+}
+
+/**
+ * Reserve slots for a number of orders so inserting them does not rehash.
+ *
+ * @param orderCount Number of orders to reserve for
+ */
+void OrderIndex::reserve(size_t orderCount) {
+    size_t capacity = mask + 1;
+    while (orderCount * 2 > capacity) {
+        capacity *= 2;
+    }
+    if (capacity != mask + 1) {
+        rehash(capacity);
+    }
+}
+
+/**
+ * Resize the slot array, reinserting all orders.
+ *
+ * @param newCapacity New number of slots, a power of two
+ */
+void OrderIndex::rehash(size_t newCapacity) {
+    Slot *oldSlots = slots;
+    size_t oldCapacity = mask + 1;
+    PageSize oldPageSize = slotsPageSize;
+
+    slots = mapSlots(newCapacity, slotsPageSize);
+    mask = newCapacity - 1;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (oldSlots[i].order != 0) {
+            size_t j = slotOf(oldSlots[i].id);
+            while (slots[j].order != 0) {
+                j = (j + 1) & mask;
+            }
+            slots[j] = oldSlots[i];
+        }
+    }
+    Arena::unmap(oldSlots, sizeof(Slot) * oldCapacity, ArenaUse::ORDER_INDEX, oldPageSize);
+}
+
+/**
+ * Getter for the number of orders in the map.
+ *
+ * @return Number of orders in the map
+ */
+size_t OrderIndex::size() const {
+    return count;
+}
+
+/**
+ * Getter for boolean indicating if the map is empty.
+ *
+ * @return Whether the map is empty
+ */
+bool OrderIndex::empty() const {
+    return count == 0;
+}
@@ -0,0 +1,150 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_ORDERINDEX_H
+#define ORDER_BOOK_ORDERINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Arena.h"
+
+/**
+ * Open addressing hash map from order ID to the 32-bit order pool index of the order.
+ *
+ * Slots are 8 bytes and probed linearly so a lookup usually touches a single cache line. Erased entries are removed
+ * by shifting back the following entries of the probe sequence, so there are no tombstones. The slot array is mapped
+ * by Arena, so a large map is backed by huge pages if requested. Storing pool indices
+ * rather than orders lets every order book configuration share the map.
+ */
+class OrderIndex {
+private:
+    /**
+     * Entry of the hash map. An order index of 0 marks an empty slot.
+     */
+    struct Slot {
+        int id;
+        uint32_t order;
+    };
+
+    /**
+     * Array of slots, length is a power of two.
+     */
+    Slot *slots;
+
+    /**
+     * Page size the slot array was mapped with.
+     */
+    PageSize slotsPageSize;
+
+    /**
+     * Number of slots minus one.
+     */
+    size_t mask;
+
+    /**
+     * Number of orders in the map.
+     */
+    size_t count;
+
+    /**
+     * Getter for the home slot of an ID.
+     *
+     * @param id ID of the order
+     * @return Home slot of the ID
+     */
+    size_t slotOf(int id) const;
+
+    /**
+     * Resize the slot array, reinserting all orders.
+     *
+     * @param newCapacity New number of slots, a power of two
+     */
+    void rehash(size_t newCapacity);
+
+    /**
+     * Count a lookup of the order map and the slots it probed past the home slot.
+     *
+     * @param home Home slot of the ID
+     * @param found Slot the lookup stopped at
+     */
+    void countProbes(size_t home, size_t found) const;
+
+    /**
+     * Map a zeroed slot array.
+     *
+     * @param capacity Number of slots
+     * @param pageSize Page size the array was mapped with
+     * @return Slot array
+     */
+    static Slot *mapSlots(size_t capacity, PageSize &pageSize);
+
+public:
+    /**
+     * Constructor for OrderIndex.
+     */
+    OrderIndex();
+
+    /**
+     * Destructor for OrderIndex.
+     */
+    ~OrderIndex();
+
+    OrderIndex(const OrderIndex &) = delete;
+
+    OrderIndex &operator=(const OrderIndex &) = delete;
+
+    /**
+     * Find an order by ID.
+     *
+     * @param id ID of the order
+     * @return Order pool index of the order with the ID, 0 if there is none
+     */
+    uint32_t find(int id) const;
+
+    /**
+     * Prefetch the home slot of an ID.
+     *
+     * @param id ID of the order
+     */
+    void prefetch(int id) const;
+
+    /**
+     * Insert an order, replacing any order with the same ID.
+     *
+     * @param id ID of the order
+     * @param order Order pool index of the order to insert, must not be 0
+     */
+    void insert(int id, uint32_t order);
+
+    /**
+     * Erase an order by ID.
+     *
+     * @param id ID of the order to erase
+     */
+    void erase(int id);
+
+    /**
+     * Reserve slots for a number of orders so inserting them does not rehash.
+     *
+     * @param orderCount Number of orders to reserve for
+     */
+    void reserve(size_t orderCount);
+
+    /**
+     * Getter for the number of orders in the map.
+     *
+     * @return Number of orders in the map
+     */
+    size_t size() const;
+
+    /**
+     * Getter for boolean indicating if the map is empty.
+     *
+     * @return Whether the map is empty
+     */
+    bool empty() const;
+};
+
+
+#endif //ORDER_BOOK_ORDERINDEX_H
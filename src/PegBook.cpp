@@ -0,0 +1,270 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "PegBook.h"
+#include "OrderBook.h"
+
+/**
+ * Constructor for PegBook. The orders map is created with the first pegged order, so order books without pegged
+ * orders map no memory for them.
+ *
+ * @param orderBook Order book the pegged orders belong to
+ */
+template <typename Traits>
+PegBook<Traits>::PegBook(OrderBook *orderBook) {
+    this->orders = nullptr;
+    this->currOrdersId = 0;
+    this->bidPrice = 0;
+    this->askPrice = 0;
+    this->hasBid = false;
+    this->hasAsk = false;
+    this->isBestStale = false;
+    this->bestBuyGroup = -1;
+    this->bestSellGroup = -1;
+    this->orderBook = orderBook;
+}
+
+/**
+ * Destructor for PegBook.
+ */
+template <typename Traits>
+PegBook<Traits>::~PegBook() {
+    delete orders;
+}
+
+/**
+ * Prices a group at the inside last passed to reprice. The midpoint is halved in the price type, so it rounds towards
+ * zero for integer prices.
+ *
+ * @param type Price the group follows
+ * @param offset Offset added to the price followed
+ * @param price Price of the group
+ * @return Whether the price the group follows exists
+ */
+template <typename Traits>
+bool PegBook<Traits>::priceOf(PegType type, Price offset, Price &price) const {
+    switch (type) {
+        case PegType::BEST_BID:
+            price = bidPrice + offset;
+            return hasBid;
+        case PegType::BEST_OFFER:
+            price = askPrice + offset;
+            return hasAsk;
+        case PegType::MID:
+        default:
+            price = (bidPrice + askPrice) / 2 + offset;
+            return hasBid && hasAsk;
+    }
+}
+
+/**
+ * Reprices every group if the displayed inside moved since the groups were last priced, by setting the price of the
+ * limit queueing each group, and finds the best group of each side among the groups with orders and a price. Ties
+ * go to the group created first. Costs one pass over the groups, however many orders they hold, and nothing if the
+ * inside did not move and no group was created, emptied or refilled.
+ *
+ * @param highestBuy Best displayed buy order, nullptr if there is none
+ * @param lowestSell Best displayed sell order, nullptr if there is none
+ */
+template <typename Traits>
+void PegBook<Traits>::reprice(const Order *highestBuy, const Order *lowestSell) {
+    bool isBidMoved = (highestBuy != nullptr) != hasBid || (hasBid && highestBuy->getPrice() != bidPrice);
+    bool isAskMoved = (lowestSell != nullptr) != hasAsk || (hasAsk && lowestSell->getPrice() != askPrice);
+    if (!isBidMoved && !isAskMoved && !isBestStale) {
+        return;
+    }
+    hasBid = highestBuy != nullptr;
+    hasAsk = lowestSell != nullptr;
+    bidPrice = hasBid ? highestBuy->getPrice() : 0;
+    askPrice = hasAsk ? lowestSell->getPrice() : 0;
+
+    bestBuyGroup = -1;
+    bestSellGroup = -1;
+    for (int i = 0; i < static_cast<int>(groups.size()); i++) {
+        PegGroup<Traits> &group = groups[i];
+        Price price;
+        group.isPriced = priceOf(group.type, group.offset, price);
+        group.queue->setPrice(price);
+        if (!group.isPriced || group.queue->getSize() == 0) {
+            continue;
+        }
+        int &best = group.isBuy ? bestBuyGroup : bestSellGroup;
+        if (best == -1 || (group.isBuy ? price > groups[best].queue->getPrice() :
+                           price < groups[best].queue->getPrice())) {
+            best = i;
+        }
+    }
+    isBestStale = false;
+}
+
+/**
+ * Adds a pegged order to the back of the group with its peg, offset and side, creating the group at the current
+ * inside if there is none. The order is stamped with the group price, 0 if the group has no price.
+ *
+ * @param type Price the order follows
+ * @param offset Offset added to the price followed
+ * @param quantity Quantity of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ * @param time Time of the order in nanoseconds since the epoch
+ * @param sequence Sequence number of the order in the order book
+ * @param owner ID of the participant owning the order
+ * @return New order
+ */
+template <typename Traits>
+typename PegBook<Traits>::Order *PegBook<Traits>::addOrder(PegType type, Price offset, Quantity quantity,
+                                                           bool isBuy, uint64_t time, uint64_t sequence,
+                                                           uint16_t owner) {
+    PegGroup<Traits> *group = nullptr;
+    for (PegGroup<Traits> &candidate : groups) {
+        if (candidate.type == type && candidate.offset == offset && candidate.isBuy == isBuy) {
+            group = &candidate;
+            break;
+        }
+    }
+    if (group == nullptr) {
+        Price price;
+        bool isPriced = priceOf(type, offset, price);
+        groups.push_back({type, isBuy, isPriced, offset, new Limit(price, isBuy, orderBook)});
+        group = &groups.back();
+    }
+    if (orders == nullptr) {
+        orders = new OrderIndex();
+    }
+
+    Order *newOrder = new Order(currOrdersId, group->isPriced ? group->queue->getPrice() : 0, quantity, isBuy, time,
+                                sequence, owner);
+    orders->insert(currOrdersId, OrderPool::indexOf(newOrder));
+    currOrdersId++;
+    group->queue->addOrder(newOrder);
+    if (group->queue->getSize() == 1) {
+        isBestStale = true;
+    }
+
+    // Notify order added
+    orderBook->getListener().onOrderAdded(*newOrder);
+    return newOrder;
+}
+
+/**
+ * Removes an order from the limit queueing its group. An emptied group may have been the best group of its side.
+ *
+ * @param order Pegged order
+ */
+template <typename Traits>
+void PegBook<Traits>::removeFromGroup(Order *order) {
+    Limit *queue = order->getParentLimit();
+    queue->removeOrder(order);
+    if (queue->getSize() == 0) {
+        isBestStale = true;
+    }
+}
+
+/**
+ * Cancels a pegged order, reported at the price of its group, and returns it to the order pool once the listener has
+ * been notified. If the order is not a live pegged order, prints error message.
+ *
+ * @param order Pegged order to cancel
+ */
+template <typename Traits>
+void PegBook<Traits>::cancelOrder(Order *order) {
+    if (orders == nullptr || orders->find(order->getId()) != OrderPool::indexOf(order)) {
+        orderBook->getListener().onError("Order does not exist.");
+        return;
+    }
+    order->setPrice(order->getParentLimit()->getPrice());
+    removeFromGroup(order);
+
+    // Notify order cancelled
+    orderBook->getRiskGate().onOrderCancelled(*order);
+    orderBook->getListener().onOrderCancelled(*order);
+
+    // Remove order from orders map
+    orders->erase(order->getId());
+    delete order;
+}
+
+/**
+ * Removes a fully executed pegged order from its group and the orders map. The order is not returned to the order
+ * pool, as the listener has not been notified of the execution yet.
+ *
+ * @param order Executed pegged order
+ */
+template <typename Traits>
+void PegBook<Traits>::removeExecutedOrder(Order *order) {
+    removeFromGroup(order);
+    orders->erase(order->getId());
+}
+
+/**
+ * Finds a live pegged order by looking up its ID in the orders map.
+ *
+ * @param id ID of the pegged order
+ * @return Pegged order with the ID, nullptr if there is none
+ */
+template <typename Traits>
+typename PegBook<Traits>::Order *PegBook<Traits>::findOrder(int id) const {
+    return orders == nullptr ? nullptr : OrderPool::get(orders->find(id));
+}
+
+/**
+ * Getter for the price of a group at the inside last passed to reprice, whether or not the group exists.
+ *
+ * @param type Price the group follows
+ * @param offset Offset added to the price followed
+ * @param price Price of the group
+ * @return Whether the price the group follows exists
+ */
+template <typename Traits>
+bool PegBook<Traits>::getPrice(PegType type, Price offset, Price &price) const {
+    return priceOf(type, offset, price);
+}
+
+/**
+ * Getter for the oldest order of the best group of a side, valid after the inside was passed to reprice. Only this
+ * order has its price refreshed to the group price, the prices of the other orders of the group are refreshed when
+ * they reach the front.
+ *
+ * @param isBuy Boolean indicating if the buy side is read
+ * @return Best pegged order, nullptr if no group of the side has orders and a price
+ */
+template <typename Traits>
+typename PegBook<Traits>::Order *PegBook<Traits>::getBest(bool isBuy) {
+    int best = isBuy ? bestBuyGroup : bestSellGroup;
+    if (best == -1) {
+        return nullptr;
+    }
+    Limit *queue = groups[best].queue;
+    Order *order = queue->getHeadOrder();
+    order->setPrice(queue->getPrice());
+    return order;
+}
+
+/**
+ * Appends the live pegged orders, walking the groups in the order they were created and each group in time priority.
+ *
+ * @param pegOrders Orders to append to
+ */
+template <typename Traits>
+void PegBook<Traits>::getOrders(std::vector<Order *> &pegOrders) const {
+    for (const PegGroup<Traits> &group : groups) {
+        for (Order *order = group.queue->getHeadOrder(); order != nullptr; order = order->getNextOrder()) {
+            pegOrders.push_back(order);
+        }
+    }
+}
+
+/**
+ * Getter for the number of groups of both sides, including emptied groups, which are kept for reuse.
+ *
+ * @return Number of groups
+ */
+template <typename Traits>
+size_t PegBook<Traits>::getGroupCount() const {
+    return groups.size();
+}
+
+template class PegBook<OrderBook::Traits>;
+template class PegBook<EquityOrderBook::Traits>;
+template class PegBook<FuturesOrderBook::Traits>;
+template class PegBook<CryptoOrderBook::Traits>;
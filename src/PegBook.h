@@ -0,0 +1,265 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_PEGBOOK_H
+#define ORDER_BOOK_PEGBOOK_H
+
+#include <cstdint>
+#include <vector>
+#include "OrderIndex.h"
+
+/**
+ * Price a pegged order follows.
+ */
+enum class PegType : uint8_t {
+    /**
+     * Highest displayed buy price.
+     */
+    BEST_BID,
+
+    /**
+     * Lowest displayed sell price.
+     */
+    BEST_OFFER,
+
+    /**
+     * Midpoint of the highest displayed buy and lowest displayed sell prices.
+     */
+    MID
+};
+
+/**
+ * Group of pegged orders on one side with the same peg and offset, which always share a price.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+struct PegGroup {
+    /**
+     * Price the group follows.
+     */
+    PegType type;
+
+    /**
+     * Boolean indicating if the group holds buy orders.
+     */
+    bool isBuy;
+
+    /**
+     * Boolean indicating if the price the group follows exists, false while the side it follows is empty.
+     */
+    bool isPriced;
+
+    /**
+     * Offset added to the price the group follows.
+     */
+    typename Traits::Price offset;
+
+    /**
+     * Limit queueing the orders of the group in time priority, priced at the group price and kept out of any price
+     * index.
+     */
+    typename Traits::Limit *queue;
+};
+
+/**
+ * Pegged orders of an order book, kept in groups that reprice as a whole when the displayed inside moves.
+ *
+ * Every pegged order on a side with the same peg and offset has the same price, so each group queues its orders in
+ * one limit and only the limit is repriced, with no order cancelled, re-added or touched. Repricing is lazy: the
+ * order book passes the displayed inside before reading the pegged orders, and the groups are repriced only if it
+ * moved. Pegged orders are not displayed, so they never move the prices they follow. Orders are allocated from the
+ * order pool of the order book and identified by IDs of their own, counting up across both sides.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class PegBook {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+    using Order = typename Traits::Order;
+    using Limit = typename Traits::Limit;
+    using OrderBook = typename Traits::OrderBook;
+    using OrderPool = typename Traits::OrderPool;
+
+private:
+    /**
+     * Groups of both sides, in the order they were created.
+     */
+    std::vector<PegGroup<Traits>> groups;
+
+    /**
+     * Map of pegged order IDs to order pool indices, created with the first pegged order.
+     */
+    OrderIndex *orders;
+
+    /**
+     * ID of the next pegged order.
+     */
+    int currOrdersId;
+
+    /**
+     * Highest displayed buy price the groups were priced at.
+     */
+    Price bidPrice;
+
+    /**
+     * Lowest displayed sell price the groups were priced at.
+     */
+    Price askPrice;
+
+    /**
+     * Boolean indicating if there was a displayed buy order when the groups were priced.
+     */
+    bool hasBid;
+
+    /**
+     * Boolean indicating if there was a displayed sell order when the groups were priced.
+     */
+    bool hasAsk;
+
+    /**
+     * Boolean indicating if the best groups must be found again, because a group was created, emptied or refilled.
+     */
+    bool isBestStale;
+
+    /**
+     * Index of the best buy group with orders, -1 if there is none.
+     */
+    int bestBuyGroup;
+
+    /**
+     * Index of the best sell group with orders, -1 if there is none.
+     */
+    int bestSellGroup;
+
+    /**
+     * Order book the pegged orders belong to.
+     */
+    OrderBook *orderBook;
+
+    /**
+     * Price a group at the current inside.
+     *
+     * @param type Price the group follows
+     * @param offset Offset added to the price followed
+     * @param price Price of the group
+     * @return Whether the price the group follows exists
+     */
+    bool priceOf(PegType type, Price offset, Price &price) const;
+
+    /**
+     * Remove an order from its group, marking the best groups stale if the group empties.
+     *
+     * @param order Pegged order
+     */
+    void removeFromGroup(Order *order);
+
+public:
+    /**
+     * Constructor for PegBook.
+     *
+     * @param orderBook Order book the pegged orders belong to
+     */
+    explicit PegBook(OrderBook *orderBook);
+
+    /**
+     * Destructor for PegBook.
+     */
+    ~PegBook();
+
+    PegBook(const PegBook &) = delete;
+    PegBook &operator=(const PegBook &) = delete;
+
+    /**
+     * Getter for boolean indicating if there are no pegged orders.
+     *
+     * @return Whether there are no pegged orders
+     */
+    bool isEmpty() const {
+        return orders == nullptr || orders->empty();
+    }
+
+    /**
+     * Reprice every group if the displayed inside moved, and find the best group of each side.
+     *
+     * @param highestBuy Best displayed buy order, nullptr if there is none
+     * @param lowestSell Best displayed sell order, nullptr if there is none
+     */
+    void reprice(const Order *highestBuy, const Order *lowestSell);
+
+    /**
+     * Add a pegged order to the back of its group, creating the group if needed. The inside must have been passed
+     * to reprice first.
+     *
+     * @param type Price the order follows
+     * @param offset Offset added to the price followed
+     * @param quantity Quantity of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @param time Time of the order in nanoseconds since the epoch
+     * @param sequence Sequence number of the order in the order book
+     * @param owner ID of the participant owning the order
+     * @return New order
+     */
+    Order *addOrder(PegType type, Price offset, Quantity quantity, bool isBuy, uint64_t time, uint64_t sequence,
+                    uint16_t owner);
+
+    /**
+     * Cancel a pegged order. If the order does not exist, prints error message.
+     *
+     * @param order Pegged order to cancel
+     */
+    void cancelOrder(Order *order);
+
+    /**
+     * Remove a fully executed pegged order.
+     *
+     * @param order Executed pegged order
+     */
+    void removeExecutedOrder(Order *order);
+
+    /**
+     * Find a pegged order by ID.
+     *
+     * @param id ID of the pegged order
+     * @return Pegged order with the ID, nullptr if there is none
+     */
+    Order *findOrder(int id) const;
+
+    /**
+     * Getter for the price of a group at the inside last passed to reprice.
+     *
+     * @param type Price the group follows
+     * @param offset Offset added to the price followed
+     * @param price Price of the group
+     * @return Whether the price the group follows exists
+     */
+    bool getPrice(PegType type, Price offset, Price &price) const;
+
+    /**
+     * Getter for the oldest order of the best group of a side, with its price set to the group price.
+     *
+     * @param isBuy Boolean indicating if the buy side is read
+     * @return Best pegged order, nullptr if no group of the side has orders and a price
+     */
+    Order *getBest(bool isBuy);
+
+    /**
+     * Append the live pegged orders, group by group in time priority.
+     *
+     * @param pegOrders Orders to append to
+     */
+    void getOrders(std::vector<Order *> &pegOrders) const;
+
+    /**
+     * Getter for the number of groups of both sides.
+     *
+     * @return Number of groups
+     */
+    size_t getGroupCount() const;
+};
+
+
+#endif //ORDER_BOOK_PEGBOOK_H
@@ -0,0 +1,116 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "PnlLedger.h"
+#include "OrderBook.h"
+#include <cmath>
+
+/**
+ * Converts a price to fixed point, rounding away the binary error of floating point prices.
+ *
+ * @param price Price to convert
+ * @return Price in fixed point, rounded to the nearest unit
+ */
+template <typename Traits>
+int64_t PnlLedger<Traits>::toFixedPoint(Price price) {
+    return std::llround(static_cast<double>(price) * FIXED_POINT_SCALE);
+}
+
+/**
+ * Records a fill of an account. A fill in the direction of the position adds to its cost. A fill against the
+ * position closes it at its average cost, realising the difference to the fill price, and any quantity left over
+ * opens a position the other way at the fill price.
+ *
+ * @param owner ID of the account
+ * @param isBuy Boolean indicating if the account bought
+ * @param price Price of the fill
+ * @param quantity Quantity of the fill
+ */
+template <typename Traits>
+void PnlLedger<Traits>::onFill(uint16_t owner, bool isBuy, Price price, Quantity quantity) {
+    if (owner >= accounts.size()) {
+        accounts.resize(owner + 1);
+    }
+    AccountPnl<Quantity> &account = accounts[owner];
+    int64_t fixedPrice = toFixedPoint(price);
+    Quantity signedQuantity = isBuy ? quantity : -quantity;
+    account.tradedQuantity += quantity;
+
+    if (account.position == 0 || (account.position > 0) == isBuy) {
+        account.cost += fixedPrice * signedQuantity;
+        account.position += signedQuantity;
+        return;
+    }
+
+    // Close at the average cost, the product is widened so large positions do not overflow
+    Quantity openQuantity = account.position > 0 ? account.position : -account.position;
+    Quantity closedQuantity = quantity < openQuantity ? quantity : openQuantity;
+    auto closedCost = static_cast<int64_t>(static_cast<__int128>(account.cost) * closedQuantity / openQuantity);
+    int64_t closedValue = fixedPrice * closedQuantity;
+    account.realisedPnl += account.position > 0 ? closedValue - closedCost : -closedValue - closedCost;
+    account.cost -= closedCost;
+    account.position += isBuy ? closedQuantity : -closedQuantity;
+
+    // Open the other way with any quantity left over
+    Quantity remainingQuantity = quantity - closedQuantity;
+    if (remainingQuantity > 0) {
+        account.position = isBuy ? remainingQuantity : -remainingQuantity;
+        account.cost = fixedPrice * account.position;
+    }
+}
+
+/**
+ * Getter for the position and PnL of an account.
+ *
+ * @param owner ID of the account
+ * @return Position and PnL of the account, all zero if the account has not traded
+ */
+template <typename Traits>
+AccountPnl<typename PnlLedger<Traits>::Quantity> PnlLedger<Traits>::getAccount(uint16_t owner) const {
+    return owner < accounts.size() ? accounts[owner] : AccountPnl<Quantity>();
+}
+
+/**
+ * Getter for the unrealised PnL of an account, the value of its open position at the mark price less its cost.
+ *
+ * @param owner ID of the account
+ * @param markPrice Fixed point price the open position is marked at
+ * @return Unrealised PnL of the account
+ */
+template <typename Traits>
+int64_t PnlLedger<Traits>::getUnrealisedPnl(uint16_t owner, int64_t markPrice) const {
+    if (owner >= accounts.size()) {
+        return 0;
+    }
+    return markPrice * accounts[owner].position - accounts[owner].cost;
+}
+
+/**
+ * Appends a report of each account that has traded, in owner order, e.g. for end of day reconciliation.
+ *
+ * @param markPrice Fixed point price open positions are marked at, 0 if there is no mark price
+ * @param reports Reports to append to
+ */
+template <typename Traits>
+void PnlLedger<Traits>::report(int64_t markPrice, std::vector<PnlReport<Quantity>> &reports) const {
+    for (size_t owner = 0; owner < accounts.size(); owner++) {
+        const AccountPnl<Quantity> &account = accounts[owner];
+        if (account.tradedQuantity == 0) {
+            continue;
+        }
+        PnlReport<Quantity> report;
+        report.owner = static_cast<uint16_t>(owner);
+        report.position = account.position;
+        report.averageCost = account.position == 0 ? 0 : account.cost / account.position;
+        report.realisedPnl = account.realisedPnl;
+        report.unrealisedPnl = markPrice == 0 ? 0 : getUnrealisedPnl(report.owner, markPrice);
+        report.tradedQuantity = account.tradedQuantity;
+        reports.push_back(report);
+    }
+}
+
+template class PnlLedger<OrderBook::Traits>;
+template class PnlLedger<EquityOrderBook::Traits>;
+template class PnlLedger<FuturesOrderBook::Traits>;
+template class PnlLedger<CryptoOrderBook::Traits>;
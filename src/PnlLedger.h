@@ -0,0 +1,149 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_PNLLEDGER_H
+#define ORDER_BOOK_PNLLEDGER_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Position and PnL of an account, with money amounts in fixed point.
+ *
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Quantity>
+struct AccountPnl {
+    /**
+     * Filled quantity bought minus filled quantity sold.
+     */
+    Quantity position = 0;
+
+    /**
+     * Cost of the open position, negative for a short position.
+     */
+    int64_t cost = 0;
+
+    /**
+     * PnL realised by closing positions.
+     */
+    int64_t realisedPnl = 0;
+
+    /**
+     * Total filled quantity bought and sold.
+     */
+    Quantity tradedQuantity = 0;
+};
+
+/**
+ * Position and PnL of an account marked at a price, with money amounts in fixed point.
+ *
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Quantity>
+struct PnlReport {
+    /**
+     * ID of the account.
+     */
+    uint16_t owner;
+
+    /**
+     * Filled quantity bought minus filled quantity sold.
+     */
+    Quantity position;
+
+    /**
+     * Average cost of a unit of the open position, 0 if the account is flat.
+     */
+    int64_t averageCost;
+
+    /**
+     * PnL realised by closing positions.
+     */
+    int64_t realisedPnl;
+
+    /**
+     * PnL of the open position at the mark price, 0 if there is no mark price.
+     */
+    int64_t unrealisedPnl;
+
+    /**
+     * Total filled quantity bought and sold.
+     */
+    Quantity tradedQuantity;
+};
+
+/**
+ * Ledger of the position and PnL of each account, updated from fills.
+ *
+ * Money amounts are 64-bit integers in units of 1 / FIXED_POINT_SCALE of the price, so PnL accumulates exactly
+ * however many fills there are, as long as the cost of a position fits in 63 bits. Accounts are the owner IDs of
+ * orders, kept in a flat array indexed by owner and grown to the highest owner seen, so a fill is O(1).
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class PnlLedger {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+
+    /**
+     * Number of fixed point units in a unit of price.
+     */
+    static constexpr int64_t FIXED_POINT_SCALE = Traits::FIXED_POINT_SCALE;
+
+private:
+    /**
+     * Position and PnL of each account.
+     */
+    std::vector<AccountPnl<Quantity>> accounts;
+
+public:
+    /**
+     * Convert a price to fixed point.
+     *
+     * @param price Price to convert
+     * @return Price in fixed point, rounded to the nearest unit
+     */
+    static int64_t toFixedPoint(Price price);
+
+    /**
+     * Record a fill of an account.
+     *
+     * @param owner ID of the account
+     * @param isBuy Boolean indicating if the account bought
+     * @param price Price of the fill
+     * @param quantity Quantity of the fill
+     */
+    void onFill(uint16_t owner, bool isBuy, Price price, Quantity quantity);
+
+    /**
+     * Getter for the position and PnL of an account.
+     *
+     * @param owner ID of the account
+     * @return Position and PnL of the account, all zero if the account has not traded
+     */
+    AccountPnl<Quantity> getAccount(uint16_t owner) const;
+
+    /**
+     * Getter for the unrealised PnL of an account.
+     *
+     * @param owner ID of the account
+     * @param markPrice Fixed point price the open position is marked at
+     * @return Unrealised PnL of the account
+     */
+    int64_t getUnrealisedPnl(uint16_t owner, int64_t markPrice) const;
+
+    /**
+     * Append a report of each account that has traded.
+     *
+     * @param markPrice Fixed point price open positions are marked at, 0 if there is no mark price
+     * @param reports Reports to append to
+     */
+    void report(int64_t markPrice, std::vector<PnlReport<Quantity>> &reports) const;
+};
+
+
+#endif //ORDER_BOOK_PNLLEDGER_H
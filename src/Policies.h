@@ -0,0 +1,284 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_POLICIES_H
+#define ORDER_BOOK_POLICIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include "Pool.h"
+
+template <typename Traits>
+class PriceIndex;
+
+template <typename Traits>
+class AvlPriceIndex;
+
+template <typename Traits>
+class BTreePriceIndex;
+
+template <typename Traits>
+class TickLadderPriceIndex;
+
+struct PriceIndexConfig;
+
+/**
+ * Price policy storing prices as 32-bit floats.
+ */
+struct FloatPrice {
+    using Price = float;
+
+    /**
+     * Default tick size, one cent.
+     */
+    static constexpr double DEFAULT_TICK_SIZE = 0.01;
+
+    /**
+     * Fixed point units in a unit of price for money amounts, a hundredth of a cent.
+     */
+    static constexpr int64_t FIXED_POINT_SCALE = 10000;
+};
+
+/**
+ * Price policy storing prices as 64-bit doubles.
+ */
+struct DoublePrice {
+    using Price = double;
+
+    /**
+     * Default tick size, one cent.
+     */
+    static constexpr double DEFAULT_TICK_SIZE = 0.01;
+
+    /**
+     * Fixed point units in a unit of price for money amounts, a hundredth of a cent.
+     */
+    static constexpr int64_t FIXED_POINT_SCALE = 10000;
+};
+
+/**
+ * Price policy storing prices as 64-bit integer ticks.
+ */
+struct TickPrice {
+    using Price = int64_t;
+
+    /**
+     * Default tick size, prices are already in ticks.
+     */
+    static constexpr double DEFAULT_TICK_SIZE = 1;
+
+    /**
+     * Fixed point units in a unit of price for money amounts, money is counted in ticks.
+     */
+    static constexpr int64_t FIXED_POINT_SCALE = 1;
+};
+
+/**
+ * Quantity policy storing quantities as 32-bit integers.
+ */
+struct Int32Quantity {
+    using Quantity = int32_t;
+};
+
+/**
+ * Quantity policy storing quantities as 64-bit integers.
+ */
+struct Int64Quantity {
+    using Quantity = int64_t;
+};
+
+/**
+ * Index policy choosing the price index of each book at runtime, called through the PriceIndex interface.
+ */
+struct RuntimeIndex {
+    template <typename Traits>
+    using Index = PriceIndex<Traits>;
+
+    template <typename Traits>
+    static Index<Traits> *create(const PriceIndexConfig &config, typename Traits::OrderBook *orderBook, bool isBuy);
+};
+
+/**
+ * Index policy using the AVL price index.
+ */
+struct AvlIndex {
+    template <typename Traits>
+    using Index = AvlPriceIndex<Traits>;
+
+    template <typename Traits>
+    static Index<Traits> *create(const PriceIndexConfig &config, typename Traits::OrderBook *orderBook, bool isBuy);
+};
+
+/**
+ * Index policy using the B+-tree price index.
+ */
+struct BTreeIndex {
+    template <typename Traits>
+    using Index = BTreePriceIndex<Traits>;
+
+    template <typename Traits>
+    static Index<Traits> *create(const PriceIndexConfig &config, typename Traits::OrderBook *orderBook, bool isBuy);
+};
+
+/**
+ * Index policy using the tick ladder price index.
+ */
+struct TickLadderIndex {
+    template <typename Traits>
+    using Index = TickLadderPriceIndex<Traits>;
+
+    template <typename Traits>
+    static Index<Traits> *create(const PriceIndexConfig &config, typename Traits::OrderBook *orderBook, bool isBuy);
+};
+
+/**
+ * Allocation policy allocating orders and limits from index addressed pools.
+ *
+ * @tparam OrderCapacity Maximum number of orders
+ * @tparam LimitCapacity Maximum number of limits
+ */
+template <uint32_t OrderCapacity = (1u << 27), uint32_t LimitCapacity = (1u << 24)>
+struct PoolAllocator {
+    template <typename Order, typename Cold>
+    using OrderPool = Pool<Order, Cold, OrderCapacity, ArenaUse::ORDERS>;
+
+    template <typename Limit, typename Cold>
+    using LimitPool = Pool<Limit, Cold, LimitCapacity, ArenaUse::LIMITS>;
+};
+
+/**
+ * Listener policy printing order book events to stdout.
+ */
+struct StdoutListener {
+    /**
+     * Print an order added to the order book.
+     *
+     * @param order Order added
+     */
+    template <typename Order>
+    void onOrderAdded(const Order &order) {
+        std::cout << (order.isBuy() ? "Buy" : "Sell") << " order added: " << order.getId() << " at " <<
+                  order.getPrice() << std::endl;
+    }
+
+    /**
+     * Print an order rejected by the risk gate.
+     *
+     * @param reason Name of the failed risk check
+     */
+    void onOrderRejected(const char *reason) {
+        std::cout << "Order rejected: " << reason << std::endl;
+    }
+
+    /**
+     * Print an order cancelled from the order book.
+     *
+     * @param order Order cancelled
+     */
+    template <typename Order>
+    void onOrderCancelled(const Order &order) {
+        std::cout << (order.isBuy() ? "Buy" : "Sell") << " order cancelled: " << order.getId() << " at " <<
+                  order.getPrice() << std::endl;
+    }
+
+    /**
+     * Print a buy and sell order executed against each other, noting which is partial.
+     *
+     * @param buyOrder Buy order executed
+     * @param sellOrder Sell order executed
+     * @param isBuyFilled Boolean indicating if the buy order is fully executed
+     * @param isSellFilled Boolean indicating if the sell order is fully executed
+     */
+    template <typename Order>
+    void onOrderExecuted(const Order &buyOrder, const Order &sellOrder, bool isBuyFilled, bool isSellFilled) {
+        if (isBuyFilled && isSellFilled) {
+            std::cout << "Executed buy order at " << buyOrder.getPrice() << " and sell order at " <<
+                      sellOrder.getPrice() << std::endl;
+        } else if (isBuyFilled) {
+            std::cout << "Executed buy order at " << buyOrder.getPrice() << " and partial sell order at" <<
+                      sellOrder.getPrice() << std::endl;
+        } else {
+            std::cout << "Executed partial buy order at " << buyOrder.getPrice() << " and sell order at" <<
+                      sellOrder.getPrice() << std::endl;
+        }
+    }
+
+    /**
+     * Print an auction uncrossed at a single price.
+     *
+     * @param price Equilibrium price all fills executed at
+     * @param volume Volume executed
+     */
+    template <typename Price, typename Quantity>
+    void onUncrossed(Price price, Quantity volume) {
+        std::cout << "Uncrossed " << volume << " at " << price << std::endl;
+    }
+
+    /**
+     * Print a trade between a buy and sell order.
+     *
+     * @param price Price the trade settled at
+     * @param quantity Quantity traded
+     */
+    template <typename Price, typename Quantity>
+    void onTrade(Price price, Quantity quantity) {
+        std::cout << "Traded " << quantity << " at " << price << std::endl;
+    }
+
+    /**
+     * Print an order book built in bulk.
+     *
+     * @param orderCount Number of orders in the order book
+     */
+    void onBookBuilt(size_t orderCount) {
+        std::cout << "Order book built from " << orderCount << " orders." << std::endl;
+    }
+
+    /**
+     * Print an error.
+     *
+     * @param message Error message
+     */
+    void onError(const char *message) {
+        std::cout << message << std::endl;
+    }
+};
+
+/**
+ * Listener policy ignoring order book events, compiled away entirely.
+ */
+struct NullListener {
+    template <typename Order>
+    void onOrderAdded(const Order &order) {
+    }
+
+    void onOrderRejected(const char *reason) {
+    }
+
+    template <typename Order>
+    void onOrderCancelled(const Order &order) {
+    }
+
+    template <typename Order>
+    void onOrderExecuted(const Order &buyOrder, const Order &sellOrder, bool isBuyFilled, bool isSellFilled) {
+    }
+
+    template <typename Price, typename Quantity>
+    void onUncrossed(Price price, Quantity volume) {
+    }
+
+    template <typename Price, typename Quantity>
+    void onTrade(Price price, Quantity quantity) {
+    }
+
+    void onBookBuilt(size_t orderCount) {
+    }
+
+    void onError(const char *message) {
+    }
+};
+
+
+#endif //ORDER_BOOK_POLICIES_H
@@ -0,0 +1,212 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_POOL_H
+#define ORDER_BOOK_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include "Arena.h"
+#include "Stats.h"
+
+/**
+ * Empty cold data for pools of objects without cold fields.
+ */
+struct NoColdData {
+};
+
+/**
+ * Pool of fixed size objects addressed by 32-bit indices.
+ *
+ * Objects live in a single contiguous virtual memory reservation so an index converts to a pointer with one add and a
+ * pointer converts back with one subtract. The reservation is mapped by Arena, with huge pages if requested. Physical
+ * pages are only committed when first touched, except hugetlb pages, which are reserved a chunk at a time as the pool
+ * grows. Index 0 is never allocated and stands for nullptr. Fields that are rarely touched can be kept out of the
+ * object in a parallel cold array with the same index. Freed slots are reused through a free list threaded through the
+ * slots.
+ *
+ * Each thread has its own instance of every pool, reserved the first time the thread allocates from it, so order
+ * books on different threads never share pool state and need no synchronisation. An order book must therefore only
+ * be used on the thread that created it, and indices are only meaningful on the thread that allocated them. The
+ * reservations of a thread are not unmapped when it exits.
+ *
+ * @tparam T Type of the pooled objects
+ * @tparam Cold Type of the cold data kept for each object
+ * @tparam Capacity Maximum number of objects in the pool
+ * @tparam Use Storage the pool is reported as
+ */
+template <typename T, typename Cold = NoColdData, uint32_t Capacity = (1u << 24), ArenaUse Use = ArenaUse::OTHER>
+class Pool {
+private:
+    /**
+     * State of the pool instance of a thread.
+     */
+    struct State {
+        /**
+         * Base of the object reservation. Slot 0 is the nullptr index.
+         */
+        T *base = nullptr;
+
+        /**
+         * Base of the cold data reservation.
+         */
+        Cold *coldBase = nullptr;
+
+        /**
+         * Index of the next never used slot.
+         */
+        uint32_t nextIndex = 1;
+
+        /**
+         * Index of the first free slot, 0 if there are no free slots.
+         */
+        uint32_t freeIndex = 0;
+
+        /**
+         * Number of slots committed in both the object and the cold data reservations.
+         */
+        uint32_t committedCount = 0;
+
+        /**
+         * Object reservation.
+         */
+        ArenaReservation objects;
+
+        /**
+         * Cold data reservation, unused if there is no cold data.
+         */
+        ArenaReservation coldObjects;
+    };
+
+    /**
+     * Pool instance of the calling thread.
+     */
+    static inline thread_local State state;
+
+    /**
+     * Reserve virtual memory for the whole capacity of the pool.
+     *
+     * @param pool Pool instance of the calling thread
+     */
+    static void reserve(State &pool) {
+        Arena::reserve(pool.objects, sizeof(T) * static_cast<size_t>(Capacity), Use);
+        pool.base = static_cast<T *>(pool.objects.start);
+        if (!std::is_empty<Cold>::value) {
+            Arena::reserve(pool.coldObjects, sizeof(Cold) * static_cast<size_t>(Capacity), Use);
+            pool.coldBase = static_cast<Cold *>(pool.coldObjects.start);
+        }
+    }
+
+    /**
+     * Commit the reservations up to and including a slot, and count the slots committed in both.
+     *
+     * @param pool Pool instance of the calling thread
+     * @param index Index of the slot about to be used
+     */
+    static void commit(State &pool, uint32_t index) {
+        size_t count = static_cast<size_t>(index) + 1;
+        Arena::commit(pool.objects, sizeof(T) * count, Use);
+        size_t committedCount = pool.objects.committedBytes / sizeof(T);
+        if (!std::is_empty<Cold>::value) {
+            Arena::commit(pool.coldObjects, sizeof(Cold) * count, Use);
+            committedCount = std::min(committedCount, pool.coldObjects.committedBytes / sizeof(Cold));
+        }
+        pool.committedCount = static_cast<uint32_t>(std::min<size_t>(committedCount, Capacity));
+    }
+
+public:
+    /**
+     * Maximum number of objects in the pool.
+     */
+    static constexpr uint32_t CAPACITY = Capacity;
+
+    /**
+     * Allocate a slot for an object.
+     *
+     * @return Uninitialised slot for an object
+     */
+    static void *allocate() {
+        State &pool = state;
+        if (pool.base == nullptr) {
+            reserve(pool);
+        }
+
+        uint32_t index;
+        if (pool.freeIndex != 0) {
+            index = pool.freeIndex;
+            pool.freeIndex = *reinterpret_cast<uint32_t *>(pool.base + index);
+        } else {
+            if (pool.nextIndex == Capacity) {
+                throw std::bad_alloc();
+            }
+            if (pool.nextIndex >= pool.committedCount) {
+                commit(pool, pool.nextIndex);
+            }
+            index = pool.nextIndex++;
+            Stats::add(Counter::POOL_REFILLS);
+        }
+        return pool.base + index;
+    }
+
+    /**
+     * Return a slot to the pool.
+     *
+     * @param object Slot of a destroyed object
+     */
+    static void release(void *object) {
+        if (object == nullptr) {
+            return;
+        }
+        State &pool = state;
+        uint32_t index = static_cast<uint32_t>(static_cast<T *>(object) - pool.base);
+        *reinterpret_cast<uint32_t *>(pool.base + index) = pool.freeIndex;
+        pool.freeIndex = index;
+    }
+
+    /**
+     * Getter for the object at an index.
+     *
+     * @param index Index of the object
+     * @return Object at the index, nullptr for index 0
+     */
+    static T *get(uint32_t index) {
+        return index == 0 ? nullptr : state.base + index;
+    }
+
+    /**
+     * Getter for the index of an object.
+     *
+     * @param object Object allocated from the pool
+     * @return Index of the object, 0 for nullptr
+     */
+    static uint32_t indexOf(const T *object) {
+        return object == nullptr ? 0 : static_cast<uint32_t>(object - state.base);
+    }
+
+    /**
+     * Getter for the cold data of the object at an index.
+     *
+     * @param index Index of the object
+     * @return Cold data of the object
+     */
+    static Cold &cold(uint32_t index) {
+        return state.coldBase[index];
+    }
+
+    /**
+     * Getter for the page size the object reservation of the calling thread was last committed with, base pages until
+     * its first allocation.
+     *
+     * @return Page size of the pool
+     */
+    static PageSize getPageSize() {
+        return state.objects.pageSize;
+    }
+};
+
+
+#endif //ORDER_BOOK_POOL_H
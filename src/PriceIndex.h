@@ -0,0 +1,214 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_PRICEINDEX_H
+#define ORDER_BOOK_PRICEINDEX_H
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * Types of price index an order book can use for each side.
+ */
+enum class PriceIndexType {
+    /**
+     * Hash map from price to limit, with limits linked into an AVL tree.
+     */
+    AVL,
+
+    /**
+     * B+-tree of limits with wide, cache line sized nodes.
+     */
+    BTREE,
+
+    /**
+     * Array of limits indexed by tick, with a bitmap of non-empty limits.
+     */
+    TICK_LADDER
+};
+
+/**
+ * Configuration of the price index of each side of an order book.
+ */
+struct PriceIndexConfig {
+    /**
+     * Type of price index, only used when the index policy chooses the index at runtime.
+     */
+    PriceIndexType type;
+
+    /**
+     * Lowest price of a tick ladder.
+     */
+    double minPrice;
+
+    /**
+     * Price difference between ticks of a tick ladder.
+     */
+    double tickSize;
+};
+
+/**
+ * Cost of sweeping one side of the order book for a quantity, taking each limit from the inside outwards.
+ *
+ * @tparam Price Price type of the order book
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Price, typename Quantity>
+struct SweepCost {
+    /**
+     * Quantity filled, less than the quantity swept for if the side runs out.
+     */
+    Quantity quantity;
+
+    /**
+     * Sum of price times quantity filled at each limit.
+     */
+    double notional;
+
+    /**
+     * Average price of the quantity filled, 0 if nothing was filled.
+     */
+    double averagePrice;
+
+    /**
+     * Price of the last limit filled from, 0 if nothing was filled.
+     */
+    Price worstPrice;
+
+    /**
+     * Number of limits filled from.
+     */
+    int levelCount;
+};
+
+/**
+ * Interface for the index of limits on one side of the order book, keyed by price.
+ *
+ * Used when an order is added at a price, to find its limit or insert a new one and to mark a refilled limit, when a
+ * limit empties, to mark it and find the next inside order, when the order book is built or validated, and by walks
+ * from the inside outwards: sweep costs, the auction uncross and listing resting orders. Orders cancelled from
+ * or executed against limits that keep other orders never touch it. Index policies that fix the index at compile
+ * time use a final implementation directly, so these calls are not dispatched virtually.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class PriceIndex {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+    using Limit = typename Traits::Limit;
+    using Order = typename Traits::Order;
+
+    /**
+     * Destructor for PriceIndex.
+     */
+    virtual ~PriceIndex() = default;
+
+    /**
+     * Find the limit at a price.
+     *
+     * @param price Price of the limit
+     * @return Limit at the price, nullptr if there is none
+     */
+    virtual Limit *find(Price price) const = 0;
+
+    /**
+     * Prefetch the memory finding the limit at a price reads first. Tree indexes reach a limit through a chain of
+     * dependent loads, so nothing is prefetched by default.
+     *
+     * @param price Price of the limit
+     */
+    virtual void prefetch(Price price) const {
+    }
+
+    /**
+     * Insert a new limit into the index.
+     *
+     * @param limit Limit to insert, its price must not be in the index
+     */
+    virtual void insert(Limit *limit) = 0;
+
+    /**
+     * Getter for boolean indicating if a limit can be created at a price.
+     *
+     * @param price Price of the limit
+     * @return Whether a limit can be created at the price
+     */
+    virtual bool isValidPrice(Price price) const {
+        return true;
+    }
+
+    /**
+     * Update the index when a limit gains its first order or loses its last order.
+     *
+     * @param limit Limit that changed
+     * @param isEmpty Boolean indicating if the limit now has no orders
+     */
+    virtual void setEmpty(const Limit *limit, bool isEmpty) {
+    }
+
+    /**
+     * Build the index from limits sorted by price. The index must be empty.
+     *
+     * @param sortedLimits Limits sorted by ascending price
+     */
+    virtual void build(const std::vector<Limit *> &sortedLimits) = 0;
+
+    /**
+     * Getter for the next inside order, the head order of the limit if it has orders, else the head order of the
+     * next limit away from the inside of the book.
+     *
+     * @param limit Limit to start from
+     * @return Next inside order, nullptr if there is none
+     */
+    virtual Order *getNextInsideOrder(const Limit *limit) const = 0;
+
+    /**
+     * Getter for the next outer order, the head order of the next limit with orders away from the inside of the
+     * book, skipping the limit itself.
+     *
+     * @param limit Limit to start from
+     * @return Next outer order, nullptr if there is none
+     */
+    virtual Order *getNextOuterOrder(const Limit *limit) const = 0;
+
+    /**
+     * Getter for boolean indicating if the index is empty.
+     *
+     * @return Whether the index is empty
+     */
+    virtual bool empty() const = 0;
+
+    /**
+     * Check the invariants of the index and collect its limits, including limits without orders.
+     *
+     * @param sortedLimits Limits to append to, sorted by ascending price
+     * @return Description of the first broken invariant, nullptr if the index is valid
+     */
+    virtual const char *validate(std::vector<const Limit *> &sortedLimits) const = 0;
+
+    /**
+     * Sweep the side from a limit outwards until a quantity is filled, adding each limit filled from to the cost.
+     * Walks the limits with orders one at a time, indexes with contiguous limits override it.
+     *
+     * @param limit Limit with orders to start from, the inside limit of the side
+     * @param quantity Quantity to fill
+     * @param cost Cost to add to, starting from zero
+     */
+    virtual void sweep(const Limit *limit, Quantity quantity, SweepCost<Price, Quantity> &cost) const {
+        while (limit != nullptr && cost.quantity < quantity) {
+            Quantity fillQuantity = std::min(limit->getTotalVolume(), quantity - cost.quantity);
+            cost.quantity += fillQuantity;
+            cost.notional += static_cast<double>(limit->getPrice()) * fillQuantity;
+            cost.worstPrice = limit->getPrice();
+            cost.levelCount++;
+            const Order *next = getNextOuterOrder(limit);
+            limit = next == nullptr ? nullptr : next->getParentLimit();
+        }
+    }
+};
+
+
+#endif //ORDER_BOOK_PRICEINDEX_H
@@ -0,0 +1,220 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "ReferenceBook.h"
+#include "OrderBook.h"
+#include <algorithm>
+
+/**
+ * Constructor for ReferenceBook.
+ */
+template <typename Traits>
+ReferenceBook<Traits>::ReferenceBook() {
+    this->sequence = 0;
+    this->volume = 0;
+    this->tradeCount = 0;
+}
+
+/**
+ * Finds a live order by looking up its price, then searching its level.
+ *
+ * @param id ID of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ * @return Order, nullptr if it is not live
+ */
+template <typename Traits>
+typename ReferenceBook<Traits>::Order *ReferenceBook<Traits>::find(int id, bool isBuy) {
+    std::map<int, Price> &prices = isBuy ? bidPrices : askPrices;
+    auto price = prices.find(id);
+    if (price == prices.end()) {
+        return nullptr;
+    }
+    Level &level = (isBuy ? bids : asks)[price->second];
+    for (Order &order : level) {
+        if (order.id == id) {
+            return &order;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Removes an order from its level, removing the level if it empties.
+ *
+ * @param id ID of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ */
+template <typename Traits>
+void ReferenceBook<Traits>::remove(int id, bool isBuy) {
+    std::map<int, Price> &prices = isBuy ? bidPrices : askPrices;
+    std::map<Price, Level> &levels = isBuy ? bids : asks;
+    auto price = prices.find(id);
+    auto level = levels.find(price->second);
+    level->second.erase(std::find_if(level->second.begin(), level->second.end(),
+                                     [id](const Order &order) { return order.id == id; }));
+    if (level->second.empty()) {
+        levels.erase(level);
+    }
+    prices.erase(price);
+}
+
+/**
+ * Adds an order behind the orders at its price, then matches the oldest orders at the best prices while the book is
+ * crossed. Each trade settles at the price of the older order.
+ *
+ * @param id ID the order book gave the order
+ * @param price Price of the order
+ * @param quantity Quantity of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ */
+template <typename Traits>
+void ReferenceBook<Traits>::addOrder(int id, Price price, Quantity quantity, bool isBuy) {
+    (isBuy ? bids : asks)[price].push_back({id, quantity, sequence++});
+    (isBuy ? bidPrices : askPrices)[id] = price;
+
+    while (!bids.empty() && !asks.empty() && bids.rbegin()->first >= asks.begin()->first) {
+        Order buyOrder = bids.rbegin()->second.front();
+        Order sellOrder = asks.begin()->second.front();
+        Price tradePrice = buyOrder.sequence < sellOrder.sequence ? bids.rbegin()->first : asks.begin()->first;
+        Quantity fillQuantity = std::min(buyOrder.quantity, sellOrder.quantity);
+        fills.push_back({tradePrice, fillQuantity, buyOrder.id, sellOrder.id});
+        volume += fillQuantity;
+        tradeCount++;
+
+        bids.rbegin()->second.front().quantity -= fillQuantity;
+        asks.begin()->second.front().quantity -= fillQuantity;
+        if (buyOrder.quantity == fillQuantity) {
+            remove(buyOrder.id, true);
+        }
+        if (sellOrder.quantity == fillQuantity) {
+            remove(sellOrder.id, false);
+        }
+    }
+}
+
+/**
+ * Cancels a live order.
+ *
+ * @param id ID of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ * @return Whether the order was live
+ */
+template <typename Traits>
+bool ReferenceBook<Traits>::cancelOrder(int id, bool isBuy) {
+    if (find(id, isBuy) == nullptr) {
+        return false;
+    }
+    remove(id, isBuy);
+    return true;
+}
+
+/**
+ * Decreases the quantity of a live order in place, so it keeps its priority.
+ *
+ * @param id ID of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ * @param amount Amount to decrease by, less than the quantity of the order
+ * @return Whether the order was live
+ */
+template <typename Traits>
+bool ReferenceBook<Traits>::decreaseQuantity(int id, bool isBuy, Quantity amount) {
+    Order *order = find(id, isBuy);
+    if (order == nullptr) {
+        return false;
+    }
+    order->quantity -= amount;
+    return true;
+}
+
+/**
+ * Removes every order and fill and resets the traded totals.
+ */
+template <typename Traits>
+void ReferenceBook<Traits>::clear() {
+    bids.clear();
+    asks.clear();
+    bidPrices.clear();
+    askPrices.clear();
+    fills.clear();
+    volume = 0;
+    tradeCount = 0;
+}
+
+/**
+ * Getter for the remaining quantity of an order.
+ *
+ * @param id ID of the order
+ * @param isBuy Boolean indicating if the order is a buy order
+ * @return Remaining quantity, 0 if the order is not live
+ */
+template <typename Traits>
+typename ReferenceBook<Traits>::Quantity ReferenceBook<Traits>::getQuantity(int id, bool isBuy) {
+    Order *order = find(id, isBuy);
+    return order == nullptr ? 0 : order->quantity;
+}
+
+/**
+ * Getter for the buy levels.
+ *
+ * @return Buy levels by price, best price last
+ */
+template <typename Traits>
+const std::map<typename ReferenceBook<Traits>::Price, typename ReferenceBook<Traits>::Level> &
+ReferenceBook<Traits>::getBids() const {
+    return bids;
+}
+
+/**
+ * Getter for the sell levels.
+ *
+ * @return Sell levels by price, best price first
+ */
+template <typename Traits>
+const std::map<typename ReferenceBook<Traits>::Price, typename ReferenceBook<Traits>::Level> &
+ReferenceBook<Traits>::getAsks() const {
+    return asks;
+}
+
+/**
+ * Getter for the fills matched since they were last cleared.
+ *
+ * @return Fills in the order they were matched
+ */
+template <typename Traits>
+const std::vector<typename ReferenceBook<Traits>::Fill> &ReferenceBook<Traits>::getFills() const {
+    return fills;
+}
+
+/**
+ * Clears the fills.
+ */
+template <typename Traits>
+void ReferenceBook<Traits>::clearFills() {
+    fills.clear();
+}
+
+/**
+ * Getter for the quantity traded since the book was cleared.
+ *
+ * @return Quantity traded
+ */
+template <typename Traits>
+typename ReferenceBook<Traits>::Quantity ReferenceBook<Traits>::getVolume() const {
+    return volume;
+}
+
+/**
+ * Getter for the number of trades since the book was cleared.
+ *
+ * @return Number of trades
+ */
+template <typename Traits>
+uint64_t ReferenceBook<Traits>::getTradeCount() const {
+    return tradeCount;
+}
+
+template class ReferenceBook<OrderBook::Traits>;
+template class ReferenceBook<EquityOrderBook::Traits>;
+template class ReferenceBook<FuturesOrderBook::Traits>;
+template class ReferenceBook<CryptoOrderBook::Traits>;
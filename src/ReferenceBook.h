@@ -0,0 +1,232 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_REFERENCEBOOK_H
+#define ORDER_BOOK_REFERENCEBOOK_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+/**
+ * Order resting in the reference book.
+ *
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Quantity>
+struct ReferenceOrder {
+    /**
+     * ID the order book gave the order.
+     */
+    int id;
+
+    /**
+     * Remaining quantity.
+     */
+    Quantity quantity;
+
+    /**
+     * Sequence number of the order in the reference book.
+     */
+    uint64_t sequence;
+};
+
+/**
+ * Fill matched by the reference book.
+ *
+ * @tparam Price Price type of the order book
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Price, typename Quantity>
+struct ReferenceFill {
+    /**
+     * Price the trade settled at.
+     */
+    Price price;
+
+    /**
+     * Quantity traded.
+     */
+    Quantity quantity;
+
+    /**
+     * ID of the buy order.
+     */
+    int buyOrderId;
+
+    /**
+     * ID of the sell order.
+     */
+    int sellOrderId;
+};
+
+/**
+ * Trivially correct model of a price-time priority order book, used as the oracle the optimised order book is
+ * compared against.
+ *
+ * Each side is a std::map of price to a std::deque of orders, matched whenever the best prices cross at the price of
+ * the older order. Nothing is pooled, indexed or cached, so every operation can be checked by reading it.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class ReferenceBook {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+    using Order = ReferenceOrder<Quantity>;
+    using Fill = ReferenceFill<Price, Quantity>;
+    using Level = std::deque<Order>;
+
+private:
+    /**
+     * Buy orders at each price, best price last.
+     */
+    std::map<Price, Level> bids;
+
+    /**
+     * Sell orders at each price, best price first.
+     */
+    std::map<Price, Level> asks;
+
+    /**
+     * Price of each live buy order by ID.
+     */
+    std::map<int, Price> bidPrices;
+
+    /**
+     * Price of each live sell order by ID.
+     */
+    std::map<int, Price> askPrices;
+
+    /**
+     * Fills matched since they were last cleared.
+     */
+    std::vector<Fill> fills;
+
+    /**
+     * Sequence number of the next order.
+     */
+    uint64_t sequence;
+
+    /**
+     * Quantity traded since the book was cleared.
+     */
+    Quantity volume;
+
+    /**
+     * Number of trades since the book was cleared.
+     */
+    uint64_t tradeCount;
+
+    /**
+     * Find a live order.
+     *
+     * @param id ID of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @return Order, nullptr if it is not live
+     */
+    Order *find(int id, bool isBuy);
+
+    /**
+     * Remove an order from its level, removing the level if it empties.
+     *
+     * @param id ID of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     */
+    void remove(int id, bool isBuy);
+
+public:
+    /**
+     * Constructor for ReferenceBook.
+     */
+    ReferenceBook();
+
+    /**
+     * Add an order behind the orders at its price and match while the book is crossed.
+     *
+     * @param id ID the order book gave the order
+     * @param price Price of the order
+     * @param quantity Quantity of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     */
+    void addOrder(int id, Price price, Quantity quantity, bool isBuy);
+
+    /**
+     * Cancel a live order.
+     *
+     * @param id ID of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @return Whether the order was live
+     */
+    bool cancelOrder(int id, bool isBuy);
+
+    /**
+     * Decrease the quantity of a live order, keeping its priority.
+     *
+     * @param id ID of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @param amount Amount to decrease by, less than the quantity of the order
+     * @return Whether the order was live
+     */
+    bool decreaseQuantity(int id, bool isBuy, Quantity amount);
+
+    /**
+     * Remove every order and fill and reset the traded totals.
+     */
+    void clear();
+
+    /**
+     * Getter for the remaining quantity of an order.
+     *
+     * @param id ID of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @return Remaining quantity, 0 if the order is not live
+     */
+    Quantity getQuantity(int id, bool isBuy);
+
+    /**
+     * Getter for the buy levels, best price last.
+     *
+     * @return Buy levels by price
+     */
+    const std::map<Price, Level> &getBids() const;
+
+    /**
+     * Getter for the sell levels, best price first.
+     *
+     * @return Sell levels by price
+     */
+    const std::map<Price, Level> &getAsks() const;
+
+    /**
+     * Getter for the fills matched since they were last cleared.
+     *
+     * @return Fills in the order they were matched
+     */
+    const std::vector<Fill> &getFills() const;
+
+    /**
+     * Clear the fills.
+     */
+    void clearFills();
+
+    /**
+     * Getter for the quantity traded since the book was cleared.
+     *
+     * @return Quantity traded
+     */
+    Quantity getVolume() const;
+
+    /**
+     * Getter for the number of trades since the book was cleared.
+     *
+     * @return Number of trades
+     */
+    uint64_t getTradeCount() const;
+};
+
+
+#endif //ORDER_BOOK_REFERENCEBOOK_H
@@ -0,0 +1,171 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "RiskGate.h"
+#include "OrderBook.h"
+#include <algorithm>
+
+/**
+ * Constructor for RiskGate. The gate starts disabled.
+ *
+ * @param orderBook Order book the gate checks orders for, nullptr for a gate used on its own
+ */
+template <typename Traits>
+RiskGate<Traits>::RiskGate(OrderBook *orderBook) {
+    this->orderBook = orderBook;
+}
+
+/**
+ * Sets the limits of an account. The account array is allocated the first time limits are set, which enables the
+ * gate for every account, with unset accounts unlimited. The order book was not reported to the disabled gate, so
+ * the orders resting in it are counted as open when the gate is enabled.
+ *
+ * @param owner ID of the account
+ * @param limits New limits of the account
+ */
+template <typename Traits>
+void RiskGate<Traits>::setLimits(uint16_t owner, const RiskLimits<Quantity> &limits) {
+    if (accounts.empty()) {
+        accounts.resize(ACCOUNT_COUNT);
+        if (orderBook != nullptr) {
+            std::vector<Order *> restingOrders;
+            orderBook->getOrders(restingOrders);
+            for (Order *order : restingOrders) {
+                onOrderAdded(*order);
+            }
+        }
+    }
+    accounts[owner].limits = limits;
+}
+
+/**
+ * Getter for the position of an account.
+ *
+ * @param owner ID of the account
+ * @return Filled quantity bought minus filled quantity sold, 0 while the gate is disabled
+ */
+template <typename Traits>
+typename RiskGate<Traits>::Quantity RiskGate<Traits>::getPosition(uint16_t owner) const {
+    return accounts.empty() ? 0 : accounts[owner].position;
+}
+
+/**
+ * Getter for the number of open orders of an account.
+ *
+ * @param owner ID of the account
+ * @return Number of open orders, 0 while the gate is disabled
+ */
+template <typename Traits>
+uint32_t RiskGate<Traits>::getOpenOrders(uint16_t owner) const {
+    return accounts.empty() ? 0 : accounts[owner].openOrders;
+}
+
+/**
+ * Records an order added to the order book as open.
+ *
+ * @param order Order added
+ */
+template <typename Traits>
+void RiskGate<Traits>::onOrderAdded(const Order &order) {
+    if (accounts.empty()) {
+        return;
+    }
+    AccountRisk<Quantity> &account = accounts[order.getOwner()];
+    account.openOrders++;
+    (order.isBuy() ? account.openBuyQuantity : account.openSellQuantity) += order.getQuantity();
+}
+
+/**
+ * Removes a quantity from an open quantity, stopping at zero for orders the gate never counted.
+ *
+ * @param openQuantity Open quantity
+ * @param quantity Quantity removed
+ */
+template <typename Traits>
+void RiskGate<Traits>::removeOpen(Quantity &openQuantity, Quantity quantity) {
+    openQuantity -= std::min(openQuantity, quantity);
+}
+
+/**
+ * Records an order cancelled from the order book, removing its remaining quantity from the open quantity.
+ *
+ * @param order Order cancelled
+ */
+template <typename Traits>
+void RiskGate<Traits>::onOrderCancelled(const Order &order) {
+    if (accounts.empty()) {
+        return;
+    }
+    AccountRisk<Quantity> &account = accounts[order.getOwner()];
+    account.openOrders -= account.openOrders > 0;
+    removeOpen(order.isBuy() ? account.openBuyQuantity : account.openSellQuantity, order.getQuantity());
+}
+
+/**
+ * Records an order decreased without a fill, e.g. by self-trade prevention.
+ *
+ * @param order Order decreased
+ * @param quantity Quantity removed from the order
+ */
+template <typename Traits>
+void RiskGate<Traits>::onOrderDecreased(const Order &order, Quantity quantity) {
+    if (accounts.empty()) {
+        return;
+    }
+    AccountRisk<Quantity> &account = accounts[order.getOwner()];
+    removeOpen(order.isBuy() ? account.openBuyQuantity : account.openSellQuantity, quantity);
+}
+
+/**
+ * Records a fill of an order, moving the filled quantity from the open quantity to the position. The order is no
+ * longer open if it is fully filled.
+ *
+ * @param order Order filled
+ * @param quantity Quantity filled
+ */
+template <typename Traits>
+void RiskGate<Traits>::onOrderFilled(const Order &order, Quantity quantity) {
+    if (accounts.empty()) {
+        return;
+    }
+    AccountRisk<Quantity> &account = accounts[order.getOwner()];
+    account.openOrders -= quantity == order.getQuantity() && account.openOrders > 0;
+    if (order.isBuy()) {
+        removeOpen(account.openBuyQuantity, quantity);
+        account.position += quantity;
+    } else {
+        removeOpen(account.openSellQuantity, quantity);
+        account.position -= quantity;
+    }
+}
+
+/**
+ * Getter for the name of a reject reason, for error messages.
+ *
+ * @param reason Reject reason
+ * @return Name of the reason
+ */
+template <typename Traits>
+const char *RiskGate<Traits>::getReasonName(RiskReject reason) {
+    switch (reason) {
+        case RiskReject::NONE:
+            return "none";
+        case RiskReject::ORDER_SIZE:
+            return "order size";
+        case RiskReject::NOTIONAL:
+            return "notional";
+        case RiskReject::PRICE_COLLAR:
+            return "price collar";
+        case RiskReject::OPEN_ORDERS:
+            return "open orders";
+        case RiskReject::POSITION:
+            return "position";
+    }
+    return "unknown";
+}
+
+template class RiskGate<OrderBook::Traits>;
+template class RiskGate<EquityOrderBook::Traits>;
+template class RiskGate<FuturesOrderBook::Traits>;
+template class RiskGate<CryptoOrderBook::Traits>;
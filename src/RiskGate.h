@@ -0,0 +1,270 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_RISKGATE_H
+#define ORDER_BOOK_RISKGATE_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * Reasons an order is rejected by the pre-trade risk gate, in the order the checks are reported.
+ */
+enum class RiskReject {
+    /**
+     * Order passed all checks.
+     */
+    NONE,
+
+    /**
+     * Quantity of the order is above the maximum order size of the account.
+     */
+    ORDER_SIZE,
+
+    /**
+     * Price times quantity of the order is above the maximum notional of the account.
+     */
+    NOTIONAL,
+
+    /**
+     * Price of the order is outside the price collar around the inside of the order book.
+     */
+    PRICE_COLLAR,
+
+    /**
+     * Account already has the maximum number of open orders.
+     */
+    OPEN_ORDERS,
+
+    /**
+     * Position of the account if all its open orders on the side filled would be above the maximum position.
+     */
+    POSITION
+};
+
+/**
+ * Risk limits of an account. Every limit defaults to unlimited.
+ *
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Quantity>
+struct RiskLimits {
+    /**
+     * Maximum quantity of a single order.
+     */
+    Quantity maxOrderQuantity = std::numeric_limits<Quantity>::max();
+
+    /**
+     * Maximum price times quantity of a single order.
+     */
+    double maxNotional = std::numeric_limits<double>::infinity();
+
+    /**
+     * Maximum distance of an order price from the reference price, as a fraction of the reference price.
+     */
+    double priceCollar = std::numeric_limits<double>::infinity();
+
+    /**
+     * Maximum number of open orders.
+     */
+    uint32_t maxOpenOrders = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * Maximum absolute position, counting open orders on the side of a new order as filled.
+     */
+    Quantity maxPosition = std::numeric_limits<Quantity>::max();
+};
+
+/**
+ * Limits and state of an account, kept in one cache line so a check touches a single line.
+ *
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Quantity>
+struct alignas(64) AccountRisk {
+    /**
+     * Risk limits of the account.
+     */
+    RiskLimits<Quantity> limits;
+
+    /**
+     * Number of open orders.
+     */
+    uint32_t openOrders = 0;
+
+    /**
+     * Open quantity of buy orders.
+     */
+    Quantity openBuyQuantity = 0;
+
+    /**
+     * Open quantity of sell orders.
+     */
+    Quantity openSellQuantity = 0;
+
+    /**
+     * Filled quantity bought minus filled quantity sold.
+     */
+    Quantity position = 0;
+};
+
+/**
+ * Pre-trade risk gate run by the order book before an order is added.
+ *
+ * Accounts are the owner IDs of orders, so limits and state live in a flat array indexed by owner and a check is a
+ * single array access. Every check is evaluated and the failures are combined into a bit mask, so passing orders take
+ * no data dependent branches and a rejected order reports its first failed check. The gate is disabled, and every
+ * hook is a single predictable branch, until limits are set for an account. Orders resting in the order book when
+ * the gate is enabled are counted as open then. Positions are kept from fills reported by the order book, from the
+ * time the gate is enabled. Open counts never drop below zero.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class RiskGate {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+    using Order = typename Traits::Order;
+    using OrderBook = typename Traits::OrderBook;
+
+    /**
+     * Number of accounts, one for each owner ID.
+     */
+    static const uint32_t ACCOUNT_COUNT = 1u << 16;
+
+private:
+    /**
+     * Limits and state of each account, empty while the gate is disabled.
+     */
+    std::vector<AccountRisk<Quantity>> accounts;
+
+    /**
+     * Order book the gate checks orders for, nullptr for a gate used on its own.
+     */
+    OrderBook *orderBook;
+
+    /**
+     * Remove a quantity from an open quantity, stopping at zero.
+     *
+     * @param openQuantity Open quantity
+     * @param quantity Quantity removed
+     */
+    static void removeOpen(Quantity &openQuantity, Quantity quantity);
+
+public:
+    /**
+     * Constructor for RiskGate.
+     *
+     * @param orderBook Order book the gate checks orders for, nullptr for a gate used on its own
+     */
+    explicit RiskGate(OrderBook *orderBook = nullptr);
+
+    /**
+     * Getter for boolean indicating if the gate checks orders.
+     *
+     * @return Whether limits have been set for any account
+     */
+    bool isEnabled() const {
+        return !accounts.empty();
+    }
+
+    /**
+     * Check an order against the limits of its account.
+     *
+     * @param owner ID of the account owning the order
+     * @param price Price of the order
+     * @param quantity Quantity of the order
+     * @param isBuy Boolean indicating if the order is a buy order
+     * @param referencePrice Price the collar is centred on, 0 if the order book is empty
+     * @return First failed check, RiskReject::NONE if the order passes
+     */
+    RiskReject check(uint16_t owner, Price price, Quantity quantity, bool isBuy, Price referencePrice) const {
+        if (accounts.empty()) {
+            return RiskReject::NONE;
+        }
+        const AccountRisk<Quantity> &account = accounts[owner];
+        const RiskLimits<Quantity> &limits = account.limits;
+
+        double notional = static_cast<double>(price) * static_cast<double>(quantity);
+        double collar = static_cast<double>(referencePrice) * limits.priceCollar;
+        double distance = static_cast<double>(price) - static_cast<double>(referencePrice);
+        Quantity exposure = isBuy ? account.position + account.openBuyQuantity + quantity :
+                            account.openSellQuantity + quantity - account.position;
+
+        uint32_t failed = static_cast<uint32_t>(quantity > limits.maxOrderQuantity) |
+                          static_cast<uint32_t>(notional > limits.maxNotional) << 1 |
+                          static_cast<uint32_t>(referencePrice != 0 && (distance > collar || -distance > collar)) << 2 |
+                          static_cast<uint32_t>(account.openOrders >= limits.maxOpenOrders) << 3 |
+                          static_cast<uint32_t>(exposure > limits.maxPosition) << 4;
+        return failed == 0 ? RiskReject::NONE : static_cast<RiskReject>(__builtin_ctz(failed) + 1);
+    }
+
+    /**
+     * Setter for the limits of an account, enabling the gate and counting the orders resting in the order book if it
+     * was disabled.
+     *
+     * @param owner ID of the account
+     * @param limits New limits of the account
+     */
+    void setLimits(uint16_t owner, const RiskLimits<Quantity> &limits);
+
+    /**
+     * Getter for the position of an account.
+     *
+     * @param owner ID of the account
+     * @return Filled quantity bought minus filled quantity sold, 0 while the gate is disabled
+     */
+    Quantity getPosition(uint16_t owner) const;
+
+    /**
+     * Getter for the number of open orders of an account.
+     *
+     * @param owner ID of the account
+     * @return Number of open orders, 0 while the gate is disabled
+     */
+    uint32_t getOpenOrders(uint16_t owner) const;
+
+    /**
+     * Record an order added to the order book.
+     *
+     * @param order Order added
+     */
+    void onOrderAdded(const Order &order);
+
+    /**
+     * Record an order cancelled from the order book, before its quantity is removed.
+     *
+     * @param order Order cancelled
+     */
+    void onOrderCancelled(const Order &order);
+
+    /**
+     * Record an order decreased without a fill, before its quantity is decreased.
+     *
+     * @param order Order decreased
+     * @param quantity Quantity removed from the order
+     */
+    void onOrderDecreased(const Order &order, Quantity quantity);
+
+    /**
+     * Record a fill of an order, before its quantity is decreased.
+     *
+     * @param order Order filled
+     * @param quantity Quantity filled
+     */
+    void onOrderFilled(const Order &order, Quantity quantity);
+
+    /**
+     * Getter for the name of a reject reason.
+     *
+     * @param reason Reject reason
+     * @return Name of the reason
+     */
+    static const char *getReasonName(RiskReject reason);
+};
+
+
+#endif //ORDER_BOOK_RISKGATE_H
@@ -0,0 +1,239 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "Stats.h"
+
+#include <cerrno>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+std::atomic<StatsHeader *> Stats::header(nullptr);
+thread_local StatsHeader *Stats::localHeader = nullptr;
+thread_local ThreadStats *Stats::localSlot = nullptr;
+
+/**
+ * Private slot of a thread that found every slot of its segment claimed, not counted in any total.
+ */
+static thread_local ThreadStats overflowSlot;
+
+/**
+ * Getter for the slots of a segment, which follow the header.
+ *
+ * @param segment Header of the segment
+ * @return First slot of the segment
+ */
+static ThreadStats *slotsOf(const StatsHeader *segment) {
+    return reinterpret_cast<ThreadStats *>(const_cast<StatsHeader *>(segment) + 1);
+}
+
+/**
+ * Getter for boolean indicating if a kernel thread exists, in any process.
+ *
+ * @param threadId Kernel thread ID
+ * @return Whether the thread exists
+ */
+static bool isThreadAlive(uint64_t threadId) {
+    return kill(static_cast<pid_t>(threadId), 0) == 0 || errno == EPERM;
+}
+
+/**
+ * Prepare a mapped segment for counting. A segment with the layout of this build keeps its counts, and slots of
+ * threads that no longer exist, e.g. of an earlier run of the process, are freed for new threads. Any other segment,
+ * new or of another version or layout, is cleared and given the layout of this build.
+ *
+ * @param segment Header of the segment
+ */
+static void initialise(StatsHeader *segment) {
+    ThreadStats *threadStats = slotsOf(segment);
+    if (segment->magic == Stats::MAGIC && segment->version == Stats::VERSION &&
+        segment->counterCount == static_cast<uint32_t>(Counter::COUNT) && segment->slotCount == Stats::SLOT_COUNT) {
+        for (uint32_t i = 0; i < Stats::SLOT_COUNT; i++) {
+            uint64_t threadId = threadStats[i].threadId.load(std::memory_order_relaxed);
+            if (threadId != 0 && !isThreadAlive(threadId)) {
+                threadStats[i].threadId.compare_exchange_strong(threadId, 0, std::memory_order_release);
+            }
+        }
+        return;
+    }
+
+    // Hide the segment from monitors while it is cleared
+    segment->magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    for (uint32_t i = 0; i < Stats::SLOT_COUNT; i++) {
+        for (std::atomic<uint64_t> &counter : threadStats[i].counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        threadStats[i].threadId.store(0, std::memory_order_relaxed);
+    }
+    segment->version = Stats::VERSION;
+    segment->counterCount = static_cast<uint32_t>(Counter::COUNT);
+    segment->slotCount = Stats::SLOT_COUNT;
+    segment->overflowCount.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    segment->magic = Stats::MAGIC;
+}
+
+/**
+ * Getter for the size of a stats segment, the header followed by the thread slots.
+ *
+ * @return Number of bytes in a stats segment
+ */
+size_t Stats::segmentSize() {
+    return sizeof(StatsHeader) + sizeof(ThreadStats) * SLOT_COUNT;
+}
+
+/**
+ * Claim a free slot of the current segment for the calling thread, freeing the slot it held in an earlier segment. If
+ * no segment is open, maps a private segment first. A thread finding every slot claimed never shares a slot, it
+ * counts into a private slot and is counted as overflow of the segment, so its counts are not in the totals.
+ *
+ * @return Slot of the calling thread, a private slot if every slot is claimed
+ */
+ThreadStats *Stats::claim() {
+    // Free the slot when the thread exits
+    struct SlotRelease {
+        ~SlotRelease() {
+            release();
+        }
+    };
+    static thread_local SlotRelease slotRelease;
+    release();
+
+    StatsHeader *segment = header.load(std::memory_order_acquire);
+    if (segment == nullptr) {
+        void *memory = mmap(nullptr, segmentSize(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        StatsHeader *privateSegment = static_cast<StatsHeader *>(memory);
+        initialise(privateSegment);
+        if (header.compare_exchange_strong(segment, privateSegment)) {
+            segment = privateSegment;
+        } else {
+            munmap(memory, segmentSize());
+        }
+    }
+
+    localHeader = segment;
+    uint64_t threadId = static_cast<uint64_t>(syscall(SYS_gettid));
+    ThreadStats *threadStats = slotsOf(segment);
+    for (uint32_t i = 0; i < segment->slotCount; i++) {
+        // Acquire the counts left by the thread that freed the slot
+        uint64_t freeId = 0;
+        if (threadStats[i].threadId.load(std::memory_order_relaxed) == 0 &&
+            threadStats[i].threadId.compare_exchange_strong(freeId, threadId, std::memory_order_acquire)) {
+            return threadStats + i;
+        }
+    }
+    segment->overflowCount.fetch_add(1, std::memory_order_relaxed);
+    return &overflowSlot;
+}
+
+/**
+ * Frees the slot of the calling thread, publishing its counts to the next thread to claim it. A private slot is not
+ * in any segment and is kept.
+ */
+void Stats::release() {
+    if (localSlot != nullptr && localSlot != &overflowSlot) {
+        localSlot->threadId.store(0, std::memory_order_release);
+    }
+    localSlot = nullptr;
+}
+
+/**
+ * Map a shared memory stats segment, creating it if it does not exist, and make it the current segment. A segment of
+ * another version or layout is reset, one with the layout of this build keeps its counts and frees the slots of threads
+ * that no longer exist. Threads claim slots of the new segment the next time they count. Prints error message and keeps
+ * the current segment if the segment cannot be mapped.
+ *
+ * @param name Shared memory name of the segment, starting with a slash
+ * @return Whether the segment was mapped
+ */
+bool Stats::open(const char *name) {
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cout << "Stats segment could not be opened." << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(segmentSize())) != 0) {
+        std::cout << "Stats segment could not be opened." << std::endl;
+        close(fd);
+        return false;
+    }
+    void *memory = mmap(nullptr, segmentSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        std::cout << "Stats segment could not be opened." << std::endl;
+        return false;
+    }
+
+    StatsHeader *segment = static_cast<StatsHeader *>(memory);
+    initialise(segment);
+    header.store(segment, std::memory_order_release);
+    return true;
+}
+
+/**
+ * Remove a shared memory stats segment. Threads keep counting into the segment until another is opened.
+ *
+ * @param name Shared memory name of the segment
+ */
+void Stats::unlink(const char *name) {
+    shm_unlink(name);
+}
+
+/**
+ * Getter for the total of a counter over all threads of the current segment.
+ *
+ * @param counter Counter to total
+ * @return Total of the counter
+ */
+uint64_t Stats::total(Counter counter) {
+    StatsHeader *segment = header.load(std::memory_order_acquire);
+    return segment == nullptr ? 0 : total(segment, counter);
+}
+
+/**
+ * Getter for the total of a counter over all threads of a mapped segment. Only reads the segment, so a monitoring
+ * process can map it read-only.
+ *
+ * @param segment Start of the mapped segment
+ * @param counter Counter to total
+ * @return Total of the counter
+ */
+uint64_t Stats::total(const void *segment, Counter counter) {
+    const StatsHeader *segmentHeader = static_cast<const StatsHeader *>(segment);
+    if (segmentHeader->magic != MAGIC || segmentHeader->version != VERSION ||
+        static_cast<uint32_t>(counter) >= segmentHeader->counterCount) {
+        return 0;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    uint64_t sum = 0;
+    const ThreadStats *threadStats = slotsOf(segmentHeader);
+    for (uint32_t i = 0; i < segmentHeader->slotCount; i++) {
+        sum += threadStats[i].counters[static_cast<int>(counter)].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+/**
+ * Getter for the number of threads of a mapped segment that found every slot claimed and counted into a private slot.
+ * Only reads the segment, so a monitoring process can map it read-only.
+ *
+ * @param segment Start of the mapped segment
+ * @return Number of threads whose counts are not in the segment, 0 if the segment is not initialised
+ */
+uint32_t Stats::getOverflowCount(const void *segment) {
+    const StatsHeader *segmentHeader = static_cast<const StatsHeader *>(segment);
+    if (segmentHeader->magic != MAGIC || segmentHeader->version != VERSION) {
+        return 0;
+    }
+    return segmentHeader->overflowCount.load(std::memory_order_relaxed);
+}
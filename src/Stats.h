@@ -0,0 +1,273 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_STATS_H
+#define ORDER_BOOK_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Counters kept for each thread.
+ */
+enum class Counter {
+    /**
+     * Orders added.
+     */
+    ADDS,
+
+    /**
+     * Orders cancelled.
+     */
+    CANCELS,
+
+    /**
+     * Executions of a buy order against a sell order.
+     */
+    EXECUTES,
+
+    /**
+     * Limits created for prices seen for the first time.
+     */
+    NEW_LIMITS,
+
+    /**
+     * AVL tree rotations.
+     */
+    ROTATIONS,
+
+    /**
+     * Order map lookups, inserts and erases.
+     */
+    HASH_LOOKUPS,
+
+    /**
+     * Order map slots probed past the home slot of an ID.
+     */
+    HASH_PROBES,
+
+    /**
+     * Pool allocations that found the free list empty and took a never used slot, which may fault in a page.
+     */
+    POOL_REFILLS,
+
+    /**
+     * Timestamp counter cycles spent adding orders.
+     */
+    ADD_CYCLES,
+
+    /**
+     * Timestamp counter cycles spent cancelling orders.
+     */
+    CANCEL_CYCLES,
+
+    /**
+     * Timestamp counter cycles spent executing orders.
+     */
+    EXECUTE_CYCLES,
+
+    /**
+     * Orders modified, in place or by cancel and replace.
+     */
+    MODIFIES,
+
+    /**
+     * Timestamp counter cycles spent modifying orders.
+     */
+    MODIFY_CYCLES,
+
+    /**
+     * Batches of messages applied.
+     */
+    BATCHES,
+
+    /**
+     * Timestamp counter cycles spent applying batches, including the operations of their messages.
+     */
+    BATCH_CYCLES,
+
+    /**
+     * Number of counters.
+     */
+    COUNT
+};
+
+/**
+ * Counters of one thread, padded to cache lines so threads never write to the same line.
+ *
+ * Only the owning thread writes its counters, with relaxed loads and stores rather than locked read-modify-writes,
+ * so readers see each counter as a whole value without slowing down the writer.
+ */
+struct alignas(64) ThreadStats {
+    /**
+     * Values of the counters.
+     */
+    std::atomic<uint64_t> counters[static_cast<int>(Counter::COUNT)];
+
+    /**
+     * Kernel thread ID of the owning thread, 0 if the slot is free.
+     */
+    std::atomic<uint64_t> threadId;
+};
+
+/**
+ * Header of the stats segment.
+ */
+struct alignas(64) StatsHeader {
+    /**
+     * Marker of an initialised segment.
+     */
+    uint64_t magic;
+
+    /**
+     * Layout version of the segment.
+     */
+    uint32_t version;
+
+    /**
+     * Number of counters in each slot.
+     */
+    uint32_t counterCount;
+
+    /**
+     * Number of thread slots in the segment.
+     */
+    uint32_t slotCount;
+
+    /**
+     * Number of threads that found every slot claimed, whose counts are not in the segment.
+     */
+    std::atomic<uint32_t> overflowCount;
+};
+
+/**
+ * Per-thread hot path counters, kept in a memory segment that can be shared with a monitoring process.
+ *
+ * Each thread claims a free slot of the segment the first time it counts and frees it when it exits, so a later
+ * thread can claim it and add to its counts. A slot is never shared: a thread finding every slot claimed counts into
+ * a private slot instead and is counted as overflow. Counters live in a private segment until open is called with a
+ * shared memory name, after which a monitoring process can map the same name read-only and sum the slots without any
+ * coordination with the counting threads. Threads claim a new slot when the segment changes.
+ */
+class Stats {
+public:
+    /**
+     * Number of thread slots in a segment.
+     */
+    static const uint32_t SLOT_COUNT = 64;
+
+    /**
+     * Marker of an initialised segment.
+     */
+    static const uint64_t MAGIC = 0x4f42535441545331ull;
+
+    /**
+     * Layout version of the segment.
+     */
+    static const uint32_t VERSION = 3;
+
+private:
+    /**
+     * Header of the current segment.
+     */
+    static std::atomic<StatsHeader *> header;
+
+    /**
+     * Header of the segment the slot of the calling thread belongs to.
+     */
+    static thread_local StatsHeader *localHeader;
+
+    /**
+     * Slot of the calling thread.
+     */
+    static thread_local ThreadStats *localSlot;
+
+    /**
+     * Claim a free slot of the current segment for the calling thread, mapping a private segment if none is open.
+     *
+     * @return Slot of the calling thread, a private slot if every slot is claimed
+     */
+    static ThreadStats *claim();
+
+    /**
+     * Free the slot of the calling thread, if it is in a segment.
+     */
+    static void release();
+
+public:
+    /**
+     * Map a shared memory stats segment, creating it if it does not exist or resetting it if it has another layout.
+     * Prints error message and keeps the current segment if the segment cannot be mapped.
+     *
+     * @param name Shared memory name of the segment, starting with a slash
+     * @return Whether the segment was mapped
+     */
+    static bool open(const char *name);
+
+    /**
+     * Remove a shared memory stats segment. Threads keep counting into the segment until another is opened.
+     *
+     * @param name Shared memory name of the segment
+     */
+    static void unlink(const char *name);
+
+    /**
+     * Getter for the counters of the calling thread.
+     *
+     * @return Counters of the calling thread
+     */
+    static ThreadStats &local() {
+        if (localSlot == nullptr || localHeader != header.load(std::memory_order_relaxed)) {
+            localSlot = claim();
+        }
+        return *localSlot;
+    }
+
+    /**
+     * Add to a counter of the calling thread.
+     *
+     * @param counter Counter to add to
+     * @param amount Amount to add
+     */
+    static void add(Counter counter, uint64_t amount = 1) {
+        std::atomic<uint64_t> &value = local().counters[static_cast<int>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    /**
+     * Getter for the total of a counter over all threads of the current segment.
+     *
+     * @param counter Counter to total
+     * @return Total of the counter
+     */
+    static uint64_t total(Counter counter);
+
+    /**
+     * Getter for the total of a counter over all threads of a mapped segment, for monitoring processes.
+     *
+     * @param segment Start of the mapped segment
+     * @param counter Counter to total
+     * @return Total of the counter
+     */
+    static uint64_t total(const void *segment, Counter counter);
+
+    /**
+     * Getter for the number of threads of a mapped segment that found every slot claimed, for monitoring processes.
+     *
+     * @param segment Start of the mapped segment
+     * @return Number of threads whose counts are not in the segment
+     */
+    static uint32_t getOverflowCount(const void *segment);
+
+    /**
+     * Getter for the size of a stats segment.
+     *
+     * @return Number of bytes in a stats segment
+     */
+    static size_t segmentSize();
+};
+
+
+#endif //ORDER_BOOK_STATS_H
@@ -0,0 +1,112 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "Throttle.h"
+#include "OrderBook.h"
+
+/**
+ * Sets the limits of a participant, converting the message rate to the interval between messages, and resets its
+ * token bucket and windows. The participant array is allocated the first time limits are set, which enables the
+ * throttle for every participant, with unset participants unlimited.
+ *
+ * @param owner ID of the participant
+ * @param limits New limits of the participant
+ */
+template <typename Traits>
+void Throttle<Traits>::setLimits(uint16_t owner, const ThrottleLimits &limits) {
+    if (participants.empty()) {
+        participants.resize(PARTICIPANT_COUNT);
+    }
+    ParticipantFlow &flow = participants[owner];
+    flow = ParticipantFlow();
+    flow.interval = limits.messagesPerSecond > 0 && limits.messagesPerSecond < 1e9 ?
+                    static_cast<uint64_t>(1e9 / limits.messagesPerSecond) : 0;
+    flow.burst = limits.burst > 0 ? limits.burst : 1;
+    flow.maxOrderToTradeRatio = limits.maxOrderToTradeRatio;
+    flow.minOrderToTradeMessages = limits.minOrderToTradeMessages;
+    flow.window = limits.orderToTradeWindow > 0 ? limits.orderToTradeWindow : 1;
+}
+
+/**
+ * Getter for the number of messages of a participant in the current window.
+ *
+ * @param owner ID of the participant
+ * @return Number of messages, 0 while the throttle is disabled
+ */
+template <typename Traits>
+uint32_t Throttle<Traits>::getMessages(uint16_t owner) const {
+    return participants.empty() ? 0 : participants[owner].messages;
+}
+
+/**
+ * Getter for the number of trades of a participant in the current window.
+ *
+ * @param owner ID of the participant
+ * @return Number of trades, 0 while the throttle is disabled
+ */
+template <typename Traits>
+uint32_t Throttle<Traits>::getTrades(uint16_t owner) const {
+    return participants.empty() ? 0 : participants[owner].trades;
+}
+
+/**
+ * Records a cancel of an order as a message of its participant. The cancel takes a token if the bucket is not
+ * empty, it is never rejected.
+ *
+ * @param order Order cancelled
+ * @param time Time of the cancel in nanoseconds since the epoch
+ */
+template <typename Traits>
+void Throttle<Traits>::onOrderCancelled(const Order &order, uint64_t time) {
+    if (participants.empty()) {
+        return;
+    }
+    ParticipantFlow &flow = participants[order.getOwner()];
+    roll(flow, time);
+    uint64_t fullTime = flow.fullTime > time ? flow.fullTime : time;
+    if (fullTime - time <= flow.interval * (flow.burst - 1)) {
+        flow.fullTime = fullTime + flow.interval;
+    }
+    flow.messages++;
+}
+
+/**
+ * Records a fill of an order as a trade of its participant.
+ *
+ * @param order Order filled
+ * @param time Time of the trade in nanoseconds since the epoch
+ */
+template <typename Traits>
+void Throttle<Traits>::onOrderFilled(const Order &order, uint64_t time) {
+    if (participants.empty()) {
+        return;
+    }
+    ParticipantFlow &flow = participants[order.getOwner()];
+    roll(flow, time);
+    flow.trades++;
+}
+
+/**
+ * Getter for the name of a reject reason, for error messages.
+ *
+ * @param reason Reject reason
+ * @return Name of the reason
+ */
+template <typename Traits>
+const char *Throttle<Traits>::getReasonName(ThrottleReject reason) {
+    switch (reason) {
+        case ThrottleReject::NONE:
+            return "none";
+        case ThrottleReject::MESSAGE_RATE:
+            return "message rate";
+        case ThrottleReject::ORDER_TO_TRADE:
+            return "order to trade ratio";
+    }
+    return "unknown";
+}
+
+template class Throttle<OrderBook::Traits>;
+template class Throttle<EquityOrderBook::Traits>;
+template class Throttle<FuturesOrderBook::Traits>;
+template class Throttle<CryptoOrderBook::Traits>;
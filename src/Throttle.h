@@ -0,0 +1,264 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_THROTTLE_H
+#define ORDER_BOOK_THROTTLE_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * Reasons a message is rejected by the throttle.
+ */
+enum class ThrottleReject {
+    /**
+     * Message passed the throttle.
+     */
+    NONE,
+
+    /**
+     * Participant has used its burst of messages and the message rate has not refilled a token.
+     */
+    MESSAGE_RATE,
+
+    /**
+     * Messages of the participant in the rolling window are above the maximum ratio to its trades.
+     */
+    ORDER_TO_TRADE
+};
+
+/**
+ * Flow limits of a participant. Every limit defaults to unlimited.
+ */
+struct ThrottleLimits {
+    /**
+     * Sustained number of messages per second.
+     */
+    double messagesPerSecond = std::numeric_limits<double>::infinity();
+
+    /**
+     * Number of messages that can be sent at once after a quiet period, the size of the token bucket.
+     */
+    uint32_t burst = 1;
+
+    /**
+     * Maximum number of messages per trade in the rolling window.
+     */
+    double maxOrderToTradeRatio = std::numeric_limits<double>::infinity();
+
+    /**
+     * Number of messages in the rolling window below which the order to trade ratio is not enforced.
+     */
+    uint32_t minOrderToTradeMessages = 0;
+
+    /**
+     * Length of the rolling window of the order to trade ratio in nanoseconds.
+     */
+    uint64_t orderToTradeWindow = 1000000000;
+};
+
+/**
+ * Limits and state of a participant, kept in one cache line so a check touches a single line.
+ */
+struct alignas(64) ParticipantFlow {
+    /**
+     * Nanoseconds between messages at the sustained rate, 0 if the rate is unlimited.
+     */
+    uint64_t interval = 0;
+
+    /**
+     * Size of the token bucket.
+     */
+    uint32_t burst = 1;
+
+    /**
+     * Number of messages in the rolling window below which the order to trade ratio is not enforced.
+     */
+    uint32_t minOrderToTradeMessages = 0;
+
+    /**
+     * Maximum number of messages per trade in the rolling window.
+     */
+    double maxOrderToTradeRatio = std::numeric_limits<double>::infinity();
+
+    /**
+     * Length of the rolling window in nanoseconds.
+     */
+    uint64_t window = 1000000000;
+
+    /**
+     * Time the token bucket would be full again, the theoretical arrival time of the next message.
+     */
+    uint64_t fullTime = 0;
+
+    /**
+     * Number of the current window, the time divided by the window length.
+     */
+    uint64_t windowIndex = 0;
+
+    /**
+     * Messages in the current window.
+     */
+    uint32_t messages = 0;
+
+    /**
+     * Trades in the current window.
+     */
+    uint32_t trades = 0;
+
+    /**
+     * Messages in the previous window.
+     */
+    uint32_t previousMessages = 0;
+
+    /**
+     * Trades in the previous window.
+     */
+    uint32_t previousTrades = 0;
+};
+
+static_assert(sizeof(ParticipantFlow) == 64, "Participant flow must fit in one cache line");
+
+/**
+ * Per-participant message rate and order to trade ratio throttle run by the order book before an order is added,
+ * modified or cancelled, so one runaway participant cannot saturate the matching thread.
+ *
+ * Participants are the owner IDs of orders, so limits and state live in a flat array indexed by owner and a check is
+ * a single array access with no loop. The token bucket is kept as the time it would be full again, a message passes
+ * if that time is at most a burst of intervals ahead and pushes it one interval later. Order to trade ratios are
+ * counted in two fixed windows, weighting the previous window by how much of it still overlaps the rolling window.
+ * Rejected messages, and cancels of orders that do not exist, are not counted. Cancels are never rejected, so a
+ * throttled participant can always pull its orders, but are counted and take a token if one is free. The throttle is
+ * disabled, and every hook is a single predictable branch, until limits are set for a participant. Rejected messages
+ * are reported to the caller, which may queue and resend them.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class Throttle {
+public:
+    using Order = typename Traits::Order;
+
+    /**
+     * Number of participants, one for each owner ID.
+     */
+    static const uint32_t PARTICIPANT_COUNT = 1u << 16;
+
+private:
+    /**
+     * Limits and state of each participant, empty while the throttle is disabled.
+     */
+    std::vector<ParticipantFlow> participants;
+
+    /**
+     * Move the windows of a participant forward to the window of a time.
+     *
+     * @param flow Participant
+     * @param time Time in nanoseconds since the epoch
+     */
+    static void roll(ParticipantFlow &flow, uint64_t time) {
+        uint64_t windowIndex = time / flow.window;
+        if (windowIndex != flow.windowIndex) {
+            bool isNext = windowIndex == flow.windowIndex + 1;
+            flow.previousMessages = isNext ? flow.messages : 0;
+            flow.previousTrades = isNext ? flow.trades : 0;
+            flow.messages = 0;
+            flow.trades = 0;
+            flow.windowIndex = windowIndex;
+        }
+    }
+
+public:
+    /**
+     * Getter for boolean indicating if the throttle checks messages.
+     *
+     * @return Whether limits have been set for any participant
+     */
+    bool isEnabled() const {
+        return !participants.empty();
+    }
+
+    /**
+     * Check a new or modified order of a participant and count it if it passes.
+     *
+     * @param owner ID of the participant
+     * @param time Time of the message in nanoseconds since the epoch
+     * @return Failed check, ThrottleReject::NONE if the message passes
+     */
+    ThrottleReject admit(uint16_t owner, uint64_t time) {
+        if (participants.empty()) {
+            return ThrottleReject::NONE;
+        }
+        ParticipantFlow &flow = participants[owner];
+        roll(flow, time);
+
+        uint64_t fullTime = flow.fullTime > time ? flow.fullTime : time;
+        double overlap = 1 - static_cast<double>(time % flow.window) / static_cast<double>(flow.window);
+        double messages = flow.previousMessages * overlap + flow.messages + 1;
+        double trades = flow.previousTrades * overlap + flow.trades;
+
+        if (fullTime - time > flow.interval * (flow.burst - 1)) {
+            return ThrottleReject::MESSAGE_RATE;
+        }
+        if (messages > flow.minOrderToTradeMessages &&
+            messages > flow.maxOrderToTradeRatio * (trades > 1 ? trades : 1)) {
+            return ThrottleReject::ORDER_TO_TRADE;
+        }
+        flow.fullTime = fullTime + flow.interval;
+        flow.messages++;
+        return ThrottleReject::NONE;
+    }
+
+    /**
+     * Setter for the limits of a participant, enabling the throttle and resetting the participant.
+     *
+     * @param owner ID of the participant
+     * @param limits New limits of the participant
+     */
+    void setLimits(uint16_t owner, const ThrottleLimits &limits);
+
+    /**
+     * Getter for the number of messages of a participant in the current window.
+     *
+     * @param owner ID of the participant
+     * @return Number of messages, 0 while the throttle is disabled
+     */
+    uint32_t getMessages(uint16_t owner) const;
+
+    /**
+     * Getter for the number of trades of a participant in the current window.
+     *
+     * @param owner ID of the participant
+     * @return Number of trades, 0 while the throttle is disabled
+     */
+    uint32_t getTrades(uint16_t owner) const;
+
+    /**
+     * Record a cancel of an order.
+     *
+     * @param order Order cancelled
+     * @param time Time of the cancel in nanoseconds since the epoch
+     */
+    void onOrderCancelled(const Order &order, uint64_t time);
+
+    /**
+     * Record a fill of an order as a trade of its participant.
+     *
+     * @param order Order filled
+     * @param time Time of the trade in nanoseconds since the epoch
+     */
+    void onOrderFilled(const Order &order, uint64_t time);
+
+    /**
+     * Getter for the name of a reject reason.
+     *
+     * @param reason Reject reason
+     * @return Name of the reason
+     */
+    static const char *getReasonName(ThrottleReject reason);
+};
+
+
+#endif //ORDER_BOOK_THROTTLE_H
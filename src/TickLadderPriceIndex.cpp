@@ -0,0 +1,379 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "TickLadderPriceIndex.h"
+#include "OrderBook.h"
+#include "Limit.h"
+#include "Order.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Getter for boolean indicating if the CPU supports AVX2, checked once.
+ *
+ * @return Whether AVX2 instructions can be used
+ */
+static bool hasAvx2() {
+#if defined(__x86_64__)
+    static const bool HAS_AVX2 = __builtin_cpu_supports("avx2");
+    return HAS_AVX2;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Constructor for TickLadderPriceIndex.
+ *
+ * @param minPrice Price of tick 0
+ * @param tickSize Price difference between ticks
+ * @param isBuy Boolean indicating if the index is for buy limits
+ */
+template <typename Traits>
+TickLadderPriceIndex<Traits>::TickLadderPriceIndex(double minPrice, double tickSize, bool isBuy) {
+    this->minPrice = static_cast<Real>(minPrice);
+    this->tickSize = static_cast<Real>(tickSize);
+    this->isBuy = isBuy;
+    this->limits = new uint32_t[LevelBitmap::LEVEL_COUNT]();
+    this->limitCount = 0;
+    this->nonEmpty = new LevelBitmap();
+}
+
+/**
+ * Destructor for TickLadderPriceIndex.
+ */
+template <typename Traits>
+TickLadderPriceIndex<Traits>::~TickLadderPriceIndex() {
+    delete[] this->limits;
+    delete this->nonEmpty;
+}
+
+/**
+ * Getter for the tick of a price. Prices within a thousandth of a tick of the grid are rounded onto it.
+ *
+ * @param price Price on the tick grid
+ * @return Tick of the price, -1 if the price is not a valid tick
+ */
+template <typename Traits>
+int TickLadderPriceIndex<Traits>::tickOf(Price price) const {
+    Real ticks = (static_cast<Real>(price) - minPrice) / tickSize;
+    Real tick = std::round(ticks);
+    if (tick < 0 || tick >= LevelBitmap::LEVEL_COUNT || std::fabs(ticks - tick) > static_cast<Real>(1e-3)) {
+        return -1;
+    }
+    return (int) tick;
+}
+
+/**
+ * Find the limit at a price.
+ *
+ * @param price Price of the limit
+ * @return Limit at the price, nullptr if there is none
+ */
+template <typename Traits>
+typename TickLadderPriceIndex<Traits>::Limit *TickLadderPriceIndex<Traits>::find(Price price) const {
+    int tick = tickOf(price);
+    return tick < 0 ? nullptr : LimitPool::get(limits[tick]);
+}
+
+/**
+ * Prefetch the ladder slot of a price, so finding its limit does not wait on memory. Prices outside the ladder are
+ * ignored.
+ *
+ * @param price Price of the limit
+ */
+template <typename Traits>
+void TickLadderPriceIndex<Traits>::prefetch(Price price) const {
+    int tick = tickOf(price);
+    if (tick >= 0) {
+        __builtin_prefetch(&limits[tick]);
+    }
+}
+
+/**
+ * Insert a new limit into the ladder.
+ *
+ * @param limit Limit to insert, its price must be valid and not in the index
+ */
+template <typename Traits>
+void TickLadderPriceIndex<Traits>::insert(Limit *limit) {
+    int tick = tickOf(limit->getPrice());
+    limits[tick] = LimitPool::indexOf(limit);
+    limitCount++;
+    if (limit->getHeadOrder() != nullptr) {
+        nonEmpty->set(tick);
+    }
+}
+
+/**
+ * Getter for boolean indicating if a price is on the tick grid within the ladder.
+ *
+ * @param price Price of the limit
+ * @return Whether a limit can be created at the price
+ */
+template <typename Traits>
+bool TickLadderPriceIndex<Traits>::isValidPrice(Price price) const {
+    return tickOf(price) >= 0;
+}
+
+/**
+ * Mark the tick of a limit as empty or non-empty in the bitmap.
+ *
+ * @param limit Limit that changed
+ * @param isEmpty Boolean indicating if the limit now has no orders
+ */
+template <typename Traits>
+void TickLadderPriceIndex<Traits>::setEmpty(const Limit *limit, bool isEmpty) {
+    int tick = tickOf(limit->getPrice());
+    if (isEmpty) {
+        nonEmpty->clear(tick);
+    } else {
+        nonEmpty->set(tick);
+    }
+}
+
+/**
+ * Build the ladder from limits sorted by price.
+ *
+ * @param sortedLimits Limits sorted by ascending price
+ */
+template <typename Traits>
+void TickLadderPriceIndex<Traits>::build(const std::vector<Limit *> &sortedLimits) {
+    for (Limit *limit : sortedLimits) {
+        insert(limit);
+    }
+}
+
+/**
+ * Getter for the next inside order. If the limit is empty, finds the highest non-empty tick below it for buy limits
+ * or the lowest non-empty tick above it for sell limits.
+ *
+ * @param limit Limit to start from
+ * @return Next inside order, nullptr if there is none
+ */
+template <typename Traits>
+typename TickLadderPriceIndex<Traits>::Order *
+TickLadderPriceIndex<Traits>::getNextInsideOrder(const Limit *limit) const {
+    if (limit->getHeadOrder() != nullptr) {
+        return limit->getHeadOrder();
+    }
+    return getNextOuterOrder(limit);
+}
+
+/**
+ * Getter for the next outer order. Finds the highest non-empty tick below the limit for buy limits or the lowest
+ * non-empty tick above it for sell limits.
+ *
+ * @param limit Limit to start from
+ * @return Next outer order, nullptr if there is none
+ */
+template <typename Traits>
+typename TickLadderPriceIndex<Traits>::Order *
+TickLadderPriceIndex<Traits>::getNextOuterOrder(const Limit *limit) const {
+    int tick = tickOf(limit->getPrice());
+    int nextTick = isBuy ? nonEmpty->findBelow(tick) : nonEmpty->findAbove(tick);
+    if (nextTick < 0) {
+        return nullptr;
+    }
+    return LimitPool::get(limits[nextTick])->getHeadOrder();
+}
+
+/**
+ * Getter for boolean indicating if the index is empty.
+ *
+ * @return Whether the index is empty
+ */
+template <typename Traits>
+bool TickLadderPriceIndex<Traits>::empty() const {
+    return limitCount == 0;
+}
+
+/**
+ * Checks every tick of the ladder. A limit must sit at the tick of its price and be marked in the bitmap exactly when
+ * it has orders, ticks without a limit must not be marked, the limit count must match, and the layers of the bitmap
+ * must agree.
+ *
+ * @param sortedLimits Limits to append to, sorted by ascending price
+ * @return Description of the first broken invariant, nullptr if the index is valid
+ */
+template <typename Traits>
+const char *TickLadderPriceIndex<Traits>::validate(std::vector<const Limit *> &sortedLimits) const {
+    int count = 0;
+    for (int tick = 0; tick < LevelBitmap::LEVEL_COUNT; tick++) {
+        const Limit *limit = LimitPool::get(limits[tick]);
+        if (limit == nullptr) {
+            if (nonEmpty->test(tick)) {
+                return "Tick ladder marks a tick without a limit as having orders.";
+            }
+            continue;
+        }
+        if (tickOf(limit->getPrice()) != tick) {
+            return "Tick ladder limit is not at the tick of its price.";
+        }
+        if (nonEmpty->test(tick) != (limit->getHeadOrder() != nullptr)) {
+            return "Tick ladder bitmap does not match the orders of a limit.";
+        }
+        sortedLimits.push_back(limit);
+        count++;
+    }
+    if (count != limitCount) {
+        return "Tick ladder limit count is wrong.";
+    }
+    if (!nonEmpty->validate()) {
+        return "Tick ladder bitmap layers do not agree.";
+    }
+    return nullptr;
+}
+
+/**
+ * Fills from the volume at a tick, up to the quantity left.
+ *
+ * @param tickSweep Sweep to advance
+ * @param tick Tick to fill from
+ * @param volume Volume at the tick, greater than 0
+ */
+template <typename Traits>
+void TickLadderPriceIndex<Traits>::fillTick(TickSweep &tickSweep, int tick, Quantity volume) {
+    Quantity fillQuantity = std::min(volume, tickSweep.remaining);
+    tickSweep.remaining -= fillQuantity;
+    tickSweep.filled += fillQuantity;
+    tickSweep.tickVolume += static_cast<int64_t>(fillQuantity) * tick;
+    tickSweep.levelCount++;
+    tickSweep.lastTick = tick;
+}
+
+/**
+ * Sweeps one tick at a time from the current tick, reading each volume from the limit pool and finding the next
+ * non-empty tick with the bitmap.
+ *
+ * @param tickSweep Sweep to advance
+ */
+template <typename Traits>
+void TickLadderPriceIndex<Traits>::sweepTicks(TickSweep &tickSweep) const {
+    while (tickSweep.remaining > 0 && tickSweep.tick >= 0 && tickSweep.tick < LevelBitmap::LEVEL_COUNT) {
+        Quantity volume = limits[tickSweep.tick] == 0 ? 0 : LimitPool::cold(limits[tickSweep.tick]).totalVolume;
+        if (volume > 0) {
+            fillTick(tickSweep, tickSweep.tick, volume);
+        }
+        tickSweep.tick = isBuy ? nonEmpty->findBelow(tickSweep.tick) : nonEmpty->findAbove(tickSweep.tick);
+    }
+}
+
+/**
+ * Sweeps four contiguous ticks at a time from the current tick. The limit pool indices of the ticks are loaded from
+ * the ladder, reversed for buy ladders so ticks run outwards, and the volumes gathered from the cold data of the
+ * limit pool, where the unused slot 0 of empty ticks holds 0. The running totals of the four volumes are an in-
+ * register prefix sum. While the quantity left exceeds the total, the whole block is filled in a few vector
+ * operations, otherwise its ticks are filled one at a time and the sweep ends. Blocks without volume jump to the next
+ * non-empty tick with the bitmap. Blocks that would run past an end of the ladder are left to sweepTicks.
+ *
+ * @param tickSweep Sweep to advance
+ */
+template <typename Traits>
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+#endif
+void TickLadderPriceIndex<Traits>::sweepTicksAvx2(TickSweep &tickSweep) const {
+#if defined(__x86_64__)
+    using Cold = LimitColdData<Traits>;
+    const auto *volumes = reinterpret_cast<const long long *>(&LimitPool::cold(0).totalVolume);
+    const __m128i coldSize = _mm_set1_epi32(sizeof(Cold));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i volumeMask = _mm256_set1_epi64x(sizeof(Quantity) == 4 ? 0xffffffffLL : -1LL);
+    const __m256i lanes = isBuy ? _mm256_set_epi64x(-3, -2, -1, 0) : _mm256_set_epi64x(3, 2, 1, 0);
+    const int step = isBuy ? -1 : 1;
+    __m256i tickVolumes = zero;
+
+    while (tickSweep.remaining > 0 && tickSweep.tick >= 0) {
+        int first = tickSweep.tick;
+        int low = isBuy ? first - 3 : first;
+        if (low < 0 || low + 4 > LevelBitmap::LEVEL_COUNT) {
+            break;
+        }
+
+        // Gather the volumes of the block in sweep order
+        __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i *>(limits + low));
+        if (isBuy) {
+            indices = _mm_shuffle_epi32(indices, _MM_SHUFFLE(0, 1, 2, 3));
+        }
+        __m256i volume = _mm256_i32gather_epi64(volumes, _mm_mullo_epi32(indices, coldSize), 1);
+        volume = _mm256_and_si256(volume, volumeMask);
+        int nonEmptyMask = ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(volume, zero))) & 0xF;
+        if (nonEmptyMask == 0) {
+            tickSweep.tick = isBuy ? nonEmpty->findBelow(low) : nonEmpty->findAbove(low + 3);
+            continue;
+        }
+
+        // Running totals of the block, within each half and then carried from the low half to the high half
+        __m256i prefix = _mm256_add_epi64(volume, _mm256_slli_si256(volume, 8));
+        prefix = _mm256_add_epi64(prefix, _mm256_blend_epi32(zero, _mm256_permute4x64_epi64(prefix, 0x55), 0xF0));
+        __m256i remaining = _mm256_set1_epi64x(static_cast<int64_t>(tickSweep.remaining));
+        if (_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(remaining, prefix))) != 0xF) {
+            // Quantity left runs out within the block
+            alignas(32) int64_t blockVolumes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(blockVolumes), volume);
+            for (int i = 0; i < 4 && tickSweep.remaining > 0; i++) {
+                if (blockVolumes[i] > 0) {
+                    fillTick(tickSweep, first + i * step, static_cast<Quantity>(blockVolumes[i]));
+                }
+            }
+            break;
+        }
+
+        // Fill the whole block, multiplying volumes by ticks in 32-bit halves
+        __m256i ticks = _mm256_add_epi64(_mm256_set1_epi64x(first), lanes);
+        __m256i products = _mm256_add_epi64(_mm256_mul_epu32(volume, ticks),
+                                            _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(volume, 32), ticks),
+                                                              32));
+        tickVolumes = _mm256_add_epi64(tickVolumes, products);
+        auto total = static_cast<Quantity>(_mm256_extract_epi64(prefix, 3));
+        tickSweep.remaining -= total;
+        tickSweep.filled += total;
+        tickSweep.levelCount += __builtin_popcount(nonEmptyMask);
+        tickSweep.lastTick = first + (31 - __builtin_clz(nonEmptyMask)) * step;
+        tickSweep.tick = first + 4 * step;
+    }
+
+    alignas(32) int64_t sums[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(sums), tickVolumes);
+    tickSweep.tickVolume += sums[0] + sums[1] + sums[2] + sums[3];
+#endif
+}
+
+/**
+ * Sweeps the side from a limit outwards. Blocks of contiguous ticks are swept with AVX2 if the CPU supports it and
+ * the byte offsets of the limit pool fit the 32-bit gather indices, the rest one tick at a time. The notional is
+ * priced on the tick grid, so for float prices it can differ from the limit prices in the last bits.
+ *
+ * @param limit Limit with orders to start from, the inside limit of the side
+ * @param quantity Quantity to fill
+ * @param cost Cost to add to, starting from zero
+ */
+template <typename Traits>
+void TickLadderPriceIndex<Traits>::sweep(const Limit *limit, Quantity quantity,
+                                         SweepCost<Price, Quantity> &cost) const {
+    TickSweep tickSweep = {tickOf(limit->getPrice()), quantity - cost.quantity, 0, 0, 0, -1};
+    if (hasAvx2() && static_cast<uint64_t>(LimitPool::CAPACITY) * sizeof(LimitColdData<Traits>) <= INT32_MAX) {
+        sweepTicksAvx2(tickSweep);
+    }
+    sweepTicks(tickSweep);
+    if (tickSweep.levelCount == 0) {
+        return;
+    }
+
+    cost.quantity += tickSweep.filled;
+    cost.notional += static_cast<double>(minPrice) * tickSweep.filled +
+                     static_cast<double>(tickSize) * static_cast<double>(tickSweep.tickVolume);
+    cost.worstPrice = LimitPool::get(limits[tickSweep.lastTick])->getPrice();
+    cost.levelCount += tickSweep.levelCount;
+}
+
+template class TickLadderPriceIndex<OrderBook::Traits>;
+template class TickLadderPriceIndex<EquityOrderBook::Traits>;
+template class TickLadderPriceIndex<FuturesOrderBook::Traits>;
@@ -0,0 +1,241 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_TICKLADDERPRICEINDEX_H
+#define ORDER_BOOK_TICKLADDERPRICEINDEX_H
+
+#include <cstdint>
+#include <type_traits>
+#include "PriceIndex.h"
+#include "LevelBitmap.h"
+
+/**
+ * Price index for tick-indexed books, storing limits in an array indexed by the number of ticks above a minimum
+ * price.
+ *
+ * Lookup is a single array access and a bitmap of non-empty limits finds the next inside limit in a handful of
+ * instructions, however many empty limits lie in between. Only prices on the tick grid within
+ * LevelBitmap::LEVEL_COUNT ticks of the minimum price are valid.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class TickLadderPriceIndex final : public PriceIndex<Traits> {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+    using Limit = typename Traits::Limit;
+    using Order = typename Traits::Order;
+    using LimitPool = typename Traits::LimitPool;
+
+    /**
+     * Type ticks are computed in, the price type for floating point prices so prices round onto the grid at their
+     * own precision, else double.
+     */
+    using Real = typename std::conditional<std::is_floating_point<Price>::value, Price, double>::type;
+
+private:
+    /**
+     * Price of tick 0.
+     */
+    Real minPrice;
+
+    /**
+     * Price difference between ticks.
+     */
+    Real tickSize;
+
+    /**
+     * Boolean indicating if the index is for buy limits.
+     */
+    bool isBuy;
+
+    /**
+     * Limit pool indices of the limits at each tick, 0 if there is no limit.
+     */
+    uint32_t *limits;
+
+    /**
+     * Number of limits in the index.
+     */
+    int limitCount;
+
+    /**
+     * Bitmap of ticks with non-empty limits.
+     */
+    LevelBitmap *nonEmpty;
+
+    /**
+     * Progress of a sweep along the ladder.
+     */
+    struct TickSweep {
+        /**
+         * Next tick to fill from, -1 once the ladder runs out.
+         */
+        int tick;
+
+        /**
+         * Quantity left to fill.
+         */
+        Quantity remaining;
+
+        /**
+         * Quantity filled.
+         */
+        Quantity filled;
+
+        /**
+         * Sum of quantity times tick filled at each tick.
+         */
+        int64_t tickVolume;
+
+        /**
+         * Number of ticks filled from.
+         */
+        int levelCount;
+
+        /**
+         * Last tick filled from.
+         */
+        int lastTick;
+    };
+
+    /**
+     * Fill from the volume at a tick.
+     *
+     * @param tickSweep Sweep to advance
+     * @param tick Tick to fill from
+     * @param volume Volume at the tick, greater than 0
+     */
+    static void fillTick(TickSweep &tickSweep, int tick, Quantity volume);
+
+    /**
+     * Sweep one tick at a time, jumping over empty ticks with the bitmap.
+     *
+     * @param tickSweep Sweep to advance
+     */
+    void sweepTicks(TickSweep &tickSweep) const;
+
+    /**
+     * Sweep four contiguous ticks at a time with AVX2, stopping at the ends of the ladder.
+     *
+     * @param tickSweep Sweep to advance
+     */
+    void sweepTicksAvx2(TickSweep &tickSweep) const;
+
+public:
+    /**
+     * Constructor for TickLadderPriceIndex.
+     *
+     * @param minPrice Price of tick 0
+     * @param tickSize Price difference between ticks
+     * @param isBuy Boolean indicating if the index is for buy limits
+     */
+    TickLadderPriceIndex(double minPrice, double tickSize, bool isBuy);
+
+    /**
+     * Destructor for TickLadderPriceIndex.
+     */
+    ~TickLadderPriceIndex() override;
+
+    TickLadderPriceIndex(const TickLadderPriceIndex &) = delete;
+
+    TickLadderPriceIndex &operator=(const TickLadderPriceIndex &) = delete;
+
+    /**
+     * Getter for the tick of a price.
+     *
+     * @param price Price on the tick grid
+     * @return Tick of the price, -1 if the price is not a valid tick
+     */
+    int tickOf(Price price) const;
+
+    /**
+     * Find the limit at a price.
+     *
+     * @param price Price of the limit
+     * @return Limit at the price, nullptr if there is none
+     */
+    Limit *find(Price price) const override;
+
+    /**
+     * Prefetch the ladder slot of a price.
+     *
+     * @param price Price of the limit
+     */
+    void prefetch(Price price) const override;
+
+    /**
+     * Insert a new limit into the ladder.
+     *
+     * @param limit Limit to insert, its price must be valid and not in the index
+     */
+    void insert(Limit *limit) override;
+
+    /**
+     * Getter for boolean indicating if a price is on the tick grid within the ladder.
+     *
+     * @param price Price of the limit
+     * @return Whether a limit can be created at the price
+     */
+    bool isValidPrice(Price price) const override;
+
+    /**
+     * Mark the tick of a limit as empty or non-empty in the bitmap.
+     *
+     * @param limit Limit that changed
+     * @param isEmpty Boolean indicating if the limit now has no orders
+     */
+    void setEmpty(const Limit *limit, bool isEmpty) override;
+
+    /**
+     * Build the ladder from limits sorted by price.
+     *
+     * @param sortedLimits Limits sorted by ascending price
+     */
+    void build(const std::vector<Limit *> &sortedLimits) override;
+
+    /**
+     * Getter for the next inside order, found by scanning the bitmap away from the inside.
+     *
+     * @param limit Limit to start from
+     * @return Next inside order, nullptr if there is none
+     */
+    Order *getNextInsideOrder(const Limit *limit) const override;
+
+    /**
+     * Getter for the next outer order, found by scanning the bitmap away from the inside.
+     *
+     * @param limit Limit to start from
+     * @return Next outer order, nullptr if there is none
+     */
+    Order *getNextOuterOrder(const Limit *limit) const override;
+
+    /**
+     * Getter for boolean indicating if the index is empty.
+     *
+     * @return Whether the index is empty
+     */
+    bool empty() const override;
+
+    /**
+     * Check the invariants of the index and collect its limits, including limits without orders.
+     *
+     * @param sortedLimits Limits to append to, sorted by ascending price
+     * @return Description of the first broken invariant, nullptr if the index is valid
+     */
+    const char *validate(std::vector<const Limit *> &sortedLimits) const override;
+
+    /**
+     * Sweep the side from a limit outwards until a quantity is filled, reading the volumes of contiguous ticks.
+     *
+     * @param limit Limit with orders to start from, the inside limit of the side
+     * @param quantity Quantity to fill
+     * @param cost Cost to add to, starting from zero
+     */
+    void sweep(const Limit *limit, Quantity quantity, SweepCost<Price, Quantity> &cost) const override;
+};
+
+
+#endif //ORDER_BOOK_TICKLADDERPRICEINDEX_H
@@ -0,0 +1,191 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "TradeStats.h"
+#include "OrderBook.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Constructor for TradeStats.
+ *
+ * @param bucketNanos Length of a time bucket in nanoseconds
+ */
+template <typename Traits>
+TradeStats<Traits>::TradeStats(uint64_t bucketNanos) {
+    this->bucketNanos = bucketNanos;
+    reset();
+}
+
+/**
+ * Records a trade in the session totals and in the time bucket of the trade, resetting the bucket if it is stale.
+ * The log return from the previous trade price is counted in the bucket of the trade.
+ *
+ * @param price Price of the trade
+ * @param quantity Quantity of the trade
+ * @param time Time of the trade in nanoseconds since the epoch
+ */
+template <typename Traits>
+void TradeStats<Traits>::onTrade(Price price, Quantity quantity, uint64_t time) {
+    uint64_t number = time / bucketNanos;
+    TradeBucket<Quantity> &bucket = buckets[number % BUCKET_COUNT];
+    if (bucket.number != number) {
+        bucket = TradeBucket<Quantity>();
+        bucket.number = number;
+    }
+    bucket.volume += quantity;
+    bucket.tradeCount++;
+    if (tradeCount != 0 && lastPrice > 0 && price > 0) {
+        double logReturn = std::log(static_cast<double>(price) / static_cast<double>(lastPrice));
+        bucket.returnCount++;
+        bucket.returnSum += logReturn;
+        bucket.returnSquareSum += logReturn * logReturn;
+    }
+
+    this->lastPrice = price;
+    this->lastQuantity = quantity;
+    this->lastTime = time;
+    this->volume += quantity;
+    this->notional += PnlLedger<Traits>::toFixedPoint(price) * quantity;
+    this->tradeCount++;
+}
+
+/**
+ * Starts a new session, clearing the session totals, the last trade and every bucket.
+ */
+template <typename Traits>
+void TradeStats<Traits>::reset() {
+    for (TradeBucket<Quantity> &bucket : buckets) {
+        bucket = TradeBucket<Quantity>();
+        bucket.number = UINT64_MAX;
+    }
+    this->lastPrice = 0;
+    this->lastQuantity = 0;
+    this->lastTime = 0;
+    this->volume = 0;
+    this->notional = 0;
+    this->tradeCount = 0;
+}
+
+/**
+ * Getter for the price of the last trade.
+ *
+ * @return Price of the last trade, 0 if there has been no trade
+ */
+template <typename Traits>
+typename TradeStats<Traits>::Price TradeStats<Traits>::getLastPrice() const {
+    return lastPrice;
+}
+
+/**
+ * Getter for the quantity of the last trade.
+ *
+ * @return Quantity of the last trade, 0 if there has been no trade
+ */
+template <typename Traits>
+typename TradeStats<Traits>::Quantity TradeStats<Traits>::getLastQuantity() const {
+    return lastQuantity;
+}
+
+/**
+ * Getter for the time of the last trade.
+ *
+ * @return Nanoseconds since the epoch, 0 if there has been no trade
+ */
+template <typename Traits>
+uint64_t TradeStats<Traits>::getLastTime() const {
+    return lastTime;
+}
+
+/**
+ * Getter for the quantity traded in the session.
+ *
+ * @return Session volume
+ */
+template <typename Traits>
+typename TradeStats<Traits>::Quantity TradeStats<Traits>::getVolume() const {
+    return volume;
+}
+
+/**
+ * Getter for the number of trades in the session.
+ *
+ * @return Session trade count
+ */
+template <typename Traits>
+uint64_t TradeStats<Traits>::getTradeCount() const {
+    return tradeCount;
+}
+
+/**
+ * Getter for the volume weighted average price of the session, converted back from fixed point.
+ *
+ * @return Session VWAP, 0 if there has been no trade
+ */
+template <typename Traits>
+double TradeStats<Traits>::getVwap() const {
+    if (volume == 0) {
+        return 0;
+    }
+    return static_cast<double>(notional) / static_cast<double>(volume) / PnlLedger<Traits>::FIXED_POINT_SCALE;
+}
+
+/**
+ * Getter for the quantity traded in a rolling window, summing the buckets of the window that are not stale.
+ *
+ * @param windowNanos Length of the window in nanoseconds, rounded up to whole buckets and cut at the epoch
+ * @param now End of the window in nanoseconds since the epoch
+ * @return Rolling volume
+ */
+template <typename Traits>
+typename TradeStats<Traits>::Quantity
+TradeStats<Traits>::getRollingVolume(uint64_t windowNanos, uint64_t now) const {
+    uint64_t last = now / bucketNanos;
+    uint64_t count = std::min<uint64_t>((windowNanos + bucketNanos - 1) / bucketNanos, BUCKET_COUNT);
+    count = std::min(count, last + 1);
+    Quantity rollingVolume = 0;
+    for (uint64_t number = last + 1 - count; number <= last; number++) {
+        const TradeBucket<Quantity> &bucket = buckets[number % BUCKET_COUNT];
+        if (bucket.number == number) {
+            rollingVolume += bucket.volume;
+        }
+    }
+    return rollingVolume;
+}
+
+/**
+ * Getter for the volatility of trade prices in a rolling window, the sample standard deviation of the log returns
+ * counted in the buckets of the window that are not stale.
+ *
+ * @param windowNanos Length of the window in nanoseconds, rounded up to whole buckets and cut at the epoch
+ * @param now End of the window in nanoseconds since the epoch
+ * @return Rolling volatility, 0 if there are fewer than two returns
+ */
+template <typename Traits>
+double TradeStats<Traits>::getRollingVolatility(uint64_t windowNanos, uint64_t now) const {
+    uint64_t last = now / bucketNanos;
+    uint64_t count = std::min<uint64_t>((windowNanos + bucketNanos - 1) / bucketNanos, BUCKET_COUNT);
+    count = std::min(count, last + 1);
+    uint64_t returnCount = 0;
+    double returnSum = 0;
+    double returnSquareSum = 0;
+    for (uint64_t number = last + 1 - count; number <= last; number++) {
+        const TradeBucket<Quantity> &bucket = buckets[number % BUCKET_COUNT];
+        if (bucket.number == number) {
+            returnCount += bucket.returnCount;
+            returnSum += bucket.returnSum;
+            returnSquareSum += bucket.returnSquareSum;
+        }
+    }
+    if (returnCount < 2) {
+        return 0;
+    }
+    double variance = (returnSquareSum - returnSum * returnSum / returnCount) / (returnCount - 1);
+    return variance > 0 ? std::sqrt(variance) : 0;
+}
+
+template class TradeStats<OrderBook::Traits>;
+template class TradeStats<EquityOrderBook::Traits>;
+template class TradeStats<FuturesOrderBook::Traits>;
+template class TradeStats<CryptoOrderBook::Traits>;
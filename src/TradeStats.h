@@ -0,0 +1,194 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_TRADESTATS_H
+#define ORDER_BOOK_TRADESTATS_H
+
+#include <cstdint>
+
+/**
+ * Trades of one time bucket.
+ *
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Quantity>
+struct TradeBucket {
+    /**
+     * Number of the time bucket since the epoch, the bucket is stale if it is not the current number.
+     */
+    uint64_t number;
+
+    /**
+     * Quantity traded.
+     */
+    Quantity volume;
+
+    /**
+     * Number of trades.
+     */
+    uint32_t tradeCount;
+
+    /**
+     * Number of log returns between consecutive trade prices.
+     */
+    uint32_t returnCount;
+
+    /**
+     * Sum of log returns.
+     */
+    double returnSum;
+
+    /**
+     * Sum of squared log returns.
+     */
+    double returnSquareSum;
+};
+
+/**
+ * Last trade, session and rolling trade statistics of an order book, maintained from its own trades.
+ *
+ * Session statistics are running totals. Rolling statistics are kept in a ring of time buckets indexed by the trade
+ * time, so a trade updates one bucket in O(1) and a rolling query sums at most BUCKET_COUNT buckets. Buckets are
+ * reset lazily when a trade or query finds them stale. The session VWAP is accumulated in fixed point.
+ *
+ * @tparam Traits Types of the order book
+ */
+template <typename Traits>
+class TradeStats {
+public:
+    using Price = typename Traits::Price;
+    using Quantity = typename Traits::Quantity;
+
+    /**
+     * Number of time buckets, the longest rolling window is this many buckets.
+     */
+    static const uint32_t BUCKET_COUNT = 64;
+
+private:
+    /**
+     * Ring of time buckets, indexed by bucket number modulo BUCKET_COUNT.
+     */
+    TradeBucket<Quantity> buckets[BUCKET_COUNT];
+
+    /**
+     * Length of a time bucket in nanoseconds.
+     */
+    uint64_t bucketNanos;
+
+    /**
+     * Price of the last trade.
+     */
+    Price lastPrice;
+
+    /**
+     * Quantity of the last trade.
+     */
+    Quantity lastQuantity;
+
+    /**
+     * Time of the last trade in nanoseconds since the epoch.
+     */
+    uint64_t lastTime;
+
+    /**
+     * Quantity traded in the session.
+     */
+    Quantity volume;
+
+    /**
+     * Fixed point price times quantity traded in the session.
+     */
+    int64_t notional;
+
+    /**
+     * Number of trades in the session.
+     */
+    uint64_t tradeCount;
+
+public:
+    /**
+     * Constructor for TradeStats.
+     *
+     * @param bucketNanos Length of a time bucket in nanoseconds
+     */
+    explicit TradeStats(uint64_t bucketNanos = 1000000000ull);
+
+    /**
+     * Record a trade.
+     *
+     * @param price Price of the trade
+     * @param quantity Quantity of the trade
+     * @param time Time of the trade in nanoseconds since the epoch
+     */
+    void onTrade(Price price, Quantity quantity, uint64_t time);
+
+    /**
+     * Start a new session, clearing all statistics.
+     */
+    void reset();
+
+    /**
+     * Getter for the price of the last trade.
+     *
+     * @return Price of the last trade, 0 if there has been no trade
+     */
+    Price getLastPrice() const;
+
+    /**
+     * Getter for the quantity of the last trade.
+     *
+     * @return Quantity of the last trade, 0 if there has been no trade
+     */
+    Quantity getLastQuantity() const;
+
+    /**
+     * Getter for the time of the last trade.
+     *
+     * @return Nanoseconds since the epoch, 0 if there has been no trade
+     */
+    uint64_t getLastTime() const;
+
+    /**
+     * Getter for the quantity traded in the session.
+     *
+     * @return Session volume
+     */
+    Quantity getVolume() const;
+
+    /**
+     * Getter for the number of trades in the session.
+     *
+     * @return Session trade count
+     */
+    uint64_t getTradeCount() const;
+
+    /**
+     * Getter for the volume weighted average price of the session.
+     *
+     * @return Session VWAP, 0 if there has been no trade
+     */
+    double getVwap() const;
+
+    /**
+     * Getter for the quantity traded in a rolling window.
+     *
+     * @param windowNanos Length of the window in nanoseconds, rounded up to whole buckets
+     * @param now End of the window in nanoseconds since the epoch
+     * @return Rolling volume
+     */
+    Quantity getRollingVolume(uint64_t windowNanos, uint64_t now) const;
+
+    /**
+     * Getter for the volatility of trade prices in a rolling window, the standard deviation of log returns between
+     * consecutive trades.
+     *
+     * @param windowNanos Length of the window in nanoseconds, rounded up to whole buckets
+     * @param now End of the window in nanoseconds since the epoch
+     * @return Rolling volatility, 0 if there are fewer than two returns
+     */
+    double getRollingVolatility(uint64_t windowNanos, uint64_t now) const;
+};
+
+
+#endif //ORDER_BOOK_TRADESTATS_H
@@ -0,0 +1,286 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_TRADETAPE_H
+#define ORDER_BOOK_TRADETAPE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Record of a trade between a buy and a sell order, one cache line in size.
+ *
+ * @tparam Price Price type of the order book
+ * @tparam Quantity Quantity type of the order book
+ */
+template <typename Price, typename Quantity>
+struct alignas(64) TradeRecord {
+    /**
+     * ID of the trade, counting up from 0 in each order book.
+     */
+    uint64_t tradeId;
+
+    /**
+     * Time of the trade in nanoseconds since the epoch.
+     */
+    uint64_t time;
+
+    /**
+     * Time the buy order was placed in nanoseconds since the epoch.
+     */
+    uint64_t buyTime;
+
+    /**
+     * Time the sell order was placed in nanoseconds since the epoch.
+     */
+    uint64_t sellTime;
+
+    /**
+     * Price the trade settled at.
+     */
+    Price price;
+
+    /**
+     * Quantity traded.
+     */
+    Quantity quantity;
+
+    /**
+     * ID of the buy order.
+     */
+    int buyOrderId;
+
+    /**
+     * ID of the sell order.
+     */
+    int sellOrderId;
+
+    /**
+     * Boolean indicating if the buy order was the newer order, which took liquidity.
+     */
+    bool isBuyAggressor;
+
+    /**
+     * Boolean indicating if the trade was part of an auction uncross, which has no aggressor.
+     */
+    bool isAuction;
+};
+
+/**
+ * What a trade tape does with a new record when the consumer has not read the oldest records.
+ */
+enum class TapeOverflow {
+    /**
+     * The new record is dropped and counted.
+     */
+    DROP_NEWEST,
+
+    /**
+     * The oldest record is overwritten, the consumer counts the records it missed.
+     */
+    OVERWRITE_OLDEST,
+
+    /**
+     * The producer waits until the consumer reads.
+     */
+    BLOCK
+};
+
+/**
+ * Lock-free single producer, single consumer ring buffer of trade records.
+ *
+ * The producer and consumer only share a write count and a read count, each on its own cache line, so publishing a
+ * record is a copy and a release store. The consumer reads records in batches. When overwriting the oldest records,
+ * the producer never waits for the consumer, and each slot is guarded by a sequence lock: the producer marks the slot
+ * odd before copying a record in and even with the number of the record after, and the consumer discards a record if
+ * the slot did not hold that record, unchanged, both before and after copying it out.
+ *
+ * @tparam Record Type of the records
+ */
+template <typename Record>
+class TradeTape {
+    static_assert(std::is_trivially_copyable<Record>::value, "Records are copied as bytes");
+
+private:
+    /**
+     * Number of records published.
+     */
+    alignas(64) std::atomic<uint64_t> writeCount;
+
+    /**
+     * Number of records dropped by the producer.
+     */
+    std::atomic<uint64_t> droppedCount;
+
+    /**
+     * Number of records read or skipped by the consumer.
+     */
+    alignas(64) std::atomic<uint64_t> readCount;
+
+    /**
+     * Number of records overwritten before the consumer read them.
+     */
+    uint64_t lostCount;
+
+    /**
+     * Records, indexed by count modulo capacity.
+     */
+    alignas(64) std::vector<Record> records;
+
+    /**
+     * Sequence of each slot when overwriting the oldest records, 2 * count + 1 while the record of a count is copied
+     * in and 2 * count + 2 once it is complete, 0 before the first record.
+     */
+    std::unique_ptr<std::atomic<uint64_t>[]> sequences;
+
+    /**
+     * Capacity minus one, capacity is a power of two.
+     */
+    uint64_t mask;
+
+    /**
+     * Overflow policy.
+     */
+    TapeOverflow overflow;
+
+public:
+    /**
+     * Constructor for TradeTape.
+     *
+     * @param capacity Minimum number of records held, rounded up to a power of two
+     * @param overflow What to do with a new record when the tape is full
+     */
+    explicit TradeTape(uint32_t capacity, TapeOverflow overflow = TapeOverflow::DROP_NEWEST) {
+        uint64_t roundedCapacity = 1;
+        while (roundedCapacity < capacity) {
+            roundedCapacity <<= 1;
+        }
+        this->writeCount.store(0, std::memory_order_relaxed);
+        this->droppedCount.store(0, std::memory_order_relaxed);
+        this->readCount.store(0, std::memory_order_relaxed);
+        this->lostCount = 0;
+        this->records.resize(roundedCapacity);
+        if (overflow == TapeOverflow::OVERWRITE_OLDEST) {
+            this->sequences.reset(new std::atomic<uint64_t>[roundedCapacity]);
+            for (uint64_t i = 0; i < roundedCapacity; i++) {
+                this->sequences[i].store(0, std::memory_order_relaxed);
+            }
+        }
+        this->mask = roundedCapacity - 1;
+        this->overflow = overflow;
+    }
+
+    /**
+     * Publish a record, called by the producer only.
+     *
+     * @param record Record to publish
+     * @return Whether the record was published, false if it was dropped
+     */
+    bool publish(const Record &record) {
+        uint64_t write = writeCount.load(std::memory_order_relaxed);
+        if (overflow != TapeOverflow::OVERWRITE_OLDEST) {
+            while (write - readCount.load(std::memory_order_acquire) > mask) {
+                if (overflow == TapeOverflow::DROP_NEWEST) {
+                    droppedCount.store(droppedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return false;
+                }
+                // Let the consumer run if it shares the core
+                std::this_thread::yield();
+            }
+        }
+        if (overflow == TapeOverflow::OVERWRITE_OLDEST) {
+            // Mark the slot as being written before any byte of the record changes
+            std::atomic<uint64_t> &sequence = sequences[write & mask];
+            sequence.store(2 * write + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&records[write & mask], &record, sizeof(Record));
+            sequence.store(2 * write + 2, std::memory_order_release);
+        } else {
+            records[write & mask] = record;
+        }
+        writeCount.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Read a batch of records in publish order, called by the consumer only.
+     *
+     * @param out Array to copy records into
+     * @param maxCount Maximum number of records to read
+     * @return Number of records read
+     */
+    size_t read(Record *out, size_t maxCount) {
+        uint64_t capacity = mask + 1;
+        uint64_t read = readCount.load(std::memory_order_relaxed);
+        uint64_t write = writeCount.load(std::memory_order_acquire);
+        if (write - read > capacity) {
+            // Skip records that were overwritten
+            lostCount += write - read - capacity;
+            read = write - capacity;
+        }
+        size_t count = std::min<uint64_t>(write - read, maxCount);
+        if (overflow != TapeOverflow::OVERWRITE_OLDEST) {
+            for (size_t i = 0; i < count; i++) {
+                out[i] = records[(read + i) & mask];
+            }
+            readCount.store(read + count, std::memory_order_release);
+            return count;
+        }
+
+        // Keep a record only if its slot held it, complete, before and after the copy
+        size_t keptCount = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t expected = 2 * (read + i) + 2;
+            std::atomic<uint64_t> &sequence = sequences[(read + i) & mask];
+            if (sequence.load(std::memory_order_acquire) == expected) {
+                std::memcpy(&out[keptCount], &records[(read + i) & mask], sizeof(Record));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == expected) {
+                    keptCount++;
+                    continue;
+                }
+            }
+            lostCount++;
+        }
+        readCount.store(read + count, std::memory_order_release);
+        return keptCount;
+    }
+
+    /**
+     * Getter for the number of records held.
+     *
+     * @return Capacity of the tape
+     */
+    size_t getCapacity() const {
+        return mask + 1;
+    }
+
+    /**
+     * Getter for the number of records dropped because the tape was full.
+     *
+     * @return Number of dropped records
+     */
+    uint64_t getDroppedCount() const {
+        return droppedCount.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Getter for the number of records overwritten before the consumer read them, called by the consumer only.
+     *
+     * @return Number of lost records
+     */
+    uint64_t getLostCount() const {
+        return lostCount;
+    }
+};
+
+
+#endif //ORDER_BOOK_TRADETAPE_H
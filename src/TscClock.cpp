@@ -0,0 +1,81 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#include "TscClock.h"
+
+#include <ctime>
+
+/**
+ * Calibration of the timestamp counter against the system clock.
+ */
+struct TscCalibration {
+    /**
+     * System clock time at calibration, in nanoseconds since the epoch.
+     */
+    uint64_t baseNanos;
+
+    /**
+     * Timestamp counter at calibration.
+     */
+    uint64_t baseTicks;
+
+    /**
+     * Nanoseconds per timestamp counter tick.
+     */
+    double nanosPerTick;
+};
+
+/**
+ * Read the system clock.
+ *
+ * @return Nanoseconds since the epoch
+ */
+static uint64_t systemNanos() {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+
+/**
+ * Calibrate the timestamp counter against the system clock by timing the counter over 10 milliseconds.
+ *
+ * @return Calibration of the timestamp counter
+ */
+static TscCalibration calibrate() {
+    TscCalibration calibration = {0, 0, 1};
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t startNanos = systemNanos();
+    uint64_t startTicks = TscClock::ticks();
+    uint64_t endNanos = startNanos;
+    while (endNanos - startNanos < 10000000) {
+        endNanos = systemNanos();
+    }
+    uint64_t endTicks = TscClock::ticks();
+
+    calibration.baseNanos = endNanos;
+    calibration.baseTicks = endTicks;
+    calibration.nanosPerTick = static_cast<double>(endNanos - startNanos) / static_cast<double>(endTicks - startTicks);
+#endif
+    return calibration;
+}
+
+/**
+ * Calibration of the timestamp counter, taken while the program starts, before main runs any thread, and never
+ * written again, so threads read it without synchronisation.
+ */
+static const TscCalibration calibration = calibrate();
+
+/**
+ * Getter for the current time, extrapolated from the calibration by the timestamp counter.
+ *
+ * @return Nanoseconds since the epoch
+ */
+uint64_t TscClock::now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return calibration.baseNanos +
+           static_cast<uint64_t>(static_cast<double>(ticks() - calibration.baseTicks) * calibration.nanosPerTick);
+#else
+    return systemNanos();
+#endif
+}
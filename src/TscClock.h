@@ -0,0 +1,45 @@
+//
+// Created by Pin Ren Toh on 19/10/26.
+//
+
+#ifndef ORDER_BOOK_TSCCLOCK_H
+#define ORDER_BOOK_TSCCLOCK_H
+
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Local wall clock in nanoseconds since the epoch read from the CPU timestamp counter.
+ *
+ * The counter is calibrated against the system clock once while the program starts, before any thread can read it,
+ * after which reading the time is a single instruction and a multiply instead of a call into libc, with no check for
+ * calibration. Assumes an invariant timestamp counter synchronised across cores, as on all recent x86 processors. On
+ * other processors the system clock is read directly.
+ */
+class TscClock {
+public:
+    /**
+     * Getter for the current time.
+     *
+     * @return Nanoseconds since the epoch
+     */
+    static uint64_t now();
+
+    /**
+     * Getter for the raw timestamp counter, for timing short sections of code in cycles.
+     *
+     * @return Timestamp counter, nanoseconds since the epoch on processors without one
+     */
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return now();
+#endif
+    }
+};
+
+
+#endif //ORDER_BOOK_TSCCLOCK_H
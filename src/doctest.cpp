@@ -5,7 +5,35 @@
 #include "OrderBook.h"
 #include "Order.h"
 #include "Limit.h"
+#include "OrderIndex.h"
+#include "Arena.h"
+#include "BTreePriceIndex.h"
+#include "LevelBitmap.h"
+#include "TickLadderPriceIndex.h"
+#include "TscClock.h"
+#include "Stats.h"
+#include "RiskGate.h"
+#include "Throttle.h"
+#include "PegBook.h"
+#include "PnlLedger.h"
+#include "TradeTape.h"
+#include "TradeStats.h"
+#include "FlowGenerator.h"
+#include "FlowReplay.h"
+#include "ReferenceBook.h"
+#include "BookFuzzer.h"
+#include "Numa.h"
+#include "BookWorker.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
 #include <queue>
+#include <random>
+#include <thread>
 
 TEST_CASE("Order") {
     SUBCASE("Create order") {
@@ -16,6 +44,7 @@ TEST_CASE("Order") {
         CHECK(order->getQuantity() == 10);
         CHECK(order->isBuy() == true);
         CHECK(order->getTime() == 0);
+        CHECK(order->getSequence() == 0);
     }
 
     SUBCASE("Set next and prev orders") {
@@ -36,6 +65,215 @@ TEST_CASE("Order") {
         order->decreaseQuantity(5);
         CHECK(order->getQuantity() == 5);
     }
+
+    SUBCASE("Allocate from order pool") {
+        Order *order1 = new Order(1, 100, 10, true, 0);
+        Order *order2 = new Order(2, 100, 10, true, 0);
+        CHECK(OrderPool::get(OrderPool::indexOf(order2)) == order2);
+        CHECK(OrderPool::indexOf(order2) == OrderPool::indexOf(order1) + 1);
+        CHECK(OrderPool::indexOf(nullptr) == 0);
+
+        // Freed slot is reused by the next order
+        delete order1;
+        Order *order3 = new Order(3, 100, 10, true, 5);
+        CHECK(order3 == order1);
+        CHECK(order3->getTime() == 5);
+    }
+
+    SUBCASE("Each thread has its own order pool") {
+        Order *order = new Order(1, 100, 10, true, 0);
+        uint32_t threadIndices[2] = {};
+        Order *threadOrders[2] = {};
+        std::thread threads[2];
+        for (int i = 0; i < 2; i++) {
+            threads[i] = std::thread([&threadIndices, &threadOrders, i]() {
+                for (int j = 0; j < 1000; j++) {
+                    threadOrders[i] = new Order(j, 100, 10, true, 0);
+                }
+                threadIndices[i] = OrderPool::indexOf(threadOrders[i]);
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        // Threads allocate from fresh pools, neither sharing slots nor disturbing the pool of this thread
+        CHECK(threadIndices[0] == 1000);
+        CHECK(threadIndices[1] == 1000);
+        CHECK(threadOrders[0] != threadOrders[1]);
+        CHECK(OrderPool::get(OrderPool::indexOf(order)) == order);
+        CHECK(OrderPool::indexOf(new Order(2, 100, 10, true, 0)) == OrderPool::indexOf(order) + 1);
+    }
+}
+
+TEST_CASE("OrderIndex") {
+    SUBCASE("Insert, find and erase orders") {
+        OrderIndex *orderIndex = new OrderIndex();
+        std::vector<Order *> orders;
+        for (int i = 0; i < 1000; i++) {
+            orders.push_back(new Order(i, 100, 10, true, 0));
+            orderIndex->insert(i, OrderPool::indexOf(orders.back()));
+        }
+        CHECK(orderIndex->size() == 1000);
+        CHECK(OrderPool::get(orderIndex->find(500)) == orders[500]);
+        CHECK(orderIndex->find(1000) == 0);
+
+        // Erase every other order, remaining orders are still found
+        for (int i = 0; i < 1000; i += 2) {
+            orderIndex->erase(i);
+        }
+        orderIndex->erase(2000);
+        CHECK(orderIndex->size() == 500);
+        for (int i = 0; i < 1000; i++) {
+            CHECK(OrderPool::get(orderIndex->find(i)) == (i % 2 == 0 ? nullptr : orders[i]));
+        }
+
+        // Reserve keeps existing orders
+        orderIndex->reserve(100000);
+        CHECK(OrderPool::get(orderIndex->find(999)) == orders[999]);
+        CHECK(!orderIndex->empty());
+    }
+}
+
+TEST_CASE("Arena") {
+    SUBCASE("Map with the requested page size or fall back") {
+        for (PageSize pageSize : {PageSize::HUGE_1GB, PageSize::HUGE_2MB, PageSize::TRANSPARENT, PageSize::BASE}) {
+            Arena::setPageSize(pageSize);
+            size_t before[static_cast<int>(PageSize::COUNT)];
+            for (int i = 0; i < static_cast<int>(PageSize::COUNT); i++) {
+                before[i] = Arena::getMappedBytes(ArenaUse::OTHER, static_cast<PageSize>(i));
+            }
+            PageSize obtained;
+            size_t size = (size_t(1) << 22) + 100;
+            auto *memory = static_cast<uint8_t *>(Arena::map(size, ArenaUse::OTHER, obtained));
+
+            // Obtained pages are never larger than requested, the mapping is zeroed and rounded to whole pages
+            CHECK(static_cast<int>(obtained) >= static_cast<int>(pageSize));
+            CHECK(memory[0] == 0);
+            CHECK(memory[size - 1] == 0);
+            memory[0] = 1;
+            memory[size - 1] = 1;
+            size_t pageBytes = Arena::getPageBytes(obtained);
+            CHECK(reinterpret_cast<uintptr_t>(memory) % pageBytes == 0);
+            CHECK(Arena::getMappedBytes(ArenaUse::OTHER, obtained) - before[static_cast<int>(obtained)] ==
+                  (size + pageBytes - 1) / pageBytes * pageBytes);
+            Arena::unmap(memory, size, ArenaUse::OTHER, obtained);
+            CHECK(Arena::getMappedBytes(ArenaUse::OTHER, obtained) == before[static_cast<int>(obtained)]);
+        }
+
+        // Small mappings skip huge pages
+        Arena::setPageSize(PageSize::HUGE_2MB);
+        PageSize obtained;
+        void *memory = Arena::map(4096, ArenaUse::OTHER, obtained);
+        CHECK(obtained == PageSize::BASE);
+        Arena::unmap(memory, 4096, ArenaUse::OTHER, obtained);
+        Arena::setPageSize(PageSize::BASE);
+    }
+
+    SUBCASE("Commit hugetlb reservations in chunks") {
+        Arena::setPageSize(PageSize::HUGE_2MB);
+        size_t before = 0;
+        for (int i = 0; i < static_cast<int>(PageSize::COUNT); i++) {
+            before += Arena::getMappedBytes(ArenaUse::OTHER, static_cast<PageSize>(i));
+        }
+        ArenaReservation reservation;
+        Arena::reserve(reservation, (size_t(1) << 28) + 100, ArenaUse::OTHER);
+
+        // Nothing is committed or counted until the reservation grows
+        CHECK(reservation.size == (size_t(1) << 28) + (size_t(1) << 21));
+        CHECK(reservation.committedBytes == 0);
+        CHECK(reinterpret_cast<uintptr_t>(reservation.start) % (size_t(1) << 21) == 0);
+        CHECK(Arena::getMappedBytes(ArenaUse::OTHER, PageSize::HUGE_2MB) +
+              Arena::getMappedBytes(ArenaUse::OTHER, PageSize::TRANSPARENT) +
+              Arena::getMappedBytes(ArenaUse::OTHER, PageSize::BASE) == before);
+
+        // Each chunk is zeroed, writable and counted against the page size it obtained
+        Arena::commit(reservation, 100, ArenaUse::OTHER);
+        CHECK(reservation.committedBytes == (size_t(1) << 26));
+        CHECK(static_cast<int>(reservation.pageSize) >= static_cast<int>(PageSize::HUGE_2MB));
+        auto *memory = static_cast<uint8_t *>(reservation.start);
+        CHECK(memory[0] == 0);
+        CHECK(memory[(size_t(1) << 26) - 1] == 0);
+        memory[0] = 1;
+        memory[(size_t(1) << 26) - 1] = 1;
+        Arena::commit(reservation, (size_t(1) << 26) + 1, ArenaUse::OTHER);
+        CHECK(reservation.committedBytes == (size_t(1) << 27));
+        CHECK(memory[0] == 1);
+        CHECK(memory[(size_t(1) << 26) - 1] == 1);
+        CHECK(memory[size_t(1) << 26] == 0);
+        Arena::commit(reservation, reservation.size, ArenaUse::OTHER);
+        CHECK(reservation.committedBytes == reservation.size);
+        CHECK(Arena::getMappedBytes(ArenaUse::OTHER, PageSize::HUGE_2MB) +
+              Arena::getMappedBytes(ArenaUse::OTHER, PageSize::TRANSPARENT) +
+              Arena::getMappedBytes(ArenaUse::OTHER, PageSize::BASE) - before == reservation.size);
+        CHECK_THROWS_AS(Arena::commit(reservation, reservation.size + 1, ArenaUse::OTHER), std::bad_alloc);
+
+        // Small reservations are mapped and committed whole
+        ArenaReservation smallReservation;
+        Arena::reserve(smallReservation, 4096, ArenaUse::OTHER);
+        CHECK(smallReservation.committedBytes == 4096);
+        CHECK(smallReservation.chunkPageSize == PageSize::BASE);
+        Arena::unmap(smallReservation.start, 4096, ArenaUse::OTHER, smallReservation.pageSize);
+        Arena::setPageSize(PageSize::BASE);
+    }
+
+    SUBCASE("Order index mapped with huge pages") {
+        Arena::setPageSize(PageSize::TRANSPARENT);
+        size_t before = Arena::getMappedBytes(ArenaUse::ORDER_INDEX, PageSize::TRANSPARENT) +
+                        Arena::getMappedBytes(ArenaUse::ORDER_INDEX, PageSize::BASE);
+        OrderIndex *orderIndex = new OrderIndex();
+        orderIndex->reserve(1 << 20);
+        std::vector<Order *> orders;
+        for (int i = 0; i < 1000; i++) {
+            orders.push_back(new Order(i, 100, 10, true, 0));
+            orderIndex->insert(i, OrderPool::indexOf(orders.back()));
+        }
+        CHECK(OrderPool::get(orderIndex->find(999)) == orders[999]);
+        CHECK(Arena::getMappedBytes(ArenaUse::ORDER_INDEX, PageSize::TRANSPARENT) +
+              Arena::getMappedBytes(ArenaUse::ORDER_INDEX, PageSize::BASE) - before == (size_t(1) << 24));
+        delete orderIndex;
+        CHECK(Arena::getMappedBytes(ArenaUse::ORDER_INDEX, PageSize::TRANSPARENT) +
+              Arena::getMappedBytes(ArenaUse::ORDER_INDEX, PageSize::BASE) == before);
+        Arena::setPageSize(PageSize::BASE);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        Arena::printReport();
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(capturedOutput.str().find("Requested base pages.\nOrders: ") == 0);
+    }
+}
+
+TEST_CASE("Numa") {
+    SUBCASE("Topology") {
+        int nodeCount = Numa::getNodeCount();
+        CHECK(nodeCount >= 1);
+        int cpu = Numa::getCurrentCpu();
+        CHECK(cpu >= 0);
+        CHECK(Numa::getNodeOfCpu(cpu) >= 0);
+        CHECK(Numa::getNodeOfCpu(cpu) < nodeCount);
+    }
+
+    SUBCASE("Bind memory to a node") {
+        int node = Numa::getNodeOfCpu(Numa::getCurrentCpu());
+        Arena::setNode(node);
+        PageSize obtained;
+        auto *memory = static_cast<uint8_t *>(Arena::map(1 << 16, ArenaUse::OTHER, obtained));
+        memory[0] = 1;
+        CHECK(Numa::getNodeOfAddress(memory) == node);
+        Arena::unmap(memory, 1 << 16, ArenaUse::OTHER, obtained);
+        Arena::setNode(-1);
+
+        // Invalid nodes are not bound
+        CHECK(!Numa::bindMemory(nullptr, 4096, -1));
+        CHECK(!Numa::pinThread(-1));
+    }
 }
 
 TEST_CASE("Limit") {
@@ -146,17 +384,1435 @@ TEST_CASE("Limit") {
         CHECK(limit->getTailOrder() == nullptr);
     }
 
-    SUBCASE("Insert limit") {
-        OrderBook *orderBook = new OrderBook();
-        Limit *limit1 = new Limit(100, true, orderBook);
-        Limit *limit2 = new Limit(90, true, orderBook);
-        Limit *limit3 = new Limit(110, true, orderBook);
-        limit1->insertLimit(limit2);
-        limit1->insertLimit(limit3);
-        CHECK(limit1->getLeftChild() == limit2);
-        CHECK(limit1->getRightChild() == limit3);
-        CHECK(limit2->getParent() == limit1);
-        CHECK(limit3->getParent() == limit1);
+    SUBCASE("Insert limit") {
+        OrderBook *orderBook = new OrderBook();
+        Limit *limit1 = new Limit(100, true, orderBook);
+        Limit *limit2 = new Limit(90, true, orderBook);
+        Limit *limit3 = new Limit(110, true, orderBook);
+        limit1->insertLimit(limit2);
+        limit1->insertLimit(limit3);
+        CHECK(limit1->getLeftChild() == limit2);
+        CHECK(limit1->getRightChild() == limit3);
+        CHECK(limit2->getParent() == limit1);
+        CHECK(limit3->getParent() == limit1);
+    }
+
+    SUBCASE("Queue kept in limit pool cold data") {
+        OrderBook *orderBook = new OrderBook();
+        Limit *limit = new Limit(100, true, orderBook);
+        Order *order = new Order(1, 100, 10, true, 0);
+        limit->addOrder(order);
+        auto &queue = LimitPool::cold(LimitPool::indexOf(limit));
+        CHECK(queue.size == 1);
+        CHECK(queue.totalVolume == 10);
+        CHECK(queue.headOrder == OrderPool::indexOf(order));
+        CHECK(queue.orderBook == orderBook);
+        CHECK(order->getParentLimit() == limit);
+    }
+}
+
+TEST_CASE("BTreePriceIndex") {
+    SUBCASE("Insert and find limits") {
+        auto *priceIndex = new BTreePriceIndex<OrderBook::Traits>(true);
+        CHECK(priceIndex->empty());
+
+        std::vector<Limit *> limits;
+        for (int i = 0; i < 2000; i++) {
+            limits.push_back(new Limit((float) i, true, nullptr));
+        }
+        std::vector<Limit *> shuffled = limits;
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+        for (Limit *limit : shuffled) {
+            priceIndex->insert(limit);
+        }
+
+        CHECK(!priceIndex->empty());
+        for (int i = 0; i < 2000; i++) {
+            CHECK(priceIndex->find((float) i) == limits[i]);
+        }
+        CHECK(priceIndex->find(-1) == nullptr);
+        CHECK(priceIndex->find(0.5) == nullptr);
+        CHECK(priceIndex->find(2000) == nullptr);
+    }
+
+    SUBCASE("Build and insert limits") {
+        auto *priceIndex = new BTreePriceIndex<OrderBook::Traits>(false);
+        std::vector<Limit *> limits;
+        for (int i = 0; i < 1000; i++) {
+            limits.push_back(new Limit((float) (i * 2), false, nullptr));
+        }
+        priceIndex->build(limits);
+        for (int i = 0; i < 1000; i++) {
+            Limit *limit = new Limit((float) (i * 2 + 1), false, nullptr);
+            priceIndex->insert(limit);
+            CHECK(priceIndex->find((float) (i * 2 + 1)) == limit);
+        }
+        for (int i = 0; i < 1000; i++) {
+            CHECK(priceIndex->find((float) (i * 2)) == limits[i]);
+        }
+    }
+
+    SUBCASE("Get next inside order across empty limits") {
+        auto *buyIndex = new BTreePriceIndex<OrderBook::Traits>(true);
+        auto *sellIndex = new BTreePriceIndex<OrderBook::Traits>(false);
+        std::vector<Limit *> buyLimits;
+        std::vector<Limit *> sellLimits;
+        for (int i = 0; i < 100; i++) {
+            buyLimits.push_back(new Limit((float) i, true, nullptr));
+            sellLimits.push_back(new Limit((float) i, false, nullptr));
+            buyIndex->insert(buyLimits.back());
+            sellIndex->insert(sellLimits.back());
+        }
+        Order *buyOrder = new Order(1, 10, 10, true, 0);
+        Order *sellOrder = new Order(2, 90, 10, false, 0);
+        buyLimits[10]->addOrder(buyOrder);
+        sellLimits[90]->addOrder(sellOrder);
+
+        CHECK(buyIndex->getNextInsideOrder(buyLimits[10]) == buyOrder);
+        CHECK(buyIndex->getNextInsideOrder(buyLimits[99]) == buyOrder);
+        CHECK(buyIndex->getNextInsideOrder(buyLimits[9]) == nullptr);
+        CHECK(sellIndex->getNextInsideOrder(sellLimits[0]) == sellOrder);
+        CHECK(sellIndex->getNextInsideOrder(sellLimits[91]) == nullptr);
+    }
+
+    SUBCASE("Order book with B+-tree price index") {
+        OrderBook *orderBook = new OrderBook(PriceIndexType::BTREE);
+        orderBook->addOrder(100, 10, true);
+        OrderHandle buyOrder = orderBook->addOrder(120, 10, true);
+        orderBook->addOrder(110, 10, true);
+        orderBook->addOrder(110, 10, true);
+        orderBook->addOrder(130, 10, false);
+        CHECK(orderBook->getBuyTree() == nullptr);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->cancelOrder(buyOrder);
+        orderBook->getBestBid();
+        orderBook->getVolumeAtLimitPrice(110, true);
+        orderBook->getVolumeAtLimitPrice(130, true);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(capturedOutput.str() == "Buy order cancelled: 1 at 120\n"
+                                      "110\n"
+                                      "20\n"
+                                      "There is no buy volume at this limit price.\n");
+    }
+}
+
+TEST_CASE("LevelBitmap") {
+    SUBCASE("Find levels above and below") {
+        LevelBitmap *bitmap = new LevelBitmap();
+        CHECK(bitmap->findAbove(0) == -1);
+        CHECK(bitmap->findBelow(LevelBitmap::LEVEL_COUNT - 1) == -1);
+
+        bitmap->set(0);
+        bitmap->set(63);
+        bitmap->set(64);
+        bitmap->set(5000);
+        bitmap->set(LevelBitmap::LEVEL_COUNT - 1);
+        CHECK(bitmap->test(5000));
+        CHECK(!bitmap->test(5001));
+
+        // Within a word, across words and across words of words
+        CHECK(bitmap->findAbove(0) == 63);
+        CHECK(bitmap->findAbove(63) == 64);
+        CHECK(bitmap->findAbove(64) == 5000);
+        CHECK(bitmap->findAbove(5000) == LevelBitmap::LEVEL_COUNT - 1);
+        CHECK(bitmap->findAbove(LevelBitmap::LEVEL_COUNT - 1) == -1);
+        CHECK(bitmap->findBelow(LevelBitmap::LEVEL_COUNT - 1) == 5000);
+        CHECK(bitmap->findBelow(5000) == 64);
+        CHECK(bitmap->findBelow(64) == 63);
+        CHECK(bitmap->findBelow(63) == 0);
+        CHECK(bitmap->findBelow(0) == -1);
+
+        bitmap->clear(5000);
+        bitmap->clear(64);
+        CHECK(bitmap->findAbove(63) == LevelBitmap::LEVEL_COUNT - 1);
+        CHECK(bitmap->findBelow(LevelBitmap::LEVEL_COUNT - 1) == 63);
+    }
+}
+
+TEST_CASE("TickLadderPriceIndex") {
+    SUBCASE("Ticks of prices") {
+        auto *priceIndex = new TickLadderPriceIndex<OrderBook::Traits>(10, 0.5, true);
+        CHECK(priceIndex->tickOf(10) == 0);
+        CHECK(priceIndex->tickOf(12.5) == 5);
+        CHECK(priceIndex->tickOf(12.25) == -1);
+        CHECK(priceIndex->tickOf(9.5) == -1);
+        CHECK(!priceIndex->isValidPrice(10 + 0.5f * LevelBitmap::LEVEL_COUNT));
+    }
+
+    SUBCASE("Order book with tick ladder price index") {
+        OrderBook *orderBook = new OrderBook(PriceIndexType::TICK_LADDER, 100, 0.01f);
+        orderBook->addOrder(100.5f, 10, true);
+        OrderHandle buyOrder = orderBook->addOrder(900, 10, true);
+        orderBook->addOrder(1000, 10, false);
+        OrderHandle sellOrder = orderBook->addOrder(901, 10, false);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        Order *invalidOrder = orderBook->addOrder(100.005f, 10, true);
+        orderBook->cancelOrder(buyOrder);
+        orderBook->getBestBid();
+        orderBook->cancelOrder(sellOrder);
+        orderBook->addOrder(1000, 10, true);
+        orderBook->executeOrder();
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(invalidOrder == nullptr);
+        CHECK(capturedOutput.str() == "Price is not a valid tick.\n"
+                                      "Buy order cancelled: 1 at 900\n"
+                                      "100.5\n"
+                                      "Sell order cancelled: 1 at 901\n"
+                                      "Buy order added: 2 at 1000\n"
+                                      "Executed buy order at 1000 and sell order at 1000\n"
+                                      "Traded 10 at 1000\n");
+    }
+
+    SUBCASE("Sweep matches walking limits") {
+        using Traits = FuturesOrderBook::Traits;
+        const int topTick = LevelBitmap::LEVEL_COUNT - 1;
+        auto *orderBook = new FuturesOrderBook(PriceIndexType::AVL, 0, 1);
+        std::mt19937 engine(11);
+
+        // Dense levels near the inside, sparse levels further out and levels at both ends of the ladder
+        for (int i = 0; i < 2000; i++) {
+            int distance = i % 4 == 0 ? static_cast<int>(engine() % 5000) : static_cast<int>(engine() % 200);
+            orderBook->addOrder(100000 - distance, 1 + engine() % 50, true);
+            orderBook->addOrder(100001 + distance, 1 + engine() % 50, false);
+        }
+        for (int tick : {0, 1, 2, 5}) {
+            orderBook->addOrder(tick, 7, true);
+            orderBook->addOrder(topTick - tick, 7, false);
+        }
+
+        bool isSame = true;
+        for (bool isBuy : {true, false}) {
+            auto *index = static_cast<TickLadderPriceIndex<Traits> *>(orderBook->getPriceIndex(isBuy));
+            const FuturesOrderBook::Limit *inside = index->find(isBuy ? 100000 : 100001);
+            for (int32_t quantity : {1, 30, 31, 1000, 12345, 40000, 100000, 1 << 30}) {
+                SweepCost<int64_t, int32_t> ladderCost = {};
+                SweepCost<int64_t, int32_t> walkCost = {};
+                index->sweep(inside, quantity, ladderCost);
+                index->PriceIndex<Traits>::sweep(inside, quantity, walkCost);
+                isSame &= ladderCost.quantity == walkCost.quantity && ladderCost.notional == walkCost.notional &&
+                          ladderCost.worstPrice == walkCost.worstPrice && ladderCost.levelCount == walkCost.levelCount;
+            }
+
+            // Sweeps starting next to an end of the ladder
+            SweepCost<int64_t, int32_t> edgeCost = {};
+            index->sweep(index->find(isBuy ? 5 : topTick - 5), 20, edgeCost);
+            CHECK(edgeCost.quantity == 20);
+            CHECK(edgeCost.worstPrice == (isBuy ? 1 : topTick - 1));
+            CHECK(edgeCost.levelCount == 3);
+        }
+        CHECK(isSame);
+    }
+}
+
+TEST_CASE("TscClock") {
+    SUBCASE("Read local time") {
+        timespec systemTime;
+        clock_gettime(CLOCK_REALTIME, &systemTime);
+        uint64_t systemNanos = static_cast<uint64_t>(systemTime.tv_sec) * 1000000000ull + systemTime.tv_nsec;
+
+        // Clock is monotonic and close to the system clock
+        uint64_t first = TscClock::now();
+        uint64_t second = TscClock::now();
+        CHECK(second >= first);
+        CHECK(first + 1000000 > systemNanos);
+        CHECK(first < systemNanos + 1000000000ull);
+    }
+
+    SUBCASE("Read from several threads without calibrating") {
+        uint64_t before = TscClock::now();
+        uint64_t readTimes[4];
+        uint64_t readTicks[4];
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&readTimes, &readTicks, i]() {
+                uint64_t startTicks = TscClock::ticks();
+                readTimes[i] = TscClock::now();
+                readTicks[i] = TscClock::ticks() - startTicks;
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        // Every thread reads the shared calibration, the first read does not wait 10 milliseconds to calibrate
+        for (int i = 0; i < 4; i++) {
+            CHECK(readTimes[i] >= before);
+            CHECK(readTimes[i] < before + 1000000000ull);
+            CHECK(readTicks[i] < 5000000);
+        }
+    }
+}
+
+TEST_CASE("Stats") {
+    SUBCASE("Count hot path operations") {
+        uint64_t adds = Stats::total(Counter::ADDS);
+        uint64_t cancels = Stats::total(Counter::CANCELS);
+        uint64_t executes = Stats::total(Counter::EXECUTES);
+        uint64_t newLimits = Stats::total(Counter::NEW_LIMITS);
+        uint64_t rotations = Stats::total(Counter::ROTATIONS);
+        uint64_t lookups = Stats::total(Counter::HASH_LOOKUPS);
+        uint64_t addCycles = Stats::total(Counter::ADD_CYCLES);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        // Ascending buy limits rotate the AVL tree once
+        OrderBook *orderBook = new OrderBook();
+        orderBook->addOrder(100, 10, true);
+        orderBook->addOrder(101, 10, true);
+        OrderHandle buyOrder = orderBook->addOrder(102, 10, true);
+        orderBook->addOrder(102, 10, true);
+        orderBook->addOrder(99, 20, false);
+        orderBook->cancelOrder(buyOrder);
+        orderBook->executeOrder();
+        orderBook->executeOrder();
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(Stats::total(Counter::ADDS) == adds + 5);
+        CHECK(Stats::total(Counter::CANCELS) == cancels + 1);
+        CHECK(Stats::total(Counter::EXECUTES) == executes + 2);
+        CHECK(Stats::total(Counter::NEW_LIMITS) == newLimits + 4);
+        CHECK(Stats::total(Counter::ROTATIONS) == rotations + 1);
+        CHECK(Stats::total(Counter::HASH_LOOKUPS) > lookups);
+        CHECK(Stats::total(Counter::ADD_CYCLES) > addCycles);
+    }
+
+    SUBCASE("Read shared segment from another mapping") {
+        const char *name = "/order_book_stats_test";
+        REQUIRE(Stats::open(name));
+        CHECK(Stats::total(Counter::ADDS) == 0);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        OrderBook *orderBook = new OrderBook();
+        orderBook->addOrder(100, 10, true);
+        orderBook->addOrder(101, 10, false);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        // Monitor maps the segment read-only
+        int fd = shm_open(name, O_RDONLY, 0);
+        REQUIRE(fd >= 0);
+        void *segment = mmap(nullptr, Stats::segmentSize(), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        REQUIRE(segment != MAP_FAILED);
+        CHECK(Stats::total(segment, Counter::ADDS) == 2);
+        CHECK(Stats::total(segment, Counter::NEW_LIMITS) == 2);
+        munmap(segment, Stats::segmentSize());
+        Stats::unlink(name);
+    }
+
+    SUBCASE("Reset a segment of another layout") {
+        const char *name = "/order_book_stats_layout_test";
+        Stats::unlink(name);
+        int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+        REQUIRE(fd >= 0);
+        REQUIRE(ftruncate(fd, static_cast<off_t>(Stats::segmentSize())) == 0);
+        void *segment = mmap(nullptr, Stats::segmentSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        REQUIRE(segment != MAP_FAILED);
+
+        // Segment of an older version with every slot claimed
+        auto *segmentHeader = static_cast<StatsHeader *>(segment);
+        auto *threadStats = reinterpret_cast<ThreadStats *>(segmentHeader + 1);
+        segmentHeader->magic = Stats::MAGIC;
+        segmentHeader->version = Stats::VERSION - 1;
+        segmentHeader->counterCount = static_cast<uint32_t>(Counter::COUNT);
+        segmentHeader->slotCount = Stats::SLOT_COUNT;
+        for (uint32_t i = 0; i < Stats::SLOT_COUNT; i++) {
+            threadStats[i].counters[static_cast<int>(Counter::ADDS)].store(7);
+            threadStats[i].threadId.store(1);
+        }
+        CHECK(Stats::total(segment, Counter::ADDS) == 0);
+
+        REQUIRE(Stats::open(name));
+        Stats::add(Counter::ADDS);
+        bool isCurrentVersion = segmentHeader->version == Stats::VERSION;
+        CHECK(isCurrentVersion);
+        CHECK(Stats::total(segment, Counter::ADDS) == 1);
+        CHECK(Stats::getOverflowCount(segment) == 0);
+        munmap(segment, Stats::segmentSize());
+        Stats::unlink(name);
+    }
+
+    SUBCASE("Threads never share a slot and free it on exit") {
+        const char *name = "/order_book_stats_slot_test";
+        Stats::unlink(name);
+        REQUIRE(Stats::open(name));
+        int fd = shm_open(name, O_RDWR, 0);
+        REQUIRE(fd >= 0);
+        void *segment = mmap(nullptr, Stats::segmentSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        REQUIRE(segment != MAP_FAILED);
+
+        // More threads than slots count at once
+        const int threadCount = Stats::SLOT_COUNT + 6;
+        std::atomic<int> countedThreads(0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; i++) {
+            threads.emplace_back([&countedThreads, threadCount]() {
+                for (int j = 0; j < 1000; j++) {
+                    Stats::add(Counter::ADDS);
+                }
+                countedThreads.fetch_add(1);
+                while (countedThreads.load() < threadCount) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        CHECK(Stats::total(segment, Counter::ADDS) == Stats::SLOT_COUNT * 1000);
+        CHECK(Stats::getOverflowCount(segment) == 6);
+
+        // Exited threads freed their slots, a later thread adds to the counts of one
+        std::thread([]() {
+            Stats::add(Counter::ADDS);
+        }).join();
+        CHECK(Stats::total(segment, Counter::ADDS) == Stats::SLOT_COUNT * 1000 + 1);
+        CHECK(Stats::getOverflowCount(segment) == 6);
+
+        // Reopening keeps the counts and frees slots of threads that no longer exist
+        auto *threadStats = reinterpret_cast<ThreadStats *>(static_cast<StatsHeader *>(segment) + 1);
+        for (uint32_t i = 0; i < Stats::SLOT_COUNT; i++) {
+            threadStats[i].threadId.store(1u << 30);
+        }
+        REQUIRE(Stats::open(name));
+        std::thread([]() {
+            Stats::add(Counter::ADDS);
+        }).join();
+        CHECK(Stats::total(segment, Counter::ADDS) == Stats::SLOT_COUNT * 1000 + 2);
+        CHECK(Stats::getOverflowCount(segment) == 6);
+        munmap(segment, Stats::segmentSize());
+        Stats::unlink(name);
+    }
+}
+
+TEST_CASE("RiskGate") {
+    RiskGate<OrderBook::Traits> riskGate;
+    RiskLimits<int32_t> limits;
+    limits.maxOrderQuantity = 100;
+    limits.maxNotional = 5000;
+    limits.priceCollar = 0.1;
+    limits.maxOpenOrders = 2;
+    limits.maxPosition = 150;
+
+    SUBCASE("Disabled gate passes every order") {
+        CHECK(!riskGate.isEnabled());
+        CHECK(riskGate.check(1, 1000, 1000000, true, 10) == RiskReject::NONE);
+    }
+
+    SUBCASE("Check each limit") {
+        riskGate.setLimits(1, limits);
+        CHECK(riskGate.isEnabled());
+        CHECK(riskGate.check(1, 40, 100, true, 40) == RiskReject::NONE);
+        CHECK(riskGate.check(1, 40, 101, true, 40) == RiskReject::ORDER_SIZE);
+        CHECK(riskGate.check(1, 60, 100, true, 60) == RiskReject::NOTIONAL);
+        CHECK(riskGate.check(1, 45, 10, true, 40) == RiskReject::PRICE_COLLAR);
+        CHECK(riskGate.check(1, 35, 10, false, 40) == RiskReject::PRICE_COLLAR);
+        CHECK(riskGate.check(1, 35, 10, false, 0) == RiskReject::NONE);
+
+        // First failed check is reported
+        CHECK(riskGate.check(1, 100, 200, true, 40) == RiskReject::ORDER_SIZE);
+
+        // Unset accounts are unlimited
+        CHECK(riskGate.check(2, 100, 200, true, 40) == RiskReject::NONE);
+    }
+
+    SUBCASE("Track open orders and positions") {
+        riskGate.setLimits(1, limits);
+        auto *buyOrder = new Order(0, 40, 100, true, 0, 0, 1);
+        auto *sellOrder = new Order(0, 40, 30, false, 0, 1, 1);
+        riskGate.onOrderAdded(*buyOrder);
+        riskGate.onOrderAdded(*sellOrder);
+        CHECK(riskGate.getOpenOrders(1) == 2);
+        CHECK(riskGate.check(1, 40, 10, true, 40) == RiskReject::OPEN_ORDERS);
+
+        // Open buy quantity counts towards the position of a buy order
+        riskGate.onOrderFilled(*sellOrder, 30);
+        CHECK(riskGate.getOpenOrders(1) == 1);
+        CHECK(riskGate.getPosition(1) == -30);
+        CHECK(riskGate.check(1, 40, 80, true, 40) == RiskReject::NONE);
+        CHECK(riskGate.check(1, 40, 90, false, 40) == RiskReject::NONE);
+        riskGate.onOrderFilled(*buyOrder, 60);
+        CHECK(riskGate.getPosition(1) == 30);
+        CHECK(riskGate.check(1, 40, 100, true, 40) == RiskReject::POSITION);
+        CHECK(riskGate.check(1, 40, 100, false, 40) == RiskReject::NONE);
+
+        // Cancelled quantity no longer counts
+        auto *remainingBuyOrder = new Order(0, 40, 40, true, 0, 0, 1);
+        riskGate.onOrderCancelled(*remainingBuyOrder);
+        CHECK(riskGate.getOpenOrders(1) == 0);
+        CHECK(riskGate.check(1, 40, 100, true, 40) == RiskReject::NONE);
+    }
+
+    SUBCASE("Order book rejects orders") {
+        OrderBook *orderBook = new OrderBook();
+        orderBook->getRiskGate().setLimits(1, limits);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->addOrder(40, 60, true, 0, 1);
+        Order *rejectedOrder = orderBook->addOrder(50, 10, false, 0, 1);
+        orderBook->addOrder(40, 20, false, 0, 2);
+        orderBook->executeOrder();
+        orderBook->addOrder(40, 100, true, 0, 1);
+        orderBook->addOrder(40, 100, true, 0, 3);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(rejectedOrder == nullptr);
+        CHECK(capturedOutput.str() == "Buy order added: 0 at 40\n"
+                                      "Order rejected: price collar\n"
+                                      "Sell order added: 0 at 40\n"
+                                      "Executed partial buy order at 40 and sell order at40\n"
+                                      "Traded 20 at 40\n"
+                                      "Order rejected: position\n"
+                                      "Buy order added: 1 at 40\n");
+        CHECK(orderBook->getRiskGate().getOpenOrders(1) == 1);
+        CHECK(orderBook->getRiskGate().getPosition(1) == 20);
+        CHECK(orderBook->getRiskGate().getPosition(2) == -20);
+    }
+
+    SUBCASE("Count built and resting orders") {
+        limits.maxOpenOrders = 10;
+        limits.maxPosition = 120;
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        // Orders loaded in bulk are counted as they are built
+        OrderBook *builtBook = new OrderBook();
+        builtBook->getRiskGate().setLimits(1, limits);
+        Order *builtOrder = new Order(0, 40, 10, true, 0, 0, 1);
+        builtBook->buildFrom({builtOrder});
+        uint32_t builtOpenOrders = builtBook->getRiskGate().getOpenOrders(1);
+        builtBook->cancelOrder(OrderHandle(builtOrder));
+        uint32_t cancelledOpenOrders = builtBook->getRiskGate().getOpenOrders(1);
+        Order *nextOrder = builtBook->addOrder(40, 10, true, 0, 1);
+
+        // Orders resting when the gate is enabled are counted then
+        OrderBook *restingBook = new OrderBook();
+        restingBook->addOrder(40, 10, true, 0, 1);
+        restingBook->addOrder(41, 20, true, 0, 1);
+        restingBook->addOrder(42, 30, false, 0, 1);
+        restingBook->addPeggedOrder(PegType::BEST_BID, 0, 5, true, 0, 1);
+        restingBook->getRiskGate().setLimits(1, limits);
+        uint32_t restingOpenOrders = restingBook->getRiskGate().getOpenOrders(1);
+        restingBook->addOrder(42, 25, true, 0, 2);
+        restingBook->executeOrder();
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(builtOpenOrders == 1);
+        CHECK(cancelledOpenOrders == 0);
+        CHECK(nextOrder != nullptr);
+        CHECK(builtBook->getRiskGate().getOpenOrders(1) == 1);
+        CHECK(restingOpenOrders == 4);
+        CHECK(restingBook->getRiskGate().getOpenOrders(1) == 4);
+        CHECK(restingBook->getRiskGate().getPosition(1) == -25);
+        CHECK(restingBook->getRiskGate().check(1, 42, 95, false, 42) == RiskReject::POSITION);
+        CHECK(restingBook->getRiskGate().check(1, 42, 100, true, 42) == RiskReject::NONE);
+    }
+
+    SUBCASE("Open counts never drop below zero") {
+        riskGate.setLimits(1, limits);
+        auto *uncountedOrder = new Order(0, 40, 30, true, 0, 0, 1);
+        riskGate.onOrderFilled(*uncountedOrder, 10);
+        riskGate.onOrderDecreased(*uncountedOrder, 10);
+        riskGate.onOrderCancelled(*uncountedOrder);
+        CHECK(riskGate.getOpenOrders(1) == 0);
+        CHECK(riskGate.getPosition(1) == 10);
+        CHECK(riskGate.check(1, 40, 10, true, 40) == RiskReject::NONE);
+        CHECK(riskGate.check(1, 40, 100, true, 40) == RiskReject::NONE);
+        CHECK(riskGate.check(1, 40, 100, false, 40) == RiskReject::NONE);
+    }
+}
+
+TEST_CASE("Throttle") {
+    Throttle<OrderBook::Traits> throttle;
+    uint64_t start = 10000000000ull;
+
+    SUBCASE("Disabled throttle passes every message") {
+        CHECK(!throttle.isEnabled());
+        for (int i = 0; i < 1000; i++) {
+            CHECK(throttle.admit(1, start) == ThrottleReject::NONE);
+        }
+    }
+
+    SUBCASE("Limit message rate with a token bucket") {
+        ThrottleLimits limits;
+        limits.messagesPerSecond = 10;
+        limits.burst = 3;
+        throttle.setLimits(1, limits);
+        CHECK(throttle.isEnabled());
+
+        // Burst passes at once, then one message per interval
+        CHECK(throttle.admit(1, start) == ThrottleReject::NONE);
+        CHECK(throttle.admit(1, start) == ThrottleReject::NONE);
+        CHECK(throttle.admit(1, start) == ThrottleReject::NONE);
+        CHECK(throttle.admit(1, start) == ThrottleReject::MESSAGE_RATE);
+        CHECK(throttle.admit(1, start + 99999999) == ThrottleReject::MESSAGE_RATE);
+        CHECK(throttle.admit(1, start + 100000000) == ThrottleReject::NONE);
+        CHECK(throttle.admit(1, start + 100000000) == ThrottleReject::MESSAGE_RATE);
+        CHECK(throttle.getMessages(1) == 4);
+
+        // Bucket refills to the burst after a quiet period, and no further
+        for (int i = 0; i < 3; i++) {
+            CHECK(throttle.admit(1, start + 5000000000ull) == ThrottleReject::NONE);
+        }
+        CHECK(throttle.admit(1, start + 5000000000ull) == ThrottleReject::MESSAGE_RATE);
+
+        // Cancels are never rejected and take no token from an empty bucket
+        auto *order = new Order(0, 100, 10, true, 0, 0, 1);
+        throttle.onOrderCancelled(*order, start + 5000000000ull);
+        CHECK(throttle.admit(1, start + 5100000000ull) == ThrottleReject::NONE);
+
+        // Unset participants are unlimited
+        for (int i = 0; i < 10; i++) {
+            CHECK(throttle.admit(2, start) == ThrottleReject::NONE);
+        }
+    }
+
+    SUBCASE("Limit order to trade ratio over a rolling window") {
+        ThrottleLimits limits;
+        limits.maxOrderToTradeRatio = 2;
+        limits.minOrderToTradeMessages = 4;
+        limits.orderToTradeWindow = 1000000000;
+        throttle.setLimits(1, limits);
+        auto *order = new Order(0, 100, 10, true, 0, 0, 1);
+
+        // Ratio is not enforced below the minimum messages
+        for (int i = 0; i < 4; i++) {
+            CHECK(throttle.admit(1, start) == ThrottleReject::NONE);
+        }
+        CHECK(throttle.admit(1, start) == ThrottleReject::ORDER_TO_TRADE);
+
+        // Trades allow more messages
+        throttle.onOrderFilled(*order, start);
+        throttle.onOrderFilled(*order, start);
+        CHECK(throttle.admit(1, start) == ThrottleReject::ORDER_TO_TRADE);
+        throttle.onOrderFilled(*order, start);
+        CHECK(throttle.admit(1, start) == ThrottleReject::NONE);
+        throttle.onOrderCancelled(*order, start);
+        CHECK(throttle.getMessages(1) == 6);
+        CHECK(throttle.getTrades(1) == 3);
+        CHECK(throttle.admit(1, start) == ThrottleReject::ORDER_TO_TRADE);
+
+        // Previous window is weighted by its overlap with the rolling window
+        CHECK(throttle.admit(1, start + 1250000000ull) == ThrottleReject::ORDER_TO_TRADE);
+        CHECK(throttle.admit(1, start + 1750000000ull) == ThrottleReject::NONE);
+        CHECK(throttle.getMessages(1) == 1);
+        CHECK(throttle.getTrades(1) == 0);
+
+        // Windows older than the previous window are dropped
+        for (int i = 0; i < 4; i++) {
+            CHECK(throttle.admit(1, start + 3000000000ull) == ThrottleReject::NONE);
+        }
+        CHECK(throttle.admit(1, start + 3000000000ull) == ThrottleReject::ORDER_TO_TRADE);
+    }
+
+    SUBCASE("Order book throttles adds and modifies") {
+        OrderBook *orderBook = new OrderBook();
+        ThrottleLimits limits;
+        limits.messagesPerSecond = 0.001;
+        limits.burst = 2;
+        orderBook->getThrottle().setLimits(1, limits);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        OrderHandle buyOrder = orderBook->addOrder(100, 10, true, 0, 1);
+        OrderHandle sellOrder = orderBook->addOrder(101, 10, false, 0, 1);
+        Order *rejectedOrder = orderBook->addOrder(102, 10, false, 0, 1);
+        OrderHandle modifiedOrder = orderBook->modifyOrder(buyOrder, 100, 5);
+        orderBook->addOrder(102, 10, false, 0, 2);
+        orderBook->cancelOrder(sellOrder);
+        orderBook->cancelOrder(sellOrder);
+        int buyQuantity = buyOrder->getQuantity();
+
+        // Cancels of orders that do not exist are not counted
+        OrderBook::Message messages[3] = {
+                {BatchType::ADD, true, 1, 0, 99, 10, 0},
+                {BatchType::CANCEL, true, 1, buyOrder->getId(), 0, 0, 0},
+                {BatchType::CANCEL, true, 1, buyOrder->getId(), 0, 0, 0}};
+        BatchResult results[3];
+        orderBook->applyBatch(messages, 3, results);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(rejectedOrder == nullptr);
+        CHECK(modifiedOrder == nullptr);
+        CHECK(buyQuantity == 10);
+        CHECK(!results[0].isApplied);
+        CHECK(results[1].isApplied);
+        CHECK(!results[2].isApplied);
+        CHECK(orderBook->getThrottle().getMessages(1) == 4);
+        CHECK(capturedOutput.str() == "Buy order added: 0 at 100\n"
+                                      "Sell order added: 0 at 101\n"
+                                      "Order rejected: message rate\n"
+                                      "Order rejected: message rate\n"
+                                      "Sell order added: 1 at 102\n"
+                                      "Sell order cancelled: 0 at 101\n"
+                                      "Order does not exist.\n"
+                                      "Order rejected: message rate\n"
+                                      "Buy order cancelled: 0 at 100\n"
+                                      "Order does not exist.\n");
+    }
+}
+
+TEST_CASE("PnlLedger") {
+    PnlLedger<OrderBook::Traits> pnlLedger;
+
+    SUBCASE("Convert prices to fixed point") {
+        CHECK(PnlLedger<OrderBook::Traits>::toFixedPoint(100.01f) == 1000100);
+        CHECK(PnlLedger<FuturesOrderBook::Traits>::toFixedPoint(412350) == 412350);
+    }
+
+    SUBCASE("Realise PnL at average cost") {
+        pnlLedger.onFill(1, true, 100, 10);
+        pnlLedger.onFill(1, true, 101, 10);
+        CHECK(pnlLedger.getAccount(1).position == 20);
+        CHECK(pnlLedger.getAccount(1).cost == 20100000);
+
+        // Closing part of a long position realises the difference to the average cost
+        pnlLedger.onFill(1, false, 102, 5);
+        CHECK(pnlLedger.getAccount(1).position == 15);
+        CHECK(pnlLedger.getAccount(1).realisedPnl == 75000);
+
+        // Selling through the position opens a short position at the fill price
+        pnlLedger.onFill(1, false, 99.5f, 25);
+        CHECK(pnlLedger.getAccount(1).position == -10);
+        CHECK(pnlLedger.getAccount(1).cost == -9950000);
+        CHECK(pnlLedger.getAccount(1).realisedPnl == -75000);
+
+        pnlLedger.onFill(1, true, 99, 4);
+        CHECK(pnlLedger.getAccount(1).position == -6);
+        CHECK(pnlLedger.getAccount(1).realisedPnl == -55000);
+        CHECK(pnlLedger.getUnrealisedPnl(1, 980000) == 90000);
+        CHECK(pnlLedger.getAccount(1).tradedQuantity == 54);
+    }
+
+    SUBCASE("Report accounts that have traded") {
+        pnlLedger.onFill(3, true, 100, 10);
+        pnlLedger.onFill(1, false, 100, 10);
+        std::vector<PnlReport<int32_t>> reports;
+        pnlLedger.report(1010000, reports);
+        CHECK(reports.size() == 2);
+        CHECK(reports[0].owner == 1);
+        CHECK(reports[0].averageCost == 1000000);
+        CHECK(reports[0].unrealisedPnl == -100000);
+        CHECK(reports[1].owner == 3);
+        CHECK(reports[1].position == 10);
+        CHECK(reports[1].unrealisedPnl == 100000);
+        CHECK(pnlLedger.getAccount(2).tradedQuantity == 0);
+    }
+
+    SUBCASE("Order book marks at the mid price") {
+        auto *orderBook = new EquityOrderBook(PriceIndexType::AVL, 90, 0.01);
+        orderBook->addOrder(101, 10, true, 0, 1);
+        orderBook->addOrder(100, 10, false, 0, 2);
+        orderBook->executeOrder();
+        orderBook->addOrder(100, 10, true, 0, 3);
+        orderBook->addOrder(104, 10, false, 0, 3);
+
+        // Trade settles at the price of the resting buy order
+        std::vector<PnlReport<int32_t>> reports;
+        orderBook->getPnlReport(reports);
+        CHECK(reports.size() == 2);
+        CHECK(reports[0].owner == 1);
+        CHECK(reports[0].averageCost == 1010000);
+        CHECK(reports[0].unrealisedPnl == 100000);
+        CHECK(reports[1].owner == 2);
+        CHECK(reports[1].position == -10);
+        CHECK(reports[1].unrealisedPnl == -100000);
+    }
+}
+
+TEST_CASE("TradeTape") {
+    using Trade = OrderBook::Trade;
+    Trade trades[8];
+
+    SUBCASE("Read in batches") {
+        TradeTape<Trade> tradeTape(3);
+        CHECK(tradeTape.getCapacity() == 4);
+        for (uint64_t i = 0; i < 3; i++) {
+            Trade trade = {};
+            trade.tradeId = i;
+            CHECK(tradeTape.publish(trade));
+        }
+        CHECK(tradeTape.read(trades, 2) == 2);
+        CHECK(trades[1].tradeId == 1);
+        CHECK(tradeTape.read(trades, 8) == 1);
+        CHECK(trades[0].tradeId == 2);
+        CHECK(tradeTape.read(trades, 8) == 0);
+    }
+
+    SUBCASE("Drop newest") {
+        TradeTape<Trade> tradeTape(4, TapeOverflow::DROP_NEWEST);
+        for (uint64_t i = 0; i < 6; i++) {
+            Trade trade = {};
+            trade.tradeId = i;
+            tradeTape.publish(trade);
+        }
+        CHECK(tradeTape.getDroppedCount() == 2);
+        CHECK(tradeTape.read(trades, 8) == 4);
+        CHECK(trades[3].tradeId == 3);
+    }
+
+    SUBCASE("Overwrite oldest") {
+        TradeTape<Trade> tradeTape(4, TapeOverflow::OVERWRITE_OLDEST);
+        for (uint64_t i = 0; i < 6; i++) {
+            Trade trade = {};
+            trade.tradeId = i;
+            CHECK(tradeTape.publish(trade));
+        }
+
+        // Only the records still held are read
+        CHECK(tradeTape.read(trades, 8) == 4);
+        CHECK(trades[0].tradeId == 2);
+        CHECK(trades[3].tradeId == 5);
+        CHECK(tradeTape.getLostCount() == 2);
+    }
+
+    SUBCASE("Overwrite oldest never reads a torn record") {
+        TradeTape<Trade> tradeTape(4, TapeOverflow::OVERWRITE_OLDEST);
+        std::thread producer([&tradeTape]() {
+            for (uint64_t i = 0; i < 100000; i++) {
+                Trade trade = {};
+                trade.tradeId = i;
+                trade.time = i;
+                trade.buyTime = i;
+                trade.sellTime = i;
+                trade.buyOrderId = static_cast<int>(i);
+                trade.sellOrderId = static_cast<int>(i);
+                tradeTape.publish(trade);
+            }
+        });
+        uint64_t readCount = 0;
+        uint64_t lastId = 0;
+        bool isWhole = true;
+        while (readCount + tradeTape.getLostCount() < 100000) {
+            size_t count = tradeTape.read(trades, 8);
+            for (size_t i = 0; i < count; i++) {
+                isWhole &= trades[i].time == trades[i].tradeId && trades[i].sellTime == trades[i].tradeId &&
+                           trades[i].sellOrderId == static_cast<int>(trades[i].tradeId) &&
+                           (readCount == 0 || trades[i].tradeId > lastId);
+                lastId = trades[i].tradeId;
+                readCount++;
+            }
+            if (count == 0) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        CHECK(isWhole);
+        CHECK(readCount + tradeTape.getLostCount() == 100000);
+    }
+
+    SUBCASE("Block until the consumer reads") {
+        TradeTape<Trade> tradeTape(16, TapeOverflow::BLOCK);
+        std::thread producer([&tradeTape]() {
+            for (uint64_t i = 0; i < 100000; i++) {
+                Trade trade = {};
+                trade.tradeId = i;
+                tradeTape.publish(trade);
+            }
+        });
+        uint64_t nextId = 0;
+        bool isOrdered = true;
+        while (nextId < 100000) {
+            size_t count = tradeTape.read(trades, 8);
+            for (size_t i = 0; i < count; i++) {
+                isOrdered &= trades[i].tradeId == nextId++;
+            }
+            if (count == 0) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        CHECK(isOrdered);
+        CHECK(tradeTape.getDroppedCount() == 0);
+    }
+
+    SUBCASE("Order book publishes trades") {
+        TradeTape<Trade> tradeTape(16);
+        auto *orderBook = new EquityOrderBook(PriceIndexType::AVL, 90, 0.01);
+        orderBook->setTradeTape(&tradeTape);
+        orderBook->addOrder(101, 10, true, 1000);
+        orderBook->addOrder(100, 4, false, 2000);
+        orderBook->addOrder(100.5f, 10, false, 3000);
+        orderBook->executeOrder();
+        orderBook->executeOrder();
+
+        CHECK(tradeTape.read(trades, 8) == 2);
+        CHECK(trades[0].tradeId == 0);
+        CHECK(trades[0].price == 101);
+        CHECK(trades[0].quantity == 4);
+        CHECK(trades[0].buyOrderId == 0);
+        CHECK(trades[0].sellOrderId == 0);
+        CHECK(trades[0].buyTime == 1000);
+        CHECK(trades[0].sellTime == 2000);
+        CHECK(!trades[0].isBuyAggressor);
+        CHECK(!trades[0].isAuction);
+        CHECK(trades[1].tradeId == 1);
+        CHECK(trades[1].quantity == 6);
+        CHECK(trades[1].sellOrderId == 1);
+        CHECK(trades[1].time >= trades[0].time);
+    }
+}
+
+TEST_CASE("TradeStats") {
+    TradeStats<OrderBook::Traits> tradeStats(1000);
+
+    SUBCASE("Last trade and session statistics") {
+        CHECK(tradeStats.getVwap() == 0);
+        tradeStats.onTrade(100, 10, 500);
+        tradeStats.onTrade(100.5f, 30, 1500);
+        CHECK(tradeStats.getLastPrice() == 100.5f);
+        CHECK(tradeStats.getLastQuantity() == 30);
+        CHECK(tradeStats.getLastTime() == 1500);
+        CHECK(tradeStats.getVolume() == 40);
+        CHECK(tradeStats.getTradeCount() == 2);
+        CHECK(tradeStats.getVwap() == doctest::Approx(100.375));
+
+        CHECK(tradeStats.getRollingVolume(2000, 1500) == 40);
+        tradeStats.reset();
+        CHECK(tradeStats.getVolume() == 0);
+        CHECK(tradeStats.getRollingVolume(2000, 1500) == 0);
+    }
+
+    SUBCASE("Rolling volume") {
+        tradeStats.onTrade(100, 10, 500);
+        tradeStats.onTrade(100, 20, 1500);
+        tradeStats.onTrade(100, 40, 2500);
+        CHECK(tradeStats.getRollingVolume(1000, 2999) == 40);
+        CHECK(tradeStats.getRollingVolume(2000, 2999) == 60);
+        CHECK(tradeStats.getRollingVolume(3000, 2999) == 70);
+        CHECK(tradeStats.getRollingVolume(1000, 3000) == 0);
+
+        // Windows reaching before the epoch are cut at bucket 0
+        CHECK(tradeStats.getRollingVolume(4000, 2999) == 70);
+        CHECK(tradeStats.getRollingVolume(64000, 2999) == 70);
+
+        // Buckets a full ring ago are stale
+        tradeStats.onTrade(100, 5, 500 + 64 * 1000);
+        CHECK(tradeStats.getRollingVolume(64000, 64999) == 5 + 20 + 40);
+    }
+
+    SUBCASE("Rolling volatility") {
+        tradeStats.onTrade(100, 10, 100);
+        CHECK(tradeStats.getRollingVolatility(1000, 999) == 0);
+        tradeStats.onTrade(110, 10, 200);
+        tradeStats.onTrade(100, 10, 300);
+        tradeStats.onTrade(100, 10, 1300);
+
+        // Log returns are ln(1.1), ln(1 / 1.1) and 0
+        double logReturn = std::log(1.1);
+        CHECK(tradeStats.getRollingVolatility(1000, 999) == doctest::Approx(std::sqrt(2 * logReturn * logReturn)));
+        CHECK(tradeStats.getRollingVolatility(2000, 1999) ==
+              doctest::Approx(std::sqrt(2 * logReturn * logReturn / 2)));
+        CHECK(tradeStats.getRollingVolatility(64000, 1999) ==
+              doctest::Approx(std::sqrt(2 * logReturn * logReturn / 2)));
+    }
+
+    SUBCASE("Order book snapshot") {
+        auto *orderBook = new EquityOrderBook(PriceIndexType::AVL, 90, 0.01);
+        orderBook->addOrder(101, 10, true);
+        orderBook->addOrder(100, 4, false);
+        orderBook->executeOrder();
+        orderBook->addOrder(99, 2, false);
+        orderBook->executeOrder();
+        orderBook->addOrder(102, 7, false);
+
+        MarketSnapshot<float, int32_t> snapshot = orderBook->getSnapshot();
+        CHECK(snapshot.bestBid == 101);
+        CHECK(snapshot.bestBidVolume == 4);
+        CHECK(snapshot.bestAsk == 102);
+        CHECK(snapshot.bestAskVolume == 7);
+        CHECK(snapshot.lastPrice == 101);
+        CHECK(snapshot.lastQuantity == 2);
+        CHECK(snapshot.volume == 6);
+        CHECK(snapshot.tradeCount == 2);
+        CHECK(snapshot.vwap == doctest::Approx(101));
+        CHECK(orderBook->getTradeStats().getRollingVolume(1000000000ull, TscClock::now()) == 6);
+    }
+}
+
+TEST_CASE("FlowGenerator") {
+    FlowConfig config;
+    config.messageCount = 20000;
+    config.seed = 42;
+
+    SUBCASE("Same seed generates the same flow") {
+        std::vector<FlowMessage> messages;
+        std::vector<FlowMessage> sameMessages;
+        std::vector<FlowMessage> otherMessages;
+        FlowHeader header = FlowGenerator(config).generate(messages);
+        FlowGenerator(config).generate(sameMessages);
+        config.seed = 43;
+        FlowGenerator(config).generate(otherMessages);
+
+        CHECK(header.messageCount == 20000);
+        CHECK(sizeof(FlowMessage) == 24);
+        CHECK(std::memcmp(messages.data(), sameMessages.data(), messages.size() * sizeof(FlowMessage)) == 0);
+        CHECK(std::memcmp(messages.data(), otherMessages.data(), messages.size() * sizeof(FlowMessage)) != 0);
+
+        // Every message type is generated and times increase
+        int typeCounts[3] = {};
+        bool isIncreasing = true;
+        for (size_t i = 0; i < messages.size(); i++) {
+            typeCounts[static_cast<int>(messages[i].type)]++;
+            isIncreasing &= i == 0 || messages[i].time > messages[i - 1].time;
+        }
+        CHECK(typeCounts[0] > 0);
+        CHECK(typeCounts[1] > 0);
+        CHECK(typeCounts[2] > 0);
+        CHECK(isIncreasing);
+    }
+
+    SUBCASE("Write and map a flow file") {
+        std::vector<FlowMessage> messages;
+        FlowHeader header = FlowGenerator(config).generate(messages);
+        const char *path = "/tmp/order_book_flow_test.bin";
+        CHECK(FlowGenerator::write(path, header, messages));
+
+        FlowFile flowFile;
+        CHECK(flowFile.open(path));
+        CHECK(flowFile.getHeader().messageCount == header.messageCount);
+        CHECK(flowFile.getHeader().orderCount == header.orderCount);
+        CHECK(std::memcmp(flowFile.getMessages(), messages.data(), messages.size() * sizeof(FlowMessage)) == 0);
+        unlink(path);
+    }
+
+    SUBCASE("Replay refers only to live orders") {
+        std::vector<FlowMessage> messages;
+        FlowHeader header = FlowGenerator(config).generate(messages);
+        auto *orderBook = new EquityOrderBook(PriceIndexType::AVL, header.minPrice, header.tickSize);
+        FlowReplay<EquityOrderBook> replay(orderBook, header);
+
+        bool isLive = true;
+        for (const FlowMessage &message : messages) {
+            isLive &= message.type == FlowType::ADD || replay.getOrder(message.orderRef) != nullptr;
+            replay.apply(message);
+        }
+        CHECK(isLive);
+        CHECK(replay.getRejectedCount() == 0);
+        CHECK(replay.getExecutedCount() > 0);
+    }
+}
+
+TEST_CASE("ReferenceBook") {
+    ReferenceBook<FuturesOrderBook::Traits> reference;
+
+    SUBCASE("Match in price-time priority at the older price") {
+        reference.addOrder(0, 100, 10, true);
+        reference.addOrder(1, 101, 5, true);
+        reference.addOrder(2, 101, 5, true);
+        reference.addOrder(0, 99, 12, false);
+
+        CHECK(reference.getFills().size() == 3);
+        CHECK(reference.getFills()[0].price == 101);
+        CHECK(reference.getFills()[0].buyOrderId == 1);
+        CHECK(reference.getFills()[1].buyOrderId == 2);
+        CHECK(reference.getFills()[2].price == 100);
+        CHECK(reference.getFills()[2].quantity == 2);
+        CHECK(reference.getQuantity(0, true) == 8);
+        CHECK(reference.getQuantity(1, true) == 0);
+        CHECK(reference.getQuantity(0, false) == 0);
+        CHECK(reference.getBids().size() == 1);
+        CHECK(reference.getAsks().empty());
+        CHECK(reference.getVolume() == 12);
+        CHECK(reference.getTradeCount() == 3);
+    }
+
+    SUBCASE("Cancel and decrease") {
+        reference.addOrder(0, 100, 10, true);
+        reference.addOrder(1, 100, 10, true);
+        CHECK(reference.decreaseQuantity(0, true, 4));
+        CHECK(reference.getQuantity(0, true) == 6);
+        CHECK(reference.cancelOrder(0, true));
+        CHECK_FALSE(reference.cancelOrder(0, true));
+        CHECK_FALSE(reference.decreaseQuantity(0, true, 1));
+        CHECK(reference.getBids().at(100).front().id == 1);
+
+        reference.clear();
+        CHECK(reference.getBids().empty());
+        CHECK(reference.getQuantity(1, true) == 0);
+    }
+}
+
+TEST_CASE("BookFuzzer") {
+    std::mt19937 engine(7);
+    std::vector<uint8_t> input(16384);
+    for (uint8_t &byte : input) {
+        byte = static_cast<uint8_t>(engine());
+    }
+
+    // Redirect std::cout to a stringstream
+    std::stringstream capturedOutput;
+    std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+    std::cout.rdbuf(capturedOutput.rdbuf());
+
+    SUBCASE("Order books agree with the reference book") {
+        BookFuzzer<OrderBook> avl(new OrderBook(PriceIndexType::AVL), 0, 1);
+        BookFuzzer<OrderBook> bTree(new OrderBook(PriceIndexType::BTREE), 0, 1);
+        BookFuzzer<OrderBook> ladder(new OrderBook(PriceIndexType::TICK_LADDER, 0, 0.5), 0, 0.5);
+        BookFuzzer<EquityOrderBook> equity(new EquityOrderBook(PriceIndexType::TICK_LADDER, 100, 0.01), 100, 0.01);
+        BookFuzzer<FuturesOrderBook> futures(new FuturesOrderBook(), 0, 1);
+        BookFuzzer<CryptoOrderBook> crypto(new CryptoOrderBook(), 100, 0.25);
+        CHECK(avl.run(input.data(), input.size()));
+        CHECK(bTree.run(input.data(), input.size()));
+        CHECK(ladder.run(input.data(), input.size()));
+        CHECK(equity.run(input.data(), input.size()));
+        CHECK(futures.run(input.data(), input.size()));
+        CHECK(crypto.run(input.data(), input.size()));
+
+        // Runs again after the orders of the previous run are cancelled
+        CHECK(futures.run(input.data() + 4096, 4096));
+    }
+
+    SUBCASE("Difference is reported") {
+        auto *orderBook = new FuturesOrderBook(PriceIndexType::AVL, 0, 1);
+        BookFuzzer<FuturesOrderBook> futures(orderBook, 0, 1);
+        CHECK(futures.run(input.data(), 400));
+        orderBook->addOrder(2000, 1, true);
+        CHECK_FALSE(futures.compare());
+        CHECK(capturedOutput.str() == "Order book differs from reference at step 100: best price.\n");
+    }
+
+    // Restore the original std::cout buffer
+    std::cout.rdbuf(originalOutputBuffer);
+}
+
+TEST_CASE("BookWorker") {
+    SUBCASE("Place worker and its books on the node of its CPU") {
+        int cpu = Numa::getCurrentCpu();
+        BookWorker worker(cpu);
+        CHECK(worker.getCpu() == cpu);
+        CHECK(worker.getNode() == Numa::getNodeOfCpu(cpu));
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        int workerCpu = -1;
+        int arenaNode = -2;
+        int mappingNode = -2;
+        bool isFilled = false;
+        worker.start([&]() {
+            workerCpu = Numa::getCurrentCpu();
+            arenaNode = Arena::getNode();
+
+            // Mappings made on the worker are bound to its node
+            PageSize obtained;
+            auto *memory = static_cast<uint8_t *>(Arena::map(1 << 16, ArenaUse::OTHER, obtained));
+            memory[0] = 1;
+            mappingNode = Numa::getNodeOfAddress(memory);
+            Arena::unmap(memory, 1 << 16, ArenaUse::OTHER, obtained);
+
+            // Order books created on the worker match on it
+            auto *orderBook = new EquityOrderBook(PriceIndexType::AVL, 90, 0.01);
+            orderBook->addOrder(101, 10, true, 1000);
+            orderBook->addOrder(100, 10, false, 2000);
+            orderBook->executeOrder();
+            isFilled = orderBook->getSnapshot().volume == 10;
+            delete orderBook;
+        });
+        worker.join();
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(worker.getIsPinned());
+        CHECK(workerCpu == cpu);
+        CHECK(arenaNode == worker.getNode());
+        CHECK(mappingNode == worker.getNode());
+        CHECK(isFilled);
+        CHECK(Arena::getNode() == -1);
+        CHECK(capturedOutput.str() == "Worker on CPU " + std::to_string(cpu) + ": node " +
+                                      std::to_string(worker.getNode()) + ", pinned.\n");
+    }
+
+    SUBCASE("Workers running books of the same type have their own pools") {
+        int cpu = Numa::getCurrentCpu();
+        BookWorker workers[2] = {BookWorker(cpu), BookWorker(cpu)};
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        uint64_t volumes[2] = {};
+        uint32_t lastIndices[2] = {};
+        for (int i = 0; i < 2; i++) {
+            workers[i].start([&volumes, &lastIndices, i]() {
+                auto *orderBook = new EquityOrderBook(PriceIndexType::AVL, 90, 0.01);
+                for (int j = 0; j < 20000; j++) {
+                    orderBook->addOrder(100, 1, true, j + 1);
+                    auto sellOrder = orderBook->addOrder(100, 1, false, j + 1);
+                    lastIndices[i] = EquityOrderBook::Traits::OrderPool::indexOf(sellOrder);
+                    orderBook->executeOrder();
+                }
+                volumes[i] = orderBook->getSnapshot().volume;
+                delete orderBook;
+            });
+        }
+        for (BookWorker &worker : workers) {
+            worker.join();
+        }
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        // Filled orders return to the pool of their worker, which never reaches the slots of the other worker
+        CHECK(volumes[0] == 20000);
+        CHECK(volumes[1] == 20000);
+        CHECK(lastIndices[0] <= 2);
+        CHECK(lastIndices[1] <= 2);
+    }
+}
+
+TEST_CASE("PegBook") {
+    SUBCASE("Reprice groups with the inside") {
+        OrderBook *orderBook = new OrderBook();
+        PegBook<OrderBook::Traits> &pegBook = orderBook->getPegBook();
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        // Pegs without the price they follow have no price
+        Order *unpricedOrder = orderBook->addPeggedOrder(PegType::MID, 0, 5, false);
+        Order *buyOrder = orderBook->addOrder(100, 10, true);
+        Order *sellOrder = orderBook->addOrder(102, 10, false);
+        Order *peggedOrder1 = orderBook->addPeggedOrder(PegType::BEST_BID, -1, 10, true);
+        Order *peggedOrder2 = orderBook->addPeggedOrder(PegType::BEST_BID, -1, 20, true);
+        Order *peggedOrder3 = orderBook->addPeggedOrder(PegType::BEST_BID, 0, 30, true);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(unpricedOrder->getPrice() == 0);
+        CHECK(peggedOrder1->getPrice() == 99);
+        CHECK(peggedOrder3->getPrice() == 100);
+        CHECK(pegBook.getGroupCount() == 3);
+        CHECK(orderBook->findPeggedOrder(1) == peggedOrder1);
+        CHECK(orderBook->findOrder(1, true) == nullptr);
+        float price;
+        CHECK(pegBook.getPrice(PegType::MID, 0, price));
+        CHECK(price == 101);
+
+        // Groups follow the inside without their orders being re-added
+        pegBook.reprice(buyOrder, sellOrder);
+        CHECK(pegBook.getBest(true) == peggedOrder3);
+        CHECK(pegBook.getBest(false) == unpricedOrder);
+        CHECK(unpricedOrder->getPrice() == 101);
+        Order *newBuyOrder = new Order(9, 101.5f, 10, true, 0);
+        pegBook.reprice(newBuyOrder, sellOrder);
+        CHECK(pegBook.getBest(true) == peggedOrder3);
+        CHECK(peggedOrder3->getPrice() == 101.5f);
+        CHECK(pegBook.getBest(false)->getPrice() == 101.75f);
+        CHECK(peggedOrder1->getParentLimit()->getPrice() == 100.5f);
+        CHECK(peggedOrder1->getParentLimit()->getHeadOrder() == peggedOrder1);
+        CHECK(peggedOrder1->getParentLimit()->getTailOrder() == peggedOrder2);
+        CHECK(peggedOrder1->getParentLimit()->getTotalVolume() == 30);
+        pegBook.reprice(nullptr, sellOrder);
+        CHECK(pegBook.getBest(true) == nullptr);
+        CHECK(pegBook.getBest(false) == nullptr);
+        CHECK(!pegBook.getPrice(PegType::BEST_BID, 0, price));
+
+        CHECK(capturedOutput.str() == "Sell order added: 0 at 0\n"
+                                      "Buy order added: 0 at 100\n"
+                                      "Sell order added: 0 at 102\n"
+                                      "Buy order added: 1 at 99\n"
+                                      "Buy order added: 2 at 99\n"
+                                      "Buy order added: 3 at 100\n");
+    }
+
+    SUBCASE("Execute pegged orders") {
+        OrderBook *orderBook = new OrderBook();
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->addOrder(100, 10, true);
+        orderBook->addOrder(102, 10, false);
+        orderBook->addOrder(103, 10, false);
+        Order *midBuyOrder = orderBook->addPeggedOrder(PegType::MID, 0, 4, true);
+        CHECK(!orderBook->executeOrder());
+
+        // Pegged order crossing the other side trades at the displayed price, and follows it as it moves
+        Order *offerBuyOrder = orderBook->addPeggedOrder(PegType::BEST_OFFER, 0, 15, true);
+        CHECK(orderBook->executeOrder());
+        CHECK(orderBook->executeOrder());
+        CHECK(orderBook->findPeggedOrder(offerBuyOrder->getId()) == nullptr);
+
+        // Midpoint pegs cross each other
+        orderBook->addPeggedOrder(PegType::MID, 0, 10, false);
+        CHECK(orderBook->executeOrder());
+        CHECK(orderBook->findPeggedOrder(midBuyOrder->getId()) == nullptr);
+
+        // Displayed orders keep priority over pegged orders at the same price
+        Order *bidBuyOrder = orderBook->addPeggedOrder(PegType::BEST_BID, 0, 10, true);
+        orderBook->addOrder(100, 3, false);
+        CHECK(orderBook->executeOrder());
+        CHECK(bidBuyOrder->getQuantity() == 10);
+        CHECK(!orderBook->executeOrder());
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(orderBook->getSnapshot().volume == 22);
+        CHECK(capturedOutput.str() == "Buy order added: 0 at 100\n"
+                                      "Sell order added: 0 at 102\n"
+                                      "Sell order added: 1 at 103\n"
+                                      "Buy order added: 0 at 101\n"
+                                      "There are no orders to execute.\n"
+                                      "Buy order added: 1 at 102\n"
+                                      "Executed partial buy order at 102 and sell order at102\n"
+                                      "Traded 10 at 102\n"
+                                      "Executed buy order at 103 and partial sell order at103\n"
+                                      "Traded 5 at 103\n"
+                                      "Sell order added: 2 at 101.5\n"
+                                      "Executed buy order at 101.5 and partial sell order at101.5\n"
+                                      "Traded 4 at 101.5\n"
+                                      "Buy order added: 3 at 100\n"
+                                      "Sell order added: 2 at 100\n"
+                                      "Executed partial buy order at 100 and sell order at100\n"
+                                      "Traded 3 at 100\n"
+                                      "There are no orders to execute.\n");
+    }
+
+    SUBCASE("Prevent self-trades with pegged orders") {
+        OrderBook *orderBook = new OrderBook();
+        orderBook->setSelfTradePrevention(SelfTradePrevention::CANCEL_NEWEST);
+        orderBook->getRiskGate().setLimits(1, RiskLimits<int32_t>());
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->addOrder(100, 10, false, 0, 1);
+        Order *peggedOrder = orderBook->addPeggedOrder(PegType::BEST_OFFER, 0, 10, true, 0, 1);
+        CHECK(orderBook->getRiskGate().getOpenOrders(1) == 2);
+        CHECK(!orderBook->executeOrder());
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(orderBook->findPeggedOrder(peggedOrder->getId()) == nullptr);
+        CHECK(orderBook->getRiskGate().getOpenOrders(1) == 1);
+        CHECK(capturedOutput.str() == "Sell order added: 0 at 100\n"
+                                      "Buy order added: 0 at 100\n"
+                                      "Buy order cancelled: 0 at 100\n"
+                                      "There are no orders to execute.\n");
+    }
+}
+
+TEST_CASE("HalfBook") {
+    SUBCASE("Compare prices by side") {
+        static_assert(HalfBook<Side::Bid, OrderBook::Traits>::isBetter(101, 100), "Higher bid is better");
+        static_assert(HalfBook<Side::Ask, OrderBook::Traits>::isBetter(100, 101), "Lower ask is better");
+        CHECK(!HalfBook<Side::Bid, OrderBook::Traits>::isBetter(100, 100));
+        CHECK(!HalfBook<Side::Ask, OrderBook::Traits>::isBetter(100, 100));
+    }
+
+    SUBCASE("Track best order") {
+        OrderBook *orderBook = new OrderBook();
+        auto *asks = new HalfBook<Side::Ask, OrderBook::Traits>(new BTreePriceIndex<OrderBook::Traits>(false), orderBook);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        Order *sellOrder1 = asks->addOrder(110, 10, 0, 0);
+        Order *sellOrder2 = asks->addOrder(100, 10, 0, 1);
+        asks->addOrder(100, 10, 0, 2);
+        CHECK(asks->getBest() == sellOrder2);
+        asks->cancelOrder(sellOrder2);
+        CHECK(asks->getBest()->getPrice() == 100);
+        asks->removeExecutedOrder(asks->getBest());
+        CHECK(asks->getBest() == sellOrder1);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(capturedOutput.str() == "Sell order added: 0 at 110\n"
+                                      "Sell order added: 1 at 100\n"
+                                      "Sell order added: 2 at 100\n"
+                                      "Sell order cancelled: 1 at 100\n");
+    }
+
+    SUBCASE("Defer best order") {
+        FuturesOrderBook *orderBook = new FuturesOrderBook(PriceIndexType::AVL, 0);
+        auto *bids = new HalfBook<Side::Bid, FuturesOrderBook::Traits>(
+                new TickLadderPriceIndex<FuturesOrderBook::Traits>(0, 1, true), orderBook);
+        FuturesOrderBook::Order *buyOrder1 = bids->addOrder(100, 10, 0, 0);
+        FuturesOrderBook::Order *buyOrder2 = bids->addOrder(105, 10, 0, 1);
+        FuturesOrderBook::Order *buyOrder3 = bids->addOrder(110, 10, 0, 2);
+        bids->setBestDeferred(true);
+
+        // Best limit empties, next best is found when the deferral ends
+        bids->cancelOrder(buyOrder3);
+        CHECK(bids->getBest() == nullptr);
+        bids->addOrder(90, 10, 0, 3);
+        CHECK(bids->getBest() == nullptr);
+        bids->setBestDeferred(false);
+        CHECK(bids->getBest() == buyOrder2);
+        CHECK(bids->validate() == nullptr);
+
+        // Order at or better than the stale limit is the best order
+        bids->setBestDeferred(true);
+        bids->removeExecutedOrder(buyOrder2);
+        FuturesOrderBook::Order *buyOrder4 = bids->addOrder(105, 10, 0, 4);
+        CHECK(bids->getBest() == buyOrder4);
+        bids->cancelOrder(buyOrder4);
+        bids->cancelOrder(buyOrder1);
+        bids->setBestDeferred(false);
+        CHECK(bids->getBest()->getPrice() == 90);
+        CHECK(bids->validate() == nullptr);
     }
 }
 
@@ -244,16 +1900,16 @@ TEST_CASE("OrderBook") {
 
     SUBCASE("Cancel order") {
         OrderBook *orderBook = new OrderBook();
-        Order *buyOrder1 = orderBook->addOrder(100, 10, true);
+        OrderHandle buyOrder1 = orderBook->addOrder(100, 10, true);
         orderBook->addOrder(200, 10, true);
         orderBook->addOrder(300, 10, true);
-        Order *buyOrder4 = orderBook->addOrder(400, 10, true);
+        OrderHandle buyOrder4 = orderBook->addOrder(400, 10, true);
         orderBook->addOrder(500, 10, true);
         orderBook->addOrder(1000, 10, false);
-        Order *sellOrder2 = orderBook->addOrder(900, 10, false);
+        OrderHandle sellOrder2 = orderBook->addOrder(900, 10, false);
         orderBook->addOrder(800, 10, false);
         orderBook->addOrder(700, 10, false);
-        Order *sellOrder5 = orderBook->addOrder(600, 10, false);
+        OrderHandle sellOrder5 = orderBook->addOrder(600, 10, false);
 
         // Bfs to check size of buy tree
         int totalBuySize = 0;
@@ -411,7 +2067,7 @@ TEST_CASE("OrderBook") {
 
         // Check the captured output against the expected output
         CHECK(output == "Executed buy order at 500 and sell order at 400\n"
-                        "Profit: 1000\n");
+                        "Traded 10 at 500\n");
 
         // Bfs to check size of buy tree
         totalBuySize = 0;
@@ -499,4 +2155,685 @@ TEST_CASE("OrderBook") {
         // Check the captured output against the expected output
         CHECK(output == "120\n");
     }
-}
\ No newline at end of file
+    SUBCASE("Best bid after cancelling several inside limits") {
+        OrderBook *orderBook = new OrderBook();
+        orderBook->addOrder(100, 10, true);
+        orderBook->addOrder(200, 10, true);
+        OrderHandle buyOrder3 = orderBook->addOrder(300, 10, true);
+        OrderHandle buyOrder4 = orderBook->addOrder(400, 10, true);
+        OrderHandle buyOrder5 = orderBook->addOrder(500, 10, true);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->cancelOrder(buyOrder5);
+        orderBook->cancelOrder(buyOrder4);
+        orderBook->cancelOrder(buyOrder3);
+        orderBook->getBestBid();
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        // Next inside limit is found through empty limits that are not its parent or child
+        CHECK(capturedOutput.str() == "Buy order cancelled: 4 at 500\n"
+                                      "Buy order cancelled: 3 at 400\n"
+                                      "Buy order cancelled: 2 at 300\n"
+                                      "200\n");
+    }
+
+    SUBCASE("Modify order") {
+        OrderBook *orderBook = new OrderBook();
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        OrderHandle buyOrder1 = orderBook->addOrder(100, 10, true, 0, 7);
+        OrderHandle buyOrder2 = orderBook->addOrder(100, 10, true);
+        OrderHandle decreasedOrder = orderBook->modifyOrder(buyOrder1, 100, 4);
+        OrderHandle increasedOrder = orderBook->modifyOrder(buyOrder2, 100, 20);
+        OrderHandle movedOrder = orderBook->modifyOrder(decreasedOrder, 101, 4);
+        OrderHandle zeroOrder = orderBook->modifyOrder(increasedOrder, 100, 0);
+        OrderHandle cancelledOrder = orderBook->modifyOrder(buyOrder2, 100, 5);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        // Decrease keeps the order and its priority, other changes replace it with the same owner
+        CHECK(decreasedOrder == buyOrder1);
+        CHECK(increasedOrder->getId() == 2);
+        CHECK(increasedOrder->getQuantity() == 20);
+        CHECK(movedOrder->getId() == 3);
+        CHECK(movedOrder->getPrice() == 101);
+        CHECK(movedOrder->getQuantity() == 4);
+        CHECK(movedOrder->getOwner() == 7);
+        CHECK(zeroOrder == nullptr);
+
+        // The replacing order reuses the slot of the order it replaced, which the old handle no longer reaches
+        CHECK(increasedOrder == buyOrder2);
+        CHECK(!buyOrder2.isLive());
+        CHECK(cancelledOrder == nullptr);
+        CHECK(increasedOrder->getParentLimit()->getHeadOrder() == increasedOrder);
+        CHECK(increasedOrder->getParentLimit()->getTotalVolume() == 20);
+        CHECK(orderBook->validate());
+        CHECK(capturedOutput.str() == "Buy order added: 0 at 100\n"
+                                      "Buy order added: 1 at 100\n"
+                                      "Buy order cancelled: 1 at 100\n"
+                                      "Buy order added: 2 at 100\n"
+                                      "Buy order cancelled: 0 at 100\n"
+                                      "Buy order added: 3 at 101\n"
+                                      "Quantity is not positive.\n"
+                                      "Order does not exist.\n");
+    }
+
+    SUBCASE("Cancelled and executed orders return to the order pool") {
+        OrderBook *orderBook = new OrderBook();
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        OrderHandle firstOrder = orderBook->addOrder(100, 10, true);
+        orderBook->cancelOrder(firstOrder);
+        for (int i = 0; i < 100000; i++) {
+            orderBook->cancelOrder(orderBook->addOrder(100, 10, true));
+        }
+        Order *reusedOrder = orderBook->addOrder(100, 10, true);
+        int reusedId = reusedOrder->getId();
+        Order *sellOrder = orderBook->addOrder(100, 4, false);
+        orderBook->executeOrder();
+        int partialQuantity = reusedOrder->getQuantity();
+        Order *nextSellOrder = orderBook->addOrder(100, 6, false);
+        orderBook->executeOrder();
+        Order *lastSellOrder = orderBook->addOrder(101, 1, false);
+        Order *lastBuyOrder = orderBook->addOrder(99, 1, true);
+
+        // Handles to orders that left the order book reach neither the order now in their slot nor a free slot
+        orderBook->cancelOrder(firstOrder);
+        OrderHandle peggedOrder = orderBook->addPeggedOrder(PegType::BEST_BID, 0, 5, true);
+        orderBook->cancelPeggedOrder(peggedOrder);
+        OrderHandle nextPeggedOrder = orderBook->addPeggedOrder(PegType::BEST_BID, 0, 5, true);
+        orderBook->cancelPeggedOrder(peggedOrder);
+        orderBook->cancelOrder(peggedOrder);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        // Add and cancel pairs keep reusing one slot, fully executed orders are reused once the listener has run
+        CHECK(reusedOrder == firstOrder);
+        CHECK(reusedId == 100001);
+        CHECK(partialQuantity == 6);
+        CHECK(nextSellOrder == sellOrder);
+        CHECK(lastSellOrder == sellOrder);
+        CHECK(lastBuyOrder == firstOrder);
+        CHECK(orderBook->findOrder(100001, true) == nullptr);
+        CHECK(orderBook->findOrder(100002, true) == lastBuyOrder);
+        CHECK(nextPeggedOrder == peggedOrder);
+        CHECK(orderBook->findPeggedOrder(1) == nextPeggedOrder);
+        CHECK(orderBook->getSnapshot().volume == 10);
+        CHECK(orderBook->validate());
+        std::string output = capturedOutput.str();
+        CHECK(output.find("Buy order cancelled: 100002") == std::string::npos);
+        CHECK(output.substr(output.find("Sell order added: 2 at 101")) == "Sell order added: 2 at 101\n"
+                                                                          "Buy order added: 100002 at 99\n"
+                                                                          "Order does not exist.\n"
+                                                                          "Buy order added: 0 at 99\n"
+                                                                          "Buy order cancelled: 0 at 99\n"
+                                                                          "Buy order added: 1 at 99\n"
+                                                                          "Order does not exist.\n"
+                                                                          "Order does not exist.\n");
+    }
+
+    SUBCASE("Timestamps and sequence numbers") {
+        OrderBook *orderBook = new OrderBook(PriceIndexType::TICK_LADDER, 100, 0.01f);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        Order *buyOrder = orderBook->addOrder(101, 10, true, 1700000000123456789ull);
+        Order *invalidOrder = orderBook->addOrder(100.005f, 10, true, 1700000000123456790ull);
+        Order *sellOrder = orderBook->addOrder(102, 10, false, 1700000000123456791ull);
+        Order *localOrder = orderBook->addOrder(101, 10, true);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        // Sequence numbers are shared by both sides and skip rejected orders
+        CHECK(invalidOrder == nullptr);
+        CHECK(buyOrder->getTime() == 1700000000123456789ull);
+        CHECK(buyOrder->getSequence() == 0);
+        CHECK(sellOrder->getTime() == 1700000000123456791ull);
+        CHECK(sellOrder->getSequence() == 1);
+        CHECK(localOrder->getSequence() == 2);
+        CHECK(localOrder->getTime() > 1700000000123456791ull);
+    }
+
+    SUBCASE("Self-trade prevention") {
+        OrderBook *orderBook = new OrderBook();
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        SUBCASE("Orders of different owners match") {
+            orderBook->setSelfTradePrevention(SelfTradePrevention::CANCEL_BOTH);
+            orderBook->addOrder(101, 10, true, 0, 1);
+            orderBook->addOrder(100, 10, false, 0, 2);
+            orderBook->addOrder(101, 10, true, 0, 0);
+            orderBook->addOrder(100, 10, false, 0, 0);
+            orderBook->executeOrder();
+            orderBook->executeOrder();
+            std::cout.rdbuf(originalOutputBuffer);
+            CHECK(capturedOutput.str().find("cancelled") == std::string::npos);
+            CHECK(orderBook->getBuyTree()->getSize() == 0);
+        }
+
+        SUBCASE("Orders of the same owner match without prevention") {
+            orderBook->addOrder(101, 10, true, 0, 1);
+            orderBook->addOrder(100, 10, false, 0, 1);
+            orderBook->executeOrder();
+            std::cout.rdbuf(originalOutputBuffer);
+            CHECK(capturedOutput.str().find("Executed buy order at 101 and sell order at 100") != std::string::npos);
+        }
+
+        SUBCASE("Cancel newest") {
+            orderBook->setSelfTradePrevention(SelfTradePrevention::CANCEL_NEWEST);
+            Order *buyOrder = orderBook->addOrder(101, 10, true, 0, 1);
+            orderBook->addOrder(100, 10, false, 0, 1);
+            orderBook->addOrder(101, 4, false, 0, 2);
+            orderBook->executeOrder();
+            std::cout.rdbuf(originalOutputBuffer);
+            CHECK(capturedOutput.str().find("Sell order cancelled: 0 at 100") != std::string::npos);
+            CHECK(capturedOutput.str().find("Executed partial buy order at 101") != std::string::npos);
+            CHECK(buyOrder->getQuantity() == 6);
+        }
+
+        SUBCASE("Cancel oldest") {
+            orderBook->setSelfTradePrevention(SelfTradePrevention::CANCEL_OLDEST);
+            orderBook->addOrder(101, 10, true, 0, 1);
+            orderBook->addOrder(100, 10, false, 0, 1);
+            orderBook->executeOrder();
+            std::cout.rdbuf(originalOutputBuffer);
+            CHECK(capturedOutput.str().find("Buy order cancelled: 0 at 101") != std::string::npos);
+            CHECK(capturedOutput.str().find("There are no orders to execute.") != std::string::npos);
+            CHECK(orderBook->getBuyTree()->getSize() == 0);
+            CHECK(orderBook->getSellTree()->getSize() == 1);
+        }
+
+        SUBCASE("Cancel both") {
+            orderBook->setSelfTradePrevention(SelfTradePrevention::CANCEL_BOTH);
+            orderBook->addOrder(101, 10, true, 0, 1);
+            orderBook->addOrder(100, 5, false, 0, 1);
+            orderBook->executeOrder();
+            std::cout.rdbuf(originalOutputBuffer);
+            CHECK(capturedOutput.str().find("Buy order cancelled: 0 at 101") != std::string::npos);
+            CHECK(capturedOutput.str().find("Sell order cancelled: 0 at 100") != std::string::npos);
+            CHECK(orderBook->getBuyTree()->getSize() == 0);
+            CHECK(orderBook->getSellTree()->getSize() == 0);
+        }
+
+        SUBCASE("Decrement and cancel") {
+            orderBook->setSelfTradePrevention(SelfTradePrevention::DECREMENT_AND_CANCEL);
+            Order *buyOrder = orderBook->addOrder(101, 10, true, 0, 1);
+            orderBook->addOrder(100, 4, false, 0, 1);
+            orderBook->addOrder(100.5f, 3, false, 0, 1);
+            orderBook->executeOrder();
+            std::cout.rdbuf(originalOutputBuffer);
+
+            // Buy order is decreased by each smaller sell order until no sell orders are left
+            CHECK(capturedOutput.str().find("Sell order cancelled: 0 at 100") != std::string::npos);
+            CHECK(capturedOutput.str().find("Sell order cancelled: 1 at 100.5") != std::string::npos);
+            CHECK(capturedOutput.str().find("There are no orders to execute.") != std::string::npos);
+            CHECK(buyOrder->getQuantity() == 3);
+            CHECK(buyOrder->getParentLimit()->getTotalVolume() == 3);
+        }
+
+        std::cout.rdbuf(originalOutputBuffer);
+    }
+
+    SUBCASE("Call auction") {
+        OrderBook *orderBook = new OrderBook();
+        orderBook->startAuction();
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        SUBCASE("Equilibrium price maximises volume") {
+            orderBook->addOrder(102, 10, true);
+            orderBook->addOrder(101, 20, true);
+            Order *restingBuy = orderBook->addOrder(100, 10, true);
+            orderBook->addOrder(99, 15, false);
+            orderBook->addOrder(100, 10, false);
+            Order *partialSell = orderBook->addOrder(101, 10, false);
+            orderBook->addOrder(103, 5, false);
+            orderBook->executeOrder();
+            orderBook->uncross();
+            orderBook->getBestBid();
+            std::cout.rdbuf(originalOutputBuffer);
+
+            // Demand and supply at 99, 100, 101 and 102 are 40/15, 40/25, 30/35 and 10/35
+            CHECK(capturedOutput.str().find("Order book is in an auction.") != std::string::npos);
+            CHECK(capturedOutput.str().find("Uncrossed 30 at 101") != std::string::npos);
+            CHECK(restingBuy->getQuantity() == 10);
+            CHECK(partialSell->getQuantity() == 5);
+            CHECK(capturedOutput.str().find("Uncrossed 30 at 101\n100\n") != std::string::npos);
+        }
+
+        SUBCASE("Buy pressure takes the highest price") {
+            orderBook->addOrder(101, 20, true);
+            orderBook->addOrder(100, 10, false);
+            orderBook->uncross();
+            std::cout.rdbuf(originalOutputBuffer);
+            CHECK(capturedOutput.str().find("Uncrossed 10 at 101") != std::string::npos);
+        }
+
+        SUBCASE("Sell pressure takes the lowest price") {
+            orderBook->addOrder(101, 10, true);
+            orderBook->addOrder(100, 20, false);
+            orderBook->uncross();
+            std::cout.rdbuf(originalOutputBuffer);
+            CHECK(capturedOutput.str().find("Uncrossed 10 at 100") != std::string::npos);
+        }
+
+        SUBCASE("Balanced auction takes the price closest to the reference") {
+            orderBook->setReferencePrice(100.75f);
+            orderBook->addOrder(101, 10, true);
+            orderBook->addOrder(100, 10, false);
+            orderBook->uncross();
+            std::cout.rdbuf(originalOutputBuffer);
+            CHECK(capturedOutput.str().find("Uncrossed 10 at 101") != std::string::npos);
+        }
+
+        SUBCASE("Uncrossed book matches again") {
+            orderBook->addOrder(99, 10, true);
+            orderBook->addOrder(100, 10, false);
+            orderBook->uncross();
+            orderBook->addOrder(100, 10, true);
+            orderBook->executeOrder();
+            std::cout.rdbuf(originalOutputBuffer);
+            CHECK(capturedOutput.str().find("There are no orders to uncross.") != std::string::npos);
+            CHECK(capturedOutput.str().find("Executed buy order at 100 and sell order at 100") != std::string::npos);
+        }
+
+        std::cout.rdbuf(originalOutputBuffer);
+    }
+
+    SUBCASE("Build from sorted orders") {
+        OrderBook *orderBook = new OrderBook();
+        std::vector<Order *> sortedOrders;
+        sortedOrders.push_back(new Order(0, 100, 10, true, 0));
+        sortedOrders.push_back(new Order(1, 100, 20, true, 0));
+        sortedOrders.push_back(new Order(2, 200, 10, true, 0));
+        sortedOrders.push_back(new Order(3, 300, 10, true, 0));
+        sortedOrders.push_back(new Order(7, 400, 10, true, 0));
+        sortedOrders.push_back(new Order(0, 500, 10, false, 0));
+        sortedOrders.push_back(new Order(1, 600, 10, false, 0));
+        sortedOrders.push_back(new Order(2, 600, 10, false, 0));
+        orderBook->buildFrom(sortedOrders);
+
+        // Buy tree is perfectly balanced
+        Limit *buyTree = orderBook->getBuyTree();
+        CHECK(buyTree->getPrice() == 300);
+        CHECK(buyTree->getHeight() == 2);
+        CHECK(buyTree->getLeftChild()->getPrice() == 200);
+        CHECK(buyTree->getLeftChild()->getLeftChild()->getPrice() == 100);
+        CHECK(buyTree->getLeftChild()->getLeftChild()->getParent() == buyTree->getLeftChild());
+        CHECK(buyTree->getRightChild()->getPrice() == 400);
+
+        // Orders are queued in time priority
+        Limit *limit = buyTree->getLeftChild()->getLeftChild();
+        CHECK(limit->getSize() == 2);
+        CHECK(limit->getTotalVolume() == 30);
+        CHECK(limit->getHeadOrder() == sortedOrders[0]);
+        CHECK(limit->getTailOrder() == sortedOrders[1]);
+
+        Limit *sellTree = orderBook->getSellTree();
+        CHECK(sellTree->getPrice() == 600);
+        CHECK(sellTree->getSize() == 2);
+        CHECK(sellTree->getLeftChild()->getPrice() == 500);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->getBestBid();
+        Order *newOrder = orderBook->addOrder(350, 10, true);
+        orderBook->buildFrom(sortedOrders);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        // New orders continue after the highest id and books can only be built when empty
+        CHECK(newOrder->getId() == 8);
+        CHECK(capturedOutput.str() == "400\n"
+                                      "Buy order added: 8 at 350\n"
+                                      "Order book is not empty.\n");
+    }
+
+    SUBCASE("Build a B+-tree with a short last inner node") {
+        // 157 levels fill 14 leaves, one more than an inner node is built with
+        for (int levelCount : {157, 160, 168, 169, 2000}) {
+            OrderBook *orderBook = new OrderBook(PriceIndexType::BTREE);
+            std::vector<Order *> sortedOrders;
+            for (int i = 0; i < levelCount; i++) {
+                sortedOrders.push_back(new Order(i, 100 + i, 10, true, 0));
+            }
+
+            // Redirect std::cout to a stringstream
+            std::stringstream capturedOutput;
+            std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+            std::cout.rdbuf(capturedOutput.rdbuf());
+
+            orderBook->buildFrom(sortedOrders);
+
+            // Restore the original std::cout buffer
+            std::cout.rdbuf(originalOutputBuffer);
+
+            CHECK(orderBook->validate());
+            CHECK(orderBook->findOrder(levelCount - 1, true)->getPrice() == 100 + levelCount - 1);
+            CHECK(orderBook->getSnapshot().bestBid == 100 + levelCount - 1);
+            std::vector<Order *> liveOrders;
+            orderBook->getOrders(liveOrders);
+            CHECK(liveOrders.size() == static_cast<size_t>(levelCount));
+        }
+    }
+
+    SUBCASE("Build from unsorted orders") {
+        OrderBook *orderBook = new OrderBook();
+        std::vector<Order *> unsortedOrders;
+        unsortedOrders.push_back(new Order(0, 200, 10, true, 0));
+        unsortedOrders.push_back(new Order(1, 100, 10, true, 0));
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->buildFrom(unsortedOrders);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(capturedOutput.str() == "Orders are not sorted by price.\n");
+        CHECK(orderBook->getBuyTree() == nullptr);
+    }
+
+    SUBCASE("Build from orders with a duplicated id") {
+        OrderBook *orderBook = new OrderBook();
+        std::vector<Order *> duplicatedOrders;
+        duplicatedOrders.push_back(new Order(0, 100, 10, true, 0));
+        duplicatedOrders.push_back(new Order(0, 101, 10, false, 0));
+        duplicatedOrders.push_back(new Order(1, 102, 10, false, 0));
+        duplicatedOrders.push_back(new Order(0, 200, 10, true, 0));
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->buildFrom(duplicatedOrders);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(capturedOutput.str() == "Order id is duplicated.\n");
+        CHECK(orderBook->getBuyTree() == nullptr);
+        CHECK(orderBook->getSellTree() == nullptr);
+
+        // The same id on both sides is not a duplicate
+        duplicatedOrders.pop_back();
+        orderBook->buildFrom(duplicatedOrders);
+        std::vector<Order *> liveOrders;
+        orderBook->getOrders(liveOrders);
+        CHECK(liveOrders.size() == 3);
+    }
+}
+TEST_CASE("BasicOrderBook") {
+    SUBCASE("Preset representations") {
+        static_assert(sizeof(EquityOrderBook::Order) == 32, "Equity order record fits in 32 bytes");
+        static_assert(sizeof(FuturesOrderBook::Order) == 32, "Futures order record fits in 32 bytes");
+        static_assert(sizeof(CryptoOrderBook::Limit) == 32, "Crypto limit record fits in 32 bytes");
+        static_assert(std::is_same<EquityOrderBook::PriceIndex, TickLadderPriceIndex<EquityOrderBook::Traits>>::value,
+                      "Equity book uses the tick ladder directly");
+        static_assert(std::is_same<CryptoOrderBook::PriceIndex, BTreePriceIndex<CryptoOrderBook::Traits>>::value,
+                      "Crypto book uses the B+-tree directly");
+        static_assert(std::is_same<CryptoOrderBook::Quantity, int64_t>::value, "Crypto book has 64-bit quantities");
+    }
+
+    SUBCASE("Equity order book") {
+        EquityOrderBook *orderBook = new EquityOrderBook(PriceIndexType::AVL, 100, 0.01);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        EquityOrderBook::OrderHandle buyOrder = orderBook->addOrder(100.02f, 10, true);
+        orderBook->addOrder(100.01f, 10, true);
+        orderBook->addOrder(100.02f, 5, false);
+        EquityOrderBook::Order *invalidOrder = orderBook->addOrder(100.005f, 10, true);
+        orderBook->executeOrder();
+        orderBook->getBestBid();
+        orderBook->cancelOrder(buyOrder);
+        orderBook->getBestBid();
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        // Events are not printed, only queries
+        CHECK(invalidOrder == nullptr);
+        CHECK(capturedOutput.str() == "100.02\n"
+                                      "100.01\n");
+    }
+
+    SUBCASE("Futures order book") {
+        FuturesOrderBook *orderBook = new FuturesOrderBook(PriceIndexType::AVL, 400000);
+        orderBook->addOrder(412350, 3, true);
+        orderBook->addOrder(412340, 2, true);
+        FuturesOrderBook::Order *sellOrder = orderBook->addOrder(412360, 4, false);
+        CHECK(orderBook->addOrder(399999, 1, true) == nullptr);
+        CHECK(sellOrder->getPrice() == 412360);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->addOrder(412350, 4, false);
+        orderBook->executeOrder();
+        orderBook->executeOrder();
+        orderBook->getBestBid();
+        orderBook->getVolumeAtLimitPrice(412350, false);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(capturedOutput.str() == "412340\n"
+                                      "1\n");
+    }
+
+    SUBCASE("Crypto order book") {
+        CryptoOrderBook *orderBook = new CryptoOrderBook();
+        orderBook->addOrder(64999.875, 5000000000LL, true);
+        orderBook->addOrder(64999.875, 4000000000LL, true);
+        orderBook->addOrder(0.000125, 1, true);
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->getVolumeAtLimitPrice(64999.875, true);
+        orderBook->addOrder(64999.875, 6000000000LL, false);
+        orderBook->executeOrder();
+        orderBook->getVolumeAtLimitPrice(64999.875, true);
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(capturedOutput.str() == "9000000000\n"
+                                      "4000000000\n");
+    }
+
+    SUBCASE("Uncross on each price index") {
+        FuturesOrderBook *futuresBook = new FuturesOrderBook(PriceIndexType::AVL, 400000);
+        futuresBook->startAuction();
+        FuturesOrderBook::Order *futuresBuy = futuresBook->addOrder(412360, 10, true);
+        futuresBook->addOrder(412340, 5, true);
+        FuturesOrderBook::Order *futuresSell = futuresBook->addOrder(412300, 4, false);
+        futuresBook->addOrder(412350, 4, false);
+        futuresBook->uncross();
+        CHECK(futuresBuy->getQuantity() == 2);
+        CHECK(futuresSell->getParentLimit()->getTotalVolume() == 0);
+
+        CryptoOrderBook *cryptoBook = new CryptoOrderBook();
+        cryptoBook->startAuction();
+        CryptoOrderBook::Order *cryptoBuy = cryptoBook->addOrder(65000.5, 3000000000LL, true);
+        cryptoBook->addOrder(64000, 1, true);
+        cryptoBook->addOrder(64999.5, 1000000000LL, false);
+        CryptoOrderBook::Order *cryptoSell = cryptoBook->addOrder(65000, 5000000000LL, false);
+        cryptoBook->uncross();
+        CHECK(cryptoBuy->getParentLimit()->getTotalVolume() == 0);
+        CHECK(cryptoSell->getQuantity() == 3000000000LL);
+    }
+
+    SUBCASE("Apply batch matches single operations") {
+        using Message = FuturesOrderBook::Message;
+        for (PriceIndexType type : {PriceIndexType::AVL, PriceIndexType::BTREE, PriceIndexType::TICK_LADDER}) {
+            FuturesOrderBook *batchBook = new FuturesOrderBook(type, 0);
+            FuturesOrderBook *singleBook = new FuturesOrderBook(type, 0);
+            std::mt19937 engine(type == PriceIndexType::AVL ? 1 : 2);
+            std::vector<int> buyIds;
+            std::vector<int> sellIds;
+            for (int round = 0; round < 20; round++) {
+                std::vector<Message> messages;
+                for (int i = 0; i < 100; i++) {
+                    Message message = {BatchType::ADD, engine() % 2 == 0, 0, 0,
+                                       static_cast<int64_t>(1000 + engine() % 20), 1 + static_cast<int>(engine() % 9),
+                                       0};
+                    std::vector<int> &ids = message.isBuy ? buyIds : sellIds;
+                    uint32_t kind = engine() % 10;
+                    if (kind < 3 && !ids.empty()) {
+                        message.type = BatchType::CANCEL;
+                        message.orderId = ids[engine() % ids.size()];
+                    } else if (kind < 5 && !ids.empty()) {
+                        message.type = BatchType::MODIFY;
+                        message.orderId = ids[engine() % ids.size()];
+                    } else if (kind < 6) {
+                        message.type = BatchType::EXECUTE;
+                    }
+                    messages.push_back(message);
+                }
+                std::vector<BatchResult> results(messages.size());
+                batchBook->applyBatch(messages.data(), messages.size(), results.data());
+
+                for (size_t i = 0; i < messages.size(); i++) {
+                    const Message &message = messages[i];
+                    FuturesOrderBook::OrderHandle order = nullptr;
+                    uint32_t executedCount = 0;
+                    if (message.type == BatchType::ADD) {
+                        order = singleBook->addOrder(message.price, message.quantity, message.isBuy);
+                        (message.isBuy ? buyIds : sellIds).push_back(order->getId());
+                    } else if (message.type == BatchType::EXECUTE) {
+                        while (singleBook->executeOrder()) {
+                            executedCount++;
+                        }
+                        CHECK(results[i].executedCount == executedCount);
+                        continue;
+                    } else {
+                        order = FuturesOrderBook::OrderHandle(singleBook->findOrder(message.orderId, message.isBuy));
+                        if (order != nullptr && message.type == BatchType::CANCEL) {
+                            singleBook->cancelOrder(order);
+                        } else if (order != nullptr) {
+                            order = singleBook->modifyOrder(order, message.price, message.quantity);
+                            (message.isBuy ? buyIds : sellIds).push_back(order->getId());
+                        }
+                    }
+                    CHECK(results[i].isApplied == (order != nullptr));
+                    CHECK(results[i].orderId == (order == nullptr ? -1 : order->getId()));
+                }
+
+                MarketSnapshot<int64_t, int32_t> batchSnapshot = batchBook->getSnapshot();
+                MarketSnapshot<int64_t, int32_t> singleSnapshot = singleBook->getSnapshot();
+                CHECK(batchSnapshot.bestBid == singleSnapshot.bestBid);
+                CHECK(batchSnapshot.bestBidVolume == singleSnapshot.bestBidVolume);
+                CHECK(batchSnapshot.bestAsk == singleSnapshot.bestAsk);
+                CHECK(batchSnapshot.bestAskVolume == singleSnapshot.bestAskVolume);
+                CHECK(batchSnapshot.volume == singleSnapshot.volume);
+                CHECK(batchBook->validate());
+            }
+        }
+    }
+
+    SUBCASE("Prefetch orders and levels") {
+        FuturesOrderBook *futuresBook = new FuturesOrderBook(PriceIndexType::TICK_LADDER, 400000);
+        FuturesOrderBook::Order *buyOrder = futuresBook->addOrder(412000, 10, true);
+        futuresBook->prefetchOrder(buyOrder->getId(), true);
+        futuresBook->prefetchOrder(1000, false);
+        futuresBook->prefetchLevel(412000, true);
+        futuresBook->prefetchLevel(300000, false);
+        CHECK(futuresBook->findOrder(buyOrder->getId(), true) == buyOrder);
+        CHECK(futuresBook->findOrder(1000, false) == nullptr);
+
+        // Stages of the pipeline find the order, then prefetch its queue
+        auto *bids = new HalfBook<Side::Bid, FuturesOrderBook::Traits>(
+                new TickLadderPriceIndex<FuturesOrderBook::Traits>(400000, 1, true), futuresBook);
+        FuturesOrderBook::Order *order = bids->addOrder(412000, 10, 0, 0);
+        uint32_t orderIndex = bids->prefetchOrderRecord(order->getId());
+        CHECK(FuturesOrderBook::Traits::OrderPool::get(orderIndex) == order);
+        CHECK(bids->prefetchOrderRecord(1000) == 0);
+        bids->prefetchQueue(orderIndex);
+        bids->prefetchQueue(0);
+    }
+
+    SUBCASE("Validate invariants") {
+        FuturesOrderBook *futuresBook = new FuturesOrderBook(PriceIndexType::AVL, 400000);
+        CryptoOrderBook *cryptoBook = new CryptoOrderBook();
+        for (int i = 0; i < 100; i++) {
+            futuresBook->addOrder(412000 + i % 40, 1 + i % 7, i % 2 == 0);
+            cryptoBook->addOrder(64000 + (i % 40) * 0.5, 1 + i % 7, i % 2 == 0);
+            futuresBook->executeOrder();
+            cryptoBook->executeOrder();
+        }
+        CHECK(futuresBook->validate());
+        CHECK(cryptoBook->validate());
+
+        OrderBook *orderBook = new OrderBook();
+
+        // Redirect std::cout to a stringstream
+        std::stringstream capturedOutput;
+        std::streambuf* originalOutputBuffer = std::cout.rdbuf();
+        std::cout.rdbuf(capturedOutput.rdbuf());
+
+        orderBook->addOrder(100, 10, true);
+        Order *buyOrder = orderBook->addOrder(90, 10, true);
+        orderBook->addOrder(80, 10, true);
+        bool isValid = orderBook->validate();
+        capturedOutput.str("");
+
+        buyOrder->getParentLimit()->increaseVolume(1);
+        bool isVolumeValid = orderBook->validate();
+        buyOrder->getParentLimit()->decreaseVolume(1);
+        orderBook->getBuyTree()->getLeftChild()->setHeight(2);
+        bool isHeightValid = orderBook->validate();
+
+        // Restore the original std::cout buffer
+        std::cout.rdbuf(originalOutputBuffer);
+
+        CHECK(isValid);
+        CHECK_FALSE(isVolumeValid);
+        CHECK_FALSE(isHeightValid);
+        CHECK(capturedOutput.str() == "Limit size or volume does not match its orders.\n"
+                                      "AVL tree height is wrong.\n");
+    }
+}